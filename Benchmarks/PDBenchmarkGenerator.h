@@ -0,0 +1,66 @@
+//
+// PDBenchmarkGenerator.h
+//
+// Copyright (c) 2015 Daniel Hall
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+
+#import <Foundation/Foundation.h>
+
+/** The shapes of document the generator can produce */
+typedef NS_ENUM(NSUInteger, PDBenchmarkShape)
+{
+    /** One element with thousands of differently named children */
+    PDBenchmarkShapeWide,
+    /** Many chains of elements nested dozens of levels deep */
+    PDBenchmarkShapeDeep,
+    /** A long array of small, similar records, like a database export */
+    PDBenchmarkShapeRecords
+};
+
+typedef NS_ENUM(NSUInteger, PDBenchmarkFormat)
+{
+    PDBenchmarkFormatJSON,
+    PDBenchmarkFormatXML
+};
+
+/** Generates JSON and XML documents for the benchmarks.  Documents are built from a fixed-seed pseudorandom sequence, so the same shape, format and length always produce exactly the same bytes, on every machine */
+
+@interface PDBenchmarkGenerator : NSObject
+
+/** Returns a document of roughly the requested length.  It is complete and well-formed, and ends with the first record that takes it past the length
+* @param shape The shape of the document
+* @param format JSON or XML.  The JSON and XML documents for a shape hold the same elements and attributes
+* @param length The length in bytes to aim for
+*/
++ (NSData *)documentWithShape:(PDBenchmarkShape)shape format:(PDBenchmarkFormat)format length:(NSUInteger)length;
+
+/** A short name for a shape, used in benchmark names */
++ (NSString *)nameOfShape:(PDBenchmarkShape)shape;
+
+/** A mix of XPath queries that find elements in documents of a shape: name steps, // steps, wildcards and predicates */
++ (NSArray *)queriesForShape:(PDBenchmarkShape)shape;
+
+/** The name of the elements that are added and removed by the mutation benchmarks, and the XPath that finds their parent */
++ (NSString *)mutableElementNameForShape:(PDBenchmarkShape)shape;
++ (NSString *)mutableParentQueryForShape:(PDBenchmarkShape)shape;
+
+@end
@@ -0,0 +1,216 @@
+//
+// PDBenchmarkGenerator.m
+//
+// Copyright (c) 2015 Daniel Hall
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+
+#import "PDBenchmarkGenerator.h"
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+
+/** The depth of each chain in deep documents, well inside the parsers' nesting limit */
+static const NSUInteger PDBenchmarkDeepChainDepth = 48;
+
+static const char *PDBenchmarkStatuses[] = { "open", "closed", "pending", "archived" };
+static const char *PDBenchmarkWords[] = { "alpha", "bravo", "charlie", "delta", "echo", "foxtrot", "golf", "hotel", "india", "juliet", "kilo", "lima" };
+
+
+/** xorshift64*, so that documents don't depend on the platform's random number generator */
+typedef struct
+{
+    uint64_t state;
+} PDBenchmarkRandom;
+
+static uint64_t PDBenchmarkRandomNext(PDBenchmarkRandom *random)
+{
+    random->state ^= random->state >> 12;
+    random->state ^= random->state << 25;
+    random->state ^= random->state >> 27;
+    return random->state * 2685821657736338717ULL;
+}
+
+static NSUInteger PDBenchmarkRandomBelow(PDBenchmarkRandom *random, NSUInteger limit)
+{
+    return (NSUInteger)(PDBenchmarkRandomNext(random) % limit);
+}
+
+static void PDBenchmarkAppend(NSMutableData *data, const char *format, ...) __attribute__((format(printf, 2, 3)));
+
+static void PDBenchmarkAppend(NSMutableData *data, const char *format, ...)
+{
+    char buffer[512];
+    va_list arguments;
+    va_start(arguments, format);
+    int length = vsnprintf(buffer, sizeof(buffer), format, arguments);
+    va_end(arguments);
+
+    [data appendBytes:buffer length:(NSUInteger)MIN(length, (int)sizeof(buffer) - 1)];
+}
+
+
+@implementation PDBenchmarkGenerator
+
++ (NSData *)documentWithShape:(PDBenchmarkShape)shape format:(PDBenchmarkFormat)format length:(NSUInteger)length
+{
+    PDBenchmarkRandom random = { 0x50524553544F4441ULL };
+    NSMutableData *data = [NSMutableData dataWithCapacity:length + 1024];
+    BOOL json = format == PDBenchmarkFormatJSON;
+
+    switch (shape)
+    {
+        case PDBenchmarkShapeWide:
+        {
+            PDBenchmarkAppend(data, json ? "{\"wide\":{" : "<wide>");
+            for (NSUInteger i = 0; i == 0 || data.length < length; i++)
+            {
+                const char *word = PDBenchmarkWords[PDBenchmarkRandomBelow(&random, 12)];
+                NSUInteger number = PDBenchmarkRandomBelow(&random, 100000);
+                if (json)
+                {
+                    PDBenchmarkAppend(data, "%s\"field%lu\":{\"value\":\"v%lu\",\"word\":\"%s\",\"innerValue\":\"%s %lu\"}", i ? "," : "", (unsigned long)i, (unsigned long)(i % 10), word, word, (unsigned long)number);
+                }
+                else
+                {
+                    PDBenchmarkAppend(data, "<field%lu value=\"v%lu\" word=\"%s\">%s %lu</field%lu>", (unsigned long)i, (unsigned long)(i % 10), word, word, (unsigned long)number, (unsigned long)i);
+                }
+            }
+            PDBenchmarkAppend(data, json ? "}}" : "</wide>");
+            break;
+        }
+
+        case PDBenchmarkShapeDeep:
+        {
+            PDBenchmarkAppend(data, json ? "{\"deep\":{\"chain\":[" : "<deep>");
+            for (NSUInteger i = 0; i == 0 || data.length < length; i++)
+            {
+                if (json)
+                {
+                    PDBenchmarkAppend(data, "%s{\"id\":%lu", i ? "," : "", (unsigned long)i);
+                }
+                else
+                {
+                    PDBenchmarkAppend(data, "<chain id=\"%lu\">", (unsigned long)i);
+                }
+                for (NSUInteger depth = 0; depth < PDBenchmarkDeepChainDepth; depth++)
+                {
+                    const char *word = PDBenchmarkWords[PDBenchmarkRandomBelow(&random, 12)];
+                    PDBenchmarkAppend(data, json ? ",\"level\":{\"depth\":\"%lu\",\"word\":\"%s\"" : "<level depth=\"%lu\" word=\"%s\">", (unsigned long)depth, word);
+                }
+                for (NSUInteger depth = 0; depth < PDBenchmarkDeepChainDepth; depth++)
+                {
+                    PDBenchmarkAppend(data, json ? "}" : "</level>");
+                }
+                PDBenchmarkAppend(data, json ? "}" : "</chain>");
+            }
+            PDBenchmarkAppend(data, json ? "]}}" : "</deep>");
+            break;
+        }
+
+        case PDBenchmarkShapeRecords:
+        {
+            PDBenchmarkAppend(data, json ? "{\"dataset\":{\"name\":\"records\",\"record\":[" : "<dataset name=\"records\">");
+            for (NSUInteger i = 0; i == 0 || data.length < length; i++)
+            {
+                const char *status = PDBenchmarkStatuses[PDBenchmarkRandomBelow(&random, 4)];
+                NSUInteger owner = PDBenchmarkRandomBelow(&random, 500);
+                double score = (double)PDBenchmarkRandomBelow(&random, 10000) / 100.0;
+                const char *firstTag = PDBenchmarkWords[PDBenchmarkRandomBelow(&random, 12)];
+                const char *secondTag = PDBenchmarkWords[PDBenchmarkRandomBelow(&random, 12)];
+                if (json)
+                {
+                    PDBenchmarkAppend(data, "%s{\"id\":%lu,\"status\":\"%s\",\"owner\":\"user%lu\",\"score\":%.2f,\"tag\":[\"%s\",\"%s\"],\"note\":{\"innerValue\":\"Record %lu of owner %lu\"}}", i ? "," : "", (unsigned long)i, status, (unsigned long)owner, score, firstTag, secondTag, (unsigned long)i, (unsigned long)owner);
+                }
+                else
+                {
+                    PDBenchmarkAppend(data, "<record id=\"%lu\" status=\"%s\" owner=\"user%lu\" score=\"%.2f\"><tag>%s</tag><tag>%s</tag><note>Record %lu of owner %lu</note></record>", (unsigned long)i, status, (unsigned long)owner, score, firstTag, secondTag, (unsigned long)i, (unsigned long)owner);
+                }
+            }
+            PDBenchmarkAppend(data, json ? "]}}" : "</dataset>");
+            break;
+        }
+    }
+
+    return data;
+}
+
++ (NSString *)nameOfShape:(PDBenchmarkShape)shape
+{
+    switch (shape)
+    {
+        case PDBenchmarkShapeWide:
+            return @"wide";
+        case PDBenchmarkShapeDeep:
+            return @"deep";
+        case PDBenchmarkShapeRecords:
+            return @"records";
+    }
+
+    return nil;
+}
+
++ (NSArray *)queriesForShape:(PDBenchmarkShape)shape
+{
+    switch (shape)
+    {
+        case PDBenchmarkShapeWide:
+            return @[@"/wide/field7", @"/wide/*[@value='v3']", @"//field1*", @"/wide/*[last()]"];
+        case PDBenchmarkShapeDeep:
+            return @[@"//level[@depth='40']", @"/deep/chain/level/level/level", @"//chain[@id='3']//level[@word='echo']", @"/deep/chain[last()]"];
+        case PDBenchmarkShapeRecords:
+            return @[@"//record[@status='open']", @"/dataset/record[position() < 10]/note", @"//tag", @"/dataset/record[@score > 50 and @owner='user7']", @"/dataset/record[last()]"];
+    }
+
+    return nil;
+}
+
++ (NSString *)mutableElementNameForShape:(PDBenchmarkShape)shape
+{
+    switch (shape)
+    {
+        case PDBenchmarkShapeWide:
+            return @"field0";
+        case PDBenchmarkShapeDeep:
+            return @"level";
+        case PDBenchmarkShapeRecords:
+            return @"record";
+    }
+
+    return nil;
+}
+
++ (NSString *)mutableParentQueryForShape:(PDBenchmarkShape)shape
+{
+    switch (shape)
+    {
+        case PDBenchmarkShapeWide:
+            return @"/wide";
+        case PDBenchmarkShapeDeep:
+            return @"/deep/chain[1]/level/level";
+        case PDBenchmarkShapeRecords:
+            return @"/dataset";
+    }
+
+    return nil;
+}
+
+@end
@@ -0,0 +1,64 @@
+//
+// PDBenchmarkRunner.h
+//
+// Copyright (c) 2015 Daniel Hall
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+
+#import <Foundation/Foundation.h>
+
+/** Times benchmarks, collects their results and compares them with a baseline from an earlier run.
+*
+* Each benchmark runs once untimed to warm up, and then the requested number of timed iterations.  The results record the mean and the 50th, 90th and 99th percentile latency of one iteration, throughput in operations and megabytes per second, and how far the resident set size of the process grew above its size before the benchmark started.  Memory that earlier benchmarks freed but the allocator kept can hide some of that growth
+*/
+
+@interface PDBenchmarkRunner : NSObject
+
+/** When set, only benchmarks whose names contain this string are run */
+@property (nonatomic, copy) NSString *filter;
+
+/** The results of the benchmarks run so far, as dictionaries in the order they were run */
+@property (nonatomic, readonly) NSArray *results;
+
+/** Times a benchmark and records its results
+* @param name The benchmark's name, which is unique within a run and is how results are matched with the baseline
+* @param bytes The number of bytes of document each iteration processes, used for throughput.  Pass 0 when throughput in bytes means nothing for the benchmark
+* @param iterations The number of timed iterations
+* @param setup An optional block run untimed before each iteration.  Whatever it returns is passed to the timed block
+* @param block The work to time
+*/
+- (void)measure:(NSString *)name bytes:(NSUInteger)bytes iterations:(NSUInteger)iterations setup:(id (^)(void))setup block:(void (^)(id input))block;
+
+/** Writes the results as JSON, in the format regressionsAgainstBaselineAtPath:threshold: reads
+* @param path The path of the file to write
+* @param error On failure, the reason the file couldn't be written
+* @return YES if the file was written, otherwise NO
+*/
+- (BOOL)writeResultsToFile:(NSString *)path error:(NSError **)error;
+
+/** Compares the median latency of every benchmark with the same benchmark in a results file from an earlier run.  Benchmarks that aren't in both are ignored
+* @param path The path of the baseline results file
+* @param threshold How much slower a benchmark can be before it counts as a regression, as a fraction: 0.1 allows 10%
+* @return A description of each regression, or nil if the baseline couldn't be read
+*/
+- (NSArray *)regressionsAgainstBaselineAtPath:(NSString *)path threshold:(double)threshold;
+
+@end
@@ -0,0 +1,201 @@
+//
+// PDBenchmarkRunner.m
+//
+// Copyright (c) 2015 Daniel Hall
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+
+#import "PDBenchmarkRunner.h"
+#include <stdio.h>
+#include <time.h>
+#include <unistd.h>
+#ifdef __APPLE__
+#include <mach/mach.h>
+#endif
+
+static uint64_t PDBenchmarkNanoseconds(void)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec * 1000000000ULL + (uint64_t)now.tv_nsec;
+}
+
+/** The resident set size of the process right now, in bytes, or 0 if it can't be read.  Unlike ru_maxrss, which only ever grows over the life of the process, this can be sampled around a single benchmark */
+static uint64_t PDBenchmarkResidentBytes(void)
+{
+#ifdef __APPLE__
+    struct mach_task_basic_info info;
+    mach_msg_type_number_t count = MACH_TASK_BASIC_INFO_COUNT;
+    if (task_info(mach_task_self(), MACH_TASK_BASIC_INFO, (task_info_t)&info, &count) != KERN_SUCCESS)
+    {
+        return 0;
+    }
+    return (uint64_t)info.resident_size;
+#else
+    // The second field is the resident size in pages
+    FILE *file = fopen("/proc/self/statm", "r");
+    if (!file)
+    {
+        return 0;
+    }
+    unsigned long long size = 0;
+    unsigned long long resident = 0;
+    int fields = fscanf(file, "%llu %llu", &size, &resident);
+    fclose(file);
+    return fields == 2 ? (uint64_t)resident * (uint64_t)sysconf(_SC_PAGESIZE) : 0;
+#endif
+}
+
+static int PDBenchmarkCompareDurations(const void *first, const void *second)
+{
+    uint64_t a = *(const uint64_t *)first;
+    uint64_t b = *(const uint64_t *)second;
+    return a < b ? -1 : (a > b ? 1 : 0);
+}
+
+/** Returns a percentile of sorted durations, using the nearest rank */
+static double PDBenchmarkPercentile(const uint64_t *sorted, NSUInteger count, double percentile)
+{
+    NSUInteger rank = (NSUInteger)ceil(percentile / 100.0 * (double)count);
+    return (double)sorted[rank > 0 ? rank - 1 : 0];
+}
+
+
+@implementation PDBenchmarkRunner
+{
+    NSMutableArray *_results;
+}
+
+- (instancetype)init
+{
+    self = [super init];
+    if (self) {
+        _results = [NSMutableArray array];
+    }
+    return self;
+}
+
+- (NSArray *)results
+{
+    return [_results copy];
+}
+
+- (void)measure:(NSString *)name bytes:(NSUInteger)bytes iterations:(NSUInteger)iterations setup:(id (^)(void))setup block:(void (^)(id input))block
+{
+    if (self.filter.length && [name rangeOfString:self.filter].location == NSNotFound)
+    {
+        return;
+    }
+
+    iterations = MAX(iterations, 1);
+    uint64_t *durations = malloc(iterations * sizeof(uint64_t));
+
+    // Resident size is sampled after the warm up and after every iteration, while the input and anything autoreleased are still alive, but outside the timed region
+    uint64_t residentBefore = PDBenchmarkResidentBytes();
+    uint64_t residentPeak = residentBefore;
+
+    @autoreleasepool
+    {
+        block(setup ? setup() : nil);
+        residentPeak = MAX(residentPeak, PDBenchmarkResidentBytes());
+    }
+
+    uint64_t total = 0;
+    for (NSUInteger i = 0; i < iterations; i++)
+    {
+        // Inputs and anything the block autoreleases are released outside the timed region
+        @autoreleasepool
+        {
+            id input = setup ? setup() : nil;
+            uint64_t start = PDBenchmarkNanoseconds();
+            @autoreleasepool
+            {
+                block(input);
+            }
+            durations[i] = PDBenchmarkNanoseconds() - start;
+            total += durations[i];
+            residentPeak = MAX(residentPeak, PDBenchmarkResidentBytes());
+        }
+    }
+
+    qsort(durations, iterations, sizeof(uint64_t), PDBenchmarkCompareDurations);
+
+    double mean = (double)total / (double)iterations;
+    NSMutableDictionary *result = [NSMutableDictionary dictionary];
+    result[@"name"] = name;
+    result[@"iterations"] = @(iterations);
+    result[@"bytes"] = @(bytes);
+    result[@"meanNanoseconds"] = @(mean);
+    result[@"p50Nanoseconds"] = @(PDBenchmarkPercentile(durations, iterations, 50));
+    result[@"p90Nanoseconds"] = @(PDBenchmarkPercentile(durations, iterations, 90));
+    result[@"p99Nanoseconds"] = @(PDBenchmarkPercentile(durations, iterations, 99));
+    result[@"operationsPerSecond"] = @(mean > 0 ? 1e9 / mean : 0);
+    result[@"megabytesPerSecond"] = @(bytes && mean > 0 ? (double)bytes / (1024.0 * 1024.0) / (mean / 1e9) : 0);
+    result[@"residentBytesBefore"] = @(residentBefore);
+    result[@"residentGrowthBytes"] = @(residentPeak - residentBefore);
+    [_results addObject:result];
+
+    free(durations);
+
+    fprintf(stdout, "%-48s %8lu iter  p50 %12.3f us  p90 %12.3f us  p99 %12.3f us  %10.2f MB/s  rss +%8.1f MB\n", name.UTF8String, (unsigned long)iterations, [result[@"p50Nanoseconds"] doubleValue] / 1e3, [result[@"p90Nanoseconds"] doubleValue] / 1e3, [result[@"p99Nanoseconds"] doubleValue] / 1e3, [result[@"megabytesPerSecond"] doubleValue], [result[@"residentGrowthBytes"] doubleValue] / (1024.0 * 1024.0));
+    fflush(stdout);
+}
+
+- (BOOL)writeResultsToFile:(NSString *)path error:(NSError **)error
+{
+    NSDictionary *document = @{ @"benchmarks" : _results, @"processorCount" : @([NSProcessInfo processInfo].activeProcessorCount) };
+    NSData *data = [NSJSONSerialization dataWithJSONObject:document options:NSJSONWritingPrettyPrinted error:error];
+    return data && [data writeToFile:path options:NSDataWritingAtomic error:error];
+}
+
+- (NSArray *)regressionsAgainstBaselineAtPath:(NSString *)path threshold:(double)threshold
+{
+    NSData *data = [NSData dataWithContentsOfFile:path];
+    NSDictionary *baseline = data ? [NSJSONSerialization JSONObjectWithData:data options:0 error:nil] : nil;
+    if (![baseline isKindOfClass:[NSDictionary class]] || ![baseline[@"benchmarks"] isKindOfClass:[NSArray class]])
+    {
+        return nil;
+    }
+
+    NSMutableDictionary *baselineMedians = [NSMutableDictionary dictionary];
+    for (NSDictionary *result in baseline[@"benchmarks"])
+    {
+        if ([result isKindOfClass:[NSDictionary class]] && result[@"name"] && result[@"p50Nanoseconds"])
+        {
+            baselineMedians[result[@"name"]] = result[@"p50Nanoseconds"];
+        }
+    }
+
+    NSMutableArray *regressions = [NSMutableArray array];
+    for (NSDictionary *result in _results)
+    {
+        double before = [baselineMedians[result[@"name"]] doubleValue];
+        double after = [result[@"p50Nanoseconds"] doubleValue];
+        if (before > 0 && after > before * (1.0 + threshold))
+        {
+            [regressions addObject:[NSString stringWithFormat:@"%@: median %.3f us, baseline %.3f us (+%.1f%%)", result[@"name"], after / 1e3, before / 1e3, (after / before - 1.0) * 100.0]];
+        }
+    }
+
+    return regressions;
+}
+
+@end
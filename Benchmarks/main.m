@@ -0,0 +1,285 @@
+//
+// main.m
+//
+// Copyright (c) 2015 Daniel Hall
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+
+#import <Foundation/Foundation.h>
+#import "PrestoData.h"
+#import "PDBenchmarkGenerator.h"
+#import "PDBenchmarkRunner.h"
+
+/** Parses a size such as 512, 64KB, 16MB or 1GB into bytes, or returns 0 if it isn't one */
+static NSUInteger PDBenchmarkParseSize(NSString *string)
+{
+    NSString *upper = [[string stringByTrimmingCharactersInSet:[NSCharacterSet whitespaceCharacterSet]] uppercaseString];
+    NSUInteger multiplier = 1;
+    NSDictionary *suffixes = @{ @"KB" : @(1024), @"MB" : @(1024 * 1024), @"GB" : @(1024 * 1024 * 1024) };
+    for (NSString *suffix in suffixes)
+    {
+        if ([upper hasSuffix:suffix])
+        {
+            multiplier = [suffixes[suffix] unsignedIntegerValue];
+            upper = [upper substringToIndex:upper.length - suffix.length];
+            break;
+        }
+    }
+
+    return (NSUInteger)MAX(upper.longLongValue, 0) * multiplier;
+}
+
+static NSString *PDBenchmarkSizeName(NSUInteger size)
+{
+    if (size >= 1024 * 1024 && size % (1024 * 1024) == 0)
+    {
+        return [NSString stringWithFormat:@"%luMB", (unsigned long)(size / (1024 * 1024))];
+    }
+    if (size >= 1024 && size % 1024 == 0)
+    {
+        return [NSString stringWithFormat:@"%luKB", (unsigned long)(size / 1024)];
+    }
+    return [NSString stringWithFormat:@"%luB", (unsigned long)size];
+}
+
+/** Scales iterations down as documents grow, so every size takes a similar time: about 64MB of document per benchmark, but never fewer than 3 iterations */
+static NSUInteger PDBenchmarkIterations(NSUInteger size, NSUInteger requested)
+{
+    if (requested)
+    {
+        return requested;
+    }
+    return MAX(3, MIN(1000, (64 * 1024 * 1024) / MAX(size, 1)));
+}
+
+static NSMutableDictionary *PDBenchmarkParse(NSData *data, PDBenchmarkFormat format)
+{
+    return format == PDBenchmarkFormatJSON ? [NSMutableDictionary pd_dictionaryFromJSONData:data] : [NSMutableDictionary pd_dictionaryFromXMLData:data];
+}
+
+static void PDBenchmarkRunDocument(PDBenchmarkRunner *runner, PDBenchmarkShape shape, PDBenchmarkFormat format, NSUInteger size, NSUInteger requestedIterations)
+{
+    NSData *data = [PDBenchmarkGenerator documentWithShape:shape format:format length:size];
+    NSString *prefix = [NSString stringWithFormat:@"%@/%@/%@", [PDBenchmarkGenerator nameOfShape:shape], format == PDBenchmarkFormatJSON ? @"json" : @"xml", PDBenchmarkSizeName(size)];
+    NSUInteger iterations = PDBenchmarkIterations(data.length, requestedIterations);
+    NSUInteger bytes = data.length;
+
+    [runner measure:[prefix stringByAppendingString:@"/parse"] bytes:bytes iterations:iterations setup:nil block:^(id input) {
+        PDBenchmarkParse(data, format);
+    }];
+
+    NSMutableDictionary *document = PDBenchmarkParse(data, format);
+    if (!document)
+    {
+        fprintf(stderr, "%s: the generated document didn't parse\n", prefix.UTF8String);
+        return;
+    }
+
+    NSArray *queries = [PDBenchmarkGenerator queriesForShape:shape];
+    [runner measure:[prefix stringByAppendingString:@"/xpath-mix"] bytes:bytes iterations:iterations setup:nil block:^(id input) {
+        for (NSString *query in queries)
+        {
+            [document pd_filterWithXPath:query];
+        }
+    }];
+    [runner measure:[prefix stringByAppendingString:@"/xpath-mix-concurrent"] bytes:bytes iterations:iterations setup:nil block:^(id input) {
+        for (NSString *query in queries)
+        {
+            [document pd_filterWithXPath:query options:PDXPathOptionsConcurrent];
+        }
+    }];
+
+    // Every mutation works on its own copy, made untimed, so that each iteration starts from the same document
+    NSString *parentQuery = [PDBenchmarkGenerator mutableParentQueryForShape:shape];
+    NSString *childName = [PDBenchmarkGenerator mutableElementNameForShape:shape];
+    NSMutableDictionary *(^parentOfCopy)(void) = ^NSMutableDictionary *{
+        return [[[document pd_copy] pd_filterWithXPath:parentQuery] firstObject];
+    };
+    NSUInteger mutationIterations = MIN(iterations, 100);
+
+    [runner measure:[prefix stringByAppendingString:@"/mutate/setValueForAttribute"] bytes:0 iterations:mutationIterations setup:parentOfCopy block:^(NSMutableDictionary *parent) {
+        [parent pd_setValue:@"benchmark" forAttribute:@"mutated"];
+    }];
+    [runner measure:[prefix stringByAppendingString:@"/mutate/deleteAttribute"] bytes:0 iterations:mutationIterations setup:^id{
+        return [parentOfCopy() pd_setValue:@"benchmark" forAttribute:@"mutated"];
+    } block:^(NSMutableDictionary *parent) {
+        [parent pd_deleteAttribute:@"mutated"];
+    }];
+    [runner measure:[prefix stringByAppendingString:@"/mutate/setInnerValue"] bytes:0 iterations:mutationIterations setup:parentOfCopy block:^(NSMutableDictionary *parent) {
+        [parent pd_setInnerValue:@"benchmark"];
+    }];
+    [runner measure:[prefix stringByAppendingString:@"/mutate/addElement"] bytes:0 iterations:mutationIterations setup:parentOfCopy block:^(NSMutableDictionary *parent) {
+        [parent pd_addElement:[NSMutableDictionary dictionaryWithObject:@"benchmark" forKey:@"mutated"] withName:childName];
+    }];
+    [runner measure:[prefix stringByAppendingString:@"/mutate/removeElement"] bytes:0 iterations:mutationIterations setup:^id{
+        NSMutableDictionary *parent = parentOfCopy();
+        NSMutableDictionary *child = [parent pd_childrenNamed:childName].lastObject;
+        return child ? @[parent, child] : nil;
+    } block:^(NSArray *parentAndChild) {
+        [parentAndChild.firstObject pd_removeElement:parentAndChild.lastObject];
+    }];
+    [runner measure:[prefix stringByAppendingString:@"/mutate/removeElementNamed"] bytes:0 iterations:mutationIterations setup:parentOfCopy block:^(NSMutableDictionary *parent) {
+        [parent pd_removeElementNamed:childName];
+    }];
+    [runner measure:[prefix stringByAppendingString:@"/mutate/removeFromParentDictionary"] bytes:0 iterations:mutationIterations setup:^id{
+        return [parentOfCopy() pd_childrenNamed:childName].firstObject;
+    } block:^(NSMutableDictionary *child) {
+        [child pd_removeFromParentDictionary];
+    }];
+
+    [runner measure:[prefix stringByAppendingString:@"/copy"] bytes:bytes iterations:iterations setup:nil block:^(id input) {
+        [document pd_copy];
+    }];
+    [runner measure:[prefix stringByAppendingString:@"/copy-and-touch"] bytes:bytes iterations:iterations setup:nil block:^(id input) {
+        [[document pd_copy] pd_filterWithXPath:@"//*"];
+    }];
+
+    NSMutableDictionary *other = PDBenchmarkParse(data, format);
+    [runner measure:[prefix stringByAppendingString:@"/isEqualToDictionary"] bytes:bytes iterations:iterations setup:nil block:^(id input) {
+        [document pd_isEqualToDictionary:other];
+    }];
+
+    [runner measure:[prefix stringByAppendingString:@"/write-json"] bytes:bytes iterations:iterations setup:nil block:^(id input) {
+        [document pd_jsonDataWithOptions:PDWritingOptionsNone];
+    }];
+    [runner measure:[prefix stringByAppendingString:@"/write-xml"] bytes:bytes iterations:iterations setup:nil block:^(id input) {
+        [document pd_xmlDataWithOptions:PDWritingOptionsNone];
+    }];
+}
+
+static void PDBenchmarkPrintUsage(void)
+{
+    fprintf(stderr,
+            "usage: PrestoDataBenchmarks [options]\n"
+            "  --sizes LIST       comma separated document sizes (default 1KB,64KB,1MB,16MB)\n"
+            "  --iterations N     timed iterations per benchmark (default scales with size)\n"
+            "  --filter TEXT      only run benchmarks whose names contain TEXT\n"
+            "  --output PATH      write results as JSON to PATH\n"
+            "  --baseline PATH    compare median latency with an earlier results file\n"
+            "  --threshold PCT    slowdown that counts as a regression (default 10)\n");
+}
+
+int main(int argc, const char *argv[])
+{
+    @autoreleasepool
+    {
+        NSArray *arguments = [NSProcessInfo processInfo].arguments;
+        NSString *sizes = @"1KB,64KB,1MB,16MB";
+        NSString *outputPath = nil;
+        NSString *baselinePath = nil;
+        NSUInteger iterations = 0;
+        double threshold = 0.1;
+        PDBenchmarkRunner *runner = [[PDBenchmarkRunner alloc] init];
+
+        for (NSUInteger i = 1; i < arguments.count; i++)
+        {
+            NSString *argument = arguments[i];
+            NSString *value = i + 1 < arguments.count ? arguments[i + 1] : nil;
+            if ([argument isEqualToString:@"--help"] || !value)
+            {
+                PDBenchmarkPrintUsage();
+                return [argument isEqualToString:@"--help"] ? 0 : 2;
+            }
+
+            if ([argument isEqualToString:@"--sizes"])
+            {
+                sizes = value;
+            }
+            else if ([argument isEqualToString:@"--iterations"])
+            {
+                iterations = (NSUInteger)MAX(value.integerValue, 0);
+            }
+            else if ([argument isEqualToString:@"--filter"])
+            {
+                runner.filter = value;
+            }
+            else if ([argument isEqualToString:@"--output"])
+            {
+                outputPath = value;
+            }
+            else if ([argument isEqualToString:@"--baseline"])
+            {
+                baselinePath = value;
+            }
+            else if ([argument isEqualToString:@"--threshold"])
+            {
+                threshold = value.doubleValue / 100.0;
+            }
+            else
+            {
+                PDBenchmarkPrintUsage();
+                return 2;
+            }
+            i++;
+        }
+
+        for (NSString *sizeString in [sizes componentsSeparatedByString:@","])
+        {
+            NSUInteger size = PDBenchmarkParseSize(sizeString);
+            if (!size)
+            {
+                fprintf(stderr, "invalid size: %s\n", sizeString.UTF8String);
+                return 2;
+            }
+
+            for (PDBenchmarkShape shape = PDBenchmarkShapeWide; shape <= PDBenchmarkShapeRecords; shape++)
+            {
+                for (PDBenchmarkFormat format = PDBenchmarkFormatJSON; format <= PDBenchmarkFormatXML; format++)
+                {
+                    @autoreleasepool
+                    {
+                        PDBenchmarkRunDocument(runner, shape, format, size, iterations);
+                    }
+                }
+            }
+        }
+
+        if (outputPath)
+        {
+            NSError *error = nil;
+            if (![runner writeResultsToFile:outputPath error:&error])
+            {
+                fprintf(stderr, "couldn't write %s: %s\n", outputPath.UTF8String, error.localizedDescription.UTF8String);
+                return 2;
+            }
+        }
+
+        if (baselinePath)
+        {
+            NSArray *regressions = [runner regressionsAgainstBaselineAtPath:baselinePath threshold:threshold];
+            if (!regressions)
+            {
+                fprintf(stderr, "couldn't read the baseline %s\n", baselinePath.UTF8String);
+                return 2;
+            }
+            for (NSString *regression in regressions)
+            {
+                fprintf(stderr, "regression: %s\n", regression.UTF8String);
+            }
+            if (regressions.count)
+            {
+                return 1;
+            }
+        }
+    }
+
+    return 0;
+}
@@ -22,6 +22,7 @@
 // SOFTWARE.
 
 #import <Foundation/Foundation.h>
+#import "PDOptions.h"
 
 /** A category containing all the methods used by Presto Data for searching, parsing, and modifying array elements */
 
@@ -39,10 +40,18 @@
 
 /** A copy method that produces deep copies specifically used to copy NSArrays that contain PrestoData dictionaries.  Use instead of the normal [NSObject copy] method
 *
+* Each dictionary is copied with pd_copy, so PDNodes in the array are copied on write
+*
 * @return A deep copy of this array containing copies of its contents instead of pointers to the original contents
 */
 - (instancetype)pd_copy;
 
+/** Freezes every dictionary in this array, as pd_freeze on NSMutableDictionary does, so that the array and its elements can be shared between threads
+*
+* @return An immutable array of the frozen dictionaries, in the same order, to use in place of this array
+*/
+- (NSArray *)pd_freeze;
+
 
 /**---------------------------------------------------------------------------------------
 * @name Creating an Array from JSON
@@ -65,6 +74,21 @@
 */
 + (instancetype)pd_arrayFromJSONData:(NSData *)jsonData keyForInnerValue:(NSString *)key;
 
+/** Returns an NSArray from UTF8-encoded JSON data using the default attribute name for inner values, with options
+*
+* @param jsonData An NSData instance that contains a UTF8-encoded JSON string
+* @param options Options for parsing.  PDParsingOptionsConcurrent parses arrays of more than a few hundred kilobytes on all available cores, PDParsingOptionsLazy fills in each dictionary only when it is first used, and PDParsingOptionsPreserveSource writes dictionaries that haven't changed by copying the bytes they were parsed from
+* @return An NSArray instance if the JSON represented an array, otherwise nil
+*/
++ (instancetype)pd_arrayFromJSONData:(NSData *)jsonData options:(PDParsingOptions)options;
+
+/** Returns a PrestoData array from a file written by pd_writeBinarySnapshotToFile:error:.  The file is memory-mapped and nothing is parsed: each element reads its keys and values from the file the first time it is used, so loading takes the same short time whatever the size of the file
+*
+* @param path The path of the snapshot file
+* @return An NSArray instance if the file is a snapshot of an array, otherwise nil
+*/
++ (instancetype)pd_arrayFromBinarySnapshotAtPath:(NSString *)path;
+
 
 /**---------------------------------------------------------------------------------------
 * @name Changing Element Attributes
@@ -125,7 +149,7 @@
 */
 - (instancetype)pd_removeElement:(NSMutableDictionary *)element;
 
-/** Removes this array from the dictionary it is a child element of */
+/** Removes each dictionary in this array from the dictionary it is a child element of.  This can be called on the array a parent stores for its same-named elements */
 - (void)pd_removeFromParentDictionary;
 
 
@@ -142,6 +166,14 @@
 */
 - (NSArray *)pd_filterWithXPath:(NSString *)xPathString;
 
+/** Returns an array of all child or descendant elements inside this array which match the specified XPath query, with options
+*
+* @param xPathString A string containing an XPath 1.0-style query
+* @param options Options for evaluation.  PDXPathOptionsConcurrent evaluates queries over tens of thousands of elements on all available cores, with the same results as serial evaluation
+* @return The array of matching elements
+*/
+- (NSArray *)pd_filterWithXPath:(NSString *)xPathString options:(PDXPathOptions)options;
+
 /** Returns all child elements inside this array which have the specified name.  Primarily used in XPath operations
 *
 * @param name The element name to search this array for
@@ -182,5 +214,73 @@
 */
 - (NSString *)pd_xmlString;
 
+/** Writes a JSON representation of this array and the elements inside it to an output stream in a single pass, using the default key name for any inner values
+*
+* @param stream An open output stream.  The stream is not closed when writing finishes
+* @param options PDWritingOptionsCompact for output without line breaks or indentation, otherwise PDWritingOptionsNone
+* @param error If writing fails, set to an error in PrestoDataErrorDomain describing the failure
+* @return YES if all output was written, otherwise NO
+*/
+- (BOOL)pd_writeJSONToStream:(NSOutputStream *)stream options:(PDWritingOptions)options error:(NSError **)error;
+
+/** Writes a JSON representation of this array and the elements inside it to an output stream in a single pass, using the specified key name for any inner values
+*
+* @param stream An open output stream.  The stream is not closed when writing finishes
+* @param keyForInnerValue The key name that will be used to map any inner values to JSON attributes
+* @param options PDWritingOptionsCompact for output without line breaks or indentation, otherwise PDWritingOptionsNone
+* @param error If writing fails, set to an error in PrestoDataErrorDomain describing the failure
+* @return YES if all output was written, otherwise NO
+*/
+- (BOOL)pd_writeJSONToStream:(NSOutputStream *)stream keyForInnerValue:(NSString *)keyForInnerValue options:(PDWritingOptions)options error:(NSError **)error;
+
+/** Writes an XML representation of this array and the elements inside it to an output stream in a single pass
+*
+* @param stream An open output stream.  The stream is not closed when writing finishes
+* @param options PDWritingOptionsCompact for output without line breaks or indentation, and PDWritingOptionsXMLDeclaration to begin with an XML declaration
+* @param error If writing fails, set to an error in PrestoDataErrorDomain describing the failure
+* @return YES if all output was written, otherwise NO
+*/
+- (BOOL)pd_writeXMLToStream:(NSOutputStream *)stream options:(PDWritingOptions)options error:(NSError **)error;
+
+/** Writes a JSON representation of this array and the elements inside it to a file descriptor, such as an open file or socket, using the default key name for any inner values
+*
+* @param fileDescriptor The file descriptor to write to.  It is not closed when writing finishes
+* @param options PDWritingOptionsCompact for output without line breaks or indentation, otherwise PDWritingOptionsNone
+* @param error If writing fails, set to an error in PrestoDataErrorDomain describing the failure
+* @return YES if all output was written, otherwise NO
+*/
+- (BOOL)pd_writeJSONToFileDescriptor:(int)fileDescriptor options:(PDWritingOptions)options error:(NSError **)error;
+
+/** Writes an XML representation of this array and the elements inside it to a file descriptor, such as an open file or socket
+*
+* @param fileDescriptor The file descriptor to write to.  It is not closed when writing finishes
+* @param options PDWritingOptionsCompact for output without line breaks or indentation, and PDWritingOptionsXMLDeclaration to begin with an XML declaration
+* @param error If writing fails, set to an error in PrestoDataErrorDomain describing the failure
+* @return YES if all output was written, otherwise NO
+*/
+- (BOOL)pd_writeXMLToFileDescriptor:(int)fileDescriptor options:(PDWritingOptions)options error:(NSError **)error;
+
+/** Returns UTF-8 encoded JSON data representing this array and the elements inside it, using the default key name for any inner values
+*
+* @param options PDWritingOptionsCompact for output without line breaks or indentation, otherwise PDWritingOptionsNone
+* @return The JSON data
+*/
+- (NSData *)pd_jsonDataWithOptions:(PDWritingOptions)options;
+
+/** Returns UTF-8 encoded XML data representing this array and the elements inside it
+*
+* @param options PDWritingOptionsCompact for output without line breaks or indentation, and PDWritingOptionsXMLDeclaration to begin with an XML declaration
+* @return The XML data
+*/
+- (NSData *)pd_xmlDataWithOptions:(PDWritingOptions)options;
+
+/** Writes this array to a file in PrestoData's binary snapshot format, which keeps the ordered keys, typed values, inner values and elements exactly and can be loaded again without parsing.  An existing file is replaced atomically
+*
+* @param path The path of the file to write
+* @param error If writing fails, set to an error in PrestoDataErrorDomain describing the failure
+* @return YES if the file was written, otherwise NO
+*/
+- (BOOL)pd_writeBinarySnapshotToFile:(NSString *)path error:(NSError **)error;
+
 
 @end
@@ -29,11 +29,24 @@
 #import "NSArray+_PrestoData_Internal.h"
 #import "NSArray+PrestoData.h"
 #import "PrestoData.h"
+#import "PDJSONParser.h"
+#import "PDXPathQuery.h"
+#import "PDNameMatcher.h"
+#import "PDWriter.h"
+#import "PDSnapshot.h"
+#import "PDNode+_PrestoData_Internal.h"
+#import "PDStats+_PrestoData_Internal.h"
 
 
 @implementation NSArray (PrestoData)
 
 
++ (instancetype)pd_arrayFromBinarySnapshotAtPath:(NSString *)path
+{
+    id object = [PDSnapshot objectFromSnapshotAtPath:path];
+    return [object isKindOfClass:[NSArray class]] ? object : nil;
+}
+
 + (instancetype)pd_arrayFromJSONData:(NSData *)jsonData
 {
     return [self pd_arrayFromJSONData:jsonData keyForInnerValue:defaultInnerValueKey];
@@ -47,19 +60,25 @@
         return nil;
     }
 
-    NSString *jsonString = [[NSString alloc] initWithData:jsonData encoding:NSUTF8StringEncoding];
-    NSArray *array = nil;
+    PDJSONParser *parser = [[PDJSONParser alloc] initWithJSONData:jsonData keyForInnerValue:key];
+    return [parser parsedArray];
+}
 
-    if ([jsonString pd_isJSONArrayValue]) {
++ (instancetype)pd_arrayFromJSONData:(NSData *)jsonData options:(PDParsingOptions)options
+{
+    if(jsonData == nil)
+    {
+        return nil;
+    }
 
-        array = [jsonString pd_extractJSONArrayValue];
+    PDJSONParser *parser = [[PDJSONParser alloc] initWithJSONData:jsonData keyForInnerValue:defaultInnerValueKey];
+    parser.preservesSource = (options & PDParsingOptionsPreserveSource) != 0;
 
-        for (NSMutableDictionary *dictionary in array) {
-            [dictionary pd_setParsedDictionaryPropertiesWithInnerValueKey:key];
-        }
+    if (options & PDParsingOptionsLazy)
+    {
+        return [parser lazilyParsedArray];
     }
-
-    return array;
+    return options & PDParsingOptionsConcurrent ? [parser parsedArrayConcurrently] : [parser parsedArray];
 }
 
 - (instancetype)pd_setValue:(id)value forAttribute:(NSString *)attribute
@@ -83,7 +102,8 @@
 
 - (void)pd_removeFromParentDictionary
 {
-    for (NSMutableDictionary *dictionary in self) {
+    // The receiver is often the parent's own array of these elements, which shrinks as they are removed
+    for (NSMutableDictionary *dictionary in [self copy]) {
         [dictionary pd_removeFromParentDictionary];
     }
 }
@@ -127,27 +147,14 @@
 - (NSArray *)pd_childrenNamed:(NSString *)name
 {
     NSMutableArray *children = [[NSMutableArray alloc] init];
-    for (NSMutableDictionary *child in self) {
-        NSArray *childChildren = [child pd_childrenNamed:name];
-        if (childChildren) {
-            [children addObjectsFromArray:childChildren];
-        }
-    }
-
+    [self pd_addChildrenMatching:[PDNameMatcher matcherWithPattern:name] toArray:children];
     return children.count > 0 ? children : nil;
 }
 
 - (NSArray *)pd_descendantsNamed:(NSString *)name
 {
     NSMutableArray *descendants = [[NSMutableArray alloc] init];
-
-    for (NSMutableDictionary *child in self) {
-        NSArray *childDescendants = [child pd_descendantsNamed:name];
-        if (childDescendants) {
-            [descendants addObjectsFromArray:childDescendants];
-        }
-    }
-
+    [self pd_addDescendantsMatching:[PDNameMatcher matcherWithPattern:name] toArray:descendants];
     return descendants.count > 0 ? descendants : nil;
 }
 
@@ -157,136 +164,41 @@
         return self;
     }
 
-    NSMutableArray *filteredResults = [[NSMutableArray alloc] init];
-    NSString *query = [xPathString stringByTrimmingCharactersInSet:[NSCharacterSet whitespaceAndNewlineCharacterSet]];
-
-    // Parse out grouped expressions from parentheses first
-
-    NSString *grouping = [query pd_extractInitialGroupingWithRemainder:&query];
-
-    if (grouping) {
-        return [[self pd_filterWithXPath:grouping] pd_filterWithXPath:query];
-    }
-
-    // If the first part of the XPath query is selecting a child or descendant, return that result filtered by the rest of the query
-
-    NSString *element = [query pd_extractFirstXPathDescendantWithRemainder:&query];
-
-    if (element) {
-        for (NSMutableDictionary *child in self) {
-            NSArray *results = [[child pd_descendantsNamed:element] pd_filterWithXPath:query];
-            if (results) {
-                [filteredResults addObjectsFromArray:results];
-            }
-        }
-        return filteredResults.count ? filteredResults : nil;
-    }
-
-    element = [query pd_extractFirstXPathChildWithRemainder:&query];
-
-    if (element)
-    {
-        for (NSMutableDictionary *child in self)
-        {
-            NSArray *results = [[child pd_childrenNamed:element] pd_filterWithXPath:query];
-            if (results)
-            {
-                [filteredResults addObjectsFromArray:results];
-            }
-        }
-        return filteredResults.count ? filteredResults : nil;
-    }
-
-    // Otherwise, check if it's a predicate for filtering
-
-    NSString *predicate = [query pd_extractXPathPredicateWithRemainder:&query];
-
-    if (predicate) {
-        if ([predicate pd_isXPathAttributePredicate])
-        {
-            //Handle attribute query
-            for (NSMutableDictionary *child in self) {
-                NSArray *childResults = [[child pd_filterWithXPath:predicate] pd_filterWithXPath:query];
-                if (childResults) {
-                    [filteredResults addObjectsFromArray:childResults];
-                }
-            }
-        }
-
-        else {
-            predicate = [predicate stringByReplacingOccurrencesOfString:@"last()" withString:@(self.count).stringValue];
-            NSExpression *expression = [predicate pd_xpathPredicateNumericExpression];
-
-            // If the predicate can be evaluated as an expression that returns a number, then evaluate it as use the resulting number as an index for retrieving a child element
-            if(expression)
-            {
-                NSNumber *index = [expression expressionValueWithObject:nil context:nil];
-                // XPath uses 1-based indexes
-                NSNumber *xPathIndex = @(index.integerValue - 1);
-
-                if (xPathIndex && xPathIndex.integerValue >= 0 && xPathIndex.unsignedIntegerValue < self.count) {
-                    [filteredResults addObject:self[xPathIndex.unsignedIntegerValue]];
-                }
-            }
-
-            // Otherwise, check if the predicate using the position() function in a comparison and evaluate the index of each child against it
-
-            else if ([predicate pd_isXPathPositionPredicate])
-            {
-                for (NSInteger i = 0; i < self.count; i++) {
-                    NSPredicate *comparison = [NSPredicate predicateWithFormat:[predicate pd_positionComparisonStringFromXPathPredicateUsingIndex:i]];
-                    if ([comparison evaluateWithObject:nil]) {
-                        [filteredResults addObject:self[i]];
-                    }
-                }
-            }
-
-            // So the only other type of predicate we care about checks for a child with a matching value
-            else {
-                for (NSMutableDictionary *child in self) {
-                    NSArray *childResults = [[child pd_filterWithXPath:predicate] pd_filterWithXPath:query];
-                    if (childResults) {
-                        [filteredResults addObjectsFromArray:childResults];
-                    }
-                }
-            }
+    return [[PDXPathQuery queryWithString:xPathString] evaluateOnArray:self];
+}
 
-        }
+- (NSArray *)pd_filterWithXPath:(NSString *)xPathString options:(PDXPathOptions)options
+{
+    if (!xPathString || !xPathString.length) {
+        return self;
     }
 
-    // This is where anything that isn't an element selector (/ or //) or a predicate expression ([]) would end up
-
-    return filteredResults.count ? filteredResults : nil;
+    return [[PDXPathQuery queryWithString:xPathString] evaluateOnArray:self options:options];
 }
 
 - (NSString *)pd_description
 {
-    NSString *tabs = @"";
-    NSMutableDictionary *parentDictionary = self.pd_parentDictionary;
-    while (parentDictionary != nil) {
-        tabs = [tabs stringByAppendingString:@"\t"];
-        parentDictionary = parentDictionary.pd_parentDictionary;
-    }
-
-    NSString *description = @"(\n";
-    for (NSMutableDictionary *child in self) {
-        description = [description stringByAppendingString:[NSString stringWithFormat:@"%@%@%@", tabs, child.pd_elementName ? [NSString stringWithFormat:@"(%@)", child.pd_elementName] : @"", child.pd_description]];
-    }
-    description = [description stringByAppendingString:[NSString stringWithFormat:@"%@)\n", tabs]];
-    return description;
+    NSData *data = [PDWriter dataByWritingObject:self format:PDWriterFormatDescription options:PDWritingOptionsNone keyForInnerValue:nil];
+    return [[NSString alloc] initWithData:data encoding:NSUTF8StringEncoding];
 }
 
 - (BOOL)pd_isEqualToArray:(NSArray *)array
+{
+    PDStatsToken token = PDStatsBeginOperation(PDStatsOperationCompare, nil);
+    BOOL equal = [self pd_isEqualToArrayContents:array];
+    PDStatsEndOperation(token, nil, 0);
+    return equal;
+}
+
+- (BOOL)pd_isEqualToArrayContents:(NSArray *)array
 {
     if (array == nil || ![array isKindOfClass:[NSArray class]])
     {
-        NSLog(@"ARRAY NOT EQUAL BECAUSE COMPARED OBJECT IS NIL OR NOT AN ARRAY");
         return NO;
     }
 
     if (self.count != array.count)
     {
-        NSLog(@"ARRAY NOT EQUAL BECAUSE DIFFERENT ELEMENT COUNTS.  %@ vs. %@", @(self.count), @(array.count));
         return NO;
     }
 
@@ -307,40 +219,80 @@
 
 - (NSString *)pd_jsonStringWithInnerValueKey:(NSString *)keyForInnerValue
 {
-    NSString *tabs = @"";
-    NSMutableDictionary *parentDictionary = self.pd_parentDictionary;
-    while (parentDictionary != nil) {
-        tabs = [tabs stringByAppendingString:@"\t"];
-        parentDictionary = parentDictionary.pd_parentDictionary;
-    }
-
-    NSString *result = @"[\n";
-    for (NSMutableDictionary *dictionary in self) {
-        result = [result stringByAppendingString:[NSString stringWithFormat:@"%@%@", tabs, [dictionary pd_jsonStringWithInnerValueKey:keyForInnerValue]]];
-        result = [result stringByAppendingString:@",\n"];
-    }
-    result = [result substringToIndex:result.length-2];
-    result = [result stringByAppendingString:@"\n"];
-    result = [result stringByAppendingString:[NSString stringWithFormat:@"%@]", tabs]];
-    return result;
+    NSData *data = [PDWriter dataByWritingObject:self format:PDWriterFormatJSON options:PDWritingOptionsNone keyForInnerValue:keyForInnerValue];
+    return [[NSString alloc] initWithData:data encoding:NSUTF8StringEncoding];
 }
 
 - (NSString *)pd_xmlString
 {
-    NSString *result = @"";
-    for (NSMutableDictionary *dictionary in self)
-    {
-        result = [result stringByAppendingString:[dictionary pd_xmlString]];
-    }
-    return result;
+    NSData *data = [PDWriter dataByWritingObject:self format:PDWriterFormatXML options:PDWritingOptionsNone keyForInnerValue:nil];
+    return [[NSString alloc] initWithData:data encoding:NSUTF8StringEncoding];
+}
+
+- (BOOL)pd_writeJSONToStream:(NSOutputStream *)stream options:(PDWritingOptions)options error:(NSError **)error
+{
+    return [self pd_writeJSONToStream:stream keyForInnerValue:defaultInnerValueKey options:options error:error];
+}
+
+- (BOOL)pd_writeJSONToStream:(NSOutputStream *)stream keyForInnerValue:(NSString *)keyForInnerValue options:(PDWritingOptions)options error:(NSError **)error
+{
+    PDWriter *writer = [[PDWriter alloc] initWithStream:stream];
+    writer.options = options;
+    writer.keyForInnerValue = keyForInnerValue;
+    return [writer writeObject:self error:error];
+}
+
+- (BOOL)pd_writeXMLToStream:(NSOutputStream *)stream options:(PDWritingOptions)options error:(NSError **)error
+{
+    PDWriter *writer = [[PDWriter alloc] initWithStream:stream];
+    writer.format = PDWriterFormatXML;
+    writer.options = options;
+    return [writer writeObject:self error:error];
+}
+
+- (BOOL)pd_writeJSONToFileDescriptor:(int)fileDescriptor options:(PDWritingOptions)options error:(NSError **)error
+{
+    PDWriter *writer = [[PDWriter alloc] initWithFileDescriptor:fileDescriptor];
+    writer.options = options;
+    return [writer writeObject:self error:error];
+}
+
+- (BOOL)pd_writeXMLToFileDescriptor:(int)fileDescriptor options:(PDWritingOptions)options error:(NSError **)error
+{
+    PDWriter *writer = [[PDWriter alloc] initWithFileDescriptor:fileDescriptor];
+    writer.format = PDWriterFormatXML;
+    writer.options = options;
+    return [writer writeObject:self error:error];
+}
+
+- (BOOL)pd_writeBinarySnapshotToFile:(NSString *)path error:(NSError **)error
+{
+    return [PDSnapshot writeObject:self toFile:path error:error];
+}
+
+- (NSData *)pd_jsonDataWithOptions:(PDWritingOptions)options
+{
+    return [PDWriter dataByWritingObject:self format:PDWriterFormatJSON options:options keyForInnerValue:defaultInnerValueKey];
+}
+
+- (NSData *)pd_xmlDataWithOptions:(PDWritingOptions)options
+{
+    return [PDWriter dataByWritingObject:self format:PDWriterFormatXML options:options keyForInnerValue:nil];
 }
 
 - (instancetype)pd_copy {
+    PDStatsToken token = PDStatsBeginOperation(PDStatsOperationCopy, nil);
     NSMutableArray *copy = [NSMutableArray arrayWithCapacity:self.count];
     for (NSMutableDictionary *dictionary in self) {
         [copy addObject:[dictionary pd_copy]];
     }
+    PDStatsEndOperation(token, nil, 0);
     return copy;
 }
 
+- (NSArray *)pd_freeze
+{
+    return PDNodeFreezeObject(self);
+}
+
 @end
@@ -23,6 +23,8 @@
 
 #import <Foundation/Foundation.h>
 
+@class PDNameMatcher;
+
 /** This category is used internally by PrestoData for keeping track of the element name and parent reference for an array element */
 
 @interface NSArray (_PrestoData_Internal)
@@ -33,4 +35,23 @@
 /** The name of the element this array is stored as */
 @property (nonatomic, copy) NSString *pd_elementName;
 
+
+/** A hash of the structural hashes of the array's elements, in order.  Arrays that are equal under pd_isEqualToArray: have equal hashes.  Computed each time from the elements, which keep their own hashes if they are PDNodes
+* @return The hash, which is never 0
+*/
+- (uint64_t)pd_structuralHash;
+
+
+/** Appends the child elements whose names match the specified matcher, in document order
+* @param matcher The compiled name pattern
+* @param children The array to append matching children to
+*/
+- (void)pd_addChildrenMatching:(PDNameMatcher *)matcher toArray:(NSMutableArray *)children;
+
+/** Appends the descendant elements whose names match the specified matcher, in document order: each element comes before its own descendants
+* @param matcher The compiled name pattern
+* @param descendants The array to append matching descendants to
+*/
+- (void)pd_addDescendantsMatching:(PDNameMatcher *)matcher toArray:(NSMutableArray *)descendants;
+
 @end
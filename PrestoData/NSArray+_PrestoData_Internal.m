@@ -24,6 +24,7 @@
 #import "NSArray+_PrestoData_Internal.h"
 #import "NSMutableDictionary+_PrestoData_Internal.h"
 #import "NSMutableDictionary+PrestoData.h"
+#import "PDNameMatcher.h"
 #import <objc/runtime.h>
 
 @implementation NSArray (_PrestoData_Internal)
@@ -52,4 +53,32 @@
 }
 
 
+- (uint64_t)pd_structuralHash
+{
+    uint64_t hash = PDStructuralHashCombine(1, self.count);
+
+    for (id element in self) {
+        hash = PDStructuralHashCombine(hash, PDStructuralHashOfValue(element));
+    }
+
+    return hash ? hash : 1;
+}
+
+
+- (void)pd_addChildrenMatching:(PDNameMatcher *)matcher toArray:(NSMutableArray *)children
+{
+    for (NSMutableDictionary *child in self) {
+        [child pd_addChildrenMatching:matcher toArray:children];
+    }
+}
+
+
+- (void)pd_addDescendantsMatching:(PDNameMatcher *)matcher toArray:(NSMutableArray *)descendants
+{
+    for (NSMutableDictionary *child in self) {
+        [child pd_addDescendantsMatching:matcher toArray:descendants];
+    }
+}
+
+
 @end
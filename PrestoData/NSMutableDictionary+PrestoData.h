@@ -23,6 +23,7 @@
 
 
 #import <Foundation/Foundation.h>
+#import "PDOptions.h"
 
 /** A category containing all the methods used by Presto Data for searching, parsing, and modifying dictionaries */
 
@@ -46,17 +47,43 @@
 
 /** An equality checking method specifically to compare PrestoData dictionaries.  Use instead of the normal [NSObject isEqual:] method
 *
+* PDNodes keep a hash of their contents between comparisons, until they change, so comparing them again is usually decided without walking them: nodes that differ anywhere have different hashes, and a copy-on-write copy that still shares its original's contents is equal to it
+*
 * @param dictionary Another PrestoData dictionary
-* @return YES if the dictionary has the same keys and values in the same order, as well as the same inner values; otherwise NO
+* @return YES if the dictionary has the same element name, the same keys and values in the same order, as well as the same inner values; otherwise NO
 */
 - (BOOL)pd_isEqualToDictionary:(NSMutableDictionary *)dictionary;
 
+/** Works out what has changed between another dictionary, such as a copy of this one made earlier with pd_copy, and this one.  See +[PDEdit editsChangingDictionary:toMatchDictionary:].  Parts of a copy that haven't changed on either side are recognized without being walked
+*
+* @param dictionary The earlier dictionary
+* @return An array of PDEdits that, applied to the other dictionary with +[PDEdit applyEdits:toObject:], make it equal to this one.  Empty if they are already equal
+*/
+- (NSArray *)pd_diffAgainst:(NSMutableDictionary *)dictionary;
+
 /** A copy method that produces deep copies specifically used to copy PrestoData dictionaries.  Use instead of the normal [NSObject copy] method
 *
+* Copies of a PDNode are copy-on-write: the copy shares the original's contents, and each node in it only copies its own keys and values from the original when it is first read or changed.  Copying is therefore constant time, and a copy that is changed in a few places duplicates only the nodes on the way to those places.  If the original is changed first, through PrestoData methods or NSMutableDictionary methods on its nodes, any parts of the copy that are still shared are copied just before the change, so the copy never sees it.  Element arrays inside the original must not be changed directly with NSMutableArray methods while copies of it are in use
+*
+* Copying a frozen dictionary takes no locks, and the copy is an ordinary mutable dictionary
+*
 * @return A deep copy of this dictionary containing copies of its contents instead of pointers to the original contents
 */
 - (instancetype)pd_copy;
 
+/** YES for a dictionary returned by pd_freeze, and for every element inside it */
+@property (nonatomic, readonly) BOOL pd_isFrozen;
+
+/** Makes this dictionary and everything inside it permanently read-only, so that it can be shared between threads.  Everything that would otherwise happen the first time a part of it is used, such as loading lazily parsed elements, copying shared copy-on-write contents and computing structural hashes, happens now, and the storage of each element is trimmed to its size
+*
+* Once frozen, XPath queries, pd_descendantsNamed: and the other searches, reading keys and values, comparisons, writing JSON, XML and snapshots, and pd_copy never change anything inside the dictionary and take no locks, so they can run on any number of threads at once.  Any attempt to change it, through the PrestoData methods or the NSMutableDictionary methods, raises an NSInternalInconsistencyException, as does adding one of its elements to another dictionary.  To change it, change a pd_copy of it.  Element indexes are kept, but must be built before freezing
+*
+* Freezing itself changes the dictionary, so it must finish before the dictionary is handed to other threads.  Plain NSMutableDictionary elements inside a PDNode are replaced by frozen PDNodes, and element arrays by immutable arrays, so references to them taken before freezing no longer belong to the dictionary.  A plain NSMutableDictionary can't be frozen itself, so a frozen PDNode copy of it is returned instead, and the plain dictionary and the PDNodes inside it are left as they were
+*
+* @return This dictionary if it is a PDNode, or else a frozen PDNode with the same contents to use in its place
+*/
+- (instancetype)pd_freeze;
+
 /**---------------------------------------------------------------------------------------
 * @name Creating a Dictionary from JSON or XML
 *  ---------------------------------------------------------------------------------------
@@ -77,6 +104,14 @@
 */
 + (instancetype)pd_dictionaryFromJSONData:(NSData *)jsonData keyForInnerValue:(NSString *)key;
 
+/** Returns a PrestoData dictionary from UTF8-encoded JSON data using the default attribute name for inner values, with options
+*
+* @param jsonData An NSData instance that contains a UTF8-encoded JSON string
+* @param options Options for the resulting dictionary.  PDParsingOptionsIndexElements builds an element index for it, PDParsingOptionsLazy fills in each dictionary only when it is first used, and PDParsingOptionsPreserveSource writes dictionaries that haven't changed by copying the bytes they were parsed from
+* @return An NSMutableDictionary instance if the JSON represents a dictionary and not an array, otherwise nil
+*/
++ (instancetype)pd_dictionaryFromJSONData:(NSData *)jsonData options:(PDParsingOptions)options;
+
 /** Returns a PrestoData dictionary from UTF8-encoded XML data
 *
 * @param xmlData An NSData instance that contains a UTF8-encoded XML string
@@ -84,6 +119,35 @@
 */
 + (instancetype)pd_dictionaryFromXMLData:(NSData *)xmlData;
 
+/** Returns a PrestoData dictionary from UTF8-encoded XML data, with options
+*
+* @param xmlData An NSData instance that contains a UTF8-encoded XML string
+* @param options Options for the resulting dictionary.  PDParsingOptionsIndexElements builds an element index for it
+* @return An NSMutableDictionary instance if the string contained valid XML, otherwise nil
+*/
++ (instancetype)pd_dictionaryFromXMLData:(NSData *)xmlData options:(PDParsingOptions)options;
+
+/** Returns a PrestoData dictionary from XML read from a stream.  The XML is parsed as it is read, so the document never needs to be in memory in its entirety
+*
+* @param stream The stream to read from.  If it isn't open yet, it is opened, and closed again when parsing finishes
+* @return An NSMutableDictionary instance if the stream contained valid XML, otherwise nil
+*/
++ (instancetype)pd_dictionaryFromXMLStream:(NSInputStream *)stream;
+
+/** Returns a PrestoData dictionary from an XML file, reading and parsing the file in chunks
+*
+* @param path The path of the XML file
+* @return An NSMutableDictionary instance if the file exists and contains valid XML, otherwise nil
+*/
++ (instancetype)pd_dictionaryFromXMLFileAtPath:(NSString *)path;
+
+/** Returns a PrestoData dictionary from a file written by pd_writeBinarySnapshotToFile:error:.  The file is memory-mapped and nothing is parsed: each element reads its keys and values from the file the first time it is used, so loading takes the same short time whatever the size of the file
+*
+* @param path The path of the snapshot file
+* @return An NSMutableDictionary instance if the file is a snapshot of a dictionary, otherwise nil
+*/
++ (instancetype)pd_dictionaryFromBinarySnapshotAtPath:(NSString *)path;
+
 
 /**---------------------------------------------------------------------------------------
 * @name Changing Element Attributes
@@ -146,7 +210,7 @@
 */
 - (instancetype)pd_removeElement:(NSMutableDictionary *)element;
 
-/** Removes this dictionary from the dictionary it is a child element of */
+/** Removes this dictionary from the dictionary it is a child element of.  Siblings with the same element name are kept */
 - (void)pd_removeFromParentDictionary;
 
 
@@ -163,6 +227,14 @@
 */
 - (NSArray *)pd_filterWithXPath:(NSString *)xPathString;
 
+/** Returns an array of all child or descendant elements inside this dictionary which match the specified XPath query, with options
+*
+* @param xPathString A string containing an XPath 1.0-style query
+* @param options Options for evaluation.  PDXPathOptionsConcurrent evaluates queries over tens of thousands of elements on all available cores, with the same results as serial evaluation
+* @return The array of matching elements
+*/
+- (NSArray *)pd_filterWithXPath:(NSString *)xPathString options:(PDXPathOptions)options;
+
 /** Returns all child and descendant elements inside this dictionary which have the specified name.  Primarily used in XPath operations
 *
 * @param name The element name to search this dictionary and its child elements for
@@ -177,6 +249,16 @@
 */
 - (NSArray *)pd_childrenNamed:(NSString *)name;
 
+/** Builds an index of all of the elements inside this dictionary by name.  Afterwards pd_descendantsNamed: and XPath // steps with an exact element name, run on this dictionary itself, find their matches in the index instead of searching every element.  Run on an element inside it, they search that element's subtree as before, unless the element has an index of its own.  The index is kept up to date as elements are added and removed with the PrestoData methods, and is not copied by pd_copy
+*
+* Changing the dictionary or its elements with the plain NSMutableDictionary and NSMutableArray methods bypasses the index, so call pd_discardElementIndex first if you need to do that
+*/
+- (void)pd_buildElementIndex;
+
+/** Discards the index built by pd_buildElementIndex, if there is one.  Queries go back to searching the elements directly
+*/
+- (void)pd_discardElementIndex;
+
 
 /**---------------------------------------------------------------------------------------
 * @name Converting to JSON and XML
@@ -202,4 +284,73 @@
 */
 - (NSString *)pd_xmlString;
 
+/** Writes a JSON representation of this dictionary to an output stream in a single pass, using the default key name for any inner values
+*
+* @param stream An open output stream.  The stream is not closed when writing finishes
+* @param options PDWritingOptionsCompact for output without line breaks or indentation, otherwise PDWritingOptionsNone
+* @param error If writing fails, set to an error in PrestoDataErrorDomain describing the failure
+* @return YES if all output was written, otherwise NO
+*/
+- (BOOL)pd_writeJSONToStream:(NSOutputStream *)stream options:(PDWritingOptions)options error:(NSError **)error;
+
+/** Writes a JSON representation of this dictionary to an output stream in a single pass, using the specified key name for any inner values
+*
+* @param stream An open output stream.  The stream is not closed when writing finishes
+* @param keyForInnerValue The key name that will be used to map any inner values to JSON attributes
+* @param options PDWritingOptionsCompact for output without line breaks or indentation, otherwise PDWritingOptionsNone
+* @param error If writing fails, set to an error in PrestoDataErrorDomain describing the failure
+* @return YES if all output was written, otherwise NO
+*/
+- (BOOL)pd_writeJSONToStream:(NSOutputStream *)stream keyForInnerValue:(NSString *)keyForInnerValue options:(PDWritingOptions)options error:(NSError **)error;
+
+/** Writes an XML representation of this dictionary to an output stream in a single pass
+*
+* @param stream An open output stream.  The stream is not closed when writing finishes
+* @param options PDWritingOptionsCompact for output without line breaks or indentation, and PDWritingOptionsXMLDeclaration to begin with an XML declaration
+* @param error If writing fails, set to an error in PrestoDataErrorDomain describing the failure
+* @return YES if all output was written, otherwise NO
+*/
+- (BOOL)pd_writeXMLToStream:(NSOutputStream *)stream options:(PDWritingOptions)options error:(NSError **)error;
+
+/** Writes a JSON representation of this dictionary to a file descriptor, such as an open file or socket, using the default key name for any inner values
+*
+* @param fileDescriptor The file descriptor to write to.  It is not closed when writing finishes
+* @param options PDWritingOptionsCompact for output without line breaks or indentation, otherwise PDWritingOptionsNone
+* @param error If writing fails, set to an error in PrestoDataErrorDomain describing the failure
+* @return YES if all output was written, otherwise NO
+*/
+- (BOOL)pd_writeJSONToFileDescriptor:(int)fileDescriptor options:(PDWritingOptions)options error:(NSError **)error;
+
+/** Writes an XML representation of this dictionary to a file descriptor, such as an open file or socket
+*
+* @param fileDescriptor The file descriptor to write to.  It is not closed when writing finishes
+* @param options PDWritingOptionsCompact for output without line breaks or indentation, and PDWritingOptionsXMLDeclaration to begin with an XML declaration
+* @param error If writing fails, set to an error in PrestoDataErrorDomain describing the failure
+* @return YES if all output was written, otherwise NO
+*/
+- (BOOL)pd_writeXMLToFileDescriptor:(int)fileDescriptor options:(PDWritingOptions)options error:(NSError **)error;
+
+/** Returns UTF-8 encoded JSON data representing this dictionary, using the default key name for any inner values
+*
+* @param options PDWritingOptionsCompact for output without line breaks or indentation, otherwise PDWritingOptionsNone
+* @return The JSON data
+*/
+- (NSData *)pd_jsonDataWithOptions:(PDWritingOptions)options;
+
+/** Returns UTF-8 encoded XML data representing this dictionary
+*
+* @param options PDWritingOptionsCompact for output without line breaks or indentation, and PDWritingOptionsXMLDeclaration to begin with an XML declaration
+* @return The XML data
+*/
+- (NSData *)pd_xmlDataWithOptions:(PDWritingOptions)options;
+
+/** Writes this dictionary to a file in PrestoData's binary snapshot format, which keeps the ordered keys, typed values, inner values and elements exactly and can be loaded again without parsing.  An existing file is replaced atomically
+*
+* @param path The path of the file to write
+* @param error If writing fails, set to an error in PrestoDataErrorDomain describing the failure
+* @return YES if the file was written, otherwise NO
+*/
+- (BOOL)pd_writeBinarySnapshotToFile:(NSString *)path error:(NSError **)error;
+
+
 @end
@@ -28,104 +28,50 @@
 #import "NSArray+_PrestoData_Internal.h"
 #import "NSArray+PrestoData.h"
 #import "PrestoData.h"
+#import "PDJSONParser.h"
+#import "PDXMLParser.h"
+#import "PDXPathQuery.h"
+#import "PDNameMatcher.h"
+#import "PDWriter.h"
+#import "PDSnapshot.h"
+#import "PDNode.h"
+#import "PDNode+_PrestoData_Internal.h"
+#import "PDElementIndex.h"
+#import "PDStats+_PrestoData_Internal.h"
 #import <objc/runtime.h>
 
-@interface PDXMLToDictionaryParser : NSObject <NSXMLParserDelegate>
-
-@property (nonatomic, strong) NSData *data;
-@property (nonatomic, strong) NSMutableDictionary *currentDictionary;
-@property (nonatomic, strong) NSMutableDictionary *rootDictionary;
-
-@end
-
-@implementation PDXMLToDictionaryParser
+@implementation NSMutableDictionary (PrestoData)
 
-- (instancetype) initWithXMLData:(NSData *)data
++ (instancetype)pd_dictionaryFromXMLData:(NSData *)xmlData
 {
-    self = [super init];
-    
-    if (self) {
-        self.data = data;
-    }
-    
-    return self;
+    PDXMLParser *parser = [[PDXMLParser alloc] initWithXMLData:xmlData];
+    return [parser parsedDictionary];
 }
 
-- (NSMutableDictionary *) parsedDictionary
++ (instancetype)pd_dictionaryFromXMLData:(NSData *)xmlData options:(PDParsingOptions)options
 {
-    if (self.data == nil) {
-        return nil;
-    }
-    self.rootDictionary = [NSMutableDictionary dictionary];
-    self.currentDictionary = self.rootDictionary;
-    
-    NSXMLParser *parser = [[NSXMLParser alloc] initWithData:self.data];
-    
-    parser.delegate = self;
-    BOOL success = [parser parse];
-    
-    if (success){
-        return self.currentDictionary;
-    }
-    
-    else {
-        return nil;
-    }
+    return [[self pd_dictionaryFromXMLData:xmlData] pd_applyParsingOptions:options];
 }
 
-
-#pragma mark -  NSXMLParserDelegate
-
-- (void)parser:(NSXMLParser *)parser didStartElement:(NSString *)elementName namespaceURI:(NSString *)namespaceURI qualifiedName:(NSString *)qName attributes:(NSDictionary *)attributeDict
++ (instancetype)pd_dictionaryFromXMLStream:(NSInputStream *)stream
 {
-    NSMutableDictionary *newDictionary = [NSMutableDictionary dictionary];
-    for (NSString *key in attributeDict.allKeys)
+    if (stream == nil)
     {
-        [newDictionary pd_setValue:attributeDict[key] forAttribute:key];
+        return nil;
     }
-    
-    newDictionary.pd_innerValue = [[NSMutableString alloc] init];
-
-    [self.currentDictionary pd_addElement:newDictionary withName:elementName];
-    self.currentDictionary = newDictionary;
+    PDXMLParser *parser = [[PDXMLParser alloc] initWithStream:stream];
+    return [parser parsedDictionary];
 }
 
-- (void)parser:(NSXMLParser *)parser didEndElement:(NSString *)elementName namespaceURI:(NSString *)namespaceURI qualifiedName:(NSString *)qName
++ (instancetype)pd_dictionaryFromXMLFileAtPath:(NSString *)path
 {
-    self.currentDictionary.pd_innerValue = [self.currentDictionary.pd_innerValue stringByTrimmingCharactersInSet:[NSCharacterSet whitespaceAndNewlineCharacterSet]];
-
-    if (((NSString *) self.currentDictionary.pd_innerValue).length == 0)
-    {
-        self.currentDictionary.pd_innerValue = nil;
-    }
-
-    else {
-        NSNumberFormatter *formatter = [[NSNumberFormatter alloc] init];
-        formatter.numberStyle = NSNumberFormatterDecimalStyle;
-        NSNumber *numberResult = [formatter numberFromString:((NSString *) self.currentDictionary.pd_innerValue)];
-        if (numberResult) {
-            self.currentDictionary.pd_innerValue = numberResult;
-        }
-    }
-
-    self.currentDictionary = self.currentDictionary.pd_parentDictionary ? : self.currentDictionary;
+    return path ? [self pd_dictionaryFromXMLStream:[NSInputStream inputStreamWithFileAtPath:path]] : nil;
 }
 
-- (void)parser:(NSXMLParser *)parser foundCharacters:(NSString *)string
++ (instancetype)pd_dictionaryFromBinarySnapshotAtPath:(NSString *)path
 {
-    self.currentDictionary.pd_innerValue = [self.currentDictionary.pd_innerValue stringByAppendingString:string];
-}
-
-
-@end
-
-
-@implementation NSMutableDictionary (PrestoData)
-
-+ (instancetype)pd_dictionaryFromXMLData:(NSData *)xmlData
-{
-    PDXMLToDictionaryParser *parser = [[PDXMLToDictionaryParser alloc] initWithXMLData:xmlData];
-    return [parser parsedDictionary];
+    id object = [PDSnapshot objectFromSnapshotAtPath:path];
+    return [object isKindOfClass:[NSMutableDictionary class]] ? object : nil;
 }
 
 + (instancetype)pd_dictionaryFromJSONData:(NSData *)jsonData
@@ -140,10 +86,35 @@
     {
         return nil;
     }
-    NSString *jsonString = [[NSString alloc] initWithData:jsonData encoding:NSUTF8StringEncoding];
-    NSMutableDictionary *dictionary = [jsonString pd_extractJSONDictionaryValue];
-    [dictionary pd_setParsedDictionaryPropertiesWithInnerValueKey:key];
-    return dictionary;
+    PDJSONParser *parser = [[PDJSONParser alloc] initWithJSONData:jsonData keyForInnerValue:key];
+    return [parser parsedDictionary];
+}
+
++ (instancetype)pd_dictionaryFromJSONData:(NSData *)jsonData options:(PDParsingOptions)options
+{
+    if (jsonData == nil)
+    {
+        return nil;
+    }
+
+    PDJSONParser *parser = [[PDJSONParser alloc] initWithJSONData:jsonData keyForInnerValue:defaultInnerValueKey];
+    parser.preservesSource = (options & PDParsingOptionsPreserveSource) != 0;
+
+    if ((options & PDParsingOptionsLazy) && !(options & PDParsingOptionsIndexElements))
+    {
+        return [parser lazilyParsedDictionary];
+    }
+
+    return [[parser parsedDictionary] pd_applyParsingOptions:options];
+}
+
+- (instancetype)pd_applyParsingOptions:(PDParsingOptions)options
+{
+    if (options & PDParsingOptionsIndexElements)
+    {
+        [self pd_buildElementIndex];
+    }
+    return self;
 }
 
 
@@ -169,17 +140,6 @@
     return [self privateOrderedKeys];
 }
 
-
-- (NSMutableArray *)privateOrderedKeys
-{
-    NSMutableArray *keys = objc_getAssociatedObject(self, @selector(pd_orderedKeys));
-    if (keys == nil) {
-        keys = [NSMutableArray array];
-        objc_setAssociatedObject(self, @selector(pd_orderedKeys), keys, OBJC_ASSOCIATION_RETAIN_NONATOMIC);
-    }
-    return keys;
-}
-
 - (instancetype)pd_setValue:(id)value forAttribute:(NSString *)attribute
 {
     if (!value || ([value isKindOfClass:[NSString class]] && !((NSString *) value).length) || !attribute || !attribute.length)
@@ -187,12 +147,7 @@
         return self;
     }
     
-    if (!self[attribute])
-    {
-        [[self privateOrderedKeys] addObject:attribute];
-    }
-    
-    self[attribute] = value;
+    [self pd_setObject:value forOrderedKey:attribute];
     return self;
 }
 
@@ -203,11 +158,7 @@
         return self;
     }
     
-    if (self[attribute])
-    {
-        [[self privateOrderedKeys] removeObject:attribute];
-        [self removeObjectForKey:attribute];
-    }
+    [self pd_removeObjectForOrderedKey:attribute];
     return self;
 
 }
@@ -220,7 +171,7 @@
 
 - (void)pd_removeFromParentDictionary
 {
-    [self.pd_parentDictionary pd_removeElementNamed:self.pd_elementName];
+    [self.pd_parentDictionary pd_removeElement:self];
 }
 
 - (instancetype)pd_addElement:(NSMutableDictionary *)element withName:(NSString *)name
@@ -229,6 +180,12 @@
     {
         return self;
     }
+
+    // A frozen dictionary raises before the element is given it as a parent, so that a rejected add leaves the element where it was
+    if (self.pd_isFrozen)
+    {
+        [self pd_willChange];
+    }
     
     element.pd_elementName = name;
     element.pd_parentDictionary = self;
@@ -243,24 +200,21 @@
             self[name] = existingValue;
         }
         
+        [self pd_willChange];
         [((NSMutableArray *)existingValue) addObject:element];
+        PDElementIndexesAddValue(self, name, element);
     }
     
     else
     {
-        [[self privateOrderedKeys] addObject:name];
-        self[name] = element;
+        [self pd_setObject:element forOrderedKey:name];
     }
     return self;
 }
 
 - (instancetype)pd_removeElementNamed:(NSString *)elementName
 {
-    if (self[elementName])
-    {
-        [[self privateOrderedKeys] removeObject:elementName];
-        [self removeObjectForKey:elementName];
-    }
+    [self pd_removeObjectForOrderedKey:elementName];
     return self;
 
 }
@@ -272,16 +226,20 @@
     if(existingValue)
     {
         if ([existingValue isKindOfClass:[NSArray class]]) {
-            if ([existingValue indexOfObject:element] != NSNotFound)
+            // Siblings often compare equal to each other, so find the element by identity and remove only it
+            NSUInteger index = [existingValue indexOfObjectIdenticalTo:element];
+            if (index != NSNotFound)
             {
-                [existingValue removeObject:element];
+                [self pd_willChange];
+                PDElementIndexesRemoveValue(self, element.pd_elementName, element);
+                [existingValue removeObjectAtIndex:index];
             }
             if (((NSArray *)existingValue).count == 0)
             {
                 [self pd_removeElementNamed:((NSArray *) existingValue).pd_elementName];
             }
         }
-        else
+        else if (existingValue == element)
         {
             [self pd_removeElementNamed:element.pd_elementName];
         }
@@ -291,66 +249,14 @@
 
 - (NSString *)pd_description
 {
-    NSString *tabs = @"";
-    NSMutableDictionary *parentDictionary = self.pd_parentDictionary;
-    while (parentDictionary != nil)
-    {
-        tabs = [tabs stringByAppendingString:@"\t"];
-        parentDictionary = parentDictionary.pd_parentDictionary;
-    }
-    NSString *description = @"{\n";
-    
-    for (NSString *key in self.pd_orderedKeys)
-    {
-        id value = self[key];
-        if([value isKindOfClass:[NSString class]]) {
-            description = [description stringByAppendingString:[NSString stringWithFormat:@"%@%@%@ = \"%@\"\n",tabs, @"\t",key, value]];
-        }
-
-        else if([value isKindOfClass:[NSNumber class]]) {
-            description = [description stringByAppendingString:[NSString stringWithFormat:@"%@%@%@ = %@\n",tabs, @"\t",key, value]];
-        }
-
-        else if([value isKindOfClass:[NSArray class]]) {
-            description = [description stringByAppendingString:[NSString stringWithFormat:@"%@%@%@ = %@",tabs, @"\t",key, [value pd_description]]];
-        }
-        else if([value isKindOfClass:[NSMutableDictionary class]]) {
-            description = [description stringByAppendingString:[NSString stringWithFormat:@"%@%@%@ = %@",tabs, @"\t",key, [value pd_description]]];
-        }
-    }
-    if ([self.pd_innerValue isKindOfClass:[NSString class]] && ((NSString *) self.pd_innerValue).length)
-    {
-        description = [description stringByAppendingString:[NSString stringWithFormat:@"%@%@pd_innerValue = \"%@\"\n", tabs, @"\t", self.pd_innerValue]];
-    }
-    else if ([self.pd_innerValue isKindOfClass:[NSNumber class]])
-    {
-        description = [description stringByAppendingString:[NSString stringWithFormat:@"%@%@pd_innerValue = %@\n", tabs, @"\t", self.pd_innerValue]];
-    }
-    description = [description stringByAppendingString:[NSString stringWithFormat:@"%@}\n", tabs]];
-    return description;
+    NSData *data = [PDWriter dataByWritingObject:self format:PDWriterFormatDescription options:PDWritingOptionsNone keyForInnerValue:nil];
+    return [[NSString alloc] initWithData:data encoding:NSUTF8StringEncoding];
 }
 
-
 - (NSArray *)pd_childrenNamed:(NSString *)name
 {
     NSMutableArray *children = [[NSMutableArray alloc] init];
-    
-    for (NSString* key in self.pd_orderedKeys)
-    {
-        if ([key pd_matchesWildcardedString:[name stringByTrimmingCharactersInSet:[NSCharacterSet whitespaceAndNewlineCharacterSet]]])
-        {
-            id value = self[key];
-            if ([value isKindOfClass:[NSMutableDictionary class]])
-            {
-                [children addObject:self[key]];
-            }
-            else if ([value isKindOfClass:[NSArray class]])
-            {
-                [children addObjectsFromArray:value];
-            }
-        }
-    }
-    
+    [self pd_addChildrenMatching:[PDNameMatcher matcherWithPattern:name] toArray:children];
     return children.count > 0 ? children : nil;
 }
 
@@ -358,214 +264,125 @@
 - (NSArray *)pd_descendantsNamed:(NSString *)name
 {
     NSMutableArray *descendants = [[NSMutableArray alloc] init];
-    
-    NSArray *children = [self pd_childrenNamed:name];
-    if (children)
-    {
-        [descendants addObjectsFromArray:children];
-    }
-    
-    for (NSString *key in self.pd_orderedKeys)
-    {
-        id value = self[key];
-        
-        if ([value isKindOfClass:[NSMutableDictionary class]] || [value isKindOfClass:[NSArray class]])
-        {
-            NSArray *valueDescendants = [value pd_descendantsNamed:name];
-            if (valueDescendants)
-            {
-                [descendants addObjectsFromArray:valueDescendants];
-            }
-        }
-    }
-    
+    [self pd_addDescendantsMatching:[PDNameMatcher matcherWithPattern:name] toArray:descendants];
     return descendants.count > 0 ? descendants : nil;
 }
 
--(NSArray *)pd_filterWithXPath:(NSString *)xPathString {
-    
+- (void)pd_buildElementIndex
+{
+    self.pd_elementIndex = [[PDElementIndex alloc] initWithRoot:self];
+}
+
+- (void)pd_discardElementIndex
+{
+    self.pd_elementIndex = nil;
+}
+
+- (NSArray *)pd_filterWithXPath:(NSString *)xPathString
+{
     if (!xPathString || !xPathString.length)
     {
         return @[self];
     }
-    
-    NSMutableArray *filteredResults = [[NSMutableArray alloc] init];
-    NSString *query = [xPathString stringByTrimmingCharactersInSet:[NSCharacterSet whitespaceAndNewlineCharacterSet]];
-    
-    // Parse out grouped expressions from parentheses first
-    
-    NSString *grouping = [query pd_extractInitialGroupingWithRemainder:&query];
-    
-    if (grouping) {
-        return [[self pd_filterWithXPath:grouping] pd_filterWithXPath:query];
-    }
-    
-    // If the first part of the Xpath query is selecting a child or descendant, return that result filtered by the rest of the query
-    
-    NSString *element = [query pd_extractFirstXPathDescendantWithRemainder:&query];
-    
-    if (element)
-    {
-        NSArray *childResults = [[self pd_descendantsNamed:element] pd_filterWithXPath:query];
-        if (childResults.count) {
-            [filteredResults addObjectsFromArray:childResults];
-        }
-        
-        return filteredResults.count ? filteredResults : nil;
-    }
-    
-    element = [query pd_extractFirstXPathChildWithRemainder:&query];
-    
-    if (element)
+
+    return [[PDXPathQuery queryWithString:xPathString] evaluateOnDictionary:self];
+}
+
+- (NSArray *)pd_filterWithXPath:(NSString *)xPathString options:(PDXPathOptions)options
+{
+    if (!xPathString || !xPathString.length)
     {
-        NSArray *childResults = [[self pd_childrenNamed:element] pd_filterWithXPath:query];
-        if (childResults.count) {
-            [filteredResults addObjectsFromArray:childResults];
-        }
-        return filteredResults.count ? filteredResults : nil;
-    }
-    
-    // Otherwise, check if it's a predicate for filtering
-    
-    NSString *predicate = [query pd_extractXPathPredicateWithRemainder:&query];
-    
-    if (predicate) {
-        // Handle attribute-based predicates
-        if ([predicate pd_isXPathAttributePredicate])
-        {
-            //Handle attribute predicates that compare attribute value to another value
-            if ([predicate pd_isXPathComparisonPredicate])
-            {
-                NSString *attribute = [predicate pd_attributeFromXPathPredicate];
-                NSString *comparisonString = [predicate pd_comparisonStringFromXPathPredicate];
-                for (NSString *key in self.pd_orderedKeys) {
-                    if ([self[key] isKindOfClass:[NSMutableDictionary class]] || [self[key] isKindOfClass:[NSArray class]]) {
-                        continue;
-                    }
-                    NSString *value = [self[key] floatValue] ? self[key] : [NSString stringWithFormat:@"'%@'", self[key]];
-                    if ([key pd_matchesWildcardedString:attribute]) {
-                        NSString *predicateString = [NSString stringWithFormat:@"%@%@", value, comparisonString];
-                        NSPredicate *comparison = [NSPredicate predicateWithFormat:predicateString];
-                        if ([comparison evaluateWithObject:nil])
-                        {
-                            NSArray *myResults = [self pd_filterWithXPath:query];
-                            if (myResults.count) {
-                                [filteredResults addObject:self];
-                            }
-                        }
-                    }
-                }
-            }
-            
-            else
-            {
-                // Otherwise, just check for attribute existence
-                NSString *attribute = [predicate pd_attributeFromXPathPredicate];
-                for (NSString *key in self.pd_orderedKeys)
-                {
-                    if ([self[key] isKindOfClass:[NSMutableDictionary class]]) {
-                        continue;
-                    }
-                    if ([key pd_matchesWildcardedString:attribute])
-                    {
-                        NSArray *myResults = [self pd_filterWithXPath:query];
-                        if (myResults.count) {
-                            [filteredResults addObject:self];
-                        }
-                    }
-                }
-            }
-        }
-        
-        else
-        {
-            //We don't handle index-based predicated within as single dictionary, those are handled only in the NSArray filtering category
-            
-            //Handle a predicate that compares a child value to another value
-            if ([predicate pd_isXPathComparisonPredicate]) {
-                NSString *predElement = [predicate pd_elementFromXPathPredicate];
-                NSString *comparisonString = [predicate pd_comparisonStringFromXPathPredicate];
-                for (NSString *key in self.pd_orderedKeys) {
-                    NSMutableDictionary *child = self[key];
-                    if (![child isKindOfClass:[NSMutableDictionary class]] || child.pd_innerValue == nil)
-                    {
-                        continue;
-                    }
-                    NSString *value = [child.pd_innerValue floatValue] ? child.pd_innerValue : [NSString stringWithFormat:@"'%@'", child.pd_innerValue];
-                    if ([key pd_matchesWildcardedString:predElement]) {
-                        NSString *predicateString = [NSString stringWithFormat:@"%@%@", value, comparisonString];
-                        NSPredicate *comparison = [NSPredicate predicateWithFormat:predicateString];
-                        if ([comparison evaluateWithObject:nil]) {
-                            NSArray *myResults = [self pd_filterWithXPath:query];
-                            if (myResults.count)
-                            {
-                                [filteredResults addObject:self];
-                            }
-                        }
-                    }
-                }
-            }
-            //Otherwise handle predicates that check only for the existence of a child (not attribute) with the specified name
-            else {
-                NSArray *childResults = [[self pd_childrenNamed:[predicate pd_elementFromXPathPredicate]] pd_filterWithXPath:query];
-                if (childResults.count)
-                {
-                    [filteredResults addObjectsFromArray:childResults];
-                }
-            }
-            
-        }
+        return @[self];
     }
-    
-    
-    return filteredResults.count ? filteredResults : nil;
+
+    return [[PDXPathQuery queryWithString:xPathString] evaluateOnDictionary:self options:options];
 }
 
 
 - (BOOL)pd_isEqualToDictionary:(NSMutableDictionary *)dictionary
 {
+    PDStatsToken token = PDStatsBeginOperation(PDStatsOperationCompare, nil);
+    BOOL equal = [self pd_isEqualToDictionaryContents:dictionary];
+    PDStatsEndOperation(token, nil, 0);
+    return equal;
+}
+
+- (NSArray *)pd_diffAgainst:(NSMutableDictionary *)dictionary
+{
+    PDStatsToken token = PDStatsBeginOperation(PDStatsOperationCompare, nil);
+    NSArray *edits = [PDEdit editsChangingDictionary:dictionary toMatchDictionary:self];
+    PDStatsEndOperation(token, nil, 0);
+    return edits;
+}
+
+- (BOOL)pd_isEqualToDictionaryContents:(NSMutableDictionary *)dictionary
+{
+    if (dictionary == self)
+    {
+        return YES;
+    }
+
     if (![dictionary isKindOfClass:[NSMutableDictionary class]])
     {
-        NSLog(@"DICTIONARY NOT EQUAL BECAUSE OTHER DICTIONARY NOT NSDICTIONARY, CLASS = %@", [dictionary class]);
         return NO;
     }
-    
-    if (!(self.pd_orderedKeys.count == 0 && dictionary.pd_orderedKeys.count == 0) && ![self.pd_orderedKeys isEqualToArray:dictionary.pd_orderedKeys])
+
+    if (self.pd_elementName != dictionary.pd_elementName && ![self.pd_elementName isEqual:dictionary.pd_elementName])
     {
-        NSLog(@"DICTIONARY NOT EQUAL BECAUSE DIFFERENT ORDERED KEYS:  %@ vs. %@", self.pd_orderedKeys, dictionary.pd_orderedKeys);
         return NO;
     }
-    
-    if (!(self.pd_innerValue == nil && dictionary.pd_innerValue == nil) && ![self.pd_innerValue isEqual:dictionary.pd_innerValue])
+
+    // Nodes keep their structural hashes, so after the first comparison a difference anywhere inside them is found without walking them, and copies that still share their contents are equal without walking them.  Plain dictionaries would hash their whole subtree again at every level, so they are only walked
+    if ([self isKindOfClass:[PDNode class]] && [dictionary isKindOfClass:[PDNode class]])
+    {
+        if (self.pd_structuralHash != dictionary.pd_structuralHash)
+        {
+            return NO;
+        }
+
+        if (PDNodeSharesContents((PDNode *) self, (PDNode *) dictionary))
+        {
+            return YES;
+        }
+    }
+
+    if (!(self.pd_orderedKeys.count == 0 && dictionary.pd_orderedKeys.count == 0) && ![self.pd_orderedKeys isEqualToArray:dictionary.pd_orderedKeys])
     {
-        NSLog(@"DICTIONARY NOT EQUAL BECAUSE DIFFERENT INNER VALUES:  %@ vs. %@", self.pd_innerValue, dictionary.pd_innerValue);
         return NO;
     }
-    
-    if (!(self.pd_elementName == nil && dictionary.pd_elementName == nil) && ![self.pd_elementName isEqual:dictionary.pd_elementName])
+
+    if (!(self.pd_innerValue == nil && dictionary.pd_innerValue == nil) && ![self.pd_innerValue isEqual:dictionary.pd_innerValue])
     {
-        NSLog(@"DICTIONARY NOT EQUAL BECAUSE DIFFERENT ELEMENT NAME:  %@ vs. %@", self.pd_elementName, dictionary.pd_elementName);
         return NO;
     }
-    
+
     for (NSString* key in self)
     {
         id myValue = self[key];
         id otherValue = dictionary[key];
-        
-        if ([myValue isKindOfClass:[NSMutableDictionary class]] && ![myValue pd_isEqualToDictionary:otherValue])
+
+        if ([myValue isKindOfClass:[NSMutableDictionary class]])
         {
-            NSLog(@"DICTIONARY NOT EQUAL BECAUSE DIFFERENT NSMUTABLEDICTIONARY ELEMENT VALUES:  %@ vs. %@", [myValue pd_description], [otherValue pd_description]);
-            return NO;
+            if (![myValue pd_isEqualToDictionary:otherValue])
+            {
+                return NO;
+            }
         }
-        
-        else if ([myValue isKindOfClass:[NSArray class]] && ![myValue pd_isEqualToArray:otherValue])
+
+        else if ([myValue isKindOfClass:[NSArray class]])
+        {
+            if (![myValue pd_isEqualToArray:otherValue])
+            {
+                return NO;
+            }
+        }
+
+        else if (![myValue isEqual:otherValue])
         {
-            NSLog(@"DICTIONARY NOT EQUAL BECAUSE DIFFERENT NSARRAY ELEMENT VALUES:  %@ vs. %@", [myValue pd_description], [otherValue pd_description]);
             return NO;
         }
     }
-    
+
     return YES;
 }
 
@@ -577,132 +394,81 @@
 
 - (NSString *)pd_jsonStringWithInnerValueKey:(NSString *)keyForInnerValue
 {
-    NSString *tabs = @"";
-    NSMutableDictionary *parentDictionary = self.pd_parentDictionary;
-    while (parentDictionary != nil)
-    {
-        tabs = [tabs stringByAppendingString:@"\t"];
-        parentDictionary = parentDictionary.pd_parentDictionary;
-    }
-    NSString *result = @"{\n";
-    
-    if (!self.pd_orderedKeys.count && self.pd_innerValue)
-    {
-        return [NSString stringWithFormat:@"%@", [self.pd_innerValue isKindOfClass:[NSNumber class]] ? self.pd_innerValue : [NSString stringWithFormat:@"\"%@\"", self.pd_innerValue]];
-    }
-    
-    for (NSString *key in self.pd_orderedKeys)
-    {
-        id value = self[key];
-        if([value isKindOfClass:[NSString class]]) {
-            result = [result stringByAppendingString:[NSString stringWithFormat:@"%@%@\"%@\" : \"%@\"",tabs, @"\t",key, value]];
-        }
+    NSData *data = [PDWriter dataByWritingObject:self format:PDWriterFormatJSON options:PDWritingOptionsNone keyForInnerValue:keyForInnerValue];
+    return [[NSString alloc] initWithData:data encoding:NSUTF8StringEncoding];
+}
 
-        else if([value isKindOfClass:[NSNumber class]]) {
-            if ([[NSStringFromClass([value class]) lowercaseString] rangeOfString:@"bool"].length > 0) {
-                result =  [result stringByAppendingString:[NSString stringWithFormat:@"%@%@\"%@\" : %@",tabs, @"\t",key, [value boolValue] ? @"true" : @"false"]];
-            }
-            else {
-                result = [result stringByAppendingString:[NSString stringWithFormat:@"%@%@\"%@\" : %@",tabs, @"\t",key, value]];
-            }
-        }
 
-        else if([value isKindOfClass:[NSArray class]]) {
-            result = [result stringByAppendingString:[NSString stringWithFormat:@"%@%@\"%@\" : %@",tabs, @"\t",key, [value pd_jsonStringWithInnerValueKey:keyForInnerValue]]];
-        }
-        else if([value isKindOfClass:[NSMutableDictionary class]]) {
-            result = [result stringByAppendingString:[NSString stringWithFormat:@"%@%@\"%@\" : %@",tabs, @"\t",key, [value pd_jsonStringWithInnerValueKey:keyForInnerValue]]];
-        }
-        
-        result = [result stringByAppendingString:@",\n"];
-    }
-    
-    if ([self.pd_innerValue isKindOfClass:[NSString class]] && ((NSString *) self.pd_innerValue).length > 0)
-    {
-        result = [result stringByAppendingString:[NSString stringWithFormat:@"%@%@\"%@\" : \"%@\"\n", tabs, @"\t", keyForInnerValue, self.pd_innerValue]];
-    }
+- (NSString *)pd_xmlString
+{
+    NSData *data = [PDWriter dataByWritingObject:self format:PDWriterFormatXML options:PDWritingOptionsNone keyForInnerValue:nil];
+    return [[NSString alloc] initWithData:data encoding:NSUTF8StringEncoding];
+}
 
-    else if ([self.pd_innerValue isKindOfClass:[NSNumber class]])
-    {
-        result = [result stringByAppendingString:[NSString stringWithFormat:@"%@%@\"%@\" : %@\n", tabs, @"\t", keyForInnerValue, self.pd_innerValue]];
-    }
-    
-    else
-    {
-        result = [result substringToIndex:result.length - 2];
-        result = [result stringByAppendingString:@"\n"];
-    }
-    result = [result stringByAppendingString:[NSString stringWithFormat:@"%@}", tabs]];
-    return result;
+
+- (BOOL)pd_writeJSONToStream:(NSOutputStream *)stream options:(PDWritingOptions)options error:(NSError **)error
+{
+    return [self pd_writeJSONToStream:stream keyForInnerValue:defaultInnerValueKey options:options error:error];
 }
 
 
-- (NSString *)pd_xmlString {
-    
-    NSString *tabs = @"";
-    NSMutableDictionary *parentDictionary = self.pd_parentDictionary;
-    while (parentDictionary != nil) {
-        tabs = [tabs stringByAppendingString:@"\t"];
-        parentDictionary = parentDictionary.pd_parentDictionary;
-    }
-    
-    NSString *result = [NSString stringWithFormat:@"%@<%@ ", tabs, self.pd_elementName];
-    
-    NSUInteger attributeCount = 0;
-    
-    for (NSString *attributeName in self.pd_orderedKeys)
-    {
-        id attributeValue = self[attributeName];
-        if (![attributeValue isKindOfClass:[NSString class]])
-        {
-            continue;
-        }
-        attributeCount++;
-        result = [result stringByAppendingString:[NSString stringWithFormat:@"%@=\"%@\" ", attributeName, attributeValue]];
-    }
-    
-    if (self.pd_orderedKeys.count == attributeCount && ([self.pd_innerValue isKindOfClass:[NSString class]] && ((NSString *) self.pd_innerValue).length == 0))
-    {
-        result = [result stringByAppendingString:@"/>\n"];
-        return result;
-    }
-    
-    else{
-        result = [result substringToIndex:result.length-1];
-        result = [result stringByAppendingString:@">\n"];
-    }
-    
-    if (!self.pd_elementName)
-    {
-        result = @"";
-    }
-    
-    for (NSString *key in self.pd_orderedKeys) {
-        id value = self[key];
-        
-        if ([value isKindOfClass:[NSArray class]]) {
-            result = [result stringByAppendingString:[NSString stringWithFormat:@"%@", [value pd_xmlString]]];
-        }
-        else if ([value isKindOfClass:[NSMutableDictionary class]]) {
-            result = [result stringByAppendingString:[NSString stringWithFormat:@"%@", [value pd_xmlString]]];
-        }
-    }
-    
-    if (([self.pd_innerValue isKindOfClass:[NSString class]] && ((NSString *) self.pd_innerValue).length > 0)) {
-        result = [result stringByAppendingString:[NSString stringWithFormat:@"%@%@%@\n", tabs, @"\t", self.pd_innerValue]];
-    }
+- (BOOL)pd_writeJSONToStream:(NSOutputStream *)stream keyForInnerValue:(NSString *)keyForInnerValue options:(PDWritingOptions)options error:(NSError **)error
+{
+    PDWriter *writer = [[PDWriter alloc] initWithStream:stream];
+    writer.options = options;
+    writer.keyForInnerValue = keyForInnerValue;
+    return [writer writeObject:self error:error];
+}
 
-    else if ([self.pd_innerValue isKindOfClass:[NSNumber class]]) {
-        result = [result stringByAppendingString:[NSString stringWithFormat:@"%@%@%@\n", tabs, @"\t", self.pd_innerValue]];
-    }
-    
-    result = self.pd_elementName ? [result stringByAppendingString:[NSString stringWithFormat:@"%@</%@>\n", tabs, self.pd_elementName]] : result;
-    return result;
+
+- (BOOL)pd_writeXMLToStream:(NSOutputStream *)stream options:(PDWritingOptions)options error:(NSError **)error
+{
+    PDWriter *writer = [[PDWriter alloc] initWithStream:stream];
+    writer.format = PDWriterFormatXML;
+    writer.options = options;
+    return [writer writeObject:self error:error];
+}
+
+
+- (BOOL)pd_writeJSONToFileDescriptor:(int)fileDescriptor options:(PDWritingOptions)options error:(NSError **)error
+{
+    PDWriter *writer = [[PDWriter alloc] initWithFileDescriptor:fileDescriptor];
+    writer.options = options;
+    return [writer writeObject:self error:error];
+}
+
+
+- (BOOL)pd_writeXMLToFileDescriptor:(int)fileDescriptor options:(PDWritingOptions)options error:(NSError **)error
+{
+    PDWriter *writer = [[PDWriter alloc] initWithFileDescriptor:fileDescriptor];
+    writer.format = PDWriterFormatXML;
+    writer.options = options;
+    return [writer writeObject:self error:error];
+}
+
+
+- (BOOL)pd_writeBinarySnapshotToFile:(NSString *)path error:(NSError **)error
+{
+    return [PDSnapshot writeObject:self toFile:path error:error];
+}
+
+- (NSData *)pd_jsonDataWithOptions:(PDWritingOptions)options
+{
+    return [PDWriter dataByWritingObject:self format:PDWriterFormatJSON options:options keyForInnerValue:defaultInnerValueKey];
+}
+
+
+- (NSData *)pd_xmlDataWithOptions:(PDWritingOptions)options
+{
+    return [PDWriter dataByWritingObject:self format:PDWriterFormatXML options:options keyForInnerValue:nil];
 }
 
 - (instancetype)pd_copy
 {
-    NSMutableDictionary *copy = [NSMutableDictionary dictionary];
+    PDStatsToken token = PDStatsBeginOperation(PDStatsOperationCopy, nil);
+    PDStatsAdd(nodesCopied, 1);
+
+    NSMutableDictionary *copy = [PDNode dictionary];
     for (NSString *key in self.pd_orderedKeys) {
         id value = self[key];
 
@@ -723,8 +489,19 @@
 
     copy.pd_innerValue = self.pd_innerValue;
 
+    PDStatsEndOperation(token, nil, 0);
     return copy;
 }
 
+- (BOOL)pd_isFrozen
+{
+    return NO;
+}
+
+- (instancetype)pd_freeze
+{
+    return PDNodeFreezeObject(self);
+}
+
 
 @end
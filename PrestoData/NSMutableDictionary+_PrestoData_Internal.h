@@ -24,6 +24,18 @@
 
 #import <Foundation/Foundation.h>
 
+@class PDNameMatcher;
+@class PDElementIndex;
+
+/** Mixes the hash of one part of a dictionary or array into the structural hash of the whole */
+static inline uint64_t PDStructuralHashCombine(uint64_t hash, uint64_t value)
+{
+    return hash ^ (value + 0x9e3779b97f4a7c15ULL + (hash << 6) + (hash >> 2));
+}
+
+/** Returns the structural hash of an element or array of elements, or the hash of an attribute value */
+uint64_t PDStructuralHashOfValue(id value);
+
 /** This category is used internally by PrestoData for keeping track of the element name and parent reference for a dictionary element */
 
 @interface NSMutableDictionary (_PrestoData_Internal)
@@ -37,9 +49,48 @@
 /** The name of the element this dictionary is stored as */
 @property (nonatomic, copy) NSString *pd_elementName;
 
-/** Transfers attribute values with the specified key name to the NSMutableDictionary.pd_innerValue property ]
-* @param key The name of the key for this dictionary and any child dictionaries whose value should be copied over to the pd_innerValue property and then removed as an attribute
-* */
-- (void)pd_setParsedDictionaryPropertiesWithInnerValueKey:(NSString *)key;
+/** The index of descendant elements by name built by pd_buildElementIndex, or nil */
+@property (nonatomic, strong) PDElementIndex *pd_elementIndex;
+
+/** The mutable array of keys in insertion order that backs pd_orderedKeys.  Kept in an associated object for plain dictionaries.  PDNode keeps its keys ordered in its own storage and doesn't use this */
+- (NSMutableArray *)privateOrderedKeys;
+
+/** Sets the value for a key, appending the key to pd_orderedKeys if it isn't already present
+* @param object The value to store
+* @param key The attribute or element name
+*/
+- (void)pd_setObject:(id)object forOrderedKey:(NSString *)key;
+
+/** Removes the value for a key, and the key from pd_orderedKeys
+* @param key The attribute or element name
+*/
+- (void)pd_removeObjectForOrderedKey:(NSString *)key;
+
+/** Returns a number that orders a key among pd_orderedKeys: a key that comes earlier has a smaller number.  Unlike the key's index in pd_orderedKeys, this is O(1) for a PDNode
+* @param key The attribute or element name
+* @return The number, or NSNotFound if the key isn't present
+*/
+- (NSUInteger)pd_orderOfOrderedKey:(NSString *)key;
+
+/** A hash of everything pd_isEqualToDictionary: compares except the dictionary's own element name: its keys in order, its attribute values and inner value, and the structural hashes of its elements.  Dictionaries that are equal have equal hashes.  A PDNode keeps its hash until it or one of its descendants changes, and a copy-on-write copy starts with the hash of its original.  A plain dictionary computes it again each time
+* @return The hash, which is never 0
+*/
+- (uint64_t)pd_structuralHash;
+
+/** Called before the dictionary's keys, values or inner value, or the contents of one of its element arrays, are changed by a PrestoData method.  Copy-on-write copies of this dictionary or of its ancestors that haven't copied their contents yet do so first, so they never see the change.  Raises NSInternalInconsistencyException if the dictionary is frozen */
+- (void)pd_willChange;
+
+
+/** Appends the child elements whose names match the specified matcher, in document order
+* @param matcher The compiled name pattern
+* @param children The array to append matching children to
+*/
+- (void)pd_addChildrenMatching:(PDNameMatcher *)matcher toArray:(NSMutableArray *)children;
+
+/** Appends the descendant elements whose names match the specified matcher, in document order: each element comes before its own descendants
+* @param matcher The compiled name pattern
+* @param descendants The array to append matching descendants to
+*/
+- (void)pd_addDescendantsMatching:(PDNameMatcher *)matcher toArray:(NSMutableArray *)descendants;
 
 @end
@@ -24,13 +24,29 @@
 
 #import "NSMutableDictionary+_PrestoData_Internal.h"
 #import "NSMutableDictionary+PrestoData.h"
+#import "NSArray+_PrestoData_Internal.h"
+#import "PDNameMatcher.h"
+#import "PDElementIndex.h"
 #import <objc/runtime.h>
 
+uint64_t PDStructuralHashOfValue(id value)
+{
+    if ([value isKindOfClass:[NSMutableDictionary class]] || [value isKindOfClass:[NSArray class]])
+    {
+        return [value pd_structuralHash];
+    }
+
+    // Attribute values that are equal have equal hashes, whatever their class
+    return [value hash];
+}
+
+
 @implementation NSMutableDictionary (_PrestoData_Internal)
 
 
 - (void)setPd_innerValue:(id)value
 {
+    [self pd_willChange];
     objc_setAssociatedObject(self, @selector(pd_innerValue), value, OBJC_ASSOCIATION_COPY_NONATOMIC);
 }
 
@@ -50,29 +66,155 @@
     objc_setAssociatedObject(self, @selector(pd_elementName), value, OBJC_ASSOCIATION_COPY_NONATOMIC);
 }
 
-- (void)pd_setParsedDictionaryPropertiesWithInnerValueKey:(NSString *)key
+
+- (PDElementIndex *)pd_elementIndex
 {
-    for (NSString *keyName in [self allKeys])
+    return objc_getAssociatedObject(self, @selector(pd_elementIndex));
+}
+
+
+- (void)setPd_elementIndex:(PDElementIndex *)elementIndex
+{
+    objc_setAssociatedObject(self, @selector(pd_elementIndex), elementIndex, OBJC_ASSOCIATION_RETAIN_NONATOMIC);
+}
+
+
+- (NSMutableArray *)privateOrderedKeys
+{
+    NSMutableArray *keys = objc_getAssociatedObject(self, @selector(pd_orderedKeys));
+    if (keys == nil) {
+        keys = [NSMutableArray array];
+        objc_setAssociatedObject(self, @selector(pd_orderedKeys), keys, OBJC_ASSOCIATION_RETAIN_NONATOMIC);
+    }
+    return keys;
+}
+
+
+- (void)pd_setObject:(id)object forOrderedKey:(NSString *)key
+{
+    [self pd_willChange];
+
+    id oldValue = self[key];
+    if (!oldValue)
+    {
+        [[self privateOrderedKeys] addObject:key];
+    }
+    else
+    {
+        PDElementIndexesRemoveValue(self, key, oldValue);
+    }
+
+    self[key] = object;
+    PDElementIndexesAddValue(self, key, object);
+}
+
+
+- (void)pd_removeObjectForOrderedKey:(NSString *)key
+{
+    if (self[key])
     {
-        id value = self[keyName];
-        if ([value isKindOfClass:[NSString class]] && [keyName isEqualToString:key])
+        [self pd_willChange];
+        PDElementIndexesRemoveValue(self, key, self[key]);
+        [[self privateOrderedKeys] removeObject:key];
+        [self removeObjectForKey:key];
+    }
+}
+
+
+- (NSUInteger)pd_orderOfOrderedKey:(NSString *)key
+{
+    return [[self privateOrderedKeys] indexOfObject:key];
+}
+
+
+- (void)pd_willChange
+{
+    // A plain dictionary has no copies of its own, but it may be part of a node that does
+    [self.pd_parentDictionary pd_willChange];
+}
+
+
+- (uint64_t)pd_structuralHash
+{
+    NSArray *keys = self.pd_orderedKeys;
+    uint64_t hash = PDStructuralHashCombine(0, keys.count);
+
+    for (NSString *key in keys)
+    {
+        hash = PDStructuralHashCombine(hash, key.hash);
+        hash = PDStructuralHashCombine(hash, PDStructuralHashOfValue(self[key]));
+    }
+
+    id innerValue = self.pd_innerValue;
+    if (innerValue)
+    {
+        hash = PDStructuralHashCombine(hash, [innerValue hash]);
+    }
+
+    return hash ? hash : 1;
+}
+
+
+- (void)pd_addChildrenMatching:(PDNameMatcher *)matcher toArray:(NSMutableArray *)children
+{
+    for (NSString *key in self.pd_orderedKeys)
+    {
+        if ([matcher matchesName:key])
         {
-            [self pd_setInnerValue:value];
-            [self pd_deleteAttribute:keyName];
+            id value = self[key];
+            if ([value isKindOfClass:[NSMutableDictionary class]])
+            {
+                [children addObject:value];
+            }
+            else if ([value isKindOfClass:[NSArray class]])
+            {
+                [children addObjectsFromArray:value];
+            }
         }
+    }
+}
 
-        else if ([value isKindOfClass:[NSMutableDictionary class]])
+
+- (void)pd_addDescendantsMatching:(PDNameMatcher *)matcher toArray:(NSMutableArray *)descendants
+{
+    // Only an index's own root is answered from it.  Below the root, placing this dictionary in the index's lists would cost more than searching its subtree
+    NSString *exactName = matcher.exactName;
+    if (exactName && PDElementIndexesExist)
+    {
+        NSArray *indexed = [self.pd_elementIndex elementsNamed:exactName];
+        if (indexed)
         {
-            [value pd_setParsedDictionaryPropertiesWithInnerValueKey:key];
+            [descendants addObjectsFromArray:indexed];
+            return;
         }
+    }
 
+    // Each child comes before its own descendants and after the descendants of the children before it, which is document order
+    for (NSString *key in self.pd_orderedKeys)
+    {
+        id value = self[key];
+        BOOL matches = [matcher matchesName:key];
+
+        if ([value isKindOfClass:[NSMutableDictionary class]])
+        {
+            if (matches)
+            {
+                [descendants addObject:value];
+            }
+            [value pd_addDescendantsMatching:matcher toArray:descendants];
+        }
         else if ([value isKindOfClass:[NSArray class]])
         {
-            for (NSMutableDictionary *dictionary in value)
+            for (NSMutableDictionary *element in value)
             {
-                [dictionary pd_setParsedDictionaryPropertiesWithInnerValueKey:key];
+                if (matches)
+                {
+                    [descendants addObject:element];
+                }
+                [element pd_addDescendantsMatching:matcher toArray:descendants];
             }
         }
     }
 }
+
 @end
@@ -0,0 +1,68 @@
+//
+// NSNumber+_PrestoData_Internal.h
+//
+// Copyright (c) 2015 Daniel Hall
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+
+#import <Foundation/Foundation.h>
+
+/** This category and these functions are used internally by PrestoData for recognizing numeric text in parsed documents, and for writing numbers and telling booleans apart from them */
+
+
+/** Writes an integer as decimal text, without the overhead of snprintf
+* @param magnitude The absolute value of the integer
+* @param negative Whether to begin with a minus sign
+* @param buffer Receives the NUL-terminated text, which is at most 21 bytes before the NUL
+* @return The length of the text
+*/
+size_t PDNumberFormatInteger(uint64_t magnitude, BOOL negative, char *buffer);
+
+/** Writes the shortest decimal text, of up to 17 significant digits, that reads back as exactly the same double.  The decimal point is always a '.', whatever the current locale
+* @param value A finite double
+* @param buffer Receives the NUL-terminated text.  32 bytes is always enough
+* @param size The size of the buffer
+* @return The length of the text
+*/
+size_t PDNumberFormatDouble(double value, char *buffer, size_t size);
+
+/** Writes a number as PDWriter writes it in JSON: integers exactly, and other numbers in their shortest round-trip form.  Booleans are not handled
+* @param number The number to write
+* @param buffer Receives the NUL-terminated text.  32 bytes is always enough
+* @param size The size of the buffer
+* @return The length of the text, or 0 if the number is NaN or infinite and so has no text
+*/
+size_t PDNumberFormat(NSNumber *number, char *buffer, size_t size);
+
+
+@interface NSNumber (_PrestoData_Internal)
+
+/** Converts UTF8 text to a number if all of it is a plain decimal number: an optional sign, digits with an optional decimal point, and an optional exponent.  The conversion never depends on the current locale, and text that can't be a number is rejected by looking at its first byte
+* @param bytes The text to convert
+* @param length The number of bytes of text
+* @return A long long NSNumber for whole numbers without a decimal point or exponent that fit in one, an unsigned long long NSNumber for larger ones that fit in 64 bits, a double NSNumber for other numbers, or nil if the text is not a number
+*/
++ (NSNumber *)pd_numberFromDecimalBytes:(const uint8_t *)bytes length:(NSUInteger)length;
+
+/** YES if the number was created from a BOOL, such as @YES or a parsed JSON true, rather than from an integer that happens to be 0 or 1 */
+@property (nonatomic, readonly) BOOL pd_isBoolean;
+
+@end
@@ -0,0 +1,304 @@
+//
+// NSNumber+_PrestoData_Internal.m
+//
+// Copyright (c) 2015 Daniel Hall
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+
+#import "NSNumber+_PrestoData_Internal.h"
+#include <limits.h>
+#include <locale.h>
+#include <math.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#if defined(__APPLE__)
+#include <xlocale.h>
+#endif
+
+static locale_t PDNumberCLocale;
+static pthread_once_t PDNumberCLocaleOnce = PTHREAD_ONCE_INIT;
+
+static void PDNumberCreateCLocale(void)
+{
+    PDNumberCLocale = newlocale(LC_ALL_MASK, "C", (locale_t)0);
+}
+
+static inline BOOL PDNumberIsDigit(uint8_t byte)
+{
+    return byte >= '0' && byte <= '9';
+}
+
+/** Reads a run of digits as an exact integer, returning NO if it doesn't fit in 64 bits */
+static BOOL PDNumberReadInteger(const uint8_t *digits, NSUInteger count, uint64_t *value)
+{
+    uint64_t result = 0;
+
+    for (NSUInteger i = 0; i < count; i++)
+    {
+        if (__builtin_mul_overflow(result, 10, &result) || __builtin_add_overflow(result, (uint64_t)(digits[i] - '0'), &result))
+        {
+            return NO;
+        }
+    }
+
+    *value = result;
+    return YES;
+}
+
+size_t PDNumberFormatInteger(uint64_t magnitude, BOOL negative, char *buffer)
+{
+    char digits[20];
+    size_t count = 0;
+
+    do
+    {
+        digits[count++] = (char)('0' + magnitude % 10);
+        magnitude /= 10;
+    }
+    while (magnitude);
+
+    size_t length = 0;
+    if (negative)
+    {
+        buffer[length++] = '-';
+    }
+    while (count)
+    {
+        buffer[length++] = digits[--count];
+    }
+    buffer[length] = '\0';
+
+    return length;
+}
+
+size_t PDNumberFormatDouble(double value, char *buffer, size_t size)
+{
+    pthread_once(&PDNumberCLocaleOnce, PDNumberCreateCLocale);
+
+    // snprintf has no locale parameter everywhere, so the "C" locale is switched in for this thread only.  Most doubles read back exactly from 15 significant digits, and every double does from 17
+    locale_t previousLocale = uselocale(PDNumberCLocale);
+    int length = 0;
+
+    for (int precision = 15; precision <= 17; precision++)
+    {
+        length = snprintf(buffer, size, "%.*g", precision, value);
+        if (strtod_l(buffer, NULL, PDNumberCLocale) == value)
+        {
+            break;
+        }
+    }
+
+    uselocale(previousLocale);
+    return length > 0 ? (size_t)length : 0;
+}
+
+size_t PDNumberFormat(NSNumber *number, char *buffer, size_t size)
+{
+    switch (number.objCType[0])
+    {
+        case 'c':
+        case 's':
+        case 'i':
+        case 'l':
+        case 'q':
+        {
+            long long value = number.longLongValue;
+            return PDNumberFormatInteger(value < 0 ? 0 - (uint64_t)value : (uint64_t)value, value < 0, buffer);
+        }
+
+        case 'C':
+        case 'S':
+        case 'I':
+        case 'L':
+        case 'Q':
+            return PDNumberFormatInteger(number.unsignedLongLongValue, NO, buffer);
+
+        default:
+        {
+            double value = number.doubleValue;
+            return isfinite(value) ? PDNumberFormatDouble(value, buffer, size) : 0;
+        }
+    }
+}
+
+
+@implementation NSNumber (_PrestoData_Internal)
+
++ (NSNumber *)pd_numberFromDecimalBytes:(const uint8_t *)bytes length:(NSUInteger)length
+{
+    // Most text isn't numeric, and nearly all of it can be turned away here without scanning
+    if (length == 0 || !(PDNumberIsDigit(bytes[0]) || bytes[0] == '-' || bytes[0] == '+' || bytes[0] == '.'))
+    {
+        return nil;
+    }
+
+    NSUInteger position = 0;
+    BOOL negative = bytes[0] == '-';
+    if (bytes[0] == '-' || bytes[0] == '+')
+    {
+        position++;
+    }
+
+    uint64_t mantissa = 0;
+    NSUInteger significantDigits = 0;
+    NSUInteger digits = 0;
+    long exponent = 0;
+    BOOL sawPoint = NO;
+    BOOL sawExponent = NO;
+
+    for (; position < length; position++)
+    {
+        uint8_t byte = bytes[position];
+
+        if (byte == '.' && !sawPoint)
+        {
+            sawPoint = YES;
+            continue;
+        }
+
+        if (!PDNumberIsDigit(byte))
+        {
+            break;
+        }
+
+        digits++;
+        if (significantDigits < 19)
+        {
+            mantissa = mantissa * 10 + (uint64_t)(byte - '0');
+            if (mantissa)
+            {
+                significantDigits++;
+            }
+            if (sawPoint)
+            {
+                exponent--;
+            }
+        }
+        else if (!sawPoint)
+        {
+            exponent++;
+        }
+    }
+
+    if (digits == 0)
+    {
+        return nil;
+    }
+
+    if (position < length && (bytes[position] == 'e' || bytes[position] == 'E'))
+    {
+        sawExponent = YES;
+        position++;
+
+        BOOL negativeExponent = position < length && bytes[position] == '-';
+        if (position < length && (bytes[position] == '-' || bytes[position] == '+'))
+        {
+            position++;
+        }
+
+        long explicitExponent = 0;
+        NSUInteger exponentDigits = 0;
+        for (; position < length && PDNumberIsDigit(bytes[position]); position++, exponentDigits++)
+        {
+            if (explicitExponent < 100000)
+            {
+                explicitExponent = explicitExponent * 10 + (bytes[position] - '0');
+            }
+        }
+
+        if (exponentDigits == 0)
+        {
+            return nil;
+        }
+
+        exponent += negativeExponent ? -explicitExponent : explicitExponent;
+    }
+
+    if (position != length)
+    {
+        return nil;
+    }
+
+    // Whole numbers are kept exactly across the whole 64-bit range, so that large identifiers don't lose their last digits to a double
+    if (!sawPoint && !sawExponent)
+    {
+        NSUInteger firstDigit = bytes[0] == '-' || bytes[0] == '+' ? 1 : 0;
+        uint64_t magnitude;
+
+        if (PDNumberReadInteger(bytes + firstDigit, length - firstDigit, &magnitude))
+        {
+            if (!negative && magnitude > (uint64_t)LLONG_MAX)
+            {
+                return @((unsigned long long)magnitude);
+            }
+            if (!negative || magnitude <= (uint64_t)LLONG_MAX)
+            {
+                return @(negative ? -(long long)magnitude : (long long)magnitude);
+            }
+            if (magnitude == (uint64_t)LLONG_MAX + 1)
+            {
+                return @(LLONG_MIN);
+            }
+        }
+    }
+
+    // Small mantissas scaled by an exact power of ten are correctly rounded, which covers nearly every value in real documents
+    static const double powersOfTen[] = { 1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11, 1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22 };
+
+    if (mantissa <= (1ULL << 53) && exponent >= -22 && exponent <= 22)
+    {
+        double value = exponent < 0 ? (double)mantissa / powersOfTen[-exponent] : (double)mantissa * powersOfTen[exponent];
+        return @(negative ? -value : value);
+    }
+
+    // Everything else goes to the C library, pinned to the "C" locale so a decimal comma setting can't change the result
+    pthread_once(&PDNumberCLocaleOnce, PDNumberCreateCLocale);
+
+    char stackBuffer[64];
+    char *buffer = length < sizeof(stackBuffer) ? stackBuffer : malloc(length + 1);
+    memcpy(buffer, bytes, length);
+    buffer[length] = '\0';
+    double value = strtod_l(buffer, NULL, PDNumberCLocale);
+
+    if (buffer != stackBuffer)
+    {
+        free(buffer);
+    }
+
+    return @(value);
+}
+
+- (BOOL)pd_isBoolean
+{
+    static Class booleanClass;
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        // Booleans have their own concrete NSNumber subclass on Apple platforms and in GNUstep
+        Class candidate = [[NSNumber numberWithBool:YES] class];
+        booleanClass = candidate != [[NSNumber numberWithInt:1] class] ? candidate : Nil;
+    });
+
+    return (booleanClass && [self isKindOfClass:booleanClass]) || strcmp(self.objCType, @encode(bool)) == 0;
+}
+
+@end
@@ -0,0 +1,76 @@
+//
+// PDDocumentCache.h
+//
+// Copyright (c) 2015 Daniel Hall
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+
+
+#import <Foundation/Foundation.h>
+
+/** A cache of parsed JSON documents, keyed by file path.  Loading a file that is already cached, and hasn't changed on disk since, skips reading and parsing it and only copies the cached dictionary or array.
+*
+* Every load checks the file's inode, size and modification time, so a file that has been replaced or rewritten is parsed again.  Cached documents are frozen with pd_freeze, and callers always get their own mutable copy, so changes to it never affect the cache or other callers and copies are made without locking.  When the cached documents exceed the memory budget, the least recently used are evicted first.
+*
+* Caching costs a parse, a freeze of the whole document and a copy on every miss, which only pays off for files that are loaded again.  A cache may be used from any thread or queue.  The PrestoData loading methods use the shared cache, which caches nothing until it is given a memory budget.
+*/
+
+@interface PDDocumentCache : NSObject
+
+/** Returns the cache used by the PrestoData loading methods.  Its memory budget is 0, which turns caching off, until it is set */
++ (instancetype)sharedCache;
+
+/** Creates an empty cache.  init creates one with a memory budget of 32MB
+* @param memoryBudget The estimated number of bytes the cached documents may use.  See memoryBudget
+* @return The new cache
+*/
+- (instancetype)initWithMemoryBudget:(NSUInteger)memoryBudget;
+
+/** The estimated number of bytes the cached documents may use.  The memory used by a parsed document is estimated from the size of its file.  Documents larger than the whole budget are never cached, and a budget of 0 turns caching off.  Lowering the budget evicts documents straight away */
+@property (nonatomic, assign) NSUInteger memoryBudget;
+
+/** The estimated number of bytes used by the documents currently in the cache */
+@property (nonatomic, readonly) NSUInteger totalCost;
+
+/** The number of loads answered from the cache */
+@property (nonatomic, readonly) NSUInteger hitCount;
+
+/** The number of loads that had to read and parse the file, including loads of files that had changed since they were cached */
+@property (nonatomic, readonly) NSUInteger missCount;
+
+/** The number of documents evicted to stay within the memory budget */
+@property (nonatomic, readonly) NSUInteger evictionCount;
+
+/** Loads a JSON file, from the cache if it hasn't changed since it was cached
+* @param filePath The path of the JSON file
+* @return A new NSMutableDictionary or NSArray, depending on what the JSON contains, that belongs to the caller.  nil if the file can't be read or isn't a JSON object or array
+*/
+- (id)objectFromJSONFileAtPath:(NSString *)filePath;
+
+/** Removes the cached document for a file, if there is one
+* @param filePath The path of the JSON file
+*/
+- (void)removeObjectForFileAtPath:(NSString *)filePath;
+
+/** Removes every cached document.  The hit, miss and eviction counts are kept */
+- (void)removeAllObjects;
+
+@end
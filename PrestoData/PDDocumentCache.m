@@ -0,0 +1,357 @@
+//
+// PDDocumentCache.m
+//
+// Copyright (c) 2015 Daniel Hall
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+
+#import "PDDocumentCache.h"
+#import "PDJSONParser.h"
+#import "NSMutableDictionary+PrestoData.h"
+#import "NSArray+PrestoData.h"
+#import "PDNode+_PrestoData_Internal.h"
+#import <pthread.h>
+#include <sys/stat.h>
+
+extern NSString *const defaultInnerValueKey;
+
+/** The memory budget of caches created with init.  The shared cache starts with a budget of 0, so that the PrestoData loading methods only cache when asked to */
+static const NSUInteger PDDocumentCacheDefaultMemoryBudget = 32 * 1024 * 1024;
+
+/** A parsed tree of dictionaries, arrays and strings takes several times the memory of the JSON it was parsed from.  Cached documents are charged this many bytes per byte of their file */
+static const NSUInteger PDDocumentCacheCostPerFileByte = 4;
+
+static PDDocumentCache *PDDocumentCacheShared;
+static pthread_once_t PDDocumentCacheSharedOnce = PTHREAD_ONCE_INIT;
+
+static void PDDocumentCacheCreateShared(void)
+{
+    PDDocumentCacheShared = [[PDDocumentCache alloc] initWithMemoryBudget:0];
+}
+
+
+/** The identity of a file's contents, as far as can be told without reading it */
+typedef struct
+{
+    dev_t device;
+    ino_t inode;
+    off_t size;
+    struct timespec modificationTime;
+} PDFileVersion;
+
+static BOOL PDFileVersionOfPath(NSString *filePath, PDFileVersion *version)
+{
+    struct stat info;
+    if (stat(filePath.fileSystemRepresentation, &info) != 0 || !S_ISREG(info.st_mode))
+    {
+        return NO;
+    }
+
+    version->device = info.st_dev;
+    version->inode = info.st_ino;
+    version->size = info.st_size;
+#ifdef __APPLE__
+    version->modificationTime = info.st_mtimespec;
+#else
+    version->modificationTime = info.st_mtim;
+#endif
+    return YES;
+}
+
+static inline BOOL PDFileVersionsEqual(const PDFileVersion *a, const PDFileVersion *b)
+{
+    return a->device == b->device && a->inode == b->inode && a->size == b->size && a->modificationTime.tv_sec == b->modificationTime.tv_sec && a->modificationTime.tv_nsec == b->modificationTime.tv_nsec;
+}
+
+
+/** A cached document and the version of the file it was parsed from */
+
+@interface PDDocumentCacheEntry : NSObject
+{
+@public
+    id _object;
+    PDFileVersion _version;
+    NSUInteger _cost;
+    uint64_t _lastUse;
+}
+
+@end
+
+@implementation PDDocumentCacheEntry
+
+@end
+
+
+@implementation PDDocumentCache
+{
+    pthread_mutex_t _lock;
+    NSMutableDictionary *_entries;
+    uint64_t _clock;
+    NSUInteger _memoryBudget;
+    NSUInteger _totalCost;
+    NSUInteger _hitCount;
+    NSUInteger _missCount;
+    NSUInteger _evictionCount;
+}
+
++ (instancetype)sharedCache
+{
+    pthread_once(&PDDocumentCacheSharedOnce, PDDocumentCacheCreateShared);
+    return PDDocumentCacheShared;
+}
+
+- (instancetype)init
+{
+    return [self initWithMemoryBudget:PDDocumentCacheDefaultMemoryBudget];
+}
+
+- (instancetype)initWithMemoryBudget:(NSUInteger)memoryBudget
+{
+    self = [super init];
+
+    if (self) {
+        pthread_mutex_init(&_lock, NULL);
+        _entries = [NSMutableDictionary dictionary];
+        _memoryBudget = memoryBudget;
+    }
+
+    return self;
+}
+
+- (void)dealloc
+{
+    pthread_mutex_destroy(&_lock);
+}
+
+- (id)objectFromJSONFileAtPath:(NSString *)filePath
+{
+    // With caching off, a load costs no more than parsing the file: nothing is looked up, frozen or copied
+    if (!self.memoryBudget)
+    {
+        pthread_mutex_lock(&_lock);
+        _missCount++;
+        pthread_mutex_unlock(&_lock);
+
+        return filePath ? [self objectByParsingFileAtPath:filePath] : nil;
+    }
+
+    PDFileVersion version;
+
+    if (!filePath || !PDFileVersionOfPath(filePath, &version))
+    {
+        [self removeObjectForFileAtPath:filePath];
+        return nil;
+    }
+
+    pthread_mutex_lock(&_lock);
+    PDDocumentCacheEntry *entry = _entries[filePath];
+    if (entry && PDFileVersionsEqual(&entry->_version, &version))
+    {
+        entry->_lastUse = ++_clock;
+        _hitCount++;
+    }
+    else
+    {
+        entry = nil;
+        _missCount++;
+    }
+    pthread_mutex_unlock(&_lock);
+
+    // The cached document is frozen, so copies of it are made outside the cache's lock, and load their contents without PDNodeCopyLock when they are first used
+    if (entry)
+    {
+        return [entry->_object pd_copy];
+    }
+
+    id object = [self objectByParsingFileAtPath:filePath];
+    if (!object)
+    {
+        return nil;
+    }
+
+    // A file that changed while it was being read may have been parsed half old and half new, so it is returned but not cached
+    PDFileVersion versionAfterReading;
+    NSUInteger cost = (NSUInteger) version.size * PDDocumentCacheCostPerFileByte;
+
+    if (!PDFileVersionOfPath(filePath, &versionAfterReading) || !PDFileVersionsEqual(&version, &versionAfterReading) || cost > self.memoryBudget)
+    {
+        return object;
+    }
+
+    // Frozen before it is cached, so that copies of it are made and loaded without PDNodeCopyLock, and the caller gets a copy like everyone else even if the budget has just been lowered
+    object = PDNodeFreezeObject(object);
+    [self cacheObject:object version:&version cost:cost forPath:filePath];
+
+    return [object pd_copy];
+}
+
+- (id)objectByParsingFileAtPath:(NSString *)filePath
+{
+    // Mapping the file lets the parser read it straight from the page cache instead of copying it into memory first
+    NSData *data = [NSData dataWithContentsOfFile:filePath options:NSDataReadingMappedIfSafe error:NULL];
+
+    if (!data)
+    {
+        return nil;
+    }
+
+    PDJSONParser *parser = [[PDJSONParser alloc] initWithJSONData:data keyForInnerValue:defaultInnerValueKey];
+    return [parser parsedObject];
+}
+
+- (BOOL)cacheObject:(id)object version:(const PDFileVersion *)version cost:(NSUInteger)cost forPath:(NSString *)filePath
+{
+    pthread_mutex_lock(&_lock);
+
+    BOOL fits = cost <= _memoryBudget;
+    if (fits)
+    {
+        [self removeEntryForPath:filePath];
+        [self evictEntriesToFitCost:cost];
+
+        PDDocumentCacheEntry *entry = [[PDDocumentCacheEntry alloc] init];
+        entry->_object = object;
+        entry->_version = *version;
+        entry->_cost = cost;
+        entry->_lastUse = ++_clock;
+        _entries[filePath] = entry;
+        _totalCost += cost;
+    }
+
+    pthread_mutex_unlock(&_lock);
+
+    return fits;
+}
+
+- (void)removeObjectForFileAtPath:(NSString *)filePath
+{
+    if (!filePath)
+    {
+        return;
+    }
+
+    pthread_mutex_lock(&_lock);
+    [self removeEntryForPath:filePath];
+    pthread_mutex_unlock(&_lock);
+}
+
+- (void)removeAllObjects
+{
+    pthread_mutex_lock(&_lock);
+    [_entries removeAllObjects];
+    _totalCost = 0;
+    pthread_mutex_unlock(&_lock);
+}
+
+
+#pragma mark - Budget and Counters
+
+- (NSUInteger)memoryBudget
+{
+    pthread_mutex_lock(&_lock);
+    NSUInteger memoryBudget = _memoryBudget;
+    pthread_mutex_unlock(&_lock);
+
+    return memoryBudget;
+}
+
+- (void)setMemoryBudget:(NSUInteger)memoryBudget
+{
+    pthread_mutex_lock(&_lock);
+    _memoryBudget = memoryBudget;
+    [self evictEntriesToFitCost:0];
+    pthread_mutex_unlock(&_lock);
+}
+
+- (NSUInteger)totalCost
+{
+    pthread_mutex_lock(&_lock);
+    NSUInteger totalCost = _totalCost;
+    pthread_mutex_unlock(&_lock);
+
+    return totalCost;
+}
+
+- (NSUInteger)hitCount
+{
+    pthread_mutex_lock(&_lock);
+    NSUInteger hitCount = _hitCount;
+    pthread_mutex_unlock(&_lock);
+
+    return hitCount;
+}
+
+- (NSUInteger)missCount
+{
+    pthread_mutex_lock(&_lock);
+    NSUInteger missCount = _missCount;
+    pthread_mutex_unlock(&_lock);
+
+    return missCount;
+}
+
+- (NSUInteger)evictionCount
+{
+    pthread_mutex_lock(&_lock);
+    NSUInteger evictionCount = _evictionCount;
+    pthread_mutex_unlock(&_lock);
+
+    return evictionCount;
+}
+
+
+#pragma mark - Eviction
+
+/** Must be called with the lock held */
+- (void)removeEntryForPath:(NSString *)filePath
+{
+    PDDocumentCacheEntry *entry = _entries[filePath];
+    if (entry)
+    {
+        _totalCost -= entry->_cost;
+        [_entries removeObjectForKey:filePath];
+    }
+}
+
+/** Evicts the least recently used documents until one costing the given amount fits in the budget.  Must be called with the lock held */
+- (void)evictEntriesToFitCost:(NSUInteger)cost
+{
+    while (_entries.count && _totalCost + cost > _memoryBudget)
+    {
+        NSString *leastRecentPath = nil;
+        uint64_t leastRecentUse = UINT64_MAX;
+
+        for (NSString *path in _entries)
+        {
+            PDDocumentCacheEntry *entry = _entries[path];
+            if (entry->_lastUse < leastRecentUse)
+            {
+                leastRecentUse = entry->_lastUse;
+                leastRecentPath = path;
+            }
+        }
+
+        [self removeEntryForPath:leastRecentPath];
+        _evictionCount++;
+    }
+}
+
+@end
@@ -0,0 +1,126 @@
+//
+// PDEdit.h
+//
+// Copyright (c) 2015 Daniel Hall
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+
+
+#import <Foundation/Foundation.h>
+
+/** The kinds of change a PDEdit can make to the elements matching its query */
+typedef NS_ENUM(NSUInteger, PDEditType)
+{
+    /** Sets an attribute to a new value, creating the attribute if it doesn't exist yet */
+    PDEditTypeSetValue,
+
+    /** Removes an attribute */
+    PDEditTypeRemoveAttribute,
+
+    /** Adds a child element, combining it with any existing elements of the same name into an array */
+    PDEditTypeAddElement,
+
+    /** Removes every child element with a given name */
+    PDEditTypeRemoveElement,
+
+    /** Sets the inner value, or removes it if the new value is nil */
+    PDEditTypeSetInnerValue,
+
+    /** Removes the matching elements themselves from their parents, leaving any siblings with the same name */
+    PDEditTypeRemoveMatchingElements
+};
+
+/** A single change to a PrestoData dictionary or array: an XPath 1.0-style query selecting the elements to change, and what to do to them.  Edits are immutable and can be applied to any number of documents.
+*
+* A list of edits is applied with applyEdits:toObject:, or loaded, applied and saved in one go with the PrestoData batch methods, so that a file is only parsed once however many edits are made to it.
+*/
+
+@interface PDEdit : NSObject
+
+/** The kind of change this edit makes */
+@property (nonatomic, assign, readonly) PDEditType type;
+
+/** The XPath 1.0-style query selecting the elements to change, or nil to change the root object */
+@property (nonatomic, copy, readonly) NSString *xpathQuery;
+
+/** The name of the attribute or element being set, added or removed, or nil for the types that don't name one */
+@property (nonatomic, copy, readonly) NSString *name;
+
+/** The new attribute value for PDEditTypeSetValue, the new inner value for PDEditTypeSetInnerValue, or the new element for PDEditTypeAddElement.  nil for the other types */
+@property (nonatomic, strong, readonly) id value;
+
+/** Creates an edit that sets an attribute value on all matching elements, like pd_setValue:forAttribute:
+* @param value A new NSString or NSNumber value for the attribute
+* @param attributeName The name of the attribute to create or modify
+* @param xpathQuery An XPath 1.0-style query selecting the elements to change, or nil to change the root object
+* @return The new edit
+*/
++ (instancetype)editSettingValue:(id)value forAttribute:(NSString *)attributeName filteredBy:(NSString *)xpathQuery;
+
+/** Creates an edit that removes an attribute from all matching elements, like pd_deleteAttribute:
+* @param attributeName The name of the attribute to remove
+* @param xpathQuery An XPath 1.0-style query selecting the elements to change, or nil to change the root object
+* @return The new edit
+*/
++ (instancetype)editRemovingAttributeNamed:(NSString *)attributeName filteredBy:(NSString *)xpathQuery;
+
+/** Creates an edit that adds a child element to all matching elements, like pd_addElement:withName:.  As with that method, the element itself is added rather than a copy
+* @param element A PrestoData dictionary to add as a child element
+* @param elementName The name that the new element will be mapped to
+* @param xpathQuery An XPath 1.0-style query selecting the elements to change, or nil to change the root object
+* @return The new edit
+*/
++ (instancetype)editAddingElement:(NSMutableDictionary *)element named:(NSString *)elementName filteredBy:(NSString *)xpathQuery;
+
+/** Creates an edit that removes all child elements with a name from the matching elements, like pd_removeElementNamed:
+* @param elementName The name of the elements to remove
+* @param xpathQuery An XPath 1.0-style query selecting the elements to change, or nil to change the root object
+* @return The new edit
+*/
++ (instancetype)editRemovingElementNamed:(NSString *)elementName filteredBy:(NSString *)xpathQuery;
+
+/** Creates an edit that sets the inner value of all matching elements, like pd_setInnerValue:
+* @param value The new inner value, or nil to remove it
+* @param xpathQuery An XPath 1.0-style query selecting the elements to change, or nil to change the root object
+* @return The new edit
+*/
++ (instancetype)editSettingInnerValue:(id)value filteredBy:(NSString *)xpathQuery;
+
+/** Creates an edit that removes the matching elements from their parents, like pd_removeFromParentDictionary.  Use a positional query such as /catalog/book[3] to remove one element of several with the same name
+* @param xpathQuery An XPath 1.0-style query selecting the elements to remove
+* @return The new edit
+*/
++ (instancetype)editRemovingElementsMatching:(NSString *)xpathQuery;
+
+/** Works out the edits that change one dictionary into another, such as the state of a document when it was last saved or sent somewhere into its current state.  Each element is addressed by a query of names and positions from the root, such as /catalog/book[3]/title, so the edits apply to the dictionary and anything equal to it.  Elements the two have in common are changed in place, and subtrees that are equal, which for PDNodes is usually decided from their structural hashes, are skipped without being walked.  Keys and elements are removed and added again where that is the only way to put them in the target's order, and elements whose names can't be written in a query are replaced whole when they differ
+* @param dictionary The dictionary to change, which isn't changed by this method
+* @param target The dictionary that the edits should make it equal to.  Elements added by the edits are copies of its elements
+* @return An array of PDEdits that, applied in order to the dictionary with applyEdits:toObject:, make it equal to the target apart from its own element name.  Empty if they are already equal
+*/
++ (NSArray *)editsChangingDictionary:(NSMutableDictionary *)dictionary toMatchDictionary:(NSMutableDictionary *)target;
+
+/** Applies a list of edits to a PrestoData dictionary or array, in order.  The result is the same as making each change with the pd_ methods one after another, but queries that begin with the same location steps, such as /catalog/book/title and /catalog/book/price, only evaluate those steps once between changes to the elements of the document
+* @param edits An array of PDEdits, applied in order so that each edit sees the changes made by the ones before it
+* @param object The NSMutableDictionary or NSArray to change
+*/
++ (void)applyEdits:(NSArray *)edits toObject:(id)object;
+
+@end
@@ -0,0 +1,531 @@
+//
+// PDEdit.m
+//
+// Copyright (c) 2015 Daniel Hall
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+
+#import "PDEdit.h"
+#import "PDXPathQuery.h"
+#import "PDXPathQuery+_PrestoData_Internal.h"
+#import "NSMutableDictionary+PrestoData.h"
+#import "NSArray+PrestoData.h"
+#import "NSMutableDictionary+_PrestoData_Internal.h"
+
+
+@implementation PDEdit
+
+- (instancetype)initWithType:(PDEditType)type name:(NSString *)name value:(id)value xpathQuery:(NSString *)xpathQuery
+{
+    self = [super init];
+
+    if (self) {
+        _type = type;
+        _name = [name copy];
+        _value = value;
+        _xpathQuery = [xpathQuery copy];
+    }
+
+    return self;
+}
+
++ (instancetype)editSettingValue:(id)value forAttribute:(NSString *)attributeName filteredBy:(NSString *)xpathQuery
+{
+    return [[self alloc] initWithType:PDEditTypeSetValue name:attributeName value:value xpathQuery:xpathQuery];
+}
+
++ (instancetype)editRemovingAttributeNamed:(NSString *)attributeName filteredBy:(NSString *)xpathQuery
+{
+    return [[self alloc] initWithType:PDEditTypeRemoveAttribute name:attributeName value:nil xpathQuery:xpathQuery];
+}
+
++ (instancetype)editAddingElement:(NSMutableDictionary *)element named:(NSString *)elementName filteredBy:(NSString *)xpathQuery
+{
+    return [[self alloc] initWithType:PDEditTypeAddElement name:elementName value:element xpathQuery:xpathQuery];
+}
+
++ (instancetype)editRemovingElementNamed:(NSString *)elementName filteredBy:(NSString *)xpathQuery
+{
+    return [[self alloc] initWithType:PDEditTypeRemoveElement name:elementName value:nil xpathQuery:xpathQuery];
+}
+
++ (instancetype)editSettingInnerValue:(id)value filteredBy:(NSString *)xpathQuery
+{
+    return [[self alloc] initWithType:PDEditTypeSetInnerValue name:nil value:value xpathQuery:xpathQuery];
+}
+
++ (instancetype)editRemovingElementsMatching:(NSString *)xpathQuery
+{
+    return [[self alloc] initWithType:PDEditTypeRemoveMatchingElements name:nil value:nil xpathQuery:xpathQuery];
+}
+
++ (void)applyEdits:(NSArray *)edits toObject:(id)object
+{
+    if (![object isKindOfClass:[NSMutableDictionary class]] && ![object isKindOfClass:[NSArray class]])
+    {
+        return;
+    }
+
+    NSArray *rootNodes = [object isKindOfClass:[NSArray class]] ? object : @[object];
+
+    // The elements selected by the leading name steps of earlier queries, keyed by those steps.  Only edits that add or remove elements can change them
+    NSMutableDictionary *selections = [NSMutableDictionary dictionary];
+
+    for (PDEdit *edit in edits)
+    {
+        id targets = object;
+
+        if (edit.xpathQuery.length)
+        {
+            targets = [self elementsMatchingQuery:[PDXPathQuery queryWithString:edit.xpathQuery] inNodes:rootNodes selections:selections];
+            if (!targets)
+            {
+                continue;
+            }
+        }
+
+        if ([edit applyToTargets:targets])
+        {
+            [selections removeAllObjects];
+        }
+    }
+}
+
++ (NSArray *)elementsMatchingQuery:(PDXPathQuery *)query inNodes:(NSArray *)nodes selections:(NSMutableDictionary *)selections
+{
+    if (!query)
+    {
+        return nil;
+    }
+
+    NSUInteger nameStepCount = query.pd_nameStepCount;
+    NSUInteger evaluatedCount = 0;
+
+    for (NSUInteger count = nameStepCount; count > 0; count--)
+    {
+        NSArray *selection = selections[[query pd_keyForFirstSteps:count]];
+        if (selection)
+        {
+            nodes = selection;
+            evaluatedCount = count;
+            break;
+        }
+    }
+
+    // Each remaining name step is remembered separately, so that later queries sharing only part of this prefix can still start from it
+    for (; evaluatedCount < nameStepCount && nodes.count; evaluatedCount++)
+    {
+        nodes = [query pd_evaluateStepsInRange:NSMakeRange(evaluatedCount, 1) onNodes:nodes] ? : @[];
+        selections[[query pd_keyForFirstSteps:evaluatedCount + 1]] = nodes;
+    }
+
+    if (!nodes.count)
+    {
+        return nil;
+    }
+
+    NSArray *results = [query pd_evaluateStepsInRange:NSMakeRange(evaluatedCount, query.pd_stepCount - evaluatedCount) onNodes:nodes];
+    return results.count ? results : nil;
+}
+
+/** Makes the change to the targets, which are either an array of matching elements or the root object
+* @return YES if the change may have added or removed elements, so that earlier selections can no longer be reused
+*/
+- (BOOL)applyToTargets:(id)targets
+{
+    switch (self.type)
+    {
+        case PDEditTypeSetValue:
+        {
+            BOOL changesElements = [self.value isKindOfClass:[NSDictionary class]] || [self.value isKindOfClass:[NSArray class]] || [self targetsHaveElementsNamed:targets];
+            [targets pd_setValue:self.value forAttribute:self.name];
+            return changesElements;
+        }
+
+        case PDEditTypeRemoveAttribute:
+        {
+            BOOL changesElements = [self targetsHaveElementsNamed:targets];
+            [targets pd_deleteAttribute:self.name];
+            return changesElements;
+        }
+
+        case PDEditTypeAddElement:
+            [targets pd_addElement:self.value withName:self.name];
+            return YES;
+
+        case PDEditTypeRemoveElement:
+            [targets pd_removeElementNamed:self.name];
+            return YES;
+
+        case PDEditTypeSetInnerValue:
+            [targets pd_setInnerValue:self.value];
+            return NO;
+
+        case PDEditTypeRemoveMatchingElements:
+            [targets pd_removeFromParentDictionary];
+            return YES;
+    }
+
+    return YES;
+}
+
+/** Checks whether setting or removing an attribute named like this edit's would replace a child element rather than an attribute value */
+- (BOOL)targetsHaveElementsNamed:(id)targets
+{
+    if (!self.name)
+    {
+        return NO;
+    }
+
+    for (id target in ([targets isKindOfClass:[NSArray class]] ? targets : @[targets]))
+    {
+        if (![target isKindOfClass:[NSDictionary class]])
+        {
+            continue;
+        }
+
+        id existingValue = target[self.name];
+        if ([existingValue isKindOfClass:[NSDictionary class]] || [existingValue isKindOfClass:[NSArray class]])
+        {
+            return YES;
+        }
+    }
+
+    return NO;
+}
+
+
+#pragma mark - Differences
+
+/** Checks whether an element name can be written as a name test in a query.  Wildcard characters, and the colon that also begins an axis, are left out */
+static BOOL PDEditNameIsQueryable(NSString *name)
+{
+    NSUInteger length = name.length;
+    if (!length)
+    {
+        return NO;
+    }
+
+    for (NSUInteger i = 0; i < length; i++)
+    {
+        unichar character = [name characterAtIndex:i];
+        BOOL isLetter = (character >= 'a' && character <= 'z') || (character >= 'A' && character <= 'Z') || character == '_' || (character > 0x7F && [[NSCharacterSet letterCharacterSet] characterIsMember:character]);
+        BOOL isOtherNameCharacter = (character >= '0' && character <= '9') || character == '-' || character == '.';
+
+        if (!isLetter && !(i && isOtherNameCharacter))
+        {
+            return NO;
+        }
+    }
+
+    return YES;
+}
+
+/** The query for a child element of the element at a path.  A position of 0 means the element isn't in an array */
+static NSString *PDEditPathOfElement(NSString *parentPath, NSString *name, NSUInteger position)
+{
+    if (!position)
+    {
+        return [NSString stringWithFormat:@"%@/%@", parentPath ? : @"", name];
+    }
+    return [NSString stringWithFormat:@"%@/%@[%lu]", parentPath ? : @"", name, (unsigned long) position];
+}
+
+static inline BOOL PDEditValueIsAttribute(id value)
+{
+    return ![value isKindOfClass:[NSMutableDictionary class]] && ![value isKindOfClass:[NSArray class]];
+}
+
+/** Checks whether the value of a key can be changed into the target's value by edits that leave the key where it is.  Attribute values can always be set.  An element or array of elements can be changed inside if the other is the same kind and its name can be queried */
+static BOOL PDEditValueCanChangeInPlace(id value, id target, NSString *key)
+{
+    if (PDEditValueIsAttribute(value) && PDEditValueIsAttribute(target))
+    {
+        return YES;
+    }
+
+    if ([value isKindOfClass:[NSMutableDictionary class]] && [target isKindOfClass:[NSMutableDictionary class]])
+    {
+        return PDEditNameIsQueryable(key) || [value pd_isEqualToDictionary:target];
+    }
+
+    if ([value isKindOfClass:[NSArray class]] && [target isKindOfClass:[NSArray class]])
+    {
+        return PDEditNameIsQueryable(key) || [value pd_isEqualToArray:target];
+    }
+
+    return NO;
+}
+
+/** Arrays whose changed parts would need more cells than this to pair up are paired by position */
+static const NSUInteger PDEditMaximumPairingCells = 1 << 20;
+
+/** Estimates the edits needed to change one element into another from the keys whose values differ.  Child elements are compared by their structural hashes, so this doesn't walk below them */
+static NSUInteger PDEditCostOfChangingElement(NSMutableDictionary *element, NSMutableDictionary *target)
+{
+    NSUInteger cost = 0;
+
+    id innerValue = target.pd_innerValue;
+    if (innerValue != element.pd_innerValue && ![innerValue isEqual:element.pd_innerValue])
+    {
+        cost++;
+    }
+
+    for (NSString *key in target.pd_orderedKeys)
+    {
+        id value = element[key];
+        id targetValue = target[key];
+
+        if (!value || (PDEditValueIsAttribute(targetValue) ? ![targetValue isEqual:value] : PDStructuralHashOfValue(targetValue) != PDStructuralHashOfValue(value)))
+        {
+            cost++;
+        }
+    }
+
+    for (NSString *key in element.pd_orderedKeys)
+    {
+        if (!target[key])
+        {
+            cost++;
+        }
+    }
+
+    return cost;
+}
+
+/** Chooses which elements of an array to change into which of the target's elements, in order, and which to remove, needing the fewest edits.  Removing an element or adding one at the end is one edit.  The target's elements that aren't paired are added at the end, unless canAppend is NO, when every one of them is paired
+* @param pairs Set to the index in the target of the element that each element is changed into, or NSNotFound if it is removed
+* @return The number of the target's elements that are paired, which are the first ones
+*/
+static NSUInteger PDEditPairElements(NSArray *elements, NSArray *targets, BOOL canAppend, NSUInteger *pairs)
+{
+    NSUInteger count = elements.count;
+    NSUInteger targetCount = targets.count;
+
+    if ((count + 1) * (targetCount + 1) > PDEditMaximumPairingCells)
+    {
+        for (NSUInteger i = 0; i < count; i++)
+        {
+            pairs[i] = i < targetCount ? i : NSNotFound;
+        }
+        return MIN(count, targetCount);
+    }
+
+    // costs[i][j] is the fewest edits that turn the elements from i on into the targets from j on.  Each is reached either by removing element i, or by pairing it with target j
+    NSUInteger width = targetCount + 1;
+    NSUInteger impossible = NSUIntegerMax / 2;
+    NSUInteger *costs = malloc((count + 1) * width * sizeof(NSUInteger));
+    BOOL *pairings = calloc((count + 1) * width, sizeof(BOOL));
+
+    for (NSUInteger j = 0; j <= targetCount; j++)
+    {
+        costs[count * width + j] = canAppend ? targetCount - j : (j == targetCount ? 0 : impossible);
+    }
+
+    for (NSUInteger i = count; i > 0; i--)
+    {
+        NSUInteger row = i - 1;
+        for (NSUInteger j = 0; j <= targetCount; j++)
+        {
+            NSUInteger cost = MIN(1 + costs[i * width + j], impossible);
+
+            if (j < targetCount)
+            {
+                NSUInteger pairedCost = MIN(PDEditCostOfChangingElement(elements[row], targets[j]) + costs[i * width + j + 1], impossible);
+                if (pairedCost <= cost)
+                {
+                    cost = pairedCost;
+                    pairings[row * width + j] = YES;
+                }
+            }
+
+            costs[row * width + j] = cost;
+        }
+    }
+
+    NSUInteger j = 0;
+    for (NSUInteger i = 0; i < count; i++)
+    {
+        pairs[i] = pairings[i * width + j] ? j++ : NSNotFound;
+    }
+
+    free(costs);
+    free(pairings);
+    return j;
+}
+
++ (NSArray *)editsChangingDictionary:(NSMutableDictionary *)dictionary toMatchDictionary:(NSMutableDictionary *)target
+{
+    NSMutableArray *edits = [NSMutableArray array];
+
+    if ([dictionary isKindOfClass:[NSMutableDictionary class]] && [target isKindOfClass:[NSMutableDictionary class]])
+    {
+        [self addEditsChangingDictionary:dictionary toMatchDictionary:target atPath:nil toEdits:edits];
+    }
+
+    return edits;
+}
+
++ (void)addEditsChangingDictionary:(NSMutableDictionary *)dictionary toMatchDictionary:(NSMutableDictionary *)target atPath:(NSString *)path toEdits:(NSMutableArray *)edits
+{
+    id innerValue = target.pd_innerValue;
+    if (innerValue != dictionary.pd_innerValue && ![innerValue isEqual:dictionary.pd_innerValue])
+    {
+        [edits addObject:[self editSettingInnerValue:innerValue filteredBy:path]];
+    }
+
+    // Keys that are changed in place keep their positions, and keys that are added go after all the others.  So the keys kept are the longest run at the start of the target's keys that are in the same order in the dictionary, and every other key is removed, and added again if the target has it
+    NSArray *targetKeys = target.pd_orderedKeys;
+    NSUInteger keptCount = 0;
+    NSUInteger lastOrder = 0;
+
+    for (NSString *key in targetKeys)
+    {
+        id value = dictionary[key];
+        NSUInteger order = [dictionary pd_orderOfOrderedKey:key];
+
+        if (!value || (keptCount && order <= lastOrder) || !PDEditValueCanChangeInPlace(value, target[key], key))
+        {
+            break;
+        }
+
+        lastOrder = order;
+        keptCount++;
+    }
+
+    NSSet *keptKeys = [NSSet setWithArray:[targetKeys subarrayWithRange:NSMakeRange(0, keptCount)]];
+
+    for (NSString *key in dictionary.pd_orderedKeys)
+    {
+        if (![keptKeys containsObject:key])
+        {
+            [edits addObject:PDEditValueIsAttribute(dictionary[key]) ? [self editRemovingAttributeNamed:key filteredBy:path] : [self editRemovingElementNamed:key filteredBy:path]];
+        }
+    }
+
+    for (NSUInteger i = 0; i < targetKeys.count; i++)
+    {
+        NSString *key = targetKeys[i];
+        id value = dictionary[key];
+        id targetValue = target[key];
+
+        if (i >= keptCount)
+        {
+            [self addEditsAddingValue:targetValue named:key atPath:path toEdits:edits];
+        }
+        else if ([targetValue isKindOfClass:[NSMutableDictionary class]])
+        {
+            if (![value pd_isEqualToDictionary:targetValue])
+            {
+                [self addEditsChangingDictionary:value toMatchDictionary:targetValue atPath:PDEditPathOfElement(path, key, 0) toEdits:edits];
+            }
+        }
+        else if ([targetValue isKindOfClass:[NSArray class]])
+        {
+            [self addEditsChangingArray:value toMatchArray:targetValue named:key atPath:path toEdits:edits];
+        }
+        else if (![value isEqual:targetValue])
+        {
+            [edits addObject:[self editSettingValue:targetValue forAttribute:key filteredBy:path]];
+        }
+    }
+}
+
++ (void)addEditsChangingArray:(NSArray *)array toMatchArray:(NSArray *)target named:(NSString *)name atPath:(NSString *)path toEdits:(NSMutableArray *)edits
+{
+    NSUInteger count = array.count;
+    NSUInteger targetCount = target.count;
+    NSUInteger prefix = 0;
+    NSUInteger suffix = 0;
+
+    while (prefix < count && prefix < targetCount && [array[prefix] pd_isEqualToDictionary:target[prefix]])
+    {
+        prefix++;
+    }
+
+    while (suffix < count - prefix && suffix < targetCount - prefix && [array[count - 1 - suffix] pd_isEqualToDictionary:target[targetCount - 1 - suffix]])
+    {
+        suffix++;
+    }
+
+    // Elements can only be added at the end, so if the target has more elements in front of the equal ones at the end, those have to be removed and added again after them
+    if (targetCount - prefix - suffix > count - prefix - suffix)
+    {
+        suffix = 0;
+    }
+
+    NSArray *changed = [array subarrayWithRange:NSMakeRange(prefix, count - prefix - suffix)];
+    NSArray *targetChanged = [target subarrayWithRange:NSMakeRange(prefix, targetCount - prefix - suffix)];
+    NSUInteger *pairs = malloc(MAX(changed.count, 1) * sizeof(NSUInteger));
+    NSUInteger pairedCount = PDEditPairElements(changed, targetChanged, suffix == 0, pairs);
+
+    for (NSUInteger i = 0; i < changed.count; i++)
+    {
+        if (pairs[i] != NSNotFound && ![changed[i] pd_isEqualToDictionary:targetChanged[pairs[i]]])
+        {
+            [self addEditsChangingDictionary:changed[i] toMatchDictionary:targetChanged[pairs[i]] atPath:PDEditPathOfElement(path, name, prefix + i + 1) toEdits:edits];
+        }
+    }
+
+    // Removed from the last, so that the positions of the ones before don't change
+    for (NSUInteger i = changed.count; i > 0; i--)
+    {
+        if (pairs[i - 1] == NSNotFound)
+        {
+            [edits addObject:[self editRemovingElementsMatching:PDEditPathOfElement(path, name, prefix + i)]];
+        }
+    }
+
+    for (NSUInteger i = pairedCount; i < targetChanged.count; i++)
+    {
+        [edits addObject:[self editAddingElement:[targetChanged[i] pd_copy] named:name filteredBy:path]];
+    }
+
+    free(pairs);
+}
+
+/** Adds edits that give the dictionary at a path a key it doesn't have, with a copy of a value */
++ (void)addEditsAddingValue:(id)value named:(NSString *)name atPath:(NSString *)path toEdits:(NSMutableArray *)edits
+{
+    if ([value isKindOfClass:[NSMutableDictionary class]])
+    {
+        [edits addObject:[self editAddingElement:[value pd_copy] named:name filteredBy:path]];
+    }
+    else if ([value isKindOfClass:[NSArray class]])
+    {
+        // A lone element added to a dictionary isn't put in an array, so an array of one is started empty first, the same way the JSON parser builds one
+        if (((NSArray *) value).count == 1)
+        {
+            [edits addObject:[self editAddingElement:(id) [NSMutableArray array] named:name filteredBy:path]];
+        }
+
+        for (NSMutableDictionary *element in value)
+        {
+            [edits addObject:[self editAddingElement:[element pd_copy] named:name filteredBy:path]];
+        }
+    }
+    else
+    {
+        [edits addObject:[self editSettingValue:value forAttribute:name filteredBy:path]];
+    }
+}
+
+@end
@@ -0,0 +1,73 @@
+//
+// PDElementIndex.h
+//
+// Copyright (c) 2015 Daniel Hall
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+
+
+#import <Foundation/Foundation.h>
+
+/** This class is used internally by PrestoData to find the descendants of an element by name without searching the tree.  An index belongs to one dictionary, its root, and lists every element below the root under its element name, in document order.
+*
+* A // step from the root costs only the number of matches.  Steps from elements below the root search their subtrees instead, since finding where an element sits in a list means walking up to the root and along its siblings.  The PrestoData methods that add and remove elements update the indexes of all of the element's ancestors as they go.  Removed elements are found in their lists by identity, and added elements that don't simply go at the end of their list are placed by binary search on their positions.
+*/
+
+@interface PDElementIndex : NSObject
+
+/** Builds an index of all of the elements below a dictionary, in a single pass over the tree
+* @param root The dictionary whose descendants are indexed.  The index doesn't retain it
+* @return The new index
+*/
+- (instancetype)initWithRoot:(NSMutableDictionary *)root;
+
+/** Returns the elements with a name that are descendants of the root, in document order
+* @param name The exact element name
+* @return The matching elements, which may be empty, or nil if the index can no longer be trusted and the tree must be searched
+*/
+- (NSArray *)elementsNamed:(NSString *)name;
+
+@end
+
+
+/** Set once the first index is built.  Until then no dictionary can have an index, so changes to the tree skip looking for them */
+extern BOOL PDElementIndexesExist;
+
+/** Adds a value to, or removes it from, the indexes of a dictionary and its ancestors.  Called through the two functions below, which skip it until an index exists */
+void PDElementIndexesUpdate(NSMutableDictionary *parent, NSString *name, id value, BOOL adding);
+
+/** Adds a value that has just been stored in a dictionary, or appended to one of its element arrays, to the indexes of the dictionary and its ancestors.  Elements and arrays of elements are added along with all of their descendants; attribute values are ignored */
+static inline void PDElementIndexesAddValue(NSMutableDictionary *parent, NSString *name, id value)
+{
+    if (PDElementIndexesExist)
+    {
+        PDElementIndexesUpdate(parent, name, value, YES);
+    }
+}
+
+/** Removes a value that is about to be removed from a dictionary, or from one of its element arrays, from the indexes of the dictionary and its ancestors.  Must be called while the value is still in place */
+static inline void PDElementIndexesRemoveValue(NSMutableDictionary *parent, NSString *name, id value)
+{
+    if (PDElementIndexesExist)
+    {
+        PDElementIndexesUpdate(parent, name, value, NO);
+    }
+}
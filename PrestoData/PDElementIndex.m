@@ -0,0 +1,393 @@
+//
+// PDElementIndex.m
+//
+// Copyright (c) 2015 Daniel Hall
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+
+#import "PDElementIndex.h"
+#import "NSMutableDictionary+_PrestoData_Internal.h"
+#import "NSMutableDictionary+PrestoData.h"
+#include <stdlib.h>
+
+BOOL PDElementIndexesExist;
+
+
+/** Where an element sits in its parent: the order of its key among the parent's keys, and its index in the element array stored under that key, or 0 */
+typedef struct
+{
+    NSUInteger key;
+    NSUInteger index;
+} PDElementPosition;
+
+/** The positions of an element and of each of its ancestors below an index's root, root first.  Comparing two paths compares the elements' places in document order */
+typedef struct
+{
+    PDElementPosition *positions;
+    NSUInteger count;
+    NSUInteger capacity;
+} PDElementPath;
+
+static void PDElementPathDestroy(PDElementPath *path)
+{
+    free(path->positions);
+    path->positions = NULL;
+    path->count = path->capacity = 0;
+}
+
+/** Finds an object by identity, searching inwards from both ends at once.  Elements are usually added and removed near one end of their array, and of their list in an index, so this rarely looks far */
+static NSUInteger PDElementIndexOfObjectIdenticalTo(NSArray *array, id object)
+{
+    for (NSUInteger front = 0, back = array.count; front < back; front++)
+    {
+        if (array[front] == object)
+        {
+            return front;
+        }
+
+        back--;
+        if (back > front && array[back] == object)
+        {
+            return back;
+        }
+    }
+
+    return NSNotFound;
+}
+
+/** Finds an element in its parent's element array.  When arrayPositions is given, the positions of all of an array's elements are noted the first time one of them is looked for, so the many lookups of a binary search cost one pass over each array they visit */
+static NSUInteger PDElementIndexOfElementInArray(NSArray *array, id element, NSMapTable *arrayPositions)
+{
+    if (!arrayPositions)
+    {
+        return PDElementIndexOfObjectIdenticalTo(array, element);
+    }
+
+    NSMapTable *positions = [arrayPositions objectForKey:array];
+    if (!positions)
+    {
+        positions = [NSMapTable mapTableWithKeyOptions:NSPointerFunctionsObjectPointerPersonality valueOptions:NSPointerFunctionsStrongMemory];
+        NSUInteger position = 0;
+        for (id candidate in array)
+        {
+            [positions setObject:@(position++) forKey:candidate];
+        }
+        [arrayPositions setObject:positions forKey:array];
+    }
+
+    NSNumber *position = [positions objectForKey:element];
+    return position ? position.unsignedIntegerValue : NSNotFound;
+}
+
+/** Fills in the path of an element below a root.  Returns NO if the element isn't below the root
+* @param arrayPositions Positions noted by earlier lookups in the same update, or nil
+*/
+static BOOL PDElementPathOfElement(PDElementPath *path, NSMutableDictionary *root, NSMutableDictionary *element, NSMapTable *arrayPositions)
+{
+    path->count = 0;
+
+    while (element != root)
+    {
+        NSMutableDictionary *parent = element.pd_parentDictionary;
+        NSString *name = element.pd_elementName;
+        if (!parent || !name)
+        {
+            return NO;
+        }
+
+        PDElementPosition position = {[parent pd_orderOfOrderedKey:name], 0};
+        id value = parent[name];
+
+        if ([value isKindOfClass:[NSArray class]])
+        {
+            position.index = PDElementIndexOfElementInArray(value, element, arrayPositions);
+        }
+        else if (value != element)
+        {
+            return NO;
+        }
+
+        if (position.key == NSNotFound || position.index == NSNotFound)
+        {
+            return NO;
+        }
+
+        if (path->count == path->capacity)
+        {
+            path->capacity = MAX(path->capacity * 2, 16);
+            path->positions = realloc(path->positions, path->capacity * sizeof(PDElementPosition));
+        }
+        path->positions[path->count++] = position;
+        element = parent;
+    }
+
+    for (NSUInteger i = 0; i < path->count / 2; i++)
+    {
+        PDElementPosition swap = path->positions[i];
+        path->positions[i] = path->positions[path->count - 1 - i];
+        path->positions[path->count - 1 - i] = swap;
+    }
+
+    return YES;
+}
+
+static NSComparisonResult PDElementPathCompare(const PDElementPath *a, const PDElementPath *b)
+{
+    NSUInteger count = MIN(a->count, b->count);
+
+    for (NSUInteger i = 0; i < count; i++)
+    {
+        PDElementPosition first = a->positions[i];
+        PDElementPosition second = b->positions[i];
+
+        if (first.key != second.key)
+        {
+            return first.key < second.key ? NSOrderedAscending : NSOrderedDescending;
+        }
+        if (first.index != second.index)
+        {
+            return first.index < second.index ? NSOrderedAscending : NSOrderedDescending;
+        }
+    }
+
+    // An ancestor comes before its descendants
+    if (a->count == b->count)
+    {
+        return NSOrderedSame;
+    }
+    return a->count < b->count ? NSOrderedAscending : NSOrderedDescending;
+}
+
+/** Checks by identity, rather than with isEqual:, whether a list holds a run of elements starting at a position */
+static BOOL PDElementListHasRun(NSArray *elements, NSUInteger position, NSArray *run)
+{
+    if (position + run.count > elements.count)
+    {
+        return NO;
+    }
+
+    for (NSUInteger i = 0; i < run.count; i++)
+    {
+        if (elements[position + i] != run[i])
+        {
+            return NO;
+        }
+    }
+
+    return YES;
+}
+
+/** Appends the elements stored in a value, and all of their descendants, to per-name lists in document order */
+static void PDElementIndexCollectValue(NSString *name, id value, NSMutableDictionary *elementsByName);
+
+static void PDElementIndexCollectChildren(NSMutableDictionary *dictionary, NSMutableDictionary *elementsByName)
+{
+    for (NSString *key in dictionary.pd_orderedKeys)
+    {
+        PDElementIndexCollectValue(key, dictionary[key], elementsByName);
+    }
+}
+
+static void PDElementIndexCollectValue(NSString *name, id value, NSMutableDictionary *elementsByName)
+{
+    if ([value isKindOfClass:[NSMutableDictionary class]])
+    {
+        NSMutableArray *elements = elementsByName[name];
+        if (!elements)
+        {
+            elements = [NSMutableArray array];
+            elementsByName[name] = elements;
+        }
+
+        [elements addObject:value];
+        PDElementIndexCollectChildren(value, elementsByName);
+    }
+    else if ([value isKindOfClass:[NSArray class]])
+    {
+        for (id element in value)
+        {
+            PDElementIndexCollectValue(name, element, elementsByName);
+        }
+    }
+}
+
+
+@implementation PDElementIndex
+{
+    __unsafe_unretained NSMutableDictionary *_root;
+    NSMutableDictionary *_elementsByName;
+    /** Set if an added element couldn't be placed in the tree, after which the lists can't be trusted and lookups fall back to searching */
+    BOOL _stale;
+}
+
+- (instancetype)initWithRoot:(NSMutableDictionary *)root
+{
+    self = [super init];
+
+    if (self) {
+        PDElementIndexesExist = YES;
+        _root = root;
+        _elementsByName = [NSMutableDictionary dictionary];
+        PDElementIndexCollectChildren(root, _elementsByName);
+    }
+
+    return self;
+}
+
+- (NSArray *)elementsNamed:(NSString *)name
+{
+    if (_stale)
+    {
+        return nil;
+    }
+
+    NSArray *elements = _elementsByName[name];
+    return elements ? [elements copy] : @[];
+}
+
+/** Binary searches a list in document order for the number of elements that come before an element's path */
+- (NSUInteger)countOfElements:(NSArray *)elements beforePath:(const PDElementPath *)target
+{
+    PDElementPath path = {0};
+    NSMapTable *arrayPositions = [NSMapTable mapTableWithKeyOptions:NSPointerFunctionsObjectPointerPersonality valueOptions:NSPointerFunctionsStrongMemory];
+    NSUInteger low = 0;
+    NSUInteger high = elements.count;
+
+    while (low < high)
+    {
+        NSUInteger middle = low + (high - low) / 2;
+
+        // An element that can't be placed can't be compared either, so it is treated as coming before the target rather than stopping the search
+        if (!PDElementPathOfElement(&path, _root, elements[middle], arrayPositions) || PDElementPathCompare(&path, target) == NSOrderedAscending)
+        {
+            low = middle + 1;
+        }
+        else
+        {
+            high = middle;
+        }
+    }
+
+    PDElementPathDestroy(&path);
+    return low;
+}
+
+- (void)addElementsInValue:(id)value named:(NSString *)name
+{
+    if (_stale)
+    {
+        return;
+    }
+
+    NSMutableDictionary *addedByName = [NSMutableDictionary dictionary];
+    PDElementIndexCollectValue(name, value, addedByName);
+
+    __block PDElementPath path = {0};
+    __block PDElementPath lastPath = {0};
+
+    [addedByName enumerateKeysAndObjectsUsingBlock:^(NSString *addedName, NSArray *added, BOOL *stop) {
+        if (!PDElementPathOfElement(&path, self->_root, added.firstObject, nil))
+        {
+            self->_stale = YES;
+            *stop = YES;
+            return;
+        }
+
+        NSMutableArray *elements = self->_elementsByName[addedName];
+        if (!elements)
+        {
+            self->_elementsByName[addedName] = [added mutableCopy];
+            return;
+        }
+
+        // New elements are usually added after everything else with their name, so that is checked before searching
+        NSUInteger position = elements.count;
+        if (!PDElementPathOfElement(&lastPath, self->_root, elements.lastObject, nil) || PDElementPathCompare(&lastPath, &path) != NSOrderedAscending)
+        {
+            position = [self countOfElements:elements beforePath:&path];
+        }
+
+        [elements replaceObjectsInRange:NSMakeRange(position, 0) withObjectsFromArray:added];
+    }];
+
+    PDElementPathDestroy(&path);
+    PDElementPathDestroy(&lastPath);
+}
+
+- (void)removeElementsInValue:(id)value named:(NSString *)name
+{
+    if (_stale)
+    {
+        return;
+    }
+
+    NSMutableDictionary *removedByName = [NSMutableDictionary dictionary];
+    PDElementIndexCollectValue(name, value, removedByName);
+
+    [removedByName enumerateKeysAndObjectsUsingBlock:^(NSString *removedName, NSArray *removed, BOOL *stop) {
+        NSMutableArray *elements = self->_elementsByName[removedName];
+
+        // The removed elements are a contiguous run of the list.  Finding its start by identity needs no paths, which would each walk the sibling arrays of the element's ancestors
+        NSUInteger position = PDElementIndexOfObjectIdenticalTo(elements, removed.firstObject);
+
+        if (position != NSNotFound && PDElementListHasRun(elements, position, removed))
+        {
+            [elements removeObjectsInRange:NSMakeRange(position, removed.count)];
+        }
+        else
+        {
+            for (id element in removed)
+            {
+                [elements removeObjectIdenticalTo:element];
+            }
+        }
+
+        if (!elements.count)
+        {
+            [self->_elementsByName removeObjectForKey:removedName];
+        }
+    }];
+}
+
+@end
+
+
+void PDElementIndexesUpdate(NSMutableDictionary *parent, NSString *name, id value, BOOL adding)
+{
+    if (!name || (![value isKindOfClass:[NSMutableDictionary class]] && ![value isKindOfClass:[NSArray class]]))
+    {
+        return;
+    }
+
+    for (NSMutableDictionary *node = parent; node; node = node.pd_parentDictionary)
+    {
+        PDElementIndex *index = node.pd_elementIndex;
+
+        if (adding)
+        {
+            [index addElementsInValue:value named:name];
+        }
+        else
+        {
+            [index removeElementsInValue:value named:name];
+        }
+    }
+}
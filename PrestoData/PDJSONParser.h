@@ -0,0 +1,88 @@
+//
+// PDJSONParser.h
+//
+// Copyright (c) 2015 Daniel Hall
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+
+#import <Foundation/Foundation.h>
+
+@class PDXPathStreamMatcher;
+
+/** This class is used internally by PrestoData to convert UTF8-encoded JSON data into PrestoData dictionaries and arrays.  The JSON bytes are tokenized in a single pass, without first converting the data to an NSString or creating intermediate substrings */
+
+@interface PDJSONParser : NSObject
+
+/** Creates a parser for the specified JSON data
+* @param data An NSData instance that contains a UTF8-encoded JSON string
+* @param key The name of the JSON attribute whose string value should be mapped to the pd_innerValue property of each dictionary as it is parsed
+* @return A parser ready to parse the data
+*/
+- (instancetype)initWithJSONData:(NSData *)data keyForInnerValue:(NSString *)key;
+
+/** Creates a parser that reads JSON from a stream as it parses, keeping only a small window of the stream in memory
+* @param stream A stream of UTF8-encoded JSON.  It is opened if necessary, and a stream that the parser opens is also closed by it
+* @param key The name of the JSON attribute whose string value should be mapped to the pd_innerValue property of each dictionary as it is parsed
+* @return A parser ready to enumerate matches in the stream
+*/
+- (instancetype)initWithStream:(NSInputStream *)stream keyForInnerValue:(NSString *)key;
+
+/** Whether the dictionaries parsed from the data remember the bytes they were parsed from, so that they can be written by copying those bytes until they change.  See PDParsingOptionsPreserveSource.  Set before parsing.  Always NO for streams */
+@property (nonatomic, assign) BOOL preservesSource;
+
+/** Parses the data as whichever of a JSON object or array it contains, deciding from the first non-whitespace byte so the data is only parsed once
+* @return An NSMutableDictionary for a JSON object or an NSArray for a JSON array, under the same rules as parsedDictionary and parsedArray, or nil if the JSON is malformed, empty, or not an object or array
+*/
+- (id)parsedObject;
+
+/** Parses the data as a JSON object
+* @return An NSMutableDictionary that represents the JSON object, or nil if the JSON is malformed, empty, or does not represent an object
+*/
+- (NSMutableDictionary *)parsedDictionary;
+
+/** Parses the data as a JSON array
+* @return An NSArray of PrestoData dictionaries that represents the JSON array, or nil if the JSON is malformed, empty, or does not represent an array
+*/
+- (NSArray *)parsedArray;
+
+/** Parses the data as a JSON array, dividing a large array into chunks that are parsed on all available cores.  A quick scan of the array's brackets, strings and commas finds where the chunks can start.  Arrays under 512KB, and streams, are parsed serially
+* @return The same array of PrestoData dictionaries that parsedArray returns, or nil under the same conditions
+*/
+- (NSArray *)parsedArrayConcurrently;
+
+/** Checks the data as a JSON object and returns a dictionary that is filled in from the data when it is first used, and whose elements are filled in the same way.  See PDParsingOptionsLazy.  Streams are parsed in full
+* @return A dictionary that loads to the same contents parsedDictionary returns, or nil under the same conditions
+*/
+- (NSMutableDictionary *)lazilyParsedDictionary;
+
+/** Checks the data as a JSON array and returns an array of dictionaries that are filled in from the data when they are first used.  See PDParsingOptionsLazy.  Streams are parsed in full
+* @return An array of dictionaries that load to the same contents parsedArray returns, or nil under the same conditions
+*/
+- (NSArray *)lazilyParsedArray;
+
+/** Parses the JSON, building only the elements that match a query and passing each one to a block as soon as it ends.  Everything else is stepped over without creating objects for it
+* @param matcher A matcher for the query, positioned at the start of a document
+* @param block Called with each matching element.  Setting *stop to YES ends parsing
+* @return YES if the whole document was parsed, or parsing was stopped by the block, otherwise NO
+*/
+- (BOOL)enumerateMatchesOfMatcher:(PDXPathStreamMatcher *)matcher usingBlock:(void (^)(NSMutableDictionary *element, BOOL *stop))block;
+
+@end
@@ -0,0 +1,1975 @@
+//
+// PDJSONParser.m
+//
+// Copyright (c) 2015 Daniel Hall
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+
+#import "PDJSONParser.h"
+#import "NSMutableDictionary+PrestoData.h"
+#import "NSMutableDictionary+_PrestoData_Internal.h"
+#import "PDNode.h"
+#import "PDNode+_PrestoData_Internal.h"
+#import "NSArray+_PrestoData_Internal.h"
+#import "PDXPathStreamMatcher.h"
+#import "PDStringTable.h"
+#import "PDStats+_PrestoData_Internal.h"
+#import "NSNumber+_PrestoData_Internal.h"
+
+/** Guards against stack exhaustion from maliciously or accidentally deep documents */
+static const NSUInteger PDJSONMaximumNestingDepth = 512;
+
+/** The number of bytes read from a stream at a time */
+static const NSUInteger PDJSONReadLength = 65536;
+
+/** The fewest bytes of a top-level array given to each thread by parsedArrayConcurrently.  Smaller documents are parsed serially */
+static const NSUInteger PDJSONConcurrentChunkLength = 256 * 1024;
+
+
+static inline BOOL PDJSONIsWhitespace(uint8_t byte)
+{
+    return byte == ' ' || byte == '\n' || byte == '\r' || byte == '\t';
+}
+
+static inline BOOL PDJSONIsDigit(uint8_t byte)
+{
+    return byte >= '0' && byte <= '9';
+}
+
+static BOOL PDJSONReadHexQuad(const uint8_t *bytes, NSUInteger length, NSUInteger position, uint32_t *value)
+{
+    if (position + 4 > length)
+    {
+        return NO;
+    }
+
+    uint32_t result = 0;
+    for (NSUInteger i = position; i < position + 4; i++)
+    {
+        uint8_t byte = bytes[i];
+        result <<= 4;
+        if (byte >= '0' && byte <= '9')
+        {
+            result |= (uint32_t)(byte - '0');
+        }
+        else if (byte >= 'a' && byte <= 'f')
+        {
+            result |= (uint32_t)(byte - 'a' + 10);
+        }
+        else if (byte >= 'A' && byte <= 'F')
+        {
+            result |= (uint32_t)(byte - 'A' + 10);
+        }
+        else
+        {
+            return NO;
+        }
+    }
+
+    *value = result;
+    return YES;
+}
+
+static NSUInteger PDJSONEncodeUTF8(uint32_t codePoint, uint8_t *encoded)
+{
+    if (codePoint < 0x80)
+    {
+        encoded[0] = (uint8_t)codePoint;
+        return 1;
+    }
+
+    if (codePoint < 0x800)
+    {
+        encoded[0] = (uint8_t)(0xC0 | (codePoint >> 6));
+        encoded[1] = (uint8_t)(0x80 | (codePoint & 0x3F));
+        return 2;
+    }
+
+    if (codePoint < 0x10000)
+    {
+        encoded[0] = (uint8_t)(0xE0 | (codePoint >> 12));
+        encoded[1] = (uint8_t)(0x80 | ((codePoint >> 6) & 0x3F));
+        encoded[2] = (uint8_t)(0x80 | (codePoint & 0x3F));
+        return 3;
+    }
+
+    encoded[0] = (uint8_t)(0xF0 | (codePoint >> 18));
+    encoded[1] = (uint8_t)(0x80 | ((codePoint >> 12) & 0x3F));
+    encoded[2] = (uint8_t)(0x80 | ((codePoint >> 6) & 0x3F));
+    encoded[3] = (uint8_t)(0x80 | (codePoint & 0x3F));
+    return 4;
+}
+
+/** Finds the end of the array that starts at a position, and the commas between its items that divide it into chunks of roughly equal length.  Only brackets, braces, strings and top-level commas are looked at; everything else is left for the chunks' parsers to check
+* @return The position of the array's closing bracket, or NSNotFound if the data ends first
+*/
+static NSUInteger PDJSONScanArraySplits(const uint8_t *bytes, NSUInteger length, NSUInteger start, NSUInteger chunkLength, NSUInteger *splits, NSUInteger maximumSplits, NSUInteger *splitCount)
+{
+    NSUInteger depth = 0;
+    NSUInteger count = 0;
+    NSUInteger nextSplit = start + chunkLength;
+
+    for (NSUInteger i = start; i < length; i++)
+    {
+        uint8_t byte = bytes[i];
+
+        if (byte == '"')
+        {
+            // Brackets and commas inside strings, including after escaped quotes, aren't structure
+            for (i++; i < length && bytes[i] != '"'; i++)
+            {
+                if (bytes[i] == '\\')
+                {
+                    i++;
+                }
+            }
+        }
+        else if (byte == '[' || byte == '{')
+        {
+            depth++;
+        }
+        else if (byte == ']' || byte == '}')
+        {
+            if (--depth == 0)
+            {
+                *splitCount = count;
+                return i;
+            }
+        }
+        else if (byte == ',' && depth == 1 && i >= nextSplit && count < maximumSplits)
+        {
+            splits[count++] = i;
+            nextSplit = i + chunkLength;
+        }
+    }
+
+    return NSNotFound;
+}
+
+
+/** One object or array in the skeleton of a lazily parsed document.  Containers are recorded in the order they begin, so the containers nested inside one follow it directly */
+typedef struct
+{
+    /** The position of the opening bracket */
+    NSUInteger start;
+    /** The position just after the closing bracket */
+    NSUInteger end;
+    /** The number of containers nested inside this one, at any depth */
+    NSUInteger descendants;
+    /** YES if an object has any attributes, elements or inner value, or an array has any elements, once loaded.  Empty objects are dropped, as a full parse drops them */
+    BOOL hasContents;
+    /** YES if a compact PDWriter would write the loaded object back as exactly these bytes.  Only recorded while preserving source */
+    BOOL canonical;
+} PDJSONContainer;
+
+
+@interface PDJSONParser () <PDNodeContentSource>
+
+- (BOOL)readUntilAvailable:(NSUInteger)count;
+
+@end
+
+
+@implementation PDJSONParser
+{
+    NSData *_data;
+    NSString *_keyForInnerValue;
+    const uint8_t *_bytes;
+    NSUInteger _length;
+    NSUInteger _position;
+    NSUInteger _depth;
+    NSMutableData *_unescapedBuffer;
+    NSInputStream *_stream;
+    NSMutableData *_streamBuffer;
+    BOOL _streamEnded;
+    BOOL _streamFailed;
+    PDXPathStreamMatcher *_matcher;
+    void (^_matchHandler)(NSMutableDictionary *element, BOOL *stop);
+    BOOL _stopped;
+    PDStringTable _keys;
+    uint64_t _streamedLength;
+    NSMutableData *_containers;
+    NSUInteger _containerCount;
+    PDNodeSourceText *_sourceText;
+    NSUInteger _noncanonicalPosition;
+    /** Set on a cursor that loads one dictionary of a lazily parsed document: the parser that scanned the document, which is the content source of its dictionaries */
+    PDJSONParser *_document;
+    /** Set on a parser for one chunk of a concurrently parsed array: the document parser's table, which is only read while the chunks are parsed.  Keys are looked up there before they are interned in the chunk's own table */
+    const PDStringTable *_sharedKeys;
+}
+
+/** Checks that the next count bytes are available, reading more of the stream if there is one */
+static inline BOOL PDJSONHasBytes(PDJSONParser *parser, NSUInteger count)
+{
+    return parser->_position + count <= parser->_length || (parser->_stream && [parser readUntilAvailable:count]);
+}
+
+/** Records that the bytes at a position won't be written back as they are: whitespace, escapes, numbers in another form, and anything the parser drops or merges.  No object containing them can be written by copying its source */
+static inline void PDJSONNoteNoncanonical(PDJSONParser *parser, NSUInteger position)
+{
+    parser->_noncanonicalPosition = position;
+}
+
+/** YES if nothing noncanonical has been read since a position, so a compact PDWriter would write what was parsed from there as exactly the same bytes */
+static inline BOOL PDJSONIsCanonicalSince(PDJSONParser *parser, NSUInteger start)
+{
+    return parser->_noncanonicalPosition == NSNotFound || parser->_noncanonicalPosition < start;
+}
+
+- (instancetype)initWithJSONData:(NSData *)data keyForInnerValue:(NSString *)key
+{
+    self = [super init];
+
+    if (self) {
+        _data = data;
+        _keyForInnerValue = [key copy];
+        _bytes = data.bytes;
+        _length = data.length;
+        _noncanonicalPosition = NSNotFound;
+    }
+
+    return self;
+}
+
+- (instancetype)initWithStream:(NSInputStream *)stream keyForInnerValue:(NSString *)key
+{
+    self = [super init];
+
+    if (self) {
+        _stream = stream;
+        _keyForInnerValue = [key copy];
+        _streamBuffer = [NSMutableData dataWithCapacity:PDJSONReadLength];
+        _noncanonicalPosition = NSNotFound;
+    }
+
+    return self;
+}
+
+- (void)setPreservesSource:(BOOL)preservesSource
+{
+    if (!preservesSource)
+    {
+        _sourceText = nil;
+    }
+    else if (_data && !_sourceText)
+    {
+        // The dictionaries keep the data to write from, so it must not change underneath them
+        _data = [_data copy];
+        _bytes = _data.bytes;
+        _length = _data.length;
+        _sourceText = [[PDNodeSourceText alloc] initWithData:_data keyForInnerValue:_keyForInnerValue];
+    }
+}
+
+- (BOOL)preservesSource
+{
+    return _sourceText != nil;
+}
+
+- (void)dealloc
+{
+    PDStringTableDestroy(&_keys);
+}
+
+- (id)parsedObject
+{
+    _position = 0;
+
+    switch ([self nextNonWhitespaceByte])
+    {
+        case '{':
+            return [self parsedDictionary];
+        case '[':
+            return [self parsedArray];
+        default:
+            return nil;
+    }
+}
+
+- (NSMutableDictionary *)parsedDictionary
+{
+    PDStatsToken token = PDStatsBeginOperation(PDStatsOperationParse, nil);
+    NSMutableDictionary *dictionary = [self parseDocumentDictionary];
+    PDStatsEndOperation(token, nil, [self parsedLength]);
+    return dictionary;
+}
+
+- (NSArray *)parsedArray
+{
+    PDStatsToken token = PDStatsBeginOperation(PDStatsOperationParse, nil);
+    NSArray *array = [self parseDocumentArray];
+    PDStatsEndOperation(token, nil, [self parsedLength]);
+    return array;
+}
+
+- (NSArray *)parsedArrayConcurrently
+{
+    PDStatsToken token = PDStatsBeginOperation(PDStatsOperationParse, nil);
+    NSArray *array = [self parseDocumentArrayConcurrently];
+    PDStatsEndOperation(token, nil, [self parsedLength]);
+    return array;
+}
+
+/** The number of bytes of JSON the parser has read, for statistics */
+- (uint64_t)parsedLength
+{
+    return _stream ? _streamedLength : _length;
+}
+
+- (NSMutableDictionary *)parseDocumentDictionary
+{
+    _position = 0;
+    _depth = 0;
+
+    if ([self nextNonWhitespaceByte] != '{')
+    {
+        return nil;
+    }
+
+    NSMutableDictionary *dictionary = [self parseObject];
+
+    if (!dictionary || ![self isAtEnd])
+    {
+        return nil;
+    }
+
+    return dictionary.pd_orderedKeys.count || dictionary.pd_innerValue ? dictionary : nil;
+}
+
+- (NSArray *)parseDocumentArray
+{
+    _position = 0;
+    _depth = 0;
+
+    if ([self nextNonWhitespaceByte] != '[')
+    {
+        return nil;
+    }
+
+    NSArray *array = [self parseArrayOfElementsNamed:nil];
+
+    if (!array || ![self isAtEnd])
+    {
+        return nil;
+    }
+
+    return array.count ? array : nil;
+}
+
+- (NSArray *)parseDocumentArrayConcurrently
+{
+    _position = 0;
+    _depth = 0;
+
+    if (_stream || _length < PDJSONConcurrentChunkLength * 2 || [self nextNonWhitespaceByte] != '[')
+    {
+        return [self parseDocumentArray];
+    }
+
+    NSUInteger start = _position;
+    NSUInteger maximumChunks = [NSProcessInfo processInfo].activeProcessorCount * 4;
+    NSUInteger chunkLength = MAX(PDJSONConcurrentChunkLength, (_length - start) / maximumChunks);
+    NSMutableData *splitData = [NSMutableData dataWithLength:maximumChunks * sizeof(NSUInteger)];
+    NSUInteger *splits = splitData.mutableBytes;
+    NSUInteger splitCount = 0;
+    NSUInteger end = PDJSONScanArraySplits(_bytes, _length, start, chunkLength, splits, maximumChunks - 1, &splitCount);
+
+    if (end == NSNotFound)
+    {
+        return nil;
+    }
+
+    _position = end + 1;
+    if (![self isAtEnd])
+    {
+        return nil;
+    }
+
+    if (!splitCount)
+    {
+        // A few very large items can't be divided, and an empty array needs no help
+        return [self parseDocumentArray];
+    }
+
+    // Each chunk runs from just after one split to just before the next.  The first is parsed here, which fills this parser's table with the keys the items share
+    NSUInteger chunkCount = splitCount + 1;
+    __strong NSArray **chunkArrays = (__strong NSArray **) calloc(chunkCount, sizeof(NSArray *));
+    NSUInteger length = _length;
+    _position = start + 1;
+    _length = splits[0];
+    _depth = 1;
+    chunkArrays[0] = [self parseArrayItems];
+    _length = length;
+    _position = end + 1;
+    _depth = 0;
+
+    // The rest are parsed by parsers of their own, which only read this parser's table, so every chunk holds the same instance of each key it shares with the first
+    NSData *data = _data;
+    NSString *keyForInnerValue = _keyForInnerValue;
+    PDNodeSourceText *sourceText = _sourceText;
+    const PDStringTable *sharedKeys = &_keys;
+
+    dispatch_apply(chunkArrays[0] ? splitCount : 0, dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0), ^(size_t index) {
+        size_t chunk = index + 1;
+        PDJSONParser *chunkParser = [[PDJSONParser alloc] initWithJSONData:data keyForInnerValue:keyForInnerValue];
+        chunkParser->_position = splits[chunk - 1] + 1;
+        chunkParser->_length = chunk < splitCount ? splits[chunk] : end;
+        chunkParser->_depth = 1;
+        chunkParser->_sourceText = sourceText;
+        chunkParser->_sharedKeys = sharedKeys;
+        chunkArrays[chunk] = [chunkParser parseArrayItems];
+    });
+
+    NSMutableArray *array = [NSMutableArray array];
+    for (NSUInteger i = 0; i < chunkCount; i++)
+    {
+        if (array && chunkArrays[i])
+        {
+            [array addObjectsFromArray:chunkArrays[i]];
+        }
+        else
+        {
+            array = nil;
+        }
+        chunkArrays[i] = nil;
+    }
+    free(chunkArrays);
+
+    return array.count ? array : nil;
+}
+
+- (BOOL)enumerateMatchesOfMatcher:(PDXPathStreamMatcher *)matcher usingBlock:(void (^)(NSMutableDictionary *element, BOOL *stop))block
+{
+    if (matcher == nil || block == nil)
+    {
+        return NO;
+    }
+
+    BOOL openedStream = NO;
+    if (_stream.streamStatus == NSStreamStatusNotOpen)
+    {
+        [_stream open];
+        openedStream = YES;
+    }
+
+    _matcher = matcher;
+    _matchHandler = block;
+    _stopped = NO;
+    _position = 0;
+    _depth = 0;
+    PDStatsToken token = PDStatsBeginOperation(PDStatsOperationParse, nil);
+
+    // The outermost object or array is the context of the query rather than an element, so its contents are scanned in the matcher's starting state
+    BOOL success;
+    switch ([self nextNonWhitespaceByte])
+    {
+        case '{':
+            success = [self scanObject];
+            break;
+        case '[':
+            success = [self scanArrayOfElementsNamed:nil];
+            break;
+        default:
+            success = NO;
+            break;
+    }
+
+    success = _stopped || (success && [self isAtEnd] && !_streamFailed);
+
+    if (openedStream)
+    {
+        [_stream close];
+    }
+
+    PDStatsEndOperation(token, nil, [self parsedLength]);
+    _matcher = nil;
+    _matchHandler = nil;
+    return success;
+}
+
+
+#pragma mark - Structure
+
+- (NSMutableDictionary *)parseObject
+{
+    if (++_depth > PDJSONMaximumNestingDepth)
+    {
+        return nil;
+    }
+
+    NSUInteger start = _position++;
+    NSMutableDictionary *dictionary = [PDNode dictionary];
+    uint8_t next = [self nextNonWhitespaceByte];
+
+    if (next == '}')
+    {
+        _position++;
+        _depth--;
+        return dictionary;
+    }
+
+    NSUInteger memberCount = 0;
+    BOOL lastMemberIsInnerValue = NO;
+
+    while (YES)
+    {
+        if (next != '"')
+        {
+            return nil;
+        }
+
+        NSString *key = [self parseKey];
+
+        if (!key || [self nextNonWhitespaceByte] != ':')
+        {
+            return nil;
+        }
+
+        _position++;
+
+        if (_sourceText)
+        {
+            // The writer writes each key once, and the inner value after everything else
+            if (lastMemberIsInnerValue || !key.length || dictionary[key])
+            {
+                PDJSONNoteNoncanonical(self, _position);
+            }
+            lastMemberIsInnerValue = [self nextNonWhitespaceByte] == '"' && [key isEqualToString:_keyForInnerValue];
+            memberCount++;
+        }
+
+        if (![self parseValueIntoDictionary:dictionary forKey:key] || _stopped)
+        {
+            return nil;
+        }
+
+        [self discardConsumedBytes];
+
+        next = [self nextNonWhitespaceByte];
+
+        if (next == ',')
+        {
+            _position++;
+            next = [self nextNonWhitespaceByte];
+        }
+        else if (next == '}')
+        {
+            _position++;
+            break;
+        }
+        else
+        {
+            return nil;
+        }
+    }
+
+    // Set once the contents are built, since building them would otherwise count as changing the dictionary.  An element with nothing but an inner value is written as the bare value
+    if (_sourceText)
+    {
+        if (lastMemberIsInnerValue && memberCount == 1)
+        {
+            PDJSONNoteNoncanonical(self, _position);
+        }
+        if (PDJSONIsCanonicalSince(self, start))
+        {
+            PDNodeSetSourceRange((PDNode *) dictionary, _sourceText, NSMakeRange(start, _position - start));
+        }
+    }
+
+    _depth--;
+    return dictionary;
+}
+
+- (NSMutableArray *)parseArrayOfElementsNamed:(NSString *)name
+{
+    if (++_depth > PDJSONMaximumNestingDepth)
+    {
+        return nil;
+    }
+
+    _position++;
+    NSMutableArray *array = [NSMutableArray array];
+
+    if ([self nextNonWhitespaceByte] == ']')
+    {
+        _position++;
+        _depth--;
+        return array;
+    }
+
+    while (YES)
+    {
+        if (![self parseValueIntoArray:array elementName:name] || _stopped)
+        {
+            return nil;
+        }
+
+        [self discardConsumedBytes];
+
+        uint8_t next = [self nextNonWhitespaceByte];
+
+        if (next == ',')
+        {
+            _position++;
+        }
+        else if (next == ']')
+        {
+            _position++;
+            break;
+        }
+        else
+        {
+            return nil;
+        }
+    }
+
+    _depth--;
+    return array;
+}
+
+/** Parses comma-separated array items from the current position to the end of the data, which has been limited to one chunk of a top-level array */
+- (NSMutableArray *)parseArrayItems
+{
+    NSMutableArray *array = [NSMutableArray array];
+
+    while (YES)
+    {
+        if (![self parseValueIntoArray:array elementName:nil])
+        {
+            return nil;
+        }
+
+        uint8_t next = [self nextNonWhitespaceByte];
+
+        if (_position == _length)
+        {
+            return array;
+        }
+        if (next != ',')
+        {
+            return nil;
+        }
+        _position++;
+    }
+}
+
+- (BOOL)parseValueIntoDictionary:(NSMutableDictionary *)dictionary forKey:(NSString *)key
+{
+    switch ([self nextNonWhitespaceByte])
+    {
+        case '{':
+        {
+            [_matcher enterElementNamed:key];
+            NSMutableDictionary *element = [self parseObject];
+            if (!element)
+            {
+                return NO;
+            }
+
+            if (element.pd_orderedKeys.count || element.pd_innerValue)
+            {
+                [dictionary pd_addElement:element withName:key];
+                [self reportElementIfMatching:element];
+            }
+            else
+            {
+                PDJSONNoteNoncanonical(self, _position);
+            }
+            [_matcher exitElement];
+            return YES;
+        }
+
+        case '[':
+        {
+            NSArray *elements = [self parseArrayOfElementsNamed:key];
+            if (!elements)
+            {
+                return NO;
+            }
+
+            if (elements.count)
+            {
+                [dictionary pd_addElement:(id) [NSMutableArray array] withName:key];
+            }
+            else
+            {
+                PDJSONNoteNoncanonical(self, _position);
+            }
+
+            for (NSMutableDictionary *element in elements)
+            {
+                [dictionary pd_addElement:element withName:key];
+            }
+            return YES;
+        }
+
+        case '"':
+        {
+            NSString *string = [self parseString];
+            if (!string)
+            {
+                return NO;
+            }
+
+            if (!string.length)
+            {
+                PDJSONNoteNoncanonical(self, _position);
+            }
+
+            // Inner values are mapped while parsing, so no separate pass over the finished tree is needed
+            if ([key isEqualToString:_keyForInnerValue])
+            {
+                if (string.length)
+                {
+                    [dictionary pd_setInnerValue:string];
+                }
+            }
+            else
+            {
+                [dictionary pd_setValue:string forAttribute:key];
+            }
+            return YES;
+        }
+
+        case 'n':
+            PDJSONNoteNoncanonical(self, _position);
+            return [self parseLiteral:"null" length:4];
+
+        default:
+        {
+            NSNumber *number = [self parseNumberOrBoolean];
+            if (!number)
+            {
+                return NO;
+            }
+
+            [dictionary pd_setValue:number forAttribute:key];
+            return YES;
+        }
+    }
+}
+
+- (BOOL)parseValueIntoArray:(NSMutableArray *)array elementName:(NSString *)name
+{
+    switch ([self nextNonWhitespaceByte])
+    {
+        case '{':
+        {
+            // Items of an array under a key are elements with that key's name, and are followed by the matcher when streaming
+            if (name)
+            {
+                [_matcher enterElementNamed:name];
+            }
+
+            NSMutableDictionary *element = [self parseObject];
+            if (!element)
+            {
+                return NO;
+            }
+
+            if (element.pd_orderedKeys.count || element.pd_innerValue)
+            {
+                [array addObject:element];
+                if (_matcher && name)
+                {
+                    element.pd_elementName = name;
+                    [self reportElementIfMatching:element];
+                }
+            }
+            else
+            {
+                PDJSONNoteNoncanonical(self, _position);
+            }
+
+            if (name)
+            {
+                [_matcher exitElement];
+            }
+            return YES;
+        }
+
+        case '[':
+            // Arrays nested directly inside arrays have no PrestoData representation, so they are validated and skipped
+            PDJSONNoteNoncanonical(self, _position);
+            return [self parseArrayOfElementsNamed:nil] != nil;
+
+        case '"':
+        {
+            NSString *string = [self parseString];
+            if (!string)
+            {
+                return NO;
+            }
+
+            NSMutableDictionary *element = [PDNode dictionary];
+            if (string.length)
+            {
+                [element pd_setInnerValue:string];
+            }
+            else
+            {
+                // Written as an empty object
+                PDJSONNoteNoncanonical(self, _position);
+            }
+            [array addObject:element];
+            [self reportScalarElementIfMatching:element named:name];
+            return YES;
+        }
+
+        case 'n':
+            PDJSONNoteNoncanonical(self, _position);
+            return [self parseLiteral:"null" length:4];
+
+        default:
+        {
+            NSNumber *number = [self parseNumberOrBoolean];
+            if (!number)
+            {
+                return NO;
+            }
+
+            NSMutableDictionary *element = [PDNode dictionary];
+            [element pd_setInnerValue:number];
+            [array addObject:element];
+            [self reportScalarElementIfMatching:element named:name];
+            return YES;
+        }
+    }
+}
+
+
+#pragma mark - Lazy Parsing
+
+- (NSMutableDictionary *)lazilyParsedDictionary
+{
+    if (_stream)
+    {
+        return [self parsedDictionary];
+    }
+
+    PDStatsToken token = PDStatsBeginOperation(PDStatsOperationParse, nil);
+    NSMutableDictionary *dictionary = [self scanSkeletonExpecting:'{'] ? [self lazyElementAtIndex:0 named:nil parent:nil] : nil;
+    PDStatsEndOperation(token, nil, _length);
+    return dictionary;
+}
+
+- (NSArray *)lazilyParsedArray
+{
+    if (_stream)
+    {
+        return [self parsedArray];
+    }
+
+    PDStatsToken token = PDStatsBeginOperation(PDStatsOperationParse, nil);
+    NSArray *array = [self scanSkeletonExpecting:'['] ? [self lazyElementsOfArrayAtIndex:0 named:nil parent:nil] : nil;
+    PDStatsEndOperation(token, nil, _length);
+    return array.count ? array : nil;
+}
+
+/** Checks the whole document and records the skeleton of its objects and arrays.  Returns NO if the JSON is malformed, isn't the expected kind of container, or would parse to nothing */
+- (BOOL)scanSkeletonExpecting:(uint8_t)open
+{
+    // The data is read again whenever a dictionary loads, so it must not change underneath the document
+    _data = [_data copy];
+    _bytes = _data.bytes;
+    _length = _data.length;
+    _position = 0;
+    _depth = 0;
+    _containers = [NSMutableData data];
+    _containerCount = 0;
+
+    BOOL hasContents = NO;
+    if ([self nextNonWhitespaceByte] != open || ![self scanSkeletonValueInArray:NO contributes:&hasContents] || ![self isAtEnd])
+    {
+        return NO;
+    }
+
+    return hasContents;
+}
+
+/** Steps over a value like skipValue, recording every object and array in it in the skeleton
+* @param inArray YES if the value is an array item, otherwise it is the value of an object member
+* @param contributes Set to whether the value adds anything to the dictionary or array it is in when loaded
+*/
+- (BOOL)scanSkeletonValueInArray:(BOOL)inArray contributes:(BOOL *)contributes
+{
+    uint8_t byte = [self nextNonWhitespaceByte];
+
+    switch (byte)
+    {
+        case '{':
+        case '[':
+        {
+            if (++_depth > PDJSONMaximumNestingDepth)
+            {
+                return NO;
+            }
+
+            BOOL isObject = byte == '{';
+            uint8_t close = isObject ? '}' : ']';
+            NSUInteger index = _containerCount++;
+            NSUInteger start = _position;
+            PDJSONContainer container = { start, 0, 0, NO, NO };
+            [_containers appendBytes:&container length:sizeof(container)];
+
+            BOOL hasContents = NO;
+            NSUInteger memberCount = 0;
+            BOOL lastMemberIsInnerValue = NO;
+            NSMutableSet *keys = isObject && _sourceText ? [NSMutableSet set] : nil;
+            _position++;
+            uint8_t next = [self nextNonWhitespaceByte];
+
+            while (next != close)
+            {
+                // Scalars under an empty key would be attributes without a name, which are never set
+                BOOL emptyKey = NO;
+                NSString *key = nil;
+                if (isObject)
+                {
+                    // Every key is interned now, so that loads can share the keys without adding to the table
+                    NSUInteger keyStart = _position;
+                    if (next != '"' || !(key = [self parseKey]) || [self nextNonWhitespaceByte] != ':')
+                    {
+                        return NO;
+                    }
+                    emptyKey = _position - keyStart == 2;
+                    _position++;
+                }
+
+                uint8_t memberByte = [self nextNonWhitespaceByte];
+                BOOL memberIsContainer = memberByte == '{' || memberByte == '[';
+                BOOL memberContributes = NO;
+
+                if (keys)
+                {
+                    // As in parseObject, each key is written once and the inner value after everything else
+                    if (lastMemberIsInnerValue || emptyKey || [keys containsObject:key])
+                    {
+                        PDJSONNoteNoncanonical(self, _position);
+                    }
+                    [keys addObject:key];
+                    lastMemberIsInnerValue = memberByte == '"' && [key isEqualToString:_keyForInnerValue];
+                    memberCount++;
+                }
+
+                if (![self scanSkeletonValueInArray:!isObject contributes:&memberContributes])
+                {
+                    return NO;
+                }
+                hasContents = hasContents || (memberContributes && (memberIsContainer || !emptyKey));
+
+                next = [self nextNonWhitespaceByte];
+                if (next == ',')
+                {
+                    _position++;
+                    next = [self nextNonWhitespaceByte];
+                    if (next == close)
+                    {
+                        return NO;
+                    }
+                }
+                else if (next != close)
+                {
+                    return NO;
+                }
+            }
+
+            _position++;
+            _depth--;
+
+            if (lastMemberIsInnerValue && memberCount == 1)
+            {
+                PDJSONNoteNoncanonical(self, _position);
+            }
+
+            PDJSONContainer *record = (PDJSONContainer *) _containers.mutableBytes + index;
+            record->end = _position;
+            record->descendants = _containerCount - index - 1;
+            record->hasContents = hasContents;
+            record->canonical = PDJSONIsCanonicalSince(self, start);
+
+            // Arrays nested directly inside arrays are dropped
+            *contributes = hasContents && (isObject || !inArray);
+            if (!*contributes)
+            {
+                PDJSONNoteNoncanonical(self, _position);
+            }
+            return YES;
+        }
+
+        case '"':
+        {
+            // An empty string is an element in an array, but isn't set as an attribute or inner value
+            NSUInteger start = _position;
+            *contributes = NO;
+            if (![self skipString])
+            {
+                return NO;
+            }
+            *contributes = inArray || _position - start > 2;
+            if (_position - start == 2)
+            {
+                PDJSONNoteNoncanonical(self, start);
+            }
+            return YES;
+        }
+
+        case 'n':
+            *contributes = NO;
+            PDJSONNoteNoncanonical(self, _position);
+            return [self parseLiteral:"null" length:4];
+
+        default:
+            *contributes = YES;
+            return [self parseNumberOrBoolean] != nil;
+    }
+}
+
+/** Returns the inner value of an object in the skeleton, which a dictionary needs before it is loaded */
+- (NSString *)innerValueOfObjectAtIndex:(NSUInteger)index
+{
+    const PDJSONContainer *containers = _containers.bytes;
+    NSUInteger nextIndex = index + 1;
+    NSString *innerValue = nil;
+
+    _position = containers[index].start + 1;
+    uint8_t next = [self nextNonWhitespaceByte];
+
+    while (next == '"')
+    {
+        NSString *key = [self parseKey];
+        if (!key || [self nextNonWhitespaceByte] != ':')
+        {
+            break;
+        }
+        _position++;
+
+        uint8_t byte = [self nextNonWhitespaceByte];
+        if (byte == '{' || byte == '[')
+        {
+            _position = containers[nextIndex].end;
+            nextIndex += containers[nextIndex].descendants + 1;
+        }
+        else if (byte == '"' && [key isEqualToString:_keyForInnerValue])
+        {
+            // As in a full parse, the last non-empty inner value wins
+            NSString *string = [self parseString];
+            if (!string)
+            {
+                break;
+            }
+            innerValue = string.length ? string : innerValue;
+        }
+        else if (![self skipValue])
+        {
+            break;
+        }
+
+        next = [self nextNonWhitespaceByte];
+        if (next == ',')
+        {
+            _position++;
+            next = [self nextNonWhitespaceByte];
+        }
+    }
+
+    return innerValue;
+}
+
+/** Creates a dictionary for an object in the skeleton, which loads its contents when it is first used */
+- (PDNode *)lazyElementAtIndex:(NSUInteger)index named:(NSString *)name parent:(NSMutableDictionary *)parent
+{
+    PDJSONParser *document = _document ? : self;
+    PDNode *node = PDNodeCreateWithContentSource(document, index, [self innerValueOfObjectAtIndex:index], name, parent);
+
+    const PDJSONContainer *container = (const PDJSONContainer *) _containers.bytes + index;
+    if (document->_sourceText && container->canonical)
+    {
+        PDNodeSetSourceRange(node, document->_sourceText, NSMakeRange(container->start, container->end - container->start));
+    }
+
+    return node;
+}
+
+/** Creates the elements of an array in the skeleton.  Objects become dictionaries that load when first used, and scalars become dictionaries with the scalar as their inner value */
+- (NSMutableArray *)lazyElementsOfArrayAtIndex:(NSUInteger)index named:(NSString *)name parent:(NSMutableDictionary *)parent
+{
+    const PDJSONContainer *containers = _containers.bytes;
+    NSUInteger nextIndex = index + 1;
+    NSMutableArray *elements = [NSMutableArray array];
+
+    _position = containers[index].start + 1;
+    uint8_t byte = [self nextNonWhitespaceByte];
+
+    while (byte != ']' && _position < _length)
+    {
+        NSMutableDictionary *element = nil;
+
+        if (byte == '{' || byte == '[')
+        {
+            NSUInteger child = nextIndex;
+            nextIndex += containers[child].descendants + 1;
+            if (byte == '{' && containers[child].hasContents)
+            {
+                element = [self lazyElementAtIndex:child named:name parent:parent];
+            }
+            _position = containers[child].end;
+        }
+        else if (byte == 'n')
+        {
+            _position += 4;
+        }
+        else
+        {
+            id value = byte == '"' ? [self parseString] : [self parseNumberOrBoolean];
+            if (!value)
+            {
+                break;
+            }
+
+            element = [PDNode dictionary];
+            if (![value isKindOfClass:[NSString class]] || ((NSString *) value).length)
+            {
+                [element pd_setInnerValue:value];
+            }
+            element.pd_elementName = name;
+            element.pd_parentDictionary = parent;
+        }
+
+        if (element)
+        {
+            [elements addObject:element];
+        }
+
+        byte = [self nextNonWhitespaceByte];
+        if (byte == ',')
+        {
+            _position++;
+            byte = [self nextNonWhitespaceByte];
+        }
+    }
+
+    return elements;
+}
+
+/** Adds an element to a dictionary that is loading, the way pd_addElement:withName: would, which can't be used while the dictionary loads */
+static void PDJSONAddLoadedElements(PDNode *node, NSString *key, NSArray *elements, BOOL asArray)
+{
+    id existing = PDNodeLoadedObjectForKey(node, key);
+
+    if (!existing && !asArray)
+    {
+        PDNodeAppendLoadedObject(node, key, elements.firstObject);
+        return;
+    }
+
+    NSMutableArray *array = existing;
+    if (![existing isKindOfClass:[NSMutableArray class]])
+    {
+        array = existing ? [NSMutableArray arrayWithObject:existing] : [NSMutableArray array];
+        array.pd_elementName = key;
+        array.pd_parentDictionary = node;
+        PDNodeAppendLoadedObject(node, key, array);
+    }
+    [array addObjectsFromArray:elements];
+}
+
+- (void)pd_loadContentsOfNode:(PDNode *)node fromLocation:(uint64_t)location
+{
+    // Dictionaries load on whichever threads first use them, so each load reads with a cursor of its own.  The skeleton and the keys table aren't changed once the scan is done, so cursors share them
+    PDJSONParser *cursor = [[PDJSONParser alloc] initWithJSONData:_data keyForInnerValue:_keyForInnerValue];
+    cursor->_document = self;
+    cursor->_containers = _containers;
+    cursor->_containerCount = _containerCount;
+    [cursor loadContentsOfNode:node fromContainerAtIndex:(NSUInteger) location];
+}
+
+/** Fills in a lazily parsed dictionary from its object in the skeleton.  Run on a cursor */
+- (void)loadContentsOfNode:(PDNode *)node fromContainerAtIndex:(NSUInteger)index
+{
+    const PDJSONContainer *containers = _containers.bytes;
+    NSUInteger nextIndex = index + 1;
+
+    _position = containers[index].start + 1;
+    uint8_t next = [self nextNonWhitespaceByte];
+
+    // The skeleton scan checked the structure, so only strings can fail here.  Whatever loaded before a bad string is kept
+    while (next == '"')
+    {
+        NSString *key = [self parseKey];
+        if (!key || [self nextNonWhitespaceByte] != ':')
+        {
+            break;
+        }
+        _position++;
+
+        uint8_t byte = [self nextNonWhitespaceByte];
+
+        if (byte == '{' || byte == '[')
+        {
+            NSUInteger child = nextIndex;
+            nextIndex += containers[child].descendants + 1;
+
+            if (containers[child].hasContents && byte == '{')
+            {
+                PDJSONAddLoadedElements(node, key, @[[self lazyElementAtIndex:child named:key parent:node]], NO);
+            }
+            else if (containers[child].hasContents)
+            {
+                PDJSONAddLoadedElements(node, key, [self lazyElementsOfArrayAtIndex:child named:key parent:node], YES);
+            }
+            _position = containers[child].end;
+        }
+        else if (byte == 'n')
+        {
+            _position += 4;
+        }
+        else if (byte == '"' && [key isEqualToString:_keyForInnerValue])
+        {
+            // The inner value was found when the node was created
+            if (![self skipString])
+            {
+                break;
+            }
+        }
+        else
+        {
+            id value = byte == '"' ? [self parseString] : [self parseNumberOrBoolean];
+            if (!value)
+            {
+                break;
+            }
+            if (key.length && (![value isKindOfClass:[NSString class]] || ((NSString *) value).length))
+            {
+                PDNodeAppendLoadedObject(node, key, value);
+            }
+        }
+
+        next = [self nextNonWhitespaceByte];
+        if (next == ',')
+        {
+            _position++;
+            next = [self nextNonWhitespaceByte];
+        }
+    }
+}
+
+
+#pragma mark - Streaming
+
+- (void)reportElementIfMatching:(NSMutableDictionary *)element
+{
+    if (_matcher && !_stopped && [_matcher currentElementMatches:element])
+    {
+        _matchHandler(element, &_stopped);
+    }
+}
+
+- (void)reportScalarElementIfMatching:(NSMutableDictionary *)element named:(NSString *)name
+{
+    if (!_matcher || !name)
+    {
+        return;
+    }
+
+    [_matcher enterElementNamed:name];
+    element.pd_elementName = name;
+    [self reportElementIfMatching:element];
+    [_matcher exitElement];
+}
+
+- (BOOL)scalarElementMayMatchNamed:(NSString *)name
+{
+    [_matcher enterElementNamed:name];
+    BOOL mayMatch = _matcher.currentElementMayMatch;
+    [_matcher exitElement];
+    return mayMatch;
+}
+
+/** Scans the members of an object without building it, following child elements with the matcher */
+- (BOOL)scanObject
+{
+    if (++_depth > PDJSONMaximumNestingDepth)
+    {
+        return NO;
+    }
+
+    _position++;
+    uint8_t next = [self nextNonWhitespaceByte];
+
+    if (next == '}')
+    {
+        _position++;
+        _depth--;
+        return YES;
+    }
+
+    while (YES)
+    {
+        if (next != '"')
+        {
+            return NO;
+        }
+
+        NSString *key = [self parseKey];
+
+        if (!key || [self nextNonWhitespaceByte] != ':')
+        {
+            return NO;
+        }
+
+        _position++;
+
+        BOOL success;
+        switch ([self nextNonWhitespaceByte])
+        {
+            case '{':
+                success = [self scanElementNamed:key];
+                break;
+            case '[':
+                success = [self scanArrayOfElementsNamed:key];
+                break;
+            default:
+                // Attributes and inner values are never elements themselves
+                success = [self skipValue];
+                break;
+        }
+
+        if (!success)
+        {
+            return NO;
+        }
+
+        if (_stopped)
+        {
+            return YES;
+        }
+
+        [self discardConsumedBytes];
+        next = [self nextNonWhitespaceByte];
+
+        if (next == ',')
+        {
+            _position++;
+            next = [self nextNonWhitespaceByte];
+        }
+        else if (next == '}')
+        {
+            _position++;
+            break;
+        }
+        else
+        {
+            return NO;
+        }
+    }
+
+    _depth--;
+    return YES;
+}
+
+/** Scans the items of an array without building it.  Items of an array under a key are elements with that key's name; items of the outermost array (with a nil name) are contexts of the query */
+- (BOOL)scanArrayOfElementsNamed:(NSString *)name
+{
+    if (++_depth > PDJSONMaximumNestingDepth)
+    {
+        return NO;
+    }
+
+    _position++;
+
+    if ([self nextNonWhitespaceByte] == ']')
+    {
+        _position++;
+        _depth--;
+        return YES;
+    }
+
+    while (YES)
+    {
+        BOOL success;
+        switch ([self nextNonWhitespaceByte])
+        {
+            case '{':
+                success = name ? [self scanElementNamed:name] : [self scanObject];
+                break;
+            case '[':
+                success = [self skipValue];
+                break;
+            default:
+                // Strings and numbers in an array become elements with inner values, so they are built only when they could match
+                success = name && [self scalarElementMayMatchNamed:name] ? [self parseValueIntoArray:[NSMutableArray array] elementName:name] : [self skipValue];
+                break;
+        }
+
+        if (!success)
+        {
+            return NO;
+        }
+
+        if (_stopped)
+        {
+            return YES;
+        }
+
+        [self discardConsumedBytes];
+        uint8_t next = [self nextNonWhitespaceByte];
+
+        if (next == ',')
+        {
+            _position++;
+        }
+        else if (next == ']')
+        {
+            _position++;
+            break;
+        }
+        else
+        {
+            return NO;
+        }
+    }
+
+    _depth--;
+    return YES;
+}
+
+/** Handles an object that is an element: builds it if it may match, scans it if elements inside it still could, and otherwise skips it */
+- (BOOL)scanElementNamed:(NSString *)name
+{
+    BOOL success;
+
+    @autoreleasepool {
+        [_matcher enterElementNamed:name];
+
+        if (_matcher.currentElementMayMatch)
+        {
+            NSMutableDictionary *element = [self parseObject];
+            success = element != nil;
+
+            // Empty objects aren't elements, just as when building a whole document
+            if (success && (element.pd_orderedKeys.count || element.pd_innerValue))
+            {
+                element.pd_elementName = name;
+                [self reportElementIfMatching:element];
+            }
+        }
+        else if (_matcher.tracking)
+        {
+            success = [self scanObject];
+        }
+        else
+        {
+            success = [self skipValue];
+        }
+
+        [_matcher exitElement];
+    }
+
+    return success;
+}
+
+/** Steps over any value without creating objects for it.  Structure is checked, but strings are only checked for termination */
+- (BOOL)skipValue
+{
+    switch ([self nextNonWhitespaceByte])
+    {
+        case '{':
+        {
+            if (++_depth > PDJSONMaximumNestingDepth)
+            {
+                return NO;
+            }
+
+            _position++;
+            uint8_t next = [self nextNonWhitespaceByte];
+
+            if (next == '}')
+            {
+                _position++;
+                _depth--;
+                return YES;
+            }
+
+            while (YES)
+            {
+                if (next != '"' || ![self skipString] || [self nextNonWhitespaceByte] != ':')
+                {
+                    return NO;
+                }
+
+                _position++;
+
+                if (![self skipValue])
+                {
+                    return NO;
+                }
+
+                [self discardConsumedBytes];
+                next = [self nextNonWhitespaceByte];
+
+                if (next == ',')
+                {
+                    _position++;
+                    next = [self nextNonWhitespaceByte];
+                }
+                else if (next == '}')
+                {
+                    _position++;
+                    break;
+                }
+                else
+                {
+                    return NO;
+                }
+            }
+
+            _depth--;
+            return YES;
+        }
+
+        case '[':
+        {
+            if (++_depth > PDJSONMaximumNestingDepth)
+            {
+                return NO;
+            }
+
+            _position++;
+
+            if ([self nextNonWhitespaceByte] == ']')
+            {
+                _position++;
+                _depth--;
+                return YES;
+            }
+
+            while (YES)
+            {
+                if (![self skipValue])
+                {
+                    return NO;
+                }
+
+                [self discardConsumedBytes];
+                uint8_t next = [self nextNonWhitespaceByte];
+
+                if (next == ',')
+                {
+                    _position++;
+                }
+                else if (next == ']')
+                {
+                    _position++;
+                    break;
+                }
+                else
+                {
+                    return NO;
+                }
+            }
+
+            _depth--;
+            return YES;
+        }
+
+        case '"':
+            return [self skipString];
+
+        case 'n':
+            return [self parseLiteral:"null" length:4];
+
+        default:
+            return [self parseNumberOrBoolean] != nil;
+    }
+}
+
+- (BOOL)skipString
+{
+    _position++;
+
+    while (PDJSONHasBytes(self, 1))
+    {
+        uint8_t byte = _bytes[_position];
+
+        if (byte == '"')
+        {
+            _position++;
+            return YES;
+        }
+
+        if (byte < 0x20)
+        {
+            return NO;
+        }
+
+        if (byte == '\\')
+        {
+            if (!PDJSONHasBytes(self, 2))
+            {
+                return NO;
+            }
+            PDJSONNoteNoncanonical(self, _position);
+            _position += 2;
+            continue;
+        }
+
+        _position++;
+    }
+
+    return NO;
+}
+
+
+#pragma mark - Scalars
+
+/** Parses a string that is an object key.  Keys repeat throughout most documents, so they are interned rather than decoded every time they occur */
+- (NSString *)parseKey
+{
+    NSUInteger start = _position + 1;
+    NSUInteger end = start;
+
+    while (end < _length && _bytes[end] != '"' && _bytes[end] != '\\' && _bytes[end] >= 0x20)
+    {
+        end++;
+    }
+
+    // Keys with escapes, and keys that continue past the end of a stream's buffer, are rare enough to take the general path
+    if (end == _length || _bytes[end] != '"')
+    {
+        return [self parseString];
+    }
+
+    _position = end + 1;
+
+    // A cursor may be loading on several threads at once with others, so it only looks keys up in the document's table, which the skeleton scan filled in
+    if (_document)
+    {
+        return PDStringTableFind(&_document->_keys, _bytes + start, end - start) ? : [[NSString alloc] initWithBytes:_bytes + start length:end - start encoding:NSUTF8StringEncoding];
+    }
+
+    // A chunk of a concurrently parsed array only interns the keys its document parser hasn't seen
+    if (_sharedKeys)
+    {
+        NSString *key = PDStringTableFind(_sharedKeys, _bytes + start, end - start);
+        if (key)
+        {
+            return key;
+        }
+    }
+
+    return PDStringTableIntern(&_keys, _bytes + start, end - start);
+}
+
+- (NSString *)parseString
+{
+    NSUInteger start = ++_position;
+
+    while (PDJSONHasBytes(self, 1))
+    {
+        uint8_t byte = _bytes[_position];
+
+        if (byte == '"')
+        {
+            NSString *string = [[NSString alloc] initWithBytes:_bytes + start length:_position - start encoding:NSUTF8StringEncoding];
+            _position++;
+            return string;
+        }
+
+        if (byte == '\\')
+        {
+            return [self parseEscapedStringWithStart:start];
+        }
+
+        if (byte < 0x20)
+        {
+            return nil;
+        }
+
+        _position++;
+    }
+
+    return nil;
+}
+
+- (NSString *)parseEscapedStringWithStart:(NSUInteger)start
+{
+    if (!_unescapedBuffer)
+    {
+        _unescapedBuffer = [NSMutableData dataWithCapacity:256];
+    }
+
+    _unescapedBuffer.length = 0;
+    [_unescapedBuffer appendBytes:_bytes + start length:_position - start];
+
+    // Most characters can be escaped more than one way, so a string with escapes isn't copied from its source
+    PDJSONNoteNoncanonical(self, _position);
+
+    while (PDJSONHasBytes(self, 1))
+    {
+        uint8_t byte = _bytes[_position];
+
+        if (byte == '"')
+        {
+            _position++;
+            return [[NSString alloc] initWithBytes:_unescapedBuffer.bytes length:_unescapedBuffer.length encoding:NSUTF8StringEncoding];
+        }
+
+        if (byte < 0x20)
+        {
+            return nil;
+        }
+
+        if (byte != '\\')
+        {
+            NSUInteger runStart = _position;
+            while (PDJSONHasBytes(self, 1) && _bytes[_position] != '"' && _bytes[_position] != '\\' && _bytes[_position] >= 0x20)
+            {
+                _position++;
+            }
+            [_unescapedBuffer appendBytes:_bytes + runStart length:_position - runStart];
+            continue;
+        }
+
+        if (!PDJSONHasBytes(self, 2))
+        {
+            return nil;
+        }
+        _position++;
+
+        uint8_t unescaped;
+        switch (_bytes[_position++])
+        {
+            case '"': unescaped = '"'; break;
+            case '\\': unescaped = '\\'; break;
+            case '/': unescaped = '/'; break;
+            case 'b': unescaped = '\b'; break;
+            case 'f': unescaped = '\f'; break;
+            case 'n': unescaped = '\n'; break;
+            case 'r': unescaped = '\r'; break;
+            case 't': unescaped = '\t'; break;
+            case 'u':
+                if (![self appendUnicodeEscape])
+                {
+                    return nil;
+                }
+                continue;
+            default:
+                return nil;
+        }
+
+        [_unescapedBuffer appendBytes:&unescaped length:1];
+    }
+
+    return nil;
+}
+
+- (BOOL)appendUnicodeEscape
+{
+    uint32_t codePoint;
+    if (!PDJSONHasBytes(self, 4) || !PDJSONReadHexQuad(_bytes, _length, _position, &codePoint))
+    {
+        return NO;
+    }
+    _position += 4;
+
+    if (codePoint >= 0xD800 && codePoint <= 0xDBFF)
+    {
+        uint32_t lowSurrogate;
+        if (PDJSONHasBytes(self, 6) && _bytes[_position] == '\\' && _bytes[_position + 1] == 'u' && PDJSONReadHexQuad(_bytes, _length, _position + 2, &lowSurrogate) && lowSurrogate >= 0xDC00 && lowSurrogate <= 0xDFFF)
+        {
+            codePoint = 0x10000 + ((codePoint - 0xD800) << 10) + (lowSurrogate - 0xDC00);
+            _position += 6;
+        }
+        else
+        {
+            codePoint = 0xFFFD;
+        }
+    }
+    else if (codePoint >= 0xDC00 && codePoint <= 0xDFFF)
+    {
+        codePoint = 0xFFFD;
+    }
+
+    uint8_t encoded[4];
+    [_unescapedBuffer appendBytes:encoded length:PDJSONEncodeUTF8(codePoint, encoded)];
+    return YES;
+}
+
+- (NSNumber *)parseNumberOrBoolean
+{
+    if (!PDJSONHasBytes(self, 1))
+    {
+        return nil;
+    }
+
+    uint8_t byte = _bytes[_position];
+
+    if (byte == 't')
+    {
+        return [self parseLiteral:"true" length:4] ? @YES : nil;
+    }
+
+    if (byte == 'f')
+    {
+        return [self parseLiteral:"false" length:5] ? @NO : nil;
+    }
+
+    NSUInteger start = _position;
+
+    if (byte == '-')
+    {
+        _position++;
+    }
+
+    if (![self skipDigits])
+    {
+        return nil;
+    }
+
+    if (PDJSONHasBytes(self, 1) && _bytes[_position] == '.')
+    {
+        _position++;
+        if (![self skipDigits])
+        {
+            return nil;
+        }
+    }
+
+    if (PDJSONHasBytes(self, 1) && (_bytes[_position] == 'e' || _bytes[_position] == 'E'))
+    {
+        _position++;
+        if (PDJSONHasBytes(self, 1) && (_bytes[_position] == '+' || _bytes[_position] == '-'))
+        {
+            _position++;
+        }
+        if (![self skipDigits])
+        {
+            return nil;
+        }
+    }
+
+    // The grammar has been checked above, so this only has to convert: whole numbers to exact integers, anything else to the nearest double, without depending on the locale
+    NSNumber *number = [NSNumber pd_numberFromDecimalBytes:_bytes + start length:_position - start];
+
+    if (_sourceText && number)
+    {
+        char buffer[32];
+        size_t length = PDNumberFormat(number, buffer, sizeof(buffer));
+        if (length != _position - start || memcmp(buffer, _bytes + start, length) != 0)
+        {
+            PDJSONNoteNoncanonical(self, start);
+        }
+    }
+
+    return number;
+}
+
+- (BOOL)parseLiteral:(const char *)literal length:(NSUInteger)length
+{
+    if (!PDJSONHasBytes(self, length) || memcmp(_bytes + _position, literal, length) != 0)
+    {
+        return NO;
+    }
+
+    _position += length;
+    return YES;
+}
+
+
+#pragma mark - Scanning
+
+- (BOOL)readUntilAvailable:(NSUInteger)count
+{
+    while (_position + count > _length)
+    {
+        if (_streamEnded)
+        {
+            return NO;
+        }
+
+        NSUInteger length = _streamBuffer.length;
+        _streamBuffer.length = length + PDJSONReadLength;
+        NSInteger read = [_stream read:(uint8_t *)_streamBuffer.mutableBytes + length maxLength:PDJSONReadLength];
+
+        if (read <= 0)
+        {
+            _streamEnded = YES;
+            _streamFailed = read < 0;
+            read = 0;
+        }
+
+        _streamBuffer.length = length + (NSUInteger)read;
+        _streamedLength += (NSUInteger)read;
+        _bytes = _streamBuffer.bytes;
+        _length = _streamBuffer.length;
+    }
+
+    return YES;
+}
+
+- (void)discardConsumedBytes
+{
+    // Nothing before the current position is looked at again once a value is finished, so a stream is parsed in a window little bigger than its largest value
+    if (!_stream || _position < PDJSONReadLength)
+    {
+        return;
+    }
+
+    uint8_t *bytes = _streamBuffer.mutableBytes;
+    memmove(bytes, bytes + _position, _length - _position);
+    _length -= _position;
+    _position = 0;
+    _streamBuffer.length = _length;
+    _bytes = _streamBuffer.bytes;
+}
+
+- (NSUInteger)skipDigits
+{
+    NSUInteger start = _position;
+    while (PDJSONHasBytes(self, 1) && PDJSONIsDigit(_bytes[_position]))
+    {
+        _position++;
+    }
+    return _position - start;
+}
+
+- (uint8_t)nextNonWhitespaceByte
+{
+    if (PDJSONHasBytes(self, 1) && PDJSONIsWhitespace(_bytes[_position]))
+    {
+        // Compact JSON has no whitespace between tokens
+        PDJSONNoteNoncanonical(self, _position);
+        do
+        {
+            _position++;
+        }
+        while (PDJSONHasBytes(self, 1) && PDJSONIsWhitespace(_bytes[_position]));
+    }
+    return PDJSONHasBytes(self, 1) ? _bytes[_position] : 0;
+}
+
+- (BOOL)isAtEnd
+{
+    return [self nextNonWhitespaceByte] == 0 && _position == _length;
+}
+
+@end
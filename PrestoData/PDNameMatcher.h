@@ -0,0 +1,56 @@
+//
+// PDNameMatcher.h
+//
+// Copyright (c) 2015 Daniel Hall
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+
+#import <Foundation/Foundation.h>
+
+/** This class is used internally by PrestoData to test element and attribute names against a name pattern.  The pattern is compiled once, so traversals that test many keys never build regular expressions.
+*
+* A pattern may contain the wildcards * (any run of characters, including none) and ? (exactly one character).  Exact names, a lone *, and simple prefix or suffix patterns such as item* and *Id are matched without running the general glob engine.
+*/
+
+@interface PDNameMatcher : NSObject
+
+/** Creates a matcher for a name pattern.  Surrounding whitespace is trimmed from the pattern
+* @param pattern The name pattern, which may contain * and ? wildcards
+* @return A matcher for the pattern
+*/
++ (instancetype)matcherWithPattern:(NSString *)pattern;
+
+/** The trimmed pattern the matcher was created with */
+@property (nonatomic, copy, readonly) NSString *pattern;
+
+/** The one name the pattern matches when it has no wildcards, otherwise nil */
+@property (nonatomic, copy, readonly) NSString *exactName;
+
+/** YES if the pattern is a lone *, which matches every name */
+@property (nonatomic, readonly) BOOL matchesAnyName;
+
+/** Checks whether a name matches the pattern
+* @param name The element or attribute name to test
+* @return YES if a match, otherwise NO
+*/
+- (BOOL)matchesName:(NSString *)name;
+
+@end
@@ -0,0 +1,183 @@
+//
+// PDNameMatcher.m
+//
+// Copyright (c) 2015 Daniel Hall
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+
+#import "PDNameMatcher.h"
+#import "PDStats+_PrestoData_Internal.h"
+
+/** Names up to this length are copied onto the stack for glob matching */
+static const NSUInteger PDNameMatcherStackBufferLength = 128;
+
+typedef NS_ENUM(NSUInteger, PDNameMatcherKind)
+{
+    PDNameMatcherKindExact,
+    PDNameMatcherKindAny,
+    PDNameMatcherKindPrefix,
+    PDNameMatcherKindSuffix,
+    PDNameMatcherKindGlob
+};
+
+
+/** Matches a name against a glob pattern.  Only the most recent * is ever revisited, so the match never backtracks further than that and runs in O(name length x pattern length) at worst */
+static BOOL PDNameMatcherMatchGlob(const unichar *pattern, NSUInteger patternLength, const unichar *name, NSUInteger nameLength)
+{
+    NSUInteger patternIndex = 0;
+    NSUInteger nameIndex = 0;
+    NSUInteger starIndex = NSNotFound;
+    NSUInteger starNameIndex = 0;
+
+    while (nameIndex < nameLength)
+    {
+        if (patternIndex < patternLength && (pattern[patternIndex] == '?' || pattern[patternIndex] == name[nameIndex]))
+        {
+            patternIndex++;
+            nameIndex++;
+        }
+        else if (patternIndex < patternLength && pattern[patternIndex] == '*')
+        {
+            starIndex = patternIndex++;
+            starNameIndex = nameIndex;
+        }
+        else if (starIndex != NSNotFound)
+        {
+            // Let the last * absorb one more character and retry from just after it
+            patternIndex = starIndex + 1;
+            nameIndex = ++starNameIndex;
+        }
+        else
+        {
+            return NO;
+        }
+    }
+
+    while (patternIndex < patternLength && pattern[patternIndex] == '*')
+    {
+        patternIndex++;
+    }
+
+    return patternIndex == patternLength;
+}
+
+
+@implementation PDNameMatcher
+{
+    PDNameMatcherKind _kind;
+    NSString *_literal;
+    NSData *_patternCharacters;
+}
+
++ (instancetype)matcherWithPattern:(NSString *)pattern
+{
+    return [[self alloc] initWithPattern:pattern];
+}
+
+- (instancetype)initWithPattern:(NSString *)pattern
+{
+    self = [super init];
+
+    if (self) {
+        PDStatsAdd(namePatternCompilations, 1);
+        _pattern = [pattern stringByTrimmingCharactersInSet:[NSCharacterSet whitespaceAndNewlineCharacterSet]] ? : @"";
+
+        NSUInteger length = _pattern.length;
+        NSUInteger starCount = 0;
+        NSUInteger questionMarkCount = 0;
+
+        for (NSUInteger i = 0; i < length; i++)
+        {
+            unichar character = [_pattern characterAtIndex:i];
+            starCount += character == '*';
+            questionMarkCount += character == '?';
+        }
+
+        if (!starCount && !questionMarkCount)
+        {
+            _kind = PDNameMatcherKindExact;
+            _literal = _pattern;
+            _exactName = _pattern;
+        }
+        else if (starCount == length)
+        {
+            _kind = PDNameMatcherKindAny;
+            _matchesAnyName = YES;
+        }
+        else if (starCount == 1 && !questionMarkCount && [_pattern hasSuffix:@"*"])
+        {
+            _kind = PDNameMatcherKindPrefix;
+            _literal = [_pattern substringToIndex:length - 1];
+        }
+        else if (starCount == 1 && !questionMarkCount && [_pattern hasPrefix:@"*"])
+        {
+            _kind = PDNameMatcherKindSuffix;
+            _literal = [_pattern substringFromIndex:1];
+        }
+        else
+        {
+            _kind = PDNameMatcherKindGlob;
+            NSMutableData *characters = [NSMutableData dataWithLength:length * sizeof(unichar)];
+            [_pattern getCharacters:characters.mutableBytes range:NSMakeRange(0, length)];
+            _patternCharacters = characters;
+        }
+    }
+
+    return self;
+}
+
+- (BOOL)matchesName:(NSString *)name
+{
+    switch (_kind)
+    {
+        case PDNameMatcherKindExact:
+            return name == _literal || [name isEqualToString:_literal];
+        case PDNameMatcherKindAny:
+            return name != nil;
+        case PDNameMatcherKindPrefix:
+            return [name hasPrefix:_literal];
+        case PDNameMatcherKindSuffix:
+            return [name hasSuffix:_literal];
+        case PDNameMatcherKindGlob:
+            return [self globMatchesName:name];
+    }
+
+    return NO;
+}
+
+- (BOOL)globMatchesName:(NSString *)name
+{
+    NSUInteger nameLength = name.length;
+    unichar stackBuffer[PDNameMatcherStackBufferLength];
+    NSMutableData *heapBuffer = nil;
+    unichar *characters = stackBuffer;
+
+    if (nameLength > PDNameMatcherStackBufferLength)
+    {
+        heapBuffer = [NSMutableData dataWithLength:nameLength * sizeof(unichar)];
+        characters = heapBuffer.mutableBytes;
+    }
+
+    [name getCharacters:characters range:NSMakeRange(0, nameLength)];
+    return PDNameMatcherMatchGlob(_patternCharacters.bytes, _patternCharacters.length / sizeof(unichar), characters, nameLength);
+}
+
+@end
@@ -0,0 +1,82 @@
+//
+// PDNode+_PrestoData_Internal.h
+//
+// Copyright (c) 2015 Daniel Hall
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+
+#import "PDNode.h"
+
+/** This protocol and these functions are used internally by PrestoData to create nodes whose keys and values are read from somewhere else, such as a binary snapshot, only when the node is first used.  Each node loads on its own, without a lock shared with other nodes: the first thread to need a node's contents loads them, and other threads that need the same node wait for it */
+
+@protocol PDNodeContentSource <NSObject>
+
+/** Fills in the keys and values of a node with PDNodeAppendLoadedObject.  Called once for each node, the first time its contents are read or changed.  Different nodes from the same source may load on several threads at once, so a source must keep the state of each load to itself, and must not read the node it is loading other than through PDNodeLoadedObjectForKey
+* @param node The node to fill in
+* @param location The location the node was created with
+*/
+- (void)pd_loadContentsOfNode:(PDNode *)node fromLocation:(uint64_t)location;
+
+@end
+
+
+/** Creates a node whose keys and values are loaded from a source when they are first needed.  Its inner value, element name and parent are known straight away, without loading
+* @param source The source of the node's contents, which the node retains until they are loaded
+* @param location Passed back to the source to identify the node's contents
+*/
+PDNode *PDNodeCreateWithContentSource(id<PDNodeContentSource> source, uint64_t location, id innerValue, NSString *elementName, NSMutableDictionary *parent);
+
+/** Appends a key and value to a node while its content source is filling it in, without the change tracking of the NSMutableDictionary methods */
+void PDNodeAppendLoadedObject(PDNode *node, NSString *key, id value);
+
+/** Returns the value a content source has already loaded into a node for a key, without trying to load the node */
+id PDNodeLoadedObjectForKey(PDNode *node, NSString *key);
+
+/** Checks whether two nodes are known to have the same contents without comparing them: they are the same node, or copy-on-write copies of the same node, or one is a copy of the other, that haven't needed their contents yet.  Element names aren't part of the contents.  Returns NO when the nodes may still be equal */
+BOOL PDNodeSharesContents(PDNode *node, PDNode *other);
+
+/** Implements pd_freeze for dictionaries and arrays.  PDNodes are loaded and frozen in place; plain dictionaries and element arrays, which can't be, are replaced by frozen nodes and immutable arrays
+* @param object A dictionary or array of elements
+* @return The frozen object: the object itself if it is a PDNode, or else its frozen replacement
+*/
+id PDNodeFreezeObject(id object);
+
+
+/** The JSON a document was parsed from, kept by documents parsed with PDParsingOptionsPreserveSource so that nodes that haven't changed can be written by copying their original bytes */
+@interface PDNodeSourceText : NSObject
+
+- (instancetype)initWithData:(NSData *)data keyForInnerValue:(NSString *)keyForInnerValue;
+
+/** The original JSON, which must never change */
+@property (nonatomic, strong, readonly) NSData *data;
+
+/** The key that inner values were parsed from.  The original bytes can only stand in for a node when it is written with the same key */
+@property (nonatomic, copy, readonly) NSString *keyForInnerValue;
+
+@end
+
+/** Records the bytes of the source text that a node was parsed from.  A node forgets them as soon as it, or anything inside it, changes
+* @param range The range of the node's object in the source text, from its opening brace to its closing brace
+*/
+void PDNodeSetSourceRange(PDNode *node, PDNodeSourceText *source, NSRange range);
+
+/** Returns the source text of a node that hasn't changed since it was parsed, and sets range to the node's bytes in it.  Returns nil if the node has changed since, or wasn't parsed with its source kept.  Never loads the node's contents */
+PDNodeSourceText *PDNodeSourceTextOfNode(PDNode *node, NSRange *range);
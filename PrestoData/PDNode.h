@@ -0,0 +1,39 @@
+//
+// PDNode.h
+//
+// Copyright (c) 2015 Daniel Hall
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+
+#import <Foundation/Foundation.h>
+
+/** The dictionary type that PrestoData creates for every element it parses or copies.  A PDNode stores its inner value, element name, parent reference and ordered keys in instance variables rather than in associated objects, so reading them doesn't go through the runtime's global association table and each node needs fewer allocations.
+*
+* pd_copy on a PDNode makes a copy-on-write copy, which shares the original's storage until the copy is read or either of them is changed, and then copies one node at a time.
+*
+* pd_freeze makes a PDNode and everything inside it permanently read-only, so that one document can be queried, written and copied on many threads at once without any locking.
+
+* PDNode is a complete NSMutableDictionary, and all of the PrestoData category methods work on it unchanged.  Plain NSMutableDictionary instances also continue to work with PrestoData, so creating elements with [PDNode dictionary] is optional but recommended.
+*/
+
+@interface PDNode : NSMutableDictionary
+
+@end
@@ -0,0 +1,953 @@
+//
+// PDNode.m
+//
+// Copyright (c) 2015 Daniel Hall
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+
+#import "PDNode.h"
+#import "PDNode+_PrestoData_Internal.h"
+#import "PDOrderedMap.h"
+#import "NSMutableDictionary+PrestoData.h"
+#import "NSMutableDictionary+_PrestoData_Internal.h"
+#import "NSArray+PrestoData.h"
+#import "NSArray+_PrestoData_Internal.h"
+#import "PDElementIndex.h"
+#import "PDStats+_PrestoData_Internal.h"
+#import <pthread.h>
+
+/** Guards the loading of copy-on-write copies and the lists of copies waiting on each node, so that copies of one document can be made and read on several threads at once.  Recursive, because copying a plain dictionary inside a copy makes copies of any nodes it contains.  Nodes that load from a content source don't take it */
+static pthread_mutex_t PDNodeCopyLock;
+static pthread_once_t PDNodeCopyLockOnce = PTHREAD_ONCE_INIT;
+
+/** Threads that need a node another thread is loading without PDNodeCopyLock wait here.  Only taken when two threads want the same node at once */
+static pthread_mutex_t PDNodeLoadWaitLock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t PDNodeLoadWaitCondition = PTHREAD_COND_INITIALIZER;
+
+/** How far a node has got with loading without PDNodeCopyLock, so that the first thread to need its contents loads them and any others wait */
+typedef NS_ENUM(uint8_t, PDNodeLoadState)
+{
+    PDNodeLoadStateIdle,
+    PDNodeLoadStateRunning,
+    /** Running, and other threads are waiting for the load to finish */
+    PDNodeLoadStateRunningWithWaiters
+};
+
+/** Set when the first copy-on-write copy is made.  Until then no node can have copies waiting on it, so changes don't need to look for them.  Copies of frozen nodes are made on any thread without a lock, so it is always read and set atomically */
+static BOOL PDNodeCopiesExist;
+
+@interface PDNode ()
+
+- (NSUInteger)orderedKeyCount;
+- (id)orderedKeyAtIndex:(NSUInteger)index;
+
+@end
+
+
+/** A read-only view of a node's keys in insertion order, returned from pd_orderedKeys so that callers don't pay for a copy of the keys */
+@interface PDNodeOrderedKeys : NSArray
+
+- (instancetype)initWithNode:(PDNode *)node;
+
+@end
+
+
+/** An element array inside a frozen node.  It keeps its element name and parent in instance variables rather than in associated objects, so that threads reading a frozen document don't take the runtime's association lock */
+@interface PDNodeFrozenElements : NSArray
+
+- (instancetype)initWithElements:(NSArray *)elements name:(NSString *)name parent:(NSMutableDictionary *)parent;
+
+@end
+
+
+@implementation PDNode
+{
+    PDOrderedMap _map;
+    id _innerValue;
+    __unsafe_unretained NSMutableDictionary *_parentDictionary;
+    NSString *_elementName;
+    /** Set while the node is a copy-on-write copy, or a node with a content source, that hasn't needed its contents yet.  Read and cleared atomically, so that readers on other threads see either no contents or all of them */
+    BOOL _needsContents;
+    /** The node whose contents this node will copy when they are first needed */
+    PDNode *_copySource;
+    /** Where this node's contents will be loaded from when they are first needed, if it isn't a copy.  Only the thread running the load reads or clears it */
+    id<PDNodeContentSource> _contentSource;
+    uint64_t _contentLocation;
+    /** Set when the node is created with a content source, and never changed, so that it can be read without a lock */
+    BOOL _loadsFromContentSource;
+    /** Set when the node is created as a copy of a frozen node, and never changed.  A frozen source can't change underneath its copies, so they load without PDNodeCopyLock */
+    BOOL _copiesFrozenSource;
+    PDNodeLoadState _loadState;
+    /** Copies of this node that haven't copied its contents yet, held weakly */
+    NSHashTable *_waitingCopies;
+    PDElementIndex *_elementIndex;
+    /** The JSON this node was parsed from and where in it, until the node or anything inside it changes */
+    PDNodeSourceText *_sourceText;
+    NSRange _sourceRange;
+    /** The node's pd_structuralHash, or 0 until it is needed.  Cleared along with the source text */
+    uint64_t _structuralHash;
+    /** Set by pd_freeze once the node and everything inside it are loaded and will never change again */
+    BOOL _frozen;
+}
+
+
+#pragma mark - Copy on Write
+
+static void PDNodeCreateCopyLock(void)
+{
+    pthread_mutexattr_t attributes;
+    pthread_mutexattr_init(&attributes);
+    pthread_mutexattr_settype(&attributes, PTHREAD_MUTEX_RECURSIVE);
+    pthread_mutex_init(&PDNodeCopyLock, &attributes);
+    pthread_mutexattr_destroy(&attributes);
+}
+
+static void PDNodeCopyContents(PDNode *node, BOOL everything);
+static void PDNodeLoadWithoutCopyLock(PDNode *node);
+static inline void PDNodeLoadContents(PDNode *node);
+
+/** Creates a copy that shares the contents of a node until they are needed.  Must be called with PDNodeCopyLock held, unless the node is frozen */
+static PDNode *PDNodeCreateCopy(PDNode *source, NSString *elementName, NSMutableDictionary *parent)
+{
+    // Until it changes, a copy has the same contents as the node it was made from, so it can be written from the same source text and has the same hash
+    PDNodeSourceText *sourceText = source->_sourceText;
+    NSRange sourceRange = source->_sourceRange;
+    uint64_t structuralHash = __atomic_load_n(&source->_structuralHash, __ATOMIC_RELAXED);
+
+    // A copy of a copy that hasn't loaded yet waits on the same original.  Nodes that load without the lock may be loading on another thread, so they are loaded first instead
+    if (__atomic_load_n(&source->_needsContents, __ATOMIC_ACQUIRE))
+    {
+        if (source->_loadsFromContentSource || source->_copiesFrozenSource)
+        {
+            PDNodeLoadWithoutCopyLock(source);
+        }
+        else
+        {
+            source = source->_copySource;
+        }
+    }
+
+    PDStatsAdd(nodesCopied, 1);
+
+    PDNode *copy = [[PDNode alloc] init];
+    copy->_innerValue = source->_innerValue;
+    copy->_elementName = [elementName copy];
+    copy->_parentDictionary = parent;
+    copy->_copySource = source;
+    copy->_copiesFrozenSource = source->_frozen;
+    copy->_needsContents = YES;
+    copy->_sourceText = sourceText;
+    copy->_sourceRange = sourceRange;
+    copy->_structuralHash = structuralHash;
+
+    // A frozen node never changes, so its copies never need to be given their contents early and it doesn't keep track of them
+    if (!source->_frozen)
+    {
+        if (!source->_waitingCopies)
+        {
+            source->_waitingCopies = [NSHashTable weakObjectsHashTable];
+        }
+        [source->_waitingCopies addObject:copy];
+    }
+
+    return copy;
+}
+
+/** Copies a child value of a copy's source.  Elements become copies that load their own contents when needed, so a copy only ever duplicates the nodes that are used.  Must be called with PDNodeCopyLock held */
+static id PDNodeCopyValue(PDNode *node, NSString *key, id value, NSMutableArray *createdCopies)
+{
+    if ([value isKindOfClass:[PDNode class]])
+    {
+        PDNode *copy = PDNodeCreateCopy(value, key, node);
+        [createdCopies addObject:copy];
+        return copy;
+    }
+
+    if ([value isKindOfClass:[NSMutableDictionary class]])
+    {
+        NSMutableDictionary *copy = [value pd_copy];
+        copy.pd_elementName = key;
+        copy.pd_parentDictionary = node;
+        return copy;
+    }
+
+    if ([value isKindOfClass:[NSArray class]])
+    {
+        NSMutableArray *elements = [NSMutableArray arrayWithCapacity:((NSArray *) value).count];
+        for (id element in value)
+        {
+            [elements addObject:PDNodeCopyValue(node, key, element, createdCopies)];
+        }
+        elements.pd_elementName = key;
+        elements.pd_parentDictionary = node;
+        return elements;
+    }
+
+    return value;
+}
+
+/** Copies the contents of a copy's source into it.  When everything is YES, the copies of its elements that this creates are given their contents straight away too, and so on all the way down.  Must be called with PDNodeCopyLock held, unless the source is frozen and the caller owns the node's load */
+static void PDNodeCopyContents(PDNode *node, BOOL everything)
+{
+    if (!__atomic_load_n(&node->_needsContents, __ATOMIC_ACQUIRE))
+    {
+        return;
+    }
+
+    PDNode *source = node->_copySource;
+    NSMutableArray *createdCopies = [NSMutableArray array];
+
+    PDOrderedMapInitWithMap(&node->_map, &source->_map, ^id(id key, id value) {
+        return PDNodeCopyValue(node, key, value, createdCopies);
+    });
+
+    // Copies created here can't have been seen by anyone else yet, so they are loaded before this node is published as loaded
+    if (everything)
+    {
+        for (PDNode *copy in createdCopies)
+        {
+            PDNodeCopyContents(copy, YES);
+        }
+    }
+
+    node->_copySource = nil;
+    __atomic_store_n(&node->_needsContents, NO, __ATOMIC_RELEASE);
+}
+
+/** Loads the contents of a node that has a content source, or that copies a frozen node.  Each node loads on its own, so nodes in different documents, or in different parts of one document, load at the same time, and copies of a cached document load on any number of threads without waiting for each other.  Neither kind of node has copies waiting on it that would need PDNodeCopyLock: elements loaded from a content source aren't copies of anything, and copies of an unloaded node of either kind load it first */
+static void PDNodeLoadWithoutCopyLock(PDNode *node)
+{
+    while (__atomic_load_n(&node->_needsContents, __ATOMIC_ACQUIRE))
+    {
+        PDNodeLoadState state = PDNodeLoadStateIdle;
+
+        if (__atomic_compare_exchange_n(&node->_loadState, &state, PDNodeLoadStateRunning, NO, __ATOMIC_ACQUIRE, __ATOMIC_ACQUIRE))
+        {
+            // Checked again now that this thread owns the load, since another thread may have finished it in between.  PDNodeCopyContents checks for itself
+            if (!node->_loadsFromContentSource)
+            {
+                PDNodeCopyContents(node, NO);
+            }
+            else if (__atomic_load_n(&node->_needsContents, __ATOMIC_ACQUIRE))
+            {
+                [node->_contentSource pd_loadContentsOfNode:node fromLocation:node->_contentLocation];
+                node->_contentSource = nil;
+                __atomic_store_n(&node->_needsContents, NO, __ATOMIC_RELEASE);
+            }
+
+            if (__atomic_exchange_n(&node->_loadState, PDNodeLoadStateIdle, __ATOMIC_ACQ_REL) == PDNodeLoadStateRunningWithWaiters)
+            {
+                pthread_mutex_lock(&PDNodeLoadWaitLock);
+                pthread_cond_broadcast(&PDNodeLoadWaitCondition);
+                pthread_mutex_unlock(&PDNodeLoadWaitLock);
+            }
+            return;
+        }
+
+        // Another thread is loading the node.  Waiting threads mark the load under the wait lock, so the loading thread knows to wake them and can't do so before they wait
+        pthread_mutex_lock(&PDNodeLoadWaitLock);
+        while (YES)
+        {
+            state = PDNodeLoadStateRunning;
+            if (!__atomic_compare_exchange_n(&node->_loadState, &state, PDNodeLoadStateRunningWithWaiters, NO, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE) && state != PDNodeLoadStateRunningWithWaiters)
+            {
+                break;
+            }
+            pthread_cond_wait(&PDNodeLoadWaitCondition, &PDNodeLoadWaitLock);
+        }
+        pthread_mutex_unlock(&PDNodeLoadWaitLock);
+    }
+}
+
+PDNode *PDNodeCreateWithContentSource(id<PDNodeContentSource> source, uint64_t location, id innerValue, NSString *elementName, NSMutableDictionary *parent)
+{
+    PDNode *node = [[PDNode alloc] init];
+    node->_innerValue = [innerValue copy];
+    node->_elementName = [elementName copy];
+    node->_parentDictionary = parent;
+    node->_contentSource = source;
+    node->_contentLocation = location;
+    node->_loadsFromContentSource = YES;
+    node->_needsContents = YES;
+
+    return node;
+}
+
+void PDNodeAppendLoadedObject(PDNode *node, NSString *key, id value)
+{
+    PDOrderedMapSet(&node->_map, key, value);
+}
+
+id PDNodeLoadedObjectForKey(PDNode *node, NSString *key)
+{
+    return PDOrderedMapGet(&node->_map, key);
+}
+
+void PDNodeSetSourceRange(PDNode *node, PDNodeSourceText *source, NSRange range)
+{
+    node->_sourceText = source;
+    node->_sourceRange = range;
+}
+
+PDNodeSourceText *PDNodeSourceTextOfNode(PDNode *node, NSRange *range)
+{
+    if (range)
+    {
+        *range = node->_sourceRange;
+    }
+    return node->_sourceText;
+}
+
+BOOL PDNodeSharesContents(PDNode *node, PDNode *other)
+{
+    if (node == other)
+    {
+        return YES;
+    }
+
+    // Frozen nodes have all of their own contents, so no lock is needed to see that they aren't shared
+    if (!__atomic_load_n(&PDNodeCopiesExist, __ATOMIC_ACQUIRE) || (node->_frozen && other->_frozen))
+    {
+        return NO;
+    }
+
+    // Copies of frozen nodes may be loading on another thread without the lock, which clears their source, so they are loaded first
+    if (node->_copiesFrozenSource)
+    {
+        PDNodeLoadContents(node);
+    }
+    if (other->_copiesFrozenSource)
+    {
+        PDNodeLoadContents(other);
+    }
+
+    // A copy that hasn't loaded has exactly the contents of its source, because the source gives its waiting copies their contents before it changes
+    pthread_mutex_lock(&PDNodeCopyLock);
+    PDNode *nodeContents = __atomic_load_n(&node->_needsContents, __ATOMIC_ACQUIRE) && node->_copySource ? node->_copySource : node;
+    PDNode *otherContents = __atomic_load_n(&other->_needsContents, __ATOMIC_ACQUIRE) && other->_copySource ? other->_copySource : other;
+    pthread_mutex_unlock(&PDNodeCopyLock);
+
+    return nodeContents == otherContents;
+}
+
+static inline BOOL PDNodeRemembersContents(PDNode *node)
+{
+    return node->_sourceText || node->_structuralHash;
+}
+
+/** Forgets the source text and structural hash of a node that is about to change, and of its ancestors, which cover its contents too.  A node only has them while its descendants do, so an ancestor that has neither has already forgotten them for an earlier change, and so have its own ancestors */
+static void PDNodeForgetContents(PDNode *node)
+{
+    node->_sourceText = nil;
+    node->_structuralHash = 0;
+
+    for (NSMutableDictionary *ancestor = node->_parentDictionary; ancestor; ancestor = ancestor.pd_parentDictionary)
+    {
+        // Plain dictionaries in between don't remember anything themselves
+        if (![ancestor isKindOfClass:[PDNode class]])
+        {
+            continue;
+        }
+
+        PDNode *ancestorNode = (PDNode *) ancestor;
+        if (!PDNodeRemembersContents(ancestorNode))
+        {
+            break;
+        }
+        ancestorNode->_sourceText = nil;
+        ancestorNode->_structuralHash = 0;
+    }
+}
+
+/** Makes sure a node has its contents before they are read or changed */
+static inline void PDNodeLoadContents(PDNode *node)
+{
+    if (!__atomic_load_n(&node->_needsContents, __ATOMIC_ACQUIRE))
+    {
+        return;
+    }
+
+    if (node->_loadsFromContentSource || node->_copiesFrozenSource)
+    {
+        PDNodeLoadWithoutCopyLock(node);
+    }
+    else
+    {
+        pthread_mutex_lock(&PDNodeCopyLock);
+        PDNodeCopyContents(node, NO);
+        pthread_mutex_unlock(&PDNodeCopyLock);
+    }
+}
+
+/** Gives every copy still waiting on a node all of its contents, before the node is changed underneath them */
+static void PDNodeFinishWaitingCopies(PDNode *node)
+{
+    if (!node->_waitingCopies)
+    {
+        return;
+    }
+
+    pthread_mutex_lock(&PDNodeCopyLock);
+    for (PDNode *copy in node->_waitingCopies.allObjects)
+    {
+        PDNodeCopyContents(copy, YES);
+    }
+    node->_waitingCopies = nil;
+    pthread_mutex_unlock(&PDNodeCopyLock);
+}
+
+static void PDNodeRaiseIfFrozen(PDNode *node, SEL selector)
+{
+    if (node->_frozen)
+    {
+        [NSException raise:NSInternalInconsistencyException format:@"*** -[PDNode %@]: the dictionary is frozen and can't be changed.  Change a pd_copy of it instead", NSStringFromSelector(selector)];
+    }
+}
+
+/** Called before a node's keys, values or inner value change */
+static inline void PDNodeWillChange(PDNode *node, SEL selector)
+{
+    PDNodeRaiseIfFrozen(node, selector);
+    PDNodeLoadContents(node);
+
+    if (__atomic_load_n(&PDNodeCopiesExist, __ATOMIC_ACQUIRE))
+    {
+        [node pd_willChange];
+    }
+    else if (PDNodeRemembersContents(node))
+    {
+        PDNodeForgetContents(node);
+    }
+}
+
+
+#pragma mark - NSMutableDictionary Primitives
+
+- (instancetype)init
+{
+    return [self initWithCapacity:0];
+}
+
+- (instancetype)initWithCapacity:(NSUInteger)capacity
+{
+    // NSDictionary's own initializers are abstract, and some route back through initWithObjects:forKeys:count:, so a node sets itself up without calling them.  The map's storage is allocated lazily on the first insert
+    PDStatsAdd(nodesCreated, 1);
+    return self;
+}
+
+- (instancetype)initWithObjects:(const id [])objects forKeys:(const id<NSCopying> [])keys count:(NSUInteger)count
+{
+    self = [self initWithCapacity:count];
+
+    if (self) {
+        for (NSUInteger i = 0; i < count; i++)
+        {
+            PDOrderedMapSet(&_map, keys[i], objects[i]);
+        }
+    }
+
+    return self;
+}
+
+- (void)dealloc
+{
+    PDOrderedMapDestroy(&_map);
+}
+
+- (NSUInteger)count
+{
+    PDNodeLoadContents(self);
+    return _map.count;
+}
+
+- (id)objectForKey:(id)key
+{
+    PDNodeLoadContents(self);
+    return PDOrderedMapGet(&_map, key);
+}
+
+- (NSEnumerator *)keyEnumerator
+{
+    PDNodeLoadContents(self);
+    return [PDOrderedMapCopyKeys(&_map) objectEnumerator];
+}
+
+- (NSUInteger)countByEnumeratingWithState:(NSFastEnumerationState *)state objects:(id __unsafe_unretained [])buffer count:(NSUInteger)length
+{
+    PDNodeLoadContents(self);
+    return PDOrderedMapEnumerateKeys(&_map, state, buffer, length);
+}
+
+- (void)setObject:(id)object forKey:(id<NSCopying>)key
+{
+    if (!object)
+    {
+        [NSException raise:NSInvalidArgumentException format:@"*** -[PDNode setObject:forKey:]: object cannot be nil (key: %@)", key];
+    }
+    if (!key)
+    {
+        [NSException raise:NSInvalidArgumentException format:@"*** -[PDNode setObject:forKey:]: key cannot be nil"];
+    }
+
+    PDNodeWillChange(self, _cmd);
+    PDOrderedMapSet(&_map, key, object);
+}
+
+- (void)removeObjectForKey:(id)key
+{
+    PDNodeWillChange(self, _cmd);
+    PDOrderedMapRemove(&_map, key);
+}
+
+
+#pragma mark - Ordered Keys
+
+// A node's map keeps its keys in insertion order itself, so there's no separate key array to maintain
+
+- (void)pd_setObject:(id)object forOrderedKey:(NSString *)key
+{
+    // Checked before the element indexes are updated, so that a failed change leaves them alone too
+    PDNodeRaiseIfFrozen(self, _cmd);
+
+    id oldValue = [self objectForKey:key];
+    if (oldValue)
+    {
+        PDElementIndexesRemoveValue(self, key, oldValue);
+    }
+
+    [self setObject:object forKey:key];
+    PDElementIndexesAddValue(self, key, object);
+}
+
+- (void)pd_removeObjectForOrderedKey:(NSString *)key
+{
+    PDNodeRaiseIfFrozen(self, _cmd);
+
+    id oldValue = [self objectForKey:key];
+    if (oldValue)
+    {
+        PDElementIndexesRemoveValue(self, key, oldValue);
+    }
+
+    [self removeObjectForKey:key];
+}
+
+- (NSUInteger)pd_orderOfOrderedKey:(NSString *)key
+{
+    PDNodeLoadContents(self);
+    return PDOrderedMapOrderOfKey(&_map, key);
+}
+
+- (NSArray *)pd_orderedKeys
+{
+    return [[PDNodeOrderedKeys alloc] initWithNode:self];
+}
+
+- (NSUInteger)orderedKeyCount
+{
+    PDNodeLoadContents(self);
+    return _map.count;
+}
+
+- (id)orderedKeyAtIndex:(NSUInteger)index
+{
+    PDNodeLoadContents(self);
+
+    if (index >= _map.count)
+    {
+        [NSException raise:NSRangeException format:@"*** -[PDNodeOrderedKeys objectAtIndex:]: index %lu beyond bounds [0 .. %ld]", (unsigned long)index, (long)_map.count - 1];
+    }
+
+    return PDOrderedMapKeyAtIndex(&_map, index);
+}
+
+
+#pragma mark - Copying
+
+- (void)pd_willChange
+{
+    // Element arrays are changed in place, after this is called on the dictionary that holds them
+    PDNodeRaiseIfFrozen(self, _cmd);
+
+    // Copies waiting on an ancestor will eventually copy this node's contents too, so they have to be given everything before it changes
+    for (NSMutableDictionary *node = self; node; node = node.pd_parentDictionary)
+    {
+        if ([node isKindOfClass:[PDNode class]])
+        {
+            PDNodeFinishWaitingCopies((PDNode *) node);
+        }
+    }
+
+    // Forgotten only once the copies have their contents, which still match the source text and hashes they are given
+    if (PDNodeRemembersContents(self))
+    {
+        PDNodeForgetContents(self);
+    }
+}
+
+- (uint64_t)pd_structuralHash
+{
+    // Threads reading the same node may compute the hash at the same time, which is harmless since they store the same value
+    uint64_t hash = __atomic_load_n(&_structuralHash, __ATOMIC_RELAXED);
+    if (!hash)
+    {
+        hash = [super pd_structuralHash];
+        __atomic_store_n(&_structuralHash, hash, __ATOMIC_RELAXED);
+    }
+    return hash;
+}
+
+- (instancetype)pd_copy
+{
+    PDStatsToken token = PDStatsBeginOperation(PDStatsOperationCopy, nil);
+    pthread_once(&PDNodeCopyLockOnce, PDNodeCreateCopyLock);
+    PDNode *copy;
+
+    // Nothing about a frozen node can change while the copy is made, so threads copying it never wait for each other
+    if (_frozen)
+    {
+        if (!__atomic_load_n(&PDNodeCopiesExist, __ATOMIC_ACQUIRE))
+        {
+            __atomic_store_n(&PDNodeCopiesExist, YES, __ATOMIC_RELEASE);
+        }
+        copy = PDNodeCreateCopy(self, nil, nil);
+    }
+    else
+    {
+        pthread_mutex_lock(&PDNodeCopyLock);
+        __atomic_store_n(&PDNodeCopiesExist, YES, __ATOMIC_RELEASE);
+        copy = PDNodeCreateCopy(self, nil, nil);
+        pthread_mutex_unlock(&PDNodeCopyLock);
+    }
+
+    PDStatsEndOperation(token, nil, 0);
+
+    return copy;
+}
+
+
+#pragma mark - Freezing
+
+- (BOOL)pd_isFrozen
+{
+    return _frozen;
+}
+
+static id PDNodeFreezeValue(id value, NSString *name, NSMutableDictionary *parent, BOOL *converted);
+
+/** Copies the nodes in a child value of a plain dictionary that is being replaced, so that freezing the replacement leaves the plain dictionary and its nodes as they were.  Copies share contents with the originals until they load, so this copies nothing that freezing wouldn't visit anyway */
+static id PDNodeCopyNodesInValue(id value)
+{
+    if ([value isKindOfClass:[PDNode class]])
+    {
+        return [value pd_copy];
+    }
+
+    if ([value isKindOfClass:[NSArray class]])
+    {
+        NSMutableArray *elements = [NSMutableArray arrayWithCapacity:((NSArray *) value).count];
+        for (id element in value)
+        {
+            [elements addObject:PDNodeCopyNodesInValue(element)];
+        }
+        return elements;
+    }
+
+    return value;
+}
+
+/** Loads a node and everything inside it, replaces anything inside it that could still change or load lazily, and marks it all frozen.  Sets converted if a plain dictionary had to be replaced, which leaves element indexes listing the old dictionary */
+static void PDNodeFreeze(PDNode *node, BOOL *converted)
+{
+    if (node->_frozen)
+    {
+        return;
+    }
+
+    PDNodeLoadContents(node);
+
+    BOOL convertedInside = NO;
+    PDOrderedMapShrink(&node->_map);
+
+    // Replacing the value of an existing key keeps its position, so the keys can be visited by position while they are replaced
+    for (NSUInteger i = 0; i < node->_map.count; i++)
+    {
+        id key = PDOrderedMapKeyAtIndex(&node->_map, i);
+        PDOrderedMapSet(&node->_map, key, PDNodeFreezeValue(PDOrderedMapGet(&node->_map, key), key, node, &convertedInside));
+    }
+
+    if (convertedInside && node->_elementIndex)
+    {
+        node->_elementIndex = [[PDElementIndex alloc] initWithRoot:node];
+    }
+
+    // Copies made before the node was frozen can't be affected by anything it does from now on
+    if (node->_waitingCopies)
+    {
+        pthread_mutex_lock(&PDNodeCopyLock);
+        node->_waitingCopies = nil;
+        pthread_mutex_unlock(&PDNodeCopyLock);
+    }
+
+    // Computed now so that reading it later never stores anything.  The children are frozen already, so this only combines their hashes
+    [node pd_structuralHash];
+    node->_frozen = YES;
+
+    if (convertedInside && converted)
+    {
+        *converted = YES;
+    }
+}
+
+static id PDNodeFreezeValue(id value, NSString *name, NSMutableDictionary *parent, BOOL *converted)
+{
+    if ([value isKindOfClass:[PDNode class]])
+    {
+        PDNode *node = value;
+
+        // A copy made for the replacement of a plain dictionary is given its place in the replacement
+        if (!node->_frozen)
+        {
+            node->_parentDictionary = parent;
+            node->_elementName = [name copy];
+        }
+        PDNodeFreeze(node, converted);
+        return node;
+    }
+
+    // Plain dictionaries keep their ordered keys and other PrestoData properties in associated objects, some of which are created when first read, so they are replaced by nodes
+    if ([value isKindOfClass:[NSMutableDictionary class]])
+    {
+        NSMutableDictionary *dictionary = value;
+        PDNode *node = [[PDNode alloc] initWithCapacity:dictionary.count];
+
+        for (NSString *key in dictionary.pd_orderedKeys)
+        {
+            PDOrderedMapSet(&node->_map, key, PDNodeCopyNodesInValue(dictionary[key]));
+        }
+        node->_innerValue = [dictionary.pd_innerValue copy];
+        node->_elementName = [name copy];
+        node->_parentDictionary = parent;
+
+        PDNodeFreeze(node, NULL);
+        if (dictionary.pd_elementIndex)
+        {
+            node->_elementIndex = [[PDElementIndex alloc] initWithRoot:node];
+        }
+
+        if (converted)
+        {
+            *converted = YES;
+        }
+        return node;
+    }
+
+    // Element arrays become immutable arrays holding exactly as many elements as they need
+    if ([value isKindOfClass:[NSArray class]])
+    {
+        NSMutableArray *elements = [NSMutableArray arrayWithCapacity:((NSArray *) value).count];
+        for (id element in value)
+        {
+            [elements addObject:PDNodeFreezeValue(element, name, parent, converted)];
+        }
+
+        return [[PDNodeFrozenElements alloc] initWithElements:elements name:name parent:parent];
+    }
+
+    if ([value isKindOfClass:[NSString class]])
+    {
+        return [value copy];
+    }
+
+    return value;
+}
+
+id PDNodeFreezeObject(id object)
+{
+    pthread_once(&PDNodeCopyLockOnce, PDNodeCreateCopyLock);
+
+    // A plain dictionary is replaced rather than frozen, and its replacement isn't in the parent dictionary, so it is made a root
+    if ([object isKindOfClass:[NSMutableDictionary class]])
+    {
+        NSMutableDictionary *parent = [object isKindOfClass:[PDNode class]] ? ((NSMutableDictionary *) object).pd_parentDictionary : nil;
+        return PDNodeFreezeValue(object, ((NSMutableDictionary *) object).pd_elementName, parent, NULL);
+    }
+
+    if ([object isKindOfClass:[NSArray class]])
+    {
+        return PDNodeFreezeValue(object, ((NSArray *) object).pd_elementName, ((NSArray *) object).pd_parentDictionary, NULL);
+    }
+
+    return object;
+}
+
+
+#pragma mark - PrestoData Properties
+
+- (id)pd_innerValue
+{
+    return _innerValue;
+}
+
+- (void)setPd_innerValue:(id)value
+{
+    PDNodeWillChange(self, _cmd);
+    _innerValue = [value copy];
+}
+
+- (NSMutableDictionary *)pd_parentDictionary
+{
+    return _parentDictionary;
+}
+
+- (void)setPd_parentDictionary:(NSMutableDictionary *)value
+{
+    PDNodeRaiseIfFrozen(self, _cmd);
+    _parentDictionary = value;
+}
+
+- (NSString *)pd_elementName
+{
+    return _elementName;
+}
+
+- (void)setPd_elementName:(NSString *)value
+{
+    PDNodeRaiseIfFrozen(self, _cmd);
+    _elementName = [value copy];
+}
+
+- (PDElementIndex *)pd_elementIndex
+{
+    return _elementIndex;
+}
+
+- (void)setPd_elementIndex:(PDElementIndex *)elementIndex
+{
+    PDNodeRaiseIfFrozen(self, _cmd);
+    _elementIndex = elementIndex;
+}
+
+@end
+
+
+@implementation PDNodeOrderedKeys
+{
+    PDNode *_node;
+}
+
+- (instancetype)initWithNode:(PDNode *)node
+{
+    // Like PDNode itself, this skips NSArray's abstract initializers
+    _node = node;
+    return self;
+}
+
+- (NSUInteger)count
+{
+    return [_node orderedKeyCount];
+}
+
+- (id)objectAtIndex:(NSUInteger)index
+{
+    return [_node orderedKeyAtIndex:index];
+}
+
+- (NSUInteger)countByEnumeratingWithState:(NSFastEnumerationState *)state objects:(id __unsafe_unretained [])buffer count:(NSUInteger)length
+{
+    return [_node countByEnumeratingWithState:state objects:buffer count:length];
+}
+
+@end
+
+
+@implementation PDNodeFrozenElements
+{
+    NSArray *_elements;
+    NSString *_elementName;
+    __unsafe_unretained NSMutableDictionary *_parentDictionary;
+}
+
+- (instancetype)initWithElements:(NSArray *)elements name:(NSString *)name parent:(NSMutableDictionary *)parent
+{
+    // Like PDNode itself, this skips NSArray's abstract initializers
+    _elements = [elements copy];
+    _elementName = [name copy];
+    _parentDictionary = parent;
+    return self;
+}
+
+- (NSUInteger)count
+{
+    return _elements.count;
+}
+
+- (id)objectAtIndex:(NSUInteger)index
+{
+    return [_elements objectAtIndex:index];
+}
+
+- (NSUInteger)countByEnumeratingWithState:(NSFastEnumerationState *)state objects:(id __unsafe_unretained [])buffer count:(NSUInteger)length
+{
+    return [_elements countByEnumeratingWithState:state objects:buffer count:length];
+}
+
+- (id)copyWithZone:(NSZone *)zone
+{
+    return self;
+}
+
+- (NSString *)pd_elementName
+{
+    return _elementName;
+}
+
+- (void)setPd_elementName:(NSString *)value
+{
+    _elementName = [value copy];
+}
+
+- (NSMutableDictionary *)pd_parentDictionary
+{
+    return _parentDictionary;
+}
+
+- (void)setPd_parentDictionary:(NSMutableDictionary *)value
+{
+    _parentDictionary = value;
+}
+
+@end
+
+
+@implementation PDNodeSourceText
+
+- (instancetype)initWithData:(NSData *)data keyForInnerValue:(NSString *)keyForInnerValue
+{
+    self = [super init];
+    if (self) {
+        _data = data;
+        _keyForInnerValue = [keyForInnerValue copy];
+    }
+    return self;
+}
+
+@end
@@ -0,0 +1,83 @@
+//
+// PDOptions.h
+//
+// Copyright (c) 2015 Daniel Hall
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+
+#import <Foundation/Foundation.h>
+
+/** The error domain for errors reported by PrestoData */
+extern NSString *const PrestoDataErrorDomain;
+
+/** The error codes used in PrestoDataErrorDomain */
+typedef NS_ENUM(NSInteger, PrestoDataErrorCode)
+{
+    /** Output could not be written to the destination stream or file descriptor.  The underlying stream or POSIX error, if any, is available under NSUnderlyingErrorKey */
+    PrestoDataErrorWriteFailed = 1,
+
+    /** Input could not be read, or was not a well-formed document.  The underlying file error, if any, is available under NSUnderlyingErrorKey */
+    PrestoDataErrorReadFailed = 2
+};
+
+/** Options that control how PrestoData dictionaries and arrays are serialized to JSON and XML */
+typedef NS_OPTIONS(NSUInteger, PDWritingOptions)
+{
+    /** Pretty-printed output, with one value per line and tab indentation */
+    PDWritingOptionsNone = 0,
+
+    /** Compact output, without any line breaks or indentation */
+    PDWritingOptionsCompact = 1 << 0,
+
+    /** Begins XML output with an XML declaration.  Ignored when writing JSON */
+    PDWritingOptionsXMLDeclaration = 1 << 1
+};
+
+/** Options that control how PrestoData dictionaries are built from JSON and XML */
+typedef NS_OPTIONS(NSUInteger, PDParsingOptions)
+{
+    /** The dictionary is returned as parsed */
+    PDParsingOptionsNone = 0,
+
+    /** Builds an element index for the dictionary as part of parsing, as if pd_buildElementIndex were called on it.  Use this when the dictionary will be queried with // steps more than once.  Ignored when parsing arrays */
+    PDParsingOptionsIndexElements = 1 << 0,
+
+    /** Parses a large top-level JSON array in chunks on all available cores.  The resulting array and its dictionaries are the same as a serial parse produces.  Ignored when parsing dictionaries and XML */
+    PDParsingOptionsConcurrent = 1 << 1,
+
+    /** Parses JSON lazily.  Parsing only checks the JSON and records where each object and array begins and ends, keeping the data.  Each dictionary is filled in from the data the first time it is used, by the PrestoData methods, subscripting or an XPath step, so time and memory follow the parts of the document that are used rather than its size.  Takes precedence over PDParsingOptionsConcurrent, and is ignored when parsing XML or building an element index, which uses every element.
+    *
+    * Strings are only decoded when the dictionary containing them is filled in, so a string with an invalid escape or encoding is dropped then, along with anything after it in the same object or array, where a full parse would have failed */
+    PDParsingOptionsLazy = 1 << 2,
+
+    /** Keeps the JSON data with the parsed dictionaries, each of which remembers the bytes it was parsed from.  Changing a dictionary, or anything inside it, makes it and the dictionaries containing it forget theirs.  When written as compact JSON, a dictionary that still remembers its bytes is copied from them instead of being written member by member, so saving a large document after a small edit only rewrites the path to the edit.  Only dictionaries whose bytes are already exactly what the writer would write are remembered: no whitespace, escapes, nulls or other members the parser drops, and numbers in their shortest form.  The bytes are also only used when writing with the inner value key the dictionary was parsed with.  Ignored when parsing XML or streams */
+    PDParsingOptionsPreserveSource = 1 << 3
+};
+
+/** Options that control how XPath queries are evaluated */
+typedef NS_OPTIONS(NSUInteger, PDXPathOptions)
+{
+    /** The query is evaluated on the calling thread */
+    PDXPathOptionsNone = 0,
+
+    /** Large sets of context nodes and large sets of nodes being filtered by a predicate are split into chunks that are evaluated on all available cores.  The results are the same, in the same order, as serial evaluation.  Sets of a few thousand nodes or fewer are still evaluated serially.  The dictionaries being queried must not be changed on any thread until the query returns */
+    PDXPathOptionsConcurrent = 1 << 0
+};
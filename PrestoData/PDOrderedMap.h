@@ -0,0 +1,87 @@
+//
+// PDOrderedMap.h
+//
+// Copyright (c) 2015 Daniel Hall
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+
+#import <Foundation/Foundation.h>
+
+/** An insertion-ordered hash map, used internally by PrestoData as the storage of a PDNode.  Insert, lookup and removal are O(1), and keys are iterated in the order they were first inserted.
+*
+* Entries are appended to parallel key and value arrays.  Removing an entry leaves a hole that iteration skips, and holes are squeezed out once they make up half of the entries, so removal never shifts the remaining entries one at a time.  While there are holes, a tree of live entry counts finds keys by index without scanning.  Small maps are searched directly; an open-addressed index of entry positions is built once a map holds more than a few keys.
+*
+* The struct is embedded directly in its owner, and must be zero-initialized before use and destroyed with PDOrderedMapDestroy.
+*/
+typedef struct
+{
+    /** Keys in insertion order.  A nil key marks a removed entry */
+    __strong id *keys;
+    __strong id *values;
+    /** The number of used entries, including removed ones */
+    NSUInteger entryCount;
+    NSUInteger entryCapacity;
+    /** The number of live entries */
+    NSUInteger count;
+    /** The hash index.  Each slot holds 0 when empty, UINT32_MAX when its entry was removed, or else an entry position + 1 */
+    uint32_t *slots;
+    NSUInteger slotCapacity;
+    NSUInteger slotLoad;
+    unsigned int slotShift;
+    /** Incremented whenever keys are added, removed or moved, so fast enumeration can detect mutation */
+    unsigned long mutations;
+    /** A Fenwick tree counting live entries by position, over the whole entry capacity.  It only exists while removed entries leave holes, and lets a key be found by its index without scanning or moving entries */
+    uint32_t *liveCounts;
+} PDOrderedMap;
+
+/** Releases all keys and values and frees the map's storage */
+void PDOrderedMapDestroy(PDOrderedMap *map);
+
+/** Fills an empty map with the entries of another map, in the same order, passing each value through a block.  Keys are shared rather than copied again, and storage and the index are allocated once at the right size rather than grown entry by entry */
+void PDOrderedMapInitWithMap(PDOrderedMap *map, const PDOrderedMap *source, id (^transform)(id key, id value));
+
+/** Squeezes out removed entries and releases unused capacity, leaving the entries in one block of exactly the right size.  For maps that won't change again */
+void PDOrderedMapShrink(PDOrderedMap *map);
+
+/** Returns the value for a key, or nil */
+id PDOrderedMapGet(const PDOrderedMap *map, id key);
+
+/** Sets the value for a key.  New keys are copied and appended to the end of the order; existing keys keep their position */
+void PDOrderedMapSet(PDOrderedMap *map, id key, id value);
+
+/** Removes a key and its value
+* @return YES if the key was present
+*/
+BOOL PDOrderedMapRemove(PDOrderedMap *map, id key);
+
+/** Returns a number that orders a key among the map's keys: a key inserted earlier has a smaller number.  The numbers are not consecutive once keys have been removed
+* @return The number, or NSNotFound if the key isn't in the map
+*/
+NSUInteger PDOrderedMapOrderOfKey(const PDOrderedMap *map, id key);
+
+/** Returns the key at a position in insertion order.  O(1), or O(log n) while removed entries leave holes.  Never changes the map, so it is as safe to call from several threads as PDOrderedMapGet */
+id PDOrderedMapKeyAtIndex(const PDOrderedMap *map, NSUInteger index);
+
+/** Returns a new array of the keys in insertion order */
+NSArray *PDOrderedMapCopyKeys(const PDOrderedMap *map);
+
+/** Implements NSFastEnumeration over the keys of the map, in insertion order */
+NSUInteger PDOrderedMapEnumerateKeys(PDOrderedMap *map, NSFastEnumerationState *state, id __unsafe_unretained buffer[], NSUInteger length);
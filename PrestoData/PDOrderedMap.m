@@ -0,0 +1,498 @@
+//
+// PDOrderedMap.m
+//
+// Copyright (c) 2015 Daniel Hall
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+
+#import "PDOrderedMap.h"
+#include <stdlib.h>
+#include <string.h>
+
+/** Maps with more keys than this get a hash index; smaller maps are faster to search directly */
+static const NSUInteger PDOrderedMapIndexThreshold = 8;
+
+static const NSUInteger PDOrderedMapMinimumEntryCapacity = 4;
+static const NSUInteger PDOrderedMapMinimumSlotCapacity = 16;
+
+static const uint32_t PDOrderedMapSlotEmpty = 0;
+static const uint32_t PDOrderedMapSlotRemoved = UINT32_MAX;
+
+
+static inline NSUInteger PDOrderedMapSlotForHash(const PDOrderedMap *map, NSUInteger hash)
+{
+    // Fibonacci hashing spreads weak hashes, such as those of short strings, across the whole index
+    return (NSUInteger)(((uint64_t)hash * 0x9E3779B97F4A7C15ULL) >> map->slotShift);
+}
+
+/** Finds the entry position of a key, or NSNotFound.  When the map has an index, slotIndex (if not NULL) receives the slot that refers to the entry */
+static NSUInteger PDOrderedMapFind(const PDOrderedMap *map, id key, NSUInteger *slotIndex)
+{
+    if (!key)
+    {
+        return NSNotFound;
+    }
+
+    if (!map->slots)
+    {
+        // Keys are very often the same string instances, so a pointer comparison pass finds most of them without sending any messages
+        for (NSUInteger i = 0; i < map->entryCount; i++)
+        {
+            if (map->keys[i] == key)
+            {
+                return i;
+            }
+        }
+
+        for (NSUInteger i = 0; i < map->entryCount; i++)
+        {
+            id candidate = map->keys[i];
+            if (candidate && [candidate isEqual:key])
+            {
+                return i;
+            }
+        }
+
+        return NSNotFound;
+    }
+
+    NSUInteger mask = map->slotCapacity - 1;
+
+    for (NSUInteger slot = PDOrderedMapSlotForHash(map, [key hash]);; slot = (slot + 1) & mask)
+    {
+        uint32_t entry = map->slots[slot];
+
+        if (entry == PDOrderedMapSlotEmpty)
+        {
+            return NSNotFound;
+        }
+
+        if (entry != PDOrderedMapSlotRemoved)
+        {
+            id candidate = map->keys[entry - 1];
+            if (candidate == key || [candidate isEqual:key])
+            {
+                if (slotIndex)
+                {
+                    *slotIndex = slot;
+                }
+                return entry - 1;
+            }
+        }
+    }
+}
+
+static void PDOrderedMapInsertSlot(PDOrderedMap *map, NSUInteger hash, NSUInteger entry)
+{
+    NSUInteger mask = map->slotCapacity - 1;
+
+    for (NSUInteger slot = PDOrderedMapSlotForHash(map, hash);; slot = (slot + 1) & mask)
+    {
+        uint32_t existing = map->slots[slot];
+
+        if (existing == PDOrderedMapSlotEmpty || existing == PDOrderedMapSlotRemoved)
+        {
+            if (existing == PDOrderedMapSlotEmpty)
+            {
+                map->slotLoad++;
+            }
+            map->slots[slot] = (uint32_t)(entry + 1);
+            return;
+        }
+    }
+}
+
+/** Rebuilds the hash index from the live entries, sized so it is at most half full */
+static void PDOrderedMapRebuildIndex(PDOrderedMap *map)
+{
+    free(map->slots);
+
+    NSUInteger capacity = PDOrderedMapMinimumSlotCapacity;
+    unsigned int bits = 4;
+    while (capacity < map->count * 2)
+    {
+        capacity <<= 1;
+        bits++;
+    }
+
+    map->slots = calloc(capacity, sizeof(uint32_t));
+    map->slotCapacity = capacity;
+    map->slotShift = 64 - bits;
+    map->slotLoad = 0;
+
+    for (NSUInteger i = 0; i < map->entryCount; i++)
+    {
+        if (map->keys[i])
+        {
+            PDOrderedMapInsertSlot(map, [map->keys[i] hash], i);
+        }
+    }
+}
+
+/** Adds delta to the live count of one entry position */
+static void PDOrderedMapUpdateLiveCounts(PDOrderedMap *map, NSUInteger entry, int delta)
+{
+    for (NSUInteger i = entry + 1; i <= map->entryCapacity; i += i & -i)
+    {
+        map->liveCounts[i] = (uint32_t)((int)map->liveCounts[i] + delta);
+    }
+}
+
+/** Builds the live counts from the entries, once removals have left holes */
+static void PDOrderedMapBuildLiveCounts(PDOrderedMap *map)
+{
+    // The tree is 1-based, so slot 0 is unused
+    map->liveCounts = calloc(map->entryCapacity + 1, sizeof(uint32_t));
+
+    for (NSUInteger i = 1; i <= map->entryCapacity; i++)
+    {
+        if (i <= map->entryCount && map->keys[i - 1])
+        {
+            map->liveCounts[i]++;
+        }
+
+        NSUInteger parent = i + (i & -i);
+        if (parent <= map->entryCapacity)
+        {
+            map->liveCounts[parent] += map->liveCounts[i];
+        }
+    }
+}
+
+static void PDOrderedMapDiscardLiveCounts(PDOrderedMap *map)
+{
+    free(map->liveCounts);
+    map->liveCounts = NULL;
+}
+
+/** Squeezes removed entries out of the key and value arrays, preserving the order of the live entries */
+static void PDOrderedMapCompact(PDOrderedMap *map)
+{
+    NSUInteger live = 0;
+
+    for (NSUInteger i = 0; i < map->entryCount; i++)
+    {
+        if (!map->keys[i])
+        {
+            continue;
+        }
+
+        if (i != live)
+        {
+            map->keys[live] = map->keys[i];
+            map->values[live] = map->values[i];
+            map->keys[i] = nil;
+            map->values[i] = nil;
+        }
+        live++;
+    }
+
+    map->entryCount = live;
+    map->mutations++;
+    PDOrderedMapDiscardLiveCounts(map);
+
+    if (map->slots)
+    {
+        PDOrderedMapRebuildIndex(map);
+    }
+}
+
+/** Makes room for one more entry, reclaiming removed entries before growing */
+static void PDOrderedMapReserveEntry(PDOrderedMap *map)
+{
+    if (map->entryCount < map->entryCapacity)
+    {
+        return;
+    }
+
+    if ((map->entryCount - map->count) * 2 >= map->entryCount && map->entryCount > map->count)
+    {
+        PDOrderedMapCompact(map);
+        return;
+    }
+
+    NSUInteger oldCapacity = map->entryCapacity;
+    NSUInteger newCapacity = MAX(oldCapacity * 2, PDOrderedMapMinimumEntryCapacity);
+
+    // The live counts cover the old capacity only; they are built again once the new entry is in place
+    PDOrderedMapDiscardLiveCounts(map);
+
+    // Strong references can be moved bitwise; only the new tail needs clearing before ARC assigns into it
+    map->keys = (__strong id *)realloc((void *)map->keys, newCapacity * sizeof(id));
+    map->values = (__strong id *)realloc((void *)map->values, newCapacity * sizeof(id));
+    memset((void *)(map->keys + oldCapacity), 0, (newCapacity - oldCapacity) * sizeof(id));
+    memset((void *)(map->values + oldCapacity), 0, (newCapacity - oldCapacity) * sizeof(id));
+    map->entryCapacity = newCapacity;
+}
+
+
+void PDOrderedMapDestroy(PDOrderedMap *map)
+{
+    for (NSUInteger i = 0; i < map->entryCount; i++)
+    {
+        map->keys[i] = nil;
+        map->values[i] = nil;
+    }
+
+    free((void *)map->keys);
+    free((void *)map->values);
+    free(map->slots);
+    free(map->liveCounts);
+    memset(map, 0, sizeof(PDOrderedMap));
+}
+
+void PDOrderedMapInitWithMap(PDOrderedMap *map, const PDOrderedMap *source, id (^transform)(id key, id value))
+{
+    if (!source->count)
+    {
+        return;
+    }
+
+    NSUInteger capacity = MAX(source->count, PDOrderedMapMinimumEntryCapacity);
+    map->keys = (__strong id *)calloc(capacity, sizeof(id));
+    map->values = (__strong id *)calloc(capacity, sizeof(id));
+    map->entryCapacity = capacity;
+
+    for (NSUInteger i = 0; i < source->entryCount; i++)
+    {
+        id key = source->keys[i];
+        if (key)
+        {
+            map->keys[map->entryCount] = key;
+            map->values[map->entryCount] = transform(key, source->values[i]);
+            map->entryCount++;
+        }
+    }
+
+    map->count = map->entryCount;
+    map->mutations++;
+
+    if (map->count > PDOrderedMapIndexThreshold)
+    {
+        PDOrderedMapRebuildIndex(map);
+    }
+}
+
+void PDOrderedMapShrink(PDOrderedMap *map)
+{
+    if (map->entryCount > map->count)
+    {
+        PDOrderedMapCompact(map);
+    }
+
+    if (map->entryCapacity == map->entryCount)
+    {
+        return;
+    }
+
+    if (!map->entryCount)
+    {
+        free((void *)map->keys);
+        free((void *)map->values);
+        map->keys = NULL;
+        map->values = NULL;
+    }
+    else
+    {
+        // Only the unused tail is released, and it holds no references
+        map->keys = (__strong id *)realloc((void *)map->keys, map->entryCount * sizeof(id));
+        map->values = (__strong id *)realloc((void *)map->values, map->entryCount * sizeof(id));
+    }
+    map->entryCapacity = map->entryCount;
+}
+
+id PDOrderedMapGet(const PDOrderedMap *map, id key)
+{
+    NSUInteger index = PDOrderedMapFind(map, key, NULL);
+    return index == NSNotFound ? nil : map->values[index];
+}
+
+void PDOrderedMapSet(PDOrderedMap *map, id key, id value)
+{
+    NSUInteger index = PDOrderedMapFind(map, key, NULL);
+
+    if (index != NSNotFound)
+    {
+        map->values[index] = value;
+        return;
+    }
+
+    PDOrderedMapReserveEntry(map);
+
+    NSUInteger entry = map->entryCount++;
+    map->keys[entry] = [key copy];
+    map->values[entry] = value;
+    map->count++;
+    map->mutations++;
+
+    if (map->liveCounts)
+    {
+        PDOrderedMapUpdateLiveCounts(map, entry, 1);
+    }
+    else if (map->entryCount != map->count)
+    {
+        PDOrderedMapBuildLiveCounts(map);
+    }
+
+    if (map->slots)
+    {
+        // Keep at least a quarter of the slots empty so that probes stay short and always terminate
+        if ((map->slotLoad + 1) * 4 > map->slotCapacity * 3)
+        {
+            PDOrderedMapRebuildIndex(map);
+        }
+        else
+        {
+            PDOrderedMapInsertSlot(map, [map->keys[entry] hash], entry);
+        }
+    }
+    else if (map->count > PDOrderedMapIndexThreshold)
+    {
+        PDOrderedMapRebuildIndex(map);
+    }
+}
+
+BOOL PDOrderedMapRemove(PDOrderedMap *map, id key)
+{
+    NSUInteger slot = NSNotFound;
+    NSUInteger index = PDOrderedMapFind(map, key, &slot);
+
+    if (index == NSNotFound)
+    {
+        return NO;
+    }
+
+    map->keys[index] = nil;
+    map->values[index] = nil;
+    map->count--;
+    map->mutations++;
+
+    if (map->slots)
+    {
+        map->slots[slot] = PDOrderedMapSlotRemoved;
+    }
+
+    if (map->liveCounts)
+    {
+        PDOrderedMapUpdateLiveCounts(map, index, -1);
+    }
+
+    // Removed entries at the end are simply forgotten, which keeps stack-like removal free of holes
+    while (map->entryCount && !map->keys[map->entryCount - 1])
+    {
+        map->entryCount--;
+    }
+
+    NSUInteger removedCount = map->entryCount - map->count;
+    if (removedCount > PDOrderedMapIndexThreshold && removedCount * 2 > map->entryCount)
+    {
+        PDOrderedMapCompact(map);
+    }
+
+    if (map->entryCount == map->count)
+    {
+        PDOrderedMapDiscardLiveCounts(map);
+    }
+    else if (!map->liveCounts)
+    {
+        PDOrderedMapBuildLiveCounts(map);
+    }
+
+    return YES;
+}
+
+NSUInteger PDOrderedMapOrderOfKey(const PDOrderedMap *map, id key)
+{
+    // Entries only ever move towards the front when removed entries are squeezed out, so entry positions stay in insertion order
+    return PDOrderedMapFind(map, key, NULL);
+}
+
+id PDOrderedMapKeyAtIndex(const PDOrderedMap *map, NSUInteger index)
+{
+    if (index >= map->count)
+    {
+        return nil;
+    }
+
+    if (!map->liveCounts)
+    {
+        return map->keys[index];
+    }
+
+    // Descends the tree to the first position with index + 1 live entries at or before it
+    NSUInteger remaining = index + 1;
+    NSUInteger position = 0;
+    NSUInteger step = 1;
+    while (step * 2 <= map->entryCapacity)
+    {
+        step *= 2;
+    }
+
+    for (; step; step /= 2)
+    {
+        if (position + step <= map->entryCapacity && map->liveCounts[position + step] < remaining)
+        {
+            position += step;
+            remaining -= map->liveCounts[position];
+        }
+    }
+
+    return map->keys[position];
+}
+
+NSArray *PDOrderedMapCopyKeys(const PDOrderedMap *map)
+{
+    if (map->entryCount == map->count)
+    {
+        return [NSArray arrayWithObjects:map->keys count:map->count];
+    }
+
+    NSMutableArray *keys = [NSMutableArray arrayWithCapacity:map->count];
+    for (NSUInteger i = 0; i < map->entryCount; i++)
+    {
+        if (map->keys[i])
+        {
+            [keys addObject:map->keys[i]];
+        }
+    }
+
+    return keys;
+}
+
+NSUInteger PDOrderedMapEnumerateKeys(PDOrderedMap *map, NSFastEnumerationState *state, id __unsafe_unretained buffer[], NSUInteger length)
+{
+    NSUInteger entry = state->state;
+    NSUInteger produced = 0;
+
+    while (entry < map->entryCount && produced < length)
+    {
+        id key = map->keys[entry++];
+        if (key)
+        {
+            buffer[produced++] = key;
+        }
+    }
+
+    state->state = entry;
+    state->itemsPtr = buffer;
+    state->mutationsPtr = &map->mutations;
+    return produced;
+}
@@ -0,0 +1,52 @@
+//
+// PDSnapshot.h
+//
+// Copyright (c) 2015 Daniel Hall
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+
+#import <Foundation/Foundation.h>
+#import "PDNode+_PrestoData_Internal.h"
+
+/** This class is used internally by PrestoData to save a dictionary or array to a compact binary file and to load it again without parsing.
+*
+* A snapshot holds every element's ordered keys, typed scalar values (strings, integers, doubles and booleans), inner value and child elements.  Each distinct string is stored once, in a table at the end of the file, and elements refer to their children by file offset.  Loading maps the file into memory and returns PDNodes that read their keys and values from the mapping only when they are first used, so opening a snapshot costs the same however large it is.
+*
+* Snapshots are meant to be read back by the version of PrestoData that wrote them; a file that doesn't start with the expected header is rejected.  Element arrays can only contain dictionaries.
+*/
+
+@interface PDSnapshot : NSObject <PDNodeContentSource>
+
+/** Writes a dictionary or an array of dictionaries to a snapshot file, replacing any existing file atomically
+* @param object The PrestoData dictionary or array to write
+* @param path The path of the file to write
+* @param error Set to an error in PrestoDataErrorDomain if the object can't be written
+* @return YES if the file was written
+*/
++ (BOOL)writeObject:(id)object toFile:(NSString *)path error:(NSError **)error;
+
+/** Maps a snapshot file and returns its root without loading any of its elements
+* @param path The path of a file written by writeObject:toFile:error:
+* @return A PDNode for a snapshot of a dictionary, an NSMutableArray of PDNodes for a snapshot of an array, or nil if the file can't be read or isn't a snapshot
+*/
++ (id)objectFromSnapshotAtPath:(NSString *)path;
+
+@end
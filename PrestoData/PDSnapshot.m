@@ -0,0 +1,650 @@
+//
+// PDSnapshot.m
+//
+// Copyright (c) 2015 Daniel Hall
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+
+#import "PDSnapshot.h"
+#import "PDOptions.h"
+#import "NSMutableDictionary+PrestoData.h"
+#import "NSMutableDictionary+_PrestoData_Internal.h"
+#import "NSArray+_PrestoData_Internal.h"
+#import "NSNumber+_PrestoData_Internal.h"
+#include <stdlib.h>
+#include <string.h>
+
+/** Identifies a snapshot file, and changes whenever the format does */
+static const uint8_t PDSnapshotMagic[8] = { 'P', 'D', 'S', 'N', 'A', 'P', '0', '1' };
+
+/** The header is the magic, the string count, the root's tag, the offset of the string table and the offset of the root */
+static const NSUInteger PDSnapshotHeaderLength = 32;
+
+/** Each value in a snapshot starts with one of these tags.  All integers are little-endian */
+typedef NS_ENUM(uint8_t, PDSnapshotTag)
+{
+    /** No value.  Used for elements without an inner value */
+    PDSnapshotTagNone = 0,
+    /** Followed by a 4-byte index into the string table */
+    PDSnapshotTagString = 1,
+    /** Followed by an 8-byte signed integer */
+    PDSnapshotTagInteger = 2,
+    /** Followed by an 8-byte unsigned integer */
+    PDSnapshotTagUnsignedInteger = 3,
+    /** Followed by the 8 bytes of a double */
+    PDSnapshotTagDouble = 4,
+    /** Followed by one byte, 0 or 1 */
+    PDSnapshotTagBoolean = 5,
+    /** Followed by the 8-byte offset of an element record: its inner value, a 4-byte key count, and a 4-byte key string index and a value for each key */
+    PDSnapshotTagElement = 6,
+    /** Followed by a 4-byte count and the 8-byte offset of each element's record */
+    PDSnapshotTagElementArray = 7
+};
+
+
+static void PDSnapshotAppendUInt8(NSMutableData *data, uint8_t value)
+{
+    [data appendBytes:&value length:1];
+}
+
+static void PDSnapshotAppendUInt32(NSMutableData *data, uint32_t value)
+{
+    uint8_t bytes[4];
+    for (NSUInteger i = 0; i < 4; i++)
+    {
+        bytes[i] = (uint8_t)(value >> (i * 8));
+    }
+    [data appendBytes:bytes length:4];
+}
+
+static void PDSnapshotAppendUInt64(NSMutableData *data, uint64_t value)
+{
+    uint8_t bytes[8];
+    for (NSUInteger i = 0; i < 8; i++)
+    {
+        bytes[i] = (uint8_t)(value >> (i * 8));
+    }
+    [data appendBytes:bytes length:8];
+}
+
+
+/** A position in a mapped snapshot.  Reads past the end of the file return 0 and set failed, so a damaged file can't be read outside its mapping */
+typedef struct
+{
+    const uint8_t *bytes;
+    NSUInteger length;
+    NSUInteger position;
+    BOOL failed;
+} PDSnapshotCursor;
+
+static BOOL PDSnapshotCursorHasBytes(PDSnapshotCursor *cursor, NSUInteger count)
+{
+    if (cursor->failed || cursor->position > cursor->length || cursor->length - cursor->position < count)
+    {
+        cursor->failed = YES;
+        return NO;
+    }
+    return YES;
+}
+
+static uint8_t PDSnapshotReadUInt8(PDSnapshotCursor *cursor)
+{
+    return PDSnapshotCursorHasBytes(cursor, 1) ? cursor->bytes[cursor->position++] : 0;
+}
+
+static uint32_t PDSnapshotReadUInt32(PDSnapshotCursor *cursor)
+{
+    if (!PDSnapshotCursorHasBytes(cursor, 4))
+    {
+        return 0;
+    }
+
+    uint32_t value = 0;
+    for (NSUInteger i = 0; i < 4; i++)
+    {
+        value |= (uint32_t)cursor->bytes[cursor->position++] << (i * 8);
+    }
+    return value;
+}
+
+static uint64_t PDSnapshotReadUInt64(PDSnapshotCursor *cursor)
+{
+    if (!PDSnapshotCursorHasBytes(cursor, 8))
+    {
+        return 0;
+    }
+
+    uint64_t value = 0;
+    for (NSUInteger i = 0; i < 8; i++)
+    {
+        value |= (uint64_t)cursor->bytes[cursor->position++] << (i * 8);
+    }
+    return value;
+}
+
+
+/** Builds the bytes of a snapshot.  Elements are written after their children, so every offset is known by the time it is written, and the string table is written last */
+
+@interface PDSnapshotWriter : NSObject
+
+@property (nonatomic, strong, readonly) NSMutableData *data;
+
+- (BOOL)writeRoot:(id)object;
+
+@end
+
+
+@implementation PDSnapshotWriter
+{
+    NSMutableDictionary *_stringIndexes;
+    NSMutableArray *_strings;
+}
+
+- (instancetype)init
+{
+    self = [super init];
+
+    if (self) {
+        _data = [NSMutableData dataWithLength:PDSnapshotHeaderLength];
+        _stringIndexes = [NSMutableDictionary dictionary];
+        _strings = [NSMutableArray array];
+    }
+
+    return self;
+}
+
+- (uint32_t)indexOfString:(NSString *)string
+{
+    NSNumber *index = _stringIndexes[string];
+
+    if (!index)
+    {
+        index = @(_strings.count);
+        _stringIndexes[string] = index;
+        [_strings addObject:string];
+    }
+
+    return index.unsignedIntValue;
+}
+
+/** Appends a tagged scalar.  Values other than strings and numbers are written as their descriptions, as the JSON and XML writers do */
+- (void)appendScalar:(id)value
+{
+    if (!value)
+    {
+        PDSnapshotAppendUInt8(_data, PDSnapshotTagNone);
+        return;
+    }
+
+    if (![value isKindOfClass:[NSNumber class]])
+    {
+        PDSnapshotAppendUInt8(_data, PDSnapshotTagString);
+        PDSnapshotAppendUInt32(_data, [self indexOfString:[value isKindOfClass:[NSString class]] ? value : [value description]]);
+        return;
+    }
+
+    NSNumber *number = value;
+
+    if (number.pd_isBoolean)
+    {
+        PDSnapshotAppendUInt8(_data, PDSnapshotTagBoolean);
+        PDSnapshotAppendUInt8(_data, number.boolValue ? 1 : 0);
+        return;
+    }
+
+    switch (number.objCType[0])
+    {
+        case 'c':
+        case 's':
+        case 'i':
+        case 'l':
+        case 'q':
+            PDSnapshotAppendUInt8(_data, PDSnapshotTagInteger);
+            PDSnapshotAppendUInt64(_data, (uint64_t)number.longLongValue);
+            break;
+
+        case 'C':
+        case 'S':
+        case 'I':
+        case 'L':
+        case 'Q':
+            PDSnapshotAppendUInt8(_data, PDSnapshotTagUnsignedInteger);
+            PDSnapshotAppendUInt64(_data, number.unsignedLongLongValue);
+            break;
+
+        default:
+        {
+            double doubleValue = number.doubleValue;
+            uint64_t bits;
+            memcpy(&bits, &doubleValue, sizeof(bits));
+            PDSnapshotAppendUInt8(_data, PDSnapshotTagDouble);
+            PDSnapshotAppendUInt64(_data, bits);
+            break;
+        }
+    }
+}
+
+/** Writes the records of an element array's dictionaries, and returns their offsets, or nil if the array holds anything else */
+- (NSMutableData *)writeElementArray:(NSArray *)array
+{
+    NSMutableData *offsets = [NSMutableData dataWithCapacity:array.count * sizeof(uint64_t)];
+
+    for (NSMutableDictionary *element in array)
+    {
+        if (![element isKindOfClass:[NSMutableDictionary class]])
+        {
+            return nil;
+        }
+
+        uint64_t offset = [self writeElement:element];
+        if (offset == 0)
+        {
+            return nil;
+        }
+        [offsets appendBytes:&offset length:sizeof(offset)];
+    }
+
+    return offsets;
+}
+
+/** Writes an element's children and then its own record
+* @return The offset of the element's record, or 0 if it contains something that can't be written
+*/
+- (uint64_t)writeElement:(NSMutableDictionary *)element
+{
+    NSArray *keys = element.pd_orderedKeys;
+    NSMutableArray *children = [NSMutableArray arrayWithCapacity:keys.count];
+
+    for (NSString *key in keys)
+    {
+        id value = element[key];
+        id child = [NSNull null];
+
+        if ([value isKindOfClass:[NSMutableDictionary class]])
+        {
+            uint64_t offset = [self writeElement:value];
+            child = offset ? @(offset) : nil;
+        }
+        else if ([value isKindOfClass:[NSArray class]])
+        {
+            child = [self writeElementArray:value];
+        }
+
+        if (!child)
+        {
+            return 0;
+        }
+        [children addObject:child];
+    }
+
+    uint64_t offset = _data.length;
+    [self appendScalar:element.pd_innerValue];
+    PDSnapshotAppendUInt32(_data, (uint32_t)keys.count);
+
+    [keys enumerateObjectsUsingBlock:^(NSString *key, NSUInteger index, BOOL *stop) {
+        PDSnapshotAppendUInt32(self->_data, [self indexOfString:key]);
+        [self appendChild:children[index] orScalar:element[key]];
+    }];
+
+    return offset;
+}
+
+- (void)appendChild:(id)child orScalar:(id)value
+{
+    if ([child isKindOfClass:[NSNumber class]])
+    {
+        PDSnapshotAppendUInt8(_data, PDSnapshotTagElement);
+        PDSnapshotAppendUInt64(_data, [child unsignedLongLongValue]);
+    }
+    else if ([child isKindOfClass:[NSData class]])
+    {
+        [self appendElementArrayOffsets:child];
+    }
+    else
+    {
+        [self appendScalar:value];
+    }
+}
+
+- (void)appendElementArrayOffsets:(NSData *)offsets
+{
+    NSUInteger count = offsets.length / sizeof(uint64_t);
+    const uint64_t *values = offsets.bytes;
+
+    PDSnapshotAppendUInt8(_data, PDSnapshotTagElementArray);
+    PDSnapshotAppendUInt32(_data, (uint32_t)count);
+    for (NSUInteger i = 0; i < count; i++)
+    {
+        PDSnapshotAppendUInt64(_data, values[i]);
+    }
+}
+
+- (BOOL)writeRoot:(id)object
+{
+    uint8_t rootTag;
+    uint64_t rootOffset;
+
+    if ([object isKindOfClass:[NSMutableDictionary class]])
+    {
+        rootTag = PDSnapshotTagElement;
+        rootOffset = [self writeElement:object];
+        if (rootOffset == 0)
+        {
+            return NO;
+        }
+    }
+    else if ([object isKindOfClass:[NSArray class]])
+    {
+        NSMutableData *offsets = [self writeElementArray:object];
+        if (!offsets)
+        {
+            return NO;
+        }
+        rootTag = PDSnapshotTagElementArray;
+        rootOffset = _data.length;
+        [self appendElementArrayOffsets:offsets];
+    }
+    else
+    {
+        return NO;
+    }
+
+    // The string table is a list of offsets followed by each string's length and UTF8 bytes
+    uint64_t stringTableOffset = _data.length;
+    NSMutableData *strings = [NSMutableData data];
+    uint64_t stringsOffset = stringTableOffset + _strings.count * sizeof(uint64_t);
+
+    for (NSString *string in _strings)
+    {
+        PDSnapshotAppendUInt64(_data, stringsOffset + strings.length);
+        NSData *bytes = [string dataUsingEncoding:NSUTF8StringEncoding];
+        PDSnapshotAppendUInt32(strings, (uint32_t)bytes.length);
+        [strings appendData:bytes];
+    }
+    [_data appendData:strings];
+
+    NSMutableData *header = [NSMutableData dataWithBytes:PDSnapshotMagic length:sizeof(PDSnapshotMagic)];
+    PDSnapshotAppendUInt32(header, (uint32_t)_strings.count);
+    PDSnapshotAppendUInt32(header, rootTag);
+    PDSnapshotAppendUInt64(header, stringTableOffset);
+    PDSnapshotAppendUInt64(header, rootOffset);
+    [_data replaceBytesInRange:NSMakeRange(0, PDSnapshotHeaderLength) withBytes:header.bytes];
+
+    return YES;
+}
+
+@end
+
+
+@implementation PDSnapshot
+{
+    NSData *_data;
+    uint32_t _stringCount;
+    uint64_t _stringTableOffset;
+    /** Strings decoded so far, each retained, so each one is only turned into an NSString once and keys are shared between elements.  Elements may load on several threads at once, so slots are filled in with a compare and swap rather than a lock */
+    void **_strings;
+}
+
++ (BOOL)writeObject:(id)object toFile:(NSString *)path error:(NSError **)error
+{
+    PDSnapshotWriter *writer = [[PDSnapshotWriter alloc] init];
+
+    if (![writer writeRoot:object])
+    {
+        if (error)
+        {
+            *error = [NSError errorWithDomain:PrestoDataErrorDomain code:PrestoDataErrorWriteFailed userInfo:@{NSLocalizedDescriptionKey : @"Only a PrestoData dictionary, or an array of dictionaries, can be written to a snapshot"}];
+        }
+        return NO;
+    }
+
+    NSError *writeError = nil;
+
+    if (![writer.data writeToFile:path options:NSDataWritingAtomic error:&writeError])
+    {
+        if (error)
+        {
+            NSMutableDictionary *userInfo = [NSMutableDictionary dictionaryWithObject:[NSString stringWithFormat:@"The snapshot could not be written to %@", path] forKey:NSLocalizedDescriptionKey];
+            if (writeError)
+            {
+                userInfo[NSUnderlyingErrorKey] = writeError;
+            }
+            *error = [NSError errorWithDomain:PrestoDataErrorDomain code:PrestoDataErrorWriteFailed userInfo:userInfo];
+        }
+        return NO;
+    }
+
+    return YES;
+}
+
++ (id)objectFromSnapshotAtPath:(NSString *)path
+{
+    NSData *data = path ? [NSData dataWithContentsOfFile:path options:NSDataReadingMappedAlways error:NULL] : nil;
+
+    if (data.length < PDSnapshotHeaderLength || memcmp(data.bytes, PDSnapshotMagic, sizeof(PDSnapshotMagic)) != 0)
+    {
+        return nil;
+    }
+
+    PDSnapshot *snapshot = [[self alloc] initWithData:data];
+    PDSnapshotCursor cursor = [snapshot cursorAtOffset:sizeof(PDSnapshotMagic)];
+    snapshot->_stringCount = PDSnapshotReadUInt32(&cursor);
+    uint8_t rootTag = (uint8_t)PDSnapshotReadUInt32(&cursor);
+    snapshot->_stringTableOffset = PDSnapshotReadUInt64(&cursor);
+    uint64_t rootOffset = PDSnapshotReadUInt64(&cursor);
+
+    if (cursor.failed || snapshot->_stringTableOffset > data.length || (data.length - snapshot->_stringTableOffset) / sizeof(uint64_t) < snapshot->_stringCount)
+    {
+        return nil;
+    }
+    snapshot->_strings = calloc(snapshot->_stringCount ? : 1, sizeof(void *));
+
+    if (rootTag == PDSnapshotTagElement)
+    {
+        return [snapshot elementAtOffset:rootOffset named:nil parent:nil];
+    }
+
+    if (rootTag == PDSnapshotTagElementArray)
+    {
+        cursor = [snapshot cursorAtOffset:rootOffset];
+        return [snapshot elementArrayAtCursor:&cursor named:nil parent:nil];
+    }
+
+    return nil;
+}
+
+- (instancetype)initWithData:(NSData *)data
+{
+    self = [super init];
+
+    if (self) {
+        _data = data;
+    }
+
+    return self;
+}
+
+- (void)dealloc
+{
+    for (NSUInteger i = 0; _strings && i < _stringCount; i++)
+    {
+        if (_strings[i])
+        {
+            CFBridgingRelease(_strings[i]);
+        }
+    }
+    free(_strings);
+}
+
+- (PDSnapshotCursor)cursorAtOffset:(uint64_t)offset
+{
+    PDSnapshotCursor cursor = { _data.bytes, _data.length, (NSUInteger)offset, offset > _data.length };
+    return cursor;
+}
+
+- (NSString *)stringAtIndex:(uint32_t)index
+{
+    if (index >= _stringCount)
+    {
+        return nil;
+    }
+
+    NSString *string = (__bridge NSString *) __atomic_load_n(&_strings[index], __ATOMIC_ACQUIRE);
+
+    if (!string)
+    {
+        PDSnapshotCursor cursor = [self cursorAtOffset:_stringTableOffset + (uint64_t)index * sizeof(uint64_t)];
+        cursor.position = (NSUInteger)PDSnapshotReadUInt64(&cursor);
+        uint32_t length = PDSnapshotReadUInt32(&cursor);
+
+        if (!PDSnapshotCursorHasBytes(&cursor, length))
+        {
+            return nil;
+        }
+
+        string = [[NSString alloc] initWithBytes:cursor.bytes + cursor.position length:length encoding:NSUTF8StringEncoding];
+        if (!string)
+        {
+            return nil;
+        }
+
+        // Threads decoding the same string at once all use whichever copy is stored first
+        void *stored = NULL;
+        void *retained = (void *) CFBridgingRetain(string);
+        if (!__atomic_compare_exchange_n(&_strings[index], &stored, retained, NO, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE))
+        {
+            CFBridgingRelease(retained);
+            string = (__bridge NSString *) stored;
+        }
+    }
+
+    return string;
+}
+
+/** Reads a tagged scalar.  Element tags aren't scalars, and give nil */
+- (id)scalarWithTag:(uint8_t)tag cursor:(PDSnapshotCursor *)cursor
+{
+    switch (tag)
+    {
+        case PDSnapshotTagString:
+            return [self stringAtIndex:PDSnapshotReadUInt32(cursor)];
+
+        case PDSnapshotTagInteger:
+            return @((long long)PDSnapshotReadUInt64(cursor));
+
+        case PDSnapshotTagUnsignedInteger:
+            return @((unsigned long long)PDSnapshotReadUInt64(cursor));
+
+        case PDSnapshotTagDouble:
+        {
+            uint64_t bits = PDSnapshotReadUInt64(cursor);
+            double value;
+            memcpy(&value, &bits, sizeof(value));
+            return @(value);
+        }
+
+        case PDSnapshotTagBoolean:
+            return @(PDSnapshotReadUInt8(cursor) != 0);
+
+        default:
+            return nil;
+    }
+}
+
+/** Creates an element that will load its keys and values from its record when they are first needed.  Only the inner value at the start of the record is read now */
+- (PDNode *)elementAtOffset:(uint64_t)offset named:(NSString *)name parent:(NSMutableDictionary *)parent
+{
+    PDSnapshotCursor cursor = [self cursorAtOffset:offset];
+    id innerValue = [self scalarWithTag:PDSnapshotReadUInt8(&cursor) cursor:&cursor];
+
+    if (cursor.failed)
+    {
+        return nil;
+    }
+
+    return PDNodeCreateWithContentSource(self, offset, innerValue, name, parent);
+}
+
+- (NSMutableArray *)elementArrayAtCursor:(PDSnapshotCursor *)cursor named:(NSString *)name parent:(NSMutableDictionary *)parent
+{
+    uint32_t count = PDSnapshotReadUInt32(cursor);
+
+    if (!PDSnapshotCursorHasBytes(cursor, (NSUInteger)count * sizeof(uint64_t)))
+    {
+        return nil;
+    }
+
+    NSMutableArray *elements = [NSMutableArray arrayWithCapacity:count];
+    for (uint32_t i = 0; i < count; i++)
+    {
+        PDNode *element = [self elementAtOffset:PDSnapshotReadUInt64(cursor) named:name parent:parent];
+        if (element)
+        {
+            [elements addObject:element];
+        }
+    }
+
+    if (name)
+    {
+        elements.pd_elementName = name;
+        elements.pd_parentDictionary = parent;
+    }
+
+    return elements;
+}
+
+- (void)pd_loadContentsOfNode:(PDNode *)node fromLocation:(uint64_t)location
+{
+    PDSnapshotCursor cursor = [self cursorAtOffset:location];
+
+    // The inner value was read when the node was created
+    [self scalarWithTag:PDSnapshotReadUInt8(&cursor) cursor:&cursor];
+    uint32_t count = PDSnapshotReadUInt32(&cursor);
+
+    for (uint32_t i = 0; i < count && !cursor.failed; i++)
+    {
+        NSString *key = [self stringAtIndex:PDSnapshotReadUInt32(&cursor)];
+        uint8_t tag = PDSnapshotReadUInt8(&cursor);
+        id value;
+
+        if (tag == PDSnapshotTagElement)
+        {
+            value = [self elementAtOffset:PDSnapshotReadUInt64(&cursor) named:key parent:node];
+        }
+        else if (tag == PDSnapshotTagElementArray)
+        {
+            value = [self elementArrayAtCursor:&cursor named:key parent:node];
+        }
+        else
+        {
+            value = [self scalarWithTag:tag cursor:&cursor];
+        }
+
+        // A damaged record loads as far as it can be read
+        if (!key || !value || cursor.failed)
+        {
+            break;
+        }
+        PDNodeAppendLoadedObject(node, key, value);
+    }
+}
+
+@end
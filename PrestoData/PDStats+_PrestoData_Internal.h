@@ -0,0 +1,72 @@
+//
+// PDStats+_PrestoData_Internal.h
+//
+// Copyright (c) 2015 Daniel Hall
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+
+#import "PDStats.h"
+
+/** YES while statistics are enabled.  Every instrumented path checks this before doing anything else */
+extern BOOL PDStatsEnabled;
+
+/** Returns the calling thread's counters, creating them on first use */
+PDStatsCounters *PDStatsCurrentThreadCounters(void);
+
+/** Adds to one of the calling thread's counters, if statistics are enabled */
+#define PDStatsAdd(counter, amount) do { if (PDStatsEnabled) { PDStatsCurrentThreadCounters()->counter += (amount); } } while (0)
+
+/** Marks an operation in progress, returned by PDStatsBeginOperation and passed to PDStatsEndOperation */
+typedef struct
+{
+    PDStatsOperation operation;
+    uint64_t start;
+    BOOL reported;
+} PDStatsToken;
+
+PDStatsToken PDStatsBeginReportedOperation(PDStatsOperation operation, NSString *detail);
+void PDStatsEndReportedOperation(PDStatsToken token, NSString *detail, uint64_t bytes);
+
+/** Marks the beginning of an operation.  Only the outermost operation of each kind on a thread is timed and reported
+* @param operation The kind of operation
+* @param detail The detail passed to the operation handler
+*/
+static inline PDStatsToken PDStatsBeginOperation(PDStatsOperation operation, NSString *detail)
+{
+    if (!PDStatsEnabled)
+    {
+        return (PDStatsToken) { operation, 0, NO };
+    }
+    return PDStatsBeginReportedOperation(operation, detail);
+}
+
+/** Marks the end of an operation
+* @param token The token returned when the operation began
+* @param detail The detail passed to the operation handler
+* @param bytes The bytes a parse read or a serialization wrote, added to bytesParsed or bytesSerialized.  Ignored for other operations
+*/
+static inline void PDStatsEndOperation(PDStatsToken token, NSString *detail, uint64_t bytes)
+{
+    if (token.reported)
+    {
+        PDStatsEndReportedOperation(token, detail, bytes);
+    }
+}
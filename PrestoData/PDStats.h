@@ -0,0 +1,113 @@
+//
+// PDStats.h
+//
+// Copyright (c) 2015 Daniel Hall
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+
+#import <Foundation/Foundation.h>
+
+/** The kinds of operation that PDStats times and reports to its operation handler */
+typedef NS_ENUM(NSUInteger, PDStatsOperation)
+{
+    /** Parsing JSON or XML data, a stream or a file, including streaming queries */
+    PDStatsOperationParse,
+    /** Evaluating an XPath query */
+    PDStatsOperationQuery,
+    /** Writing JSON, XML or a description */
+    PDStatsOperationSerialize,
+    /** pd_copy of a dictionary or array */
+    PDStatsOperationCopy,
+    /** pd_isEqualToDictionary:, pd_isEqualToArray: or pd_diffAgainst: */
+    PDStatsOperationCompare
+};
+
+/** The number of PDStatsOperation values, for sizing arrays indexed by operation */
+#define PDStatsOperationCount 5
+
+/** Counts of the work PrestoData has done on one thread, or on all threads */
+typedef struct
+{
+    /** Bytes of JSON or XML read by the parsers */
+    uint64_t bytesParsed;
+    /** Bytes of output written by the serializers */
+    uint64_t bytesSerialized;
+    /** Element nodes created, whether by parsing, by copying, or by the caller */
+    uint64_t nodesCreated;
+    /** Element nodes copied by pd_copy.  Copies share contents with their original until either changes, so this can be much smaller than the size of the copied document */
+    uint64_t nodesCopied;
+    /** XPath queries compiled, which excludes those answered from the compiled query cache */
+    uint64_t queriesCompiled;
+    /** XPath location steps evaluated, once for each query evaluation */
+    uint64_t queryStepsEvaluated;
+    /** Nodes selected by XPath location steps, before their predicates were applied */
+    uint64_t nodesVisited;
+    /** XPath predicates evaluated, once for each node they were tested against */
+    uint64_t predicateEvaluations;
+    /** Element and attribute name patterns compiled */
+    uint64_t namePatternCompilations;
+    /** The number of each operation performed, indexed by PDStatsOperation.  An operation that calls another of the same kind counts once */
+    uint64_t operations[PDStatsOperationCount];
+    /** The total nanoseconds spent in each operation, indexed by PDStatsOperation */
+    uint64_t operationNanoseconds[PDStatsOperationCount];
+} PDStatsCounters;
+
+/** Called as each operation begins and ends
+* @param operation The kind of operation
+* @param detail The query string for PDStatsOperationQuery, otherwise nil
+* @param finished NO when the operation begins, YES when it ends
+* @param nanoseconds How long the operation took, or 0 when it begins
+*/
+typedef void (^PDStatsOperationHandler)(PDStatsOperation operation, NSString *detail, BOOL finished, uint64_t nanoseconds);
+
+/** Opt-in instrumentation of PrestoData's work, for finding where the time goes when a call is slow.
+*
+* Nothing is counted or timed until statistics are enabled, and while they are disabled the instrumentation costs a single check of a flag.  Counters are kept separately for each thread, so counting never contends for a lock.  Work that a concurrent query or parse hands to other threads is counted on those threads, and is included in allThreadsCounters.
+*
+* An operation handler sees every parse, query, serialization, copy and comparison begin and end on the thread that performs it, which makes it the place to emit signposts or trace events, or to attribute a slow call to the query that caused it.
+*/
+
+@interface PDStats : NSObject
+
+/** Starts or stops counting and calling the operation handler.  Defaults to NO */
++ (void)setEnabled:(BOOL)enabled;
++ (BOOL)isEnabled;
+
+/** The block called as each operation begins and ends, while statistics are enabled.  It is called on the thread doing the work, so it should be quick and thread-safe.  Operations nested inside another of the same kind, such as the parse of each item of a concurrently parsed array, are not reported */
++ (void)setOperationHandler:(PDStatsOperationHandler)handler;
++ (PDStatsOperationHandler)operationHandler;
+
+/** The counters for work done on the calling thread since it started or since they were last reset */
++ (PDStatsCounters)currentThreadCounters;
+
+/** The sum of the counters of every thread, including threads that have exited.  Other threads may be counting while the sum is taken, so it is approximate while they are busy */
++ (PDStatsCounters)allThreadsCounters;
+
+/** Sets the calling thread's counters to zero */
++ (void)resetCurrentThreadCounters;
+
+/** Returns counters as a dictionary of NSNumbers, keyed by names such as bytesParsed and queryNanoseconds, ready to be exported to a metrics system
+* @param counters The counters to convert
+* @return A dictionary with an entry for every counter
+*/
++ (NSDictionary *)dictionaryWithCounters:(PDStatsCounters)counters;
+
+@end
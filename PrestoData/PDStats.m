@@ -0,0 +1,269 @@
+//
+// PDStats.m
+//
+// Copyright (c) 2015 Daniel Hall
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+
+#import "PDStats+_PrestoData_Internal.h"
+#import <pthread.h>
+#ifdef __APPLE__
+#include <mach/mach_time.h>
+#else
+#include <time.h>
+#endif
+
+BOOL PDStatsEnabled = NO;
+
+/** The counters of one thread, kept on a list so they can be summed across threads */
+typedef struct PDStatsThread
+{
+    PDStatsCounters counters;
+    /** How many operations of each kind are in progress on the thread, so that only the outermost is reported */
+    NSUInteger depth[PDStatsOperationCount];
+    struct PDStatsThread *previous;
+    struct PDStatsThread *next;
+} PDStatsThread;
+
+static pthread_key_t PDStatsThreadKey;
+static pthread_once_t PDStatsThreadKeyOnce = PTHREAD_ONCE_INIT;
+static pthread_mutex_t PDStatsLock = PTHREAD_MUTEX_INITIALIZER;
+static PDStatsThread *PDStatsThreads;
+/** The counters of threads that have exited */
+static PDStatsCounters PDStatsExitedCounters;
+static PDStatsOperationHandler PDStatsHandler;
+
+static void PDStatsAddCounters(PDStatsCounters *sum, const PDStatsCounters *counters)
+{
+    sum->bytesParsed += counters->bytesParsed;
+    sum->bytesSerialized += counters->bytesSerialized;
+    sum->nodesCreated += counters->nodesCreated;
+    sum->nodesCopied += counters->nodesCopied;
+    sum->queriesCompiled += counters->queriesCompiled;
+    sum->queryStepsEvaluated += counters->queryStepsEvaluated;
+    sum->nodesVisited += counters->nodesVisited;
+    sum->predicateEvaluations += counters->predicateEvaluations;
+    sum->namePatternCompilations += counters->namePatternCompilations;
+    for (NSUInteger i = 0; i < PDStatsOperationCount; i++)
+    {
+        sum->operations[i] += counters->operations[i];
+        sum->operationNanoseconds[i] += counters->operationNanoseconds[i];
+    }
+}
+
+static void PDStatsThreadExited(void *value)
+{
+    PDStatsThread *thread = value;
+
+    pthread_mutex_lock(&PDStatsLock);
+    PDStatsAddCounters(&PDStatsExitedCounters, &thread->counters);
+    if (thread->previous)
+    {
+        thread->previous->next = thread->next;
+    }
+    else
+    {
+        PDStatsThreads = thread->next;
+    }
+    if (thread->next)
+    {
+        thread->next->previous = thread->previous;
+    }
+    pthread_mutex_unlock(&PDStatsLock);
+
+    free(thread);
+}
+
+static void PDStatsCreateThreadKey(void)
+{
+    pthread_key_create(&PDStatsThreadKey, PDStatsThreadExited);
+}
+
+static PDStatsThread *PDStatsCurrentThread(void)
+{
+    pthread_once(&PDStatsThreadKeyOnce, PDStatsCreateThreadKey);
+    PDStatsThread *thread = pthread_getspecific(PDStatsThreadKey);
+
+    if (!thread)
+    {
+        thread = calloc(1, sizeof(PDStatsThread));
+        pthread_setspecific(PDStatsThreadKey, thread);
+
+        pthread_mutex_lock(&PDStatsLock);
+        thread->next = PDStatsThreads;
+        if (PDStatsThreads)
+        {
+            PDStatsThreads->previous = thread;
+        }
+        PDStatsThreads = thread;
+        pthread_mutex_unlock(&PDStatsLock);
+    }
+
+    return thread;
+}
+
+PDStatsCounters *PDStatsCurrentThreadCounters(void)
+{
+    return &PDStatsCurrentThread()->counters;
+}
+
+static uint64_t PDStatsNanoseconds(void)
+{
+#ifdef __APPLE__
+    static mach_timebase_info_data_t timebase;
+    if (!timebase.denom)
+    {
+        mach_timebase_info(&timebase);
+    }
+    return mach_absolute_time() * timebase.numer / timebase.denom;
+#else
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec * 1000000000ULL + (uint64_t)now.tv_nsec;
+#endif
+}
+
+static PDStatsOperationHandler PDStatsCurrentHandler(void)
+{
+    pthread_mutex_lock(&PDStatsLock);
+    PDStatsOperationHandler handler = PDStatsHandler;
+    pthread_mutex_unlock(&PDStatsLock);
+    return handler;
+}
+
+PDStatsToken PDStatsBeginReportedOperation(PDStatsOperation operation, NSString *detail)
+{
+    PDStatsThread *thread = PDStatsCurrentThread();
+    if (thread->depth[operation]++)
+    {
+        // Nested inside an operation of the same kind, which will count the time for both.  The nested operation still ends, to balance the depth
+        return (PDStatsToken) { operation, 0, YES };
+    }
+
+    PDStatsOperationHandler handler = PDStatsCurrentHandler();
+    if (handler)
+    {
+        handler(operation, detail, NO, 0);
+    }
+
+    return (PDStatsToken) { operation, PDStatsNanoseconds(), YES };
+}
+
+void PDStatsEndReportedOperation(PDStatsToken token, NSString *detail, uint64_t bytes)
+{
+    PDStatsThread *thread = PDStatsCurrentThread();
+    if (--thread->depth[token.operation])
+    {
+        return;
+    }
+
+    uint64_t nanoseconds = PDStatsNanoseconds() - token.start;
+    thread->counters.operations[token.operation]++;
+    thread->counters.operationNanoseconds[token.operation] += nanoseconds;
+    if (token.operation == PDStatsOperationParse)
+    {
+        thread->counters.bytesParsed += bytes;
+    }
+    else if (token.operation == PDStatsOperationSerialize)
+    {
+        thread->counters.bytesSerialized += bytes;
+    }
+
+    PDStatsOperationHandler handler = PDStatsCurrentHandler();
+    if (handler)
+    {
+        handler(token.operation, detail, YES, nanoseconds);
+    }
+}
+
+
+@implementation PDStats
+
++ (void)setEnabled:(BOOL)enabled
+{
+    PDStatsEnabled = enabled;
+}
+
++ (BOOL)isEnabled
+{
+    return PDStatsEnabled;
+}
+
++ (void)setOperationHandler:(PDStatsOperationHandler)handler
+{
+    handler = [handler copy];
+    pthread_mutex_lock(&PDStatsLock);
+    PDStatsHandler = handler;
+    pthread_mutex_unlock(&PDStatsLock);
+}
+
++ (PDStatsOperationHandler)operationHandler
+{
+    return PDStatsCurrentHandler();
+}
+
++ (PDStatsCounters)currentThreadCounters
+{
+    return PDStatsCurrentThread()->counters;
+}
+
++ (PDStatsCounters)allThreadsCounters
+{
+    pthread_mutex_lock(&PDStatsLock);
+    PDStatsCounters sum = PDStatsExitedCounters;
+    for (PDStatsThread *thread = PDStatsThreads; thread; thread = thread->next)
+    {
+        PDStatsAddCounters(&sum, &thread->counters);
+    }
+    pthread_mutex_unlock(&PDStatsLock);
+
+    return sum;
+}
+
++ (void)resetCurrentThreadCounters
+{
+    memset(&PDStatsCurrentThread()->counters, 0, sizeof(PDStatsCounters));
+}
+
++ (NSDictionary *)dictionaryWithCounters:(PDStatsCounters)counters
+{
+    NSArray *operationNames = @[@"parse", @"query", @"serialize", @"copy", @"compare"];
+    NSMutableDictionary *dictionary = [NSMutableDictionary dictionary];
+    dictionary[@"bytesParsed"] = @(counters.bytesParsed);
+    dictionary[@"bytesSerialized"] = @(counters.bytesSerialized);
+    dictionary[@"nodesCreated"] = @(counters.nodesCreated);
+    dictionary[@"nodesCopied"] = @(counters.nodesCopied);
+    dictionary[@"queriesCompiled"] = @(counters.queriesCompiled);
+    dictionary[@"queryStepsEvaluated"] = @(counters.queryStepsEvaluated);
+    dictionary[@"nodesVisited"] = @(counters.nodesVisited);
+    dictionary[@"predicateEvaluations"] = @(counters.predicateEvaluations);
+    dictionary[@"namePatternCompilations"] = @(counters.namePatternCompilations);
+
+    for (NSUInteger i = 0; i < PDStatsOperationCount; i++)
+    {
+        dictionary[[operationNames[i] stringByAppendingString:@"Count"]] = @(counters.operations[i]);
+        dictionary[[operationNames[i] stringByAppendingString:@"Nanoseconds"]] = @(counters.operationNanoseconds[i]);
+    }
+
+    return dictionary;
+}
+
+@end
@@ -0,0 +1,68 @@
+//
+// PDStringTable.h
+//
+// Copyright (c) 2015 Daniel Hall
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+
+#import <Foundation/Foundation.h>
+
+/** A slot in a string table's hash index */
+typedef struct
+{
+    /** The position of the string's UTF8 bytes in the table's byte storage */
+    NSUInteger offset;
+    uint32_t length;
+    uint32_t hash;
+    /** The index of the string + 1, or 0 for an empty slot */
+    NSUInteger entry;
+} PDStringTableSlot;
+
+/** A table of interned strings, used internally by PrestoData so that the keys and element names of parsed documents are shared NSString instances rather than a new string for every occurrence.  Shared names also make the pointer comparisons in PDOrderedMap and PDNameMatcher succeed without comparing characters.
+*
+* Each parser keeps its own table, which needs no locking.  Tables are never shared between documents, so the names a document interns go away with it, and parsers working on separate documents, or on chunks of one, never wait for each other.  The parsers for the chunks of one array only look keys up in the document parser's table, and intern the ones it doesn't have in their own.
+*
+* Strings are looked up by their UTF8 bytes, so a name that has been seen before costs a hash and a comparison and no allocation.  The struct must be zero-initialized before use and destroyed with PDStringTableDestroy.
+*/
+typedef struct
+{
+    __strong NSString **strings;
+    NSUInteger count;
+    NSUInteger stringCapacity;
+    uint8_t *bytes;
+    NSUInteger byteCount;
+    NSUInteger byteCapacity;
+    PDStringTableSlot *slots;
+    NSUInteger slotCapacity;
+} PDStringTable;
+
+/** Releases the table's strings and frees its storage */
+void PDStringTableDestroy(PDStringTable *table);
+
+/** Returns the interned string for some UTF8 bytes, adding it to the table if it isn't there yet.  Strings too long to be names are returned without being interned
+* @return The string, or nil if the bytes aren't valid UTF8
+*/
+NSString *PDStringTableIntern(PDStringTable *table, const uint8_t *bytes, NSUInteger length);
+
+/** Returns the interned string for some UTF8 bytes if the table has one, without adding anything.  Several threads can look strings up at once, as long as nothing is interned in the table meanwhile
+* @return The string, or nil if it isn't in the table
+*/
+NSString *PDStringTableFind(const PDStringTable *table, const uint8_t *bytes, NSUInteger length);
@@ -0,0 +1,185 @@
+//
+// PDStringTable.m
+//
+// Copyright (c) 2015 Daniel Hall
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+
+#import "PDStringTable.h"
+#include <stdlib.h>
+#include <string.h>
+
+/** Longer strings are almost never repeated names, and aren't worth keeping */
+static const NSUInteger PDStringTableMaximumLength = 128;
+
+static const NSUInteger PDStringTableMinimumSlotCapacity = 64;
+
+
+static inline uint32_t PDStringTableHash(const uint8_t *bytes, NSUInteger length)
+{
+    // FNV-1a
+    uint32_t hash = 2166136261u;
+    for (NSUInteger i = 0; i < length; i++)
+    {
+        hash = (hash ^ bytes[i]) * 16777619u;
+    }
+    return hash;
+}
+
+/** Returns the slot holding a string with these bytes, or the empty slot where it belongs */
+static PDStringTableSlot *PDStringTableFindSlot(const PDStringTable *table, const uint8_t *bytes, NSUInteger length, uint32_t hash)
+{
+    NSUInteger mask = table->slotCapacity - 1;
+
+    for (NSUInteger index = hash & mask; ; index = (index + 1) & mask)
+    {
+        PDStringTableSlot *slot = &table->slots[index];
+
+        if (!slot->entry || (slot->hash == hash && slot->length == length && memcmp(table->bytes + slot->offset, bytes, length) == 0))
+        {
+            return slot;
+        }
+    }
+}
+
+static void PDStringTableGrowSlots(PDStringTable *table)
+{
+    PDStringTableSlot *oldSlots = table->slots;
+    NSUInteger oldCapacity = table->slotCapacity;
+
+    table->slotCapacity = MAX(oldCapacity * 2, PDStringTableMinimumSlotCapacity);
+    table->slots = calloc(table->slotCapacity, sizeof(PDStringTableSlot));
+
+    for (NSUInteger i = 0; i < oldCapacity; i++)
+    {
+        if (oldSlots[i].entry)
+        {
+            NSUInteger mask = table->slotCapacity - 1;
+            NSUInteger index = oldSlots[i].hash & mask;
+            while (table->slots[index].entry)
+            {
+                index = (index + 1) & mask;
+            }
+            table->slots[index] = oldSlots[i];
+        }
+    }
+
+    free(oldSlots);
+}
+
+/** Adds a string that isn't in the table yet */
+static void PDStringTableAdd(PDStringTable *table, const uint8_t *bytes, NSUInteger length, uint32_t hash, NSString *string)
+{
+    // The index is kept at most half full, so probes stay short
+    if ((table->count + 1) * 2 > table->slotCapacity)
+    {
+        PDStringTableGrowSlots(table);
+    }
+
+    if (table->count == table->stringCapacity)
+    {
+        NSUInteger capacity = MAX(table->stringCapacity * 2, PDStringTableMinimumSlotCapacity / 2);
+        __strong NSString **strings = (__strong NSString **) calloc(capacity, sizeof(NSString *));
+        for (NSUInteger i = 0; i < table->count; i++)
+        {
+            strings[i] = table->strings[i];
+            table->strings[i] = nil;
+        }
+        free(table->strings);
+        table->strings = strings;
+        table->stringCapacity = capacity;
+    }
+
+    if (table->byteCount + length > table->byteCapacity)
+    {
+        table->byteCapacity = MAX(table->byteCapacity * 2, table->byteCount + length + 1024);
+        table->bytes = realloc(table->bytes, table->byteCapacity);
+    }
+
+    PDStringTableSlot *slot = PDStringTableFindSlot(table, bytes, length, hash);
+    slot->offset = table->byteCount;
+    slot->length = (uint32_t)length;
+    slot->hash = hash;
+    slot->entry = table->count + 1;
+
+    memcpy(table->bytes + table->byteCount, bytes, length);
+    table->byteCount += length;
+    table->strings[table->count++] = string;
+}
+
+static NSString *PDStringTableLookup(const PDStringTable *table, const uint8_t *bytes, NSUInteger length, uint32_t hash)
+{
+    if (!table->slotCapacity)
+    {
+        return nil;
+    }
+
+    PDStringTableSlot *slot = PDStringTableFindSlot(table, bytes, length, hash);
+    return slot->entry ? table->strings[slot->entry - 1] : nil;
+}
+
+
+void PDStringTableDestroy(PDStringTable *table)
+{
+    for (NSUInteger i = 0; i < table->count; i++)
+    {
+        table->strings[i] = nil;
+    }
+
+    free(table->strings);
+    free(table->bytes);
+    free(table->slots);
+    memset(table, 0, sizeof(PDStringTable));
+}
+
+NSString *PDStringTableIntern(PDStringTable *table, const uint8_t *bytes, NSUInteger length)
+{
+    if (length > PDStringTableMaximumLength)
+    {
+        return [[NSString alloc] initWithBytes:bytes length:length encoding:NSUTF8StringEncoding];
+    }
+
+    uint32_t hash = PDStringTableHash(bytes, length);
+    NSString *string = PDStringTableLookup(table, bytes, length, hash);
+
+    if (string)
+    {
+        return string;
+    }
+
+    string = [[NSString alloc] initWithBytes:bytes length:length encoding:NSUTF8StringEncoding];
+    if (string)
+    {
+        PDStringTableAdd(table, bytes, length, hash, string);
+    }
+
+    return string;
+}
+
+NSString *PDStringTableFind(const PDStringTable *table, const uint8_t *bytes, NSUInteger length)
+{
+    if (length > PDStringTableMaximumLength)
+    {
+        return nil;
+    }
+
+    return PDStringTableLookup(table, bytes, length, PDStringTableHash(bytes, length));
+}
@@ -0,0 +1,76 @@
+//
+// PDWriter.h
+//
+// Copyright (c) 2015 Daniel Hall
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+
+#import <Foundation/Foundation.h>
+#import "PDOptions.h"
+
+/** The output formats supported by PDWriter */
+typedef NS_ENUM(NSUInteger, PDWriterFormat)
+{
+    PDWriterFormatJSON,
+    PDWriterFormatXML,
+    /** The debugging format returned by pd_description */
+    PDWriterFormatDescription
+};
+
+/** This class is used internally by PrestoData to serialize dictionaries and arrays in a single pass.  Output is encoded as UTF-8 into a fixed-size buffer, which is flushed to an NSMutableData, an NSOutputStream or a file descriptor whenever it fills up, so no intermediate strings are built for nodes or values */
+
+@interface PDWriter : NSObject
+
+/** Creates a writer that appends its output to the specified data */
+- (instancetype)initWithData:(NSMutableData *)data;
+
+/** Creates a writer that writes its output to the specified stream, which must already be open.  The stream is not closed when writing finishes */
+- (instancetype)initWithStream:(NSOutputStream *)stream;
+
+/** Creates a writer that writes its output to the specified file descriptor, which is not closed when writing finishes */
+- (instancetype)initWithFileDescriptor:(int)fileDescriptor;
+
+/** The format to write.  Defaults to JSON */
+@property (nonatomic, assign) PDWriterFormat format;
+
+/** Options for pretty or compact output */
+@property (nonatomic, assign) PDWritingOptions options;
+
+/** The JSON key that inner values are written under.  Defaults to defaultInnerValueKey */
+@property (nonatomic, copy) NSString *keyForInnerValue;
+
+/** Serializes a PrestoData dictionary or array and flushes all output to the destination
+* @param object The dictionary or array to write
+* @param error If writing fails, set to an error in PrestoDataErrorDomain describing the failure
+* @return YES if all output was written, otherwise NO
+*/
+- (BOOL)writeObject:(id)object error:(NSError **)error;
+
+/** Convenience method that serializes a PrestoData dictionary or array into a new data object
+* @param object The dictionary or array to write
+* @param format The format to write
+* @param options Options for pretty or compact output
+* @param keyForInnerValue The JSON key that inner values are written under
+* @return The UTF-8 encoded output
+*/
++ (NSData *)dataByWritingObject:(id)object format:(PDWriterFormat)format options:(PDWritingOptions)options keyForInnerValue:(NSString *)keyForInnerValue;
+
+@end
@@ -0,0 +1,829 @@
+//
+// PDWriter.m
+//
+// Copyright (c) 2015 Daniel Hall
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+
+#import "PDWriter.h"
+#import "PrestoData.h"
+#import "NSMutableDictionary+_PrestoData_Internal.h"
+#import "NSArray+_PrestoData_Internal.h"
+#import "NSNumber+_PrestoData_Internal.h"
+#import "PDNode+_PrestoData_Internal.h"
+#import "PDStats+_PrestoData_Internal.h"
+#include <errno.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+/** The size of the buffer that output is accumulated in before it is flushed to the destination */
+static const NSUInteger PDWriterBufferLength = 16384;
+
+/** The number of UTF-16 characters copied out of a string at a time while encoding it */
+static const NSUInteger PDWriterCharacterChunkLength = 256;
+
+typedef NS_ENUM(NSUInteger, PDWriterDestination)
+{
+    PDWriterDestinationData,
+    PDWriterDestinationStream,
+    PDWriterDestinationFileDescriptor
+};
+
+typedef NS_ENUM(NSUInteger, PDWriterEscaping)
+{
+    PDWriterEscapingNone,
+    PDWriterEscapingJSON,
+    PDWriterEscapingXMLText,
+    PDWriterEscapingXMLAttribute
+};
+
+
+@interface PDWriter ()
+
+- (void)flush;
+
+@end
+
+
+@implementation PDWriter
+{
+    PDWriterDestination _destination;
+    NSMutableData *_data;
+    NSOutputStream *_stream;
+    int _fileDescriptor;
+    NSMutableData *_bufferStorage;
+    uint8_t *_buffer;
+    NSUInteger _length;
+    uint64_t _flushedLength;
+    BOOL _pretty;
+    NSError *_error;
+}
+
+
+#pragma mark - Buffering
+
+static inline void PDWriterAppendByte(PDWriter *writer, uint8_t byte)
+{
+    if (writer->_length == PDWriterBufferLength)
+    {
+        [writer flush];
+    }
+    writer->_buffer[writer->_length++] = byte;
+}
+
+static void PDWriterAppendBytes(PDWriter *writer, const void *bytes, NSUInteger length)
+{
+    const uint8_t *source = bytes;
+
+    while (length)
+    {
+        if (writer->_length == PDWriterBufferLength)
+        {
+            [writer flush];
+        }
+
+        NSUInteger count = MIN(length, PDWriterBufferLength - writer->_length);
+        memcpy(writer->_buffer + writer->_length, source, count);
+        writer->_length += count;
+        source += count;
+        length -= count;
+    }
+}
+
+static inline void PDWriterAppendLiteral(PDWriter *writer, const char *literal)
+{
+    PDWriterAppendBytes(writer, literal, strlen(literal));
+}
+
+static void PDWriterAppendCodePoint(PDWriter *writer, uint32_t codePoint)
+{
+    uint8_t bytes[4];
+    NSUInteger length;
+
+    if (codePoint < 0x80)
+    {
+        bytes[0] = (uint8_t)codePoint;
+        length = 1;
+    }
+    else if (codePoint < 0x800)
+    {
+        bytes[0] = (uint8_t)(0xC0 | (codePoint >> 6));
+        bytes[1] = (uint8_t)(0x80 | (codePoint & 0x3F));
+        length = 2;
+    }
+    else if (codePoint < 0x10000)
+    {
+        bytes[0] = (uint8_t)(0xE0 | (codePoint >> 12));
+        bytes[1] = (uint8_t)(0x80 | ((codePoint >> 6) & 0x3F));
+        bytes[2] = (uint8_t)(0x80 | (codePoint & 0x3F));
+        length = 3;
+    }
+    else
+    {
+        bytes[0] = (uint8_t)(0xF0 | (codePoint >> 18));
+        bytes[1] = (uint8_t)(0x80 | ((codePoint >> 12) & 0x3F));
+        bytes[2] = (uint8_t)(0x80 | ((codePoint >> 6) & 0x3F));
+        bytes[3] = (uint8_t)(0x80 | (codePoint & 0x3F));
+        length = 4;
+    }
+
+    PDWriterAppendBytes(writer, bytes, length);
+}
+
+static void PDWriterAppendEscapedASCII(PDWriter *writer, uint8_t character, PDWriterEscaping escaping)
+{
+    switch (escaping)
+    {
+        case PDWriterEscapingNone:
+            PDWriterAppendByte(writer, character);
+            return;
+
+        case PDWriterEscapingJSON:
+            switch (character)
+            {
+                case '"':  PDWriterAppendLiteral(writer, "\\\""); return;
+                case '\\': PDWriterAppendLiteral(writer, "\\\\"); return;
+                case '\n': PDWriterAppendLiteral(writer, "\\n"); return;
+                case '\r': PDWriterAppendLiteral(writer, "\\r"); return;
+                case '\t': PDWriterAppendLiteral(writer, "\\t"); return;
+                case '\b': PDWriterAppendLiteral(writer, "\\b"); return;
+                case '\f': PDWriterAppendLiteral(writer, "\\f"); return;
+            }
+
+            if (character < 0x20)
+            {
+                char escape[7];
+                snprintf(escape, sizeof(escape), "\\u%04x", character);
+                PDWriterAppendBytes(writer, escape, 6);
+                return;
+            }
+
+            PDWriterAppendByte(writer, character);
+            return;
+
+        case PDWriterEscapingXMLText:
+        case PDWriterEscapingXMLAttribute:
+            switch (character)
+            {
+                case '&': PDWriterAppendLiteral(writer, "&amp;"); return;
+                case '<': PDWriterAppendLiteral(writer, "&lt;"); return;
+                case '>': PDWriterAppendLiteral(writer, "&gt;"); return;
+            }
+
+            if (escaping == PDWriterEscapingXMLAttribute)
+            {
+                // Line breaks and tabs are escaped in attributes so that attribute value normalization doesn't turn them into spaces
+                switch (character)
+                {
+                    case '"':  PDWriterAppendLiteral(writer, "&quot;"); return;
+                    case '\n': PDWriterAppendLiteral(writer, "&#10;"); return;
+                    case '\r': PDWriterAppendLiteral(writer, "&#13;"); return;
+                    case '\t': PDWriterAppendLiteral(writer, "&#9;"); return;
+                }
+            }
+
+            // Other control characters can't be represented in XML 1.0 at all
+            if (character < 0x20 && character != '\n' && character != '\r' && character != '\t')
+            {
+                return;
+            }
+
+            PDWriterAppendByte(writer, character);
+            return;
+    }
+}
+
+static inline void PDWriterAppendNewline(PDWriter *writer)
+{
+    if (writer->_pretty)
+    {
+        PDWriterAppendByte(writer, '\n');
+    }
+}
+
+static inline void PDWriterAppendIndent(PDWriter *writer, NSUInteger depth)
+{
+    if (writer->_pretty)
+    {
+        for (NSUInteger i = 0; i < depth; i++)
+        {
+            PDWriterAppendByte(writer, '\t');
+        }
+    }
+}
+
+
+#pragma mark - Lifecycle
+
++ (NSData *)dataByWritingObject:(id)object format:(PDWriterFormat)format options:(PDWritingOptions)options keyForInnerValue:(NSString *)keyForInnerValue
+{
+    NSMutableData *data = [NSMutableData data];
+    PDWriter *writer = [[self alloc] initWithData:data];
+    writer.format = format;
+    writer.options = options;
+    writer.keyForInnerValue = keyForInnerValue;
+    [writer writeObject:object error:nil];
+    return data;
+}
+
+- (instancetype)init
+{
+    self = [super init];
+
+    if (self) {
+        _bufferStorage = [NSMutableData dataWithLength:PDWriterBufferLength];
+        _buffer = _bufferStorage.mutableBytes;
+        _keyForInnerValue = defaultInnerValueKey;
+    }
+
+    return self;
+}
+
+- (instancetype)initWithData:(NSMutableData *)data
+{
+    self = [self init];
+
+    if (self) {
+        _destination = PDWriterDestinationData;
+        _data = data;
+    }
+
+    return self;
+}
+
+- (instancetype)initWithStream:(NSOutputStream *)stream
+{
+    self = [self init];
+
+    if (self) {
+        _destination = PDWriterDestinationStream;
+        _stream = stream;
+    }
+
+    return self;
+}
+
+- (instancetype)initWithFileDescriptor:(int)fileDescriptor
+{
+    self = [self init];
+
+    if (self) {
+        _destination = PDWriterDestinationFileDescriptor;
+        _fileDescriptor = fileDescriptor;
+    }
+
+    return self;
+}
+
+- (BOOL)writeObject:(id)object error:(NSError **)error
+{
+    // The description is always written one value per line, since it is meant for reading while debugging
+    _pretty = self.format == PDWriterFormatDescription || !(self.options & PDWritingOptionsCompact);
+    _error = nil;
+    _flushedLength = 0;
+    PDStatsToken token = PDStatsBeginOperation(PDStatsOperationSerialize, nil);
+
+    switch (self.format)
+    {
+        case PDWriterFormatJSON:
+            [self writeJSONValue:object depth:0];
+            break;
+
+        case PDWriterFormatXML:
+            if (self.options & PDWritingOptionsXMLDeclaration)
+            {
+                PDWriterAppendLiteral(self, "<?xml version=\"1.0\" encoding=\"UTF-8\"?>");
+                PDWriterAppendNewline(self);
+            }
+
+            if ([object isKindOfClass:[NSArray class]])
+            {
+                for (NSMutableDictionary *element in object)
+                {
+                    [self writeXMLElement:element name:element.pd_elementName ? : ((NSArray *) object).pd_elementName depth:0];
+                }
+            }
+            else if ([object isKindOfClass:[NSMutableDictionary class]])
+            {
+                [self writeXMLElement:object name:((NSMutableDictionary *) object).pd_elementName depth:0];
+            }
+            break;
+
+        case PDWriterFormatDescription:
+            [self writeDescriptionOfValue:object depth:0];
+            break;
+    }
+
+    [self flush];
+    PDStatsEndOperation(token, nil, _flushedLength);
+
+    if (_error)
+    {
+        if (error)
+        {
+            *error = _error;
+        }
+        return NO;
+    }
+
+    return YES;
+}
+
+- (void)flush
+{
+    if (!_length)
+    {
+        return;
+    }
+
+    // After a failed write the rest of the output is discarded
+    if (_error)
+    {
+        _length = 0;
+        return;
+    }
+
+    NSUInteger written = 0;
+
+    switch (_destination)
+    {
+        case PDWriterDestinationData:
+            [_data appendBytes:_buffer length:_length];
+            break;
+
+        case PDWriterDestinationStream:
+            while (written < _length)
+            {
+                NSInteger result = [_stream write:_buffer + written maxLength:_length - written];
+                if (result <= 0)
+                {
+                    [self failWithUnderlyingError:_stream.streamError];
+                    break;
+                }
+                written += (NSUInteger)result;
+            }
+            break;
+
+        case PDWriterDestinationFileDescriptor:
+            while (written < _length)
+            {
+                ssize_t result = write(_fileDescriptor, _buffer + written, _length - written);
+                if (result < 0)
+                {
+                    if (errno == EINTR)
+                    {
+                        continue;
+                    }
+                    [self failWithUnderlyingError:[NSError errorWithDomain:NSPOSIXErrorDomain code:errno userInfo:nil]];
+                    break;
+                }
+                written += (NSUInteger)result;
+            }
+            break;
+    }
+
+    _flushedLength += _length;
+    _length = 0;
+}
+
+- (void)failWithUnderlyingError:(NSError *)underlyingError
+{
+    NSMutableDictionary *userInfo = [NSMutableDictionary dictionaryWithObject:@"The output could not be written" forKey:NSLocalizedDescriptionKey];
+    if (underlyingError)
+    {
+        userInfo[NSUnderlyingErrorKey] = underlyingError;
+    }
+    _error = [NSError errorWithDomain:PrestoDataErrorDomain code:PrestoDataErrorWriteFailed userInfo:userInfo];
+}
+
+
+#pragma mark - Values
+
+/** Returns the inner value of a dictionary if it is one that gets written, which excludes empty strings */
+- (id)innerValueOfDictionary:(NSMutableDictionary *)dictionary
+{
+    id innerValue = dictionary.pd_innerValue;
+
+    if ([innerValue isKindOfClass:[NSNumber class]] || ([innerValue isKindOfClass:[NSString class]] && ((NSString *) innerValue).length))
+    {
+        return innerValue;
+    }
+
+    return nil;
+}
+
+- (void)writeString:(NSString *)string escaping:(PDWriterEscaping)escaping
+{
+    NSUInteger length = string.length;
+    unichar characters[PDWriterCharacterChunkLength];
+    unichar highSurrogate = 0;
+
+    for (NSUInteger offset = 0; offset < length; offset += PDWriterCharacterChunkLength)
+    {
+        NSUInteger chunkLength = MIN(PDWriterCharacterChunkLength, length - offset);
+        [string getCharacters:characters range:NSMakeRange(offset, chunkLength)];
+
+        for (NSUInteger i = 0; i < chunkLength; i++)
+        {
+            unichar character = characters[i];
+
+            if (highSurrogate)
+            {
+                unichar pendingSurrogate = highSurrogate;
+                highSurrogate = 0;
+
+                if (character >= 0xDC00 && character <= 0xDFFF)
+                {
+                    PDWriterAppendCodePoint(self, 0x10000 + (((uint32_t)pendingSurrogate - 0xD800) << 10) + (character - 0xDC00));
+                    continue;
+                }
+
+                PDWriterAppendCodePoint(self, 0xFFFD);
+            }
+
+            if (character < 0x80)
+            {
+                PDWriterAppendEscapedASCII(self, (uint8_t)character, escaping);
+            }
+            else if (character >= 0xD800 && character <= 0xDBFF)
+            {
+                highSurrogate = character;
+            }
+            else if (character >= 0xDC00 && character <= 0xDFFF)
+            {
+                // An unpaired surrogate can't be encoded as UTF-8, so it is replaced
+                PDWriterAppendCodePoint(self, 0xFFFD);
+            }
+            else
+            {
+                PDWriterAppendCodePoint(self, character);
+            }
+        }
+    }
+
+    if (highSurrogate)
+    {
+        PDWriterAppendCodePoint(self, 0xFFFD);
+    }
+}
+
+- (void)writeNumber:(NSNumber *)number
+{
+    if (number.pd_isBoolean)
+    {
+        PDWriterAppendLiteral(self, number.boolValue ? "true" : "false");
+        return;
+    }
+
+    char buffer[32];
+    size_t length = PDNumberFormat(number, buffer, sizeof(buffer));
+
+    if (!length)
+    {
+        // JSON has no representation for NaN or infinity
+        double value = number.doubleValue;
+        PDWriterAppendLiteral(self, self.format == PDWriterFormatJSON ? "null" : (isnan(value) ? "NaN" : (value < 0 ? "-INF" : "INF")));
+        return;
+    }
+
+    PDWriterAppendBytes(self, buffer, length);
+}
+
+- (void)writeScalar:(id)value escaping:(PDWriterEscaping)escaping
+{
+    if ([value isKindOfClass:[NSNumber class]])
+    {
+        [self writeNumber:value];
+    }
+    else
+    {
+        [self writeString:[value description] escaping:escaping];
+    }
+}
+
+
+#pragma mark - JSON
+
+- (void)writeJSONValue:(id)value depth:(NSUInteger)depth
+{
+    if ([value isKindOfClass:[NSMutableDictionary class]])
+    {
+        [self writeJSONDictionary:value depth:depth];
+    }
+    else if ([value isKindOfClass:[NSArray class]])
+    {
+        [self writeJSONArray:value depth:depth];
+    }
+    else if ([value isKindOfClass:[NSString class]])
+    {
+        PDWriterAppendByte(self, '"');
+        [self writeString:value escaping:PDWriterEscapingJSON];
+        PDWriterAppendByte(self, '"');
+    }
+    else if ([value isKindOfClass:[NSNumber class]])
+    {
+        [self writeNumber:value];
+    }
+    else
+    {
+        PDWriterAppendLiteral(self, "null");
+    }
+}
+
+- (void)writeJSONMemberSeparatorWithDepth:(NSUInteger)depth isFirst:(BOOL *)isFirst
+{
+    if (!*isFirst)
+    {
+        PDWriterAppendByte(self, ',');
+    }
+    *isFirst = NO;
+
+    PDWriterAppendNewline(self);
+    PDWriterAppendIndent(self, depth);
+}
+
+- (void)writeJSONKey:(NSString *)key
+{
+    PDWriterAppendByte(self, '"');
+    [self writeString:key escaping:PDWriterEscapingJSON];
+    PDWriterAppendLiteral(self, _pretty ? "\" : " : "\":");
+}
+
+- (void)writeJSONDictionary:(NSMutableDictionary *)dictionary depth:(NSUInteger)depth
+{
+    // A node that hasn't changed since it was parsed with PDParsingOptionsPreserveSource is copied from its original bytes, without visiting (or loading) anything inside it.  The parser only keeps the bytes of objects that are already written exactly as compact output would write them
+    if (!_pretty && [dictionary isKindOfClass:[PDNode class]])
+    {
+        NSRange range;
+        PDNodeSourceText *source = PDNodeSourceTextOfNode((PDNode *) dictionary, &range);
+        if (source && [source.keyForInnerValue isEqualToString:self.keyForInnerValue])
+        {
+            PDWriterAppendBytes(self, (const uint8_t *) source.data.bytes + range.location, range.length);
+            return;
+        }
+    }
+
+    NSArray *keys = dictionary.pd_orderedKeys;
+    id innerValue = [self innerValueOfDictionary:dictionary];
+
+    // An element with nothing but an inner value is written as that value
+    if (!keys.count && innerValue)
+    {
+        [self writeJSONValue:innerValue depth:depth];
+        return;
+    }
+
+    BOOL isFirst = YES;
+    PDWriterAppendByte(self, '{');
+
+    for (NSString *key in keys)
+    {
+        id value = dictionary[key];
+        if (!value)
+        {
+            continue;
+        }
+
+        [self writeJSONMemberSeparatorWithDepth:depth + 1 isFirst:&isFirst];
+        [self writeJSONKey:key];
+        [self writeJSONValue:value depth:depth + 1];
+    }
+
+    if (innerValue)
+    {
+        [self writeJSONMemberSeparatorWithDepth:depth + 1 isFirst:&isFirst];
+        [self writeJSONKey:self.keyForInnerValue];
+        [self writeJSONValue:innerValue depth:depth + 1];
+    }
+
+    if (!isFirst)
+    {
+        PDWriterAppendNewline(self);
+        PDWriterAppendIndent(self, depth);
+    }
+    PDWriterAppendByte(self, '}');
+}
+
+- (void)writeJSONArray:(NSArray *)array depth:(NSUInteger)depth
+{
+    BOOL isFirst = YES;
+    PDWriterAppendByte(self, '[');
+
+    for (id value in array)
+    {
+        [self writeJSONMemberSeparatorWithDepth:depth + 1 isFirst:&isFirst];
+        [self writeJSONValue:value depth:depth + 1];
+    }
+
+    if (!isFirst)
+    {
+        PDWriterAppendNewline(self);
+        PDWriterAppendIndent(self, depth);
+    }
+    PDWriterAppendByte(self, ']');
+}
+
+
+#pragma mark - XML
+
+- (void)writeXMLElement:(NSMutableDictionary *)element name:(NSString *)name depth:(NSUInteger)depth
+{
+    if (![element isKindOfClass:[NSMutableDictionary class]])
+    {
+        return;
+    }
+
+    NSArray *keys = element.pd_orderedKeys;
+    id innerValue = [self innerValueOfDictionary:element];
+
+    // A dictionary without an element name, such as the root of a parsed XML document, only contributes its contents
+    if (!name)
+    {
+        [self writeXMLChildrenOfElement:element depth:depth];
+        if (innerValue)
+        {
+            PDWriterAppendIndent(self, depth);
+            [self writeScalar:innerValue escaping:PDWriterEscapingXMLText];
+            PDWriterAppendNewline(self);
+        }
+        return;
+    }
+
+    BOOL hasChildren = NO;
+
+    PDWriterAppendIndent(self, depth);
+    PDWriterAppendByte(self, '<');
+    [self writeString:name escaping:PDWriterEscapingNone];
+
+    for (NSString *key in keys)
+    {
+        id value = element[key];
+
+        if ([value isKindOfClass:[NSMutableDictionary class]] || [value isKindOfClass:[NSArray class]])
+        {
+            hasChildren = YES;
+            continue;
+        }
+
+        if ([value isKindOfClass:[NSString class]] || [value isKindOfClass:[NSNumber class]])
+        {
+            PDWriterAppendByte(self, ' ');
+            [self writeString:key escaping:PDWriterEscapingNone];
+            PDWriterAppendLiteral(self, "=\"");
+            [self writeScalar:value escaping:PDWriterEscapingXMLAttribute];
+            PDWriterAppendByte(self, '"');
+        }
+    }
+
+    if (!hasChildren && !innerValue)
+    {
+        PDWriterAppendLiteral(self, "/>");
+        PDWriterAppendNewline(self);
+        return;
+    }
+
+    PDWriterAppendByte(self, '>');
+
+    if (hasChildren)
+    {
+        PDWriterAppendNewline(self);
+        [self writeXMLChildrenOfElement:element depth:depth + 1];
+
+        if (innerValue)
+        {
+            PDWriterAppendIndent(self, depth + 1);
+            [self writeScalar:innerValue escaping:PDWriterEscapingXMLText];
+            PDWriterAppendNewline(self);
+        }
+
+        PDWriterAppendIndent(self, depth);
+    }
+    else
+    {
+        [self writeScalar:innerValue escaping:PDWriterEscapingXMLText];
+    }
+
+    PDWriterAppendLiteral(self, "</");
+    [self writeString:name escaping:PDWriterEscapingNone];
+    PDWriterAppendByte(self, '>');
+    PDWriterAppendNewline(self);
+}
+
+- (void)writeXMLChildrenOfElement:(NSMutableDictionary *)element depth:(NSUInteger)depth
+{
+    for (NSString *key in element.pd_orderedKeys)
+    {
+        id value = element[key];
+
+        if ([value isKindOfClass:[NSMutableDictionary class]])
+        {
+            [self writeXMLElement:value name:key depth:depth];
+        }
+        else if ([value isKindOfClass:[NSArray class]])
+        {
+            for (NSMutableDictionary *child in value)
+            {
+                [self writeXMLElement:child name:key depth:depth];
+            }
+        }
+    }
+}
+
+
+#pragma mark - Description
+
+- (void)writeDescriptionOfValue:(id)value depth:(NSUInteger)depth
+{
+    if ([value isKindOfClass:[NSMutableDictionary class]])
+    {
+        NSMutableDictionary *dictionary = value;
+        PDWriterAppendLiteral(self, "{\n");
+
+        for (NSString *key in dictionary.pd_orderedKeys)
+        {
+            id member = dictionary[key];
+            if (![member isKindOfClass:[NSString class]] && ![member isKindOfClass:[NSNumber class]] && ![member isKindOfClass:[NSMutableDictionary class]] && ![member isKindOfClass:[NSArray class]])
+            {
+                continue;
+            }
+
+            PDWriterAppendIndent(self, depth + 1);
+            [self writeString:key escaping:PDWriterEscapingNone];
+            PDWriterAppendLiteral(self, " = ");
+            [self writeDescriptionOfMember:member depth:depth + 1];
+        }
+
+        id innerValue = [self innerValueOfDictionary:dictionary];
+        if (innerValue)
+        {
+            PDWriterAppendIndent(self, depth + 1);
+            PDWriterAppendLiteral(self, "pd_innerValue = ");
+            [self writeDescriptionOfMember:innerValue depth:depth + 1];
+        }
+
+        PDWriterAppendIndent(self, depth);
+        PDWriterAppendLiteral(self, "}\n");
+    }
+    else if ([value isKindOfClass:[NSArray class]])
+    {
+        PDWriterAppendLiteral(self, "(\n");
+
+        for (NSMutableDictionary *child in value)
+        {
+            PDWriterAppendIndent(self, depth);
+            NSString *elementName = [child isKindOfClass:[NSMutableDictionary class]] ? child.pd_elementName : nil;
+            if (elementName)
+            {
+                PDWriterAppendByte(self, '(');
+                [self writeString:elementName escaping:PDWriterEscapingNone];
+                PDWriterAppendByte(self, ')');
+            }
+            [self writeDescriptionOfValue:child depth:depth];
+        }
+
+        PDWriterAppendIndent(self, depth);
+        PDWriterAppendLiteral(self, ")\n");
+    }
+}
+
+- (void)writeDescriptionOfMember:(id)member depth:(NSUInteger)depth
+{
+    if ([member isKindOfClass:[NSString class]])
+    {
+        PDWriterAppendByte(self, '"');
+        [self writeString:member escaping:PDWriterEscapingNone];
+        PDWriterAppendLiteral(self, "\"\n");
+    }
+    else if ([member isKindOfClass:[NSNumber class]])
+    {
+        [self writeNumber:member];
+        PDWriterAppendByte(self, '\n');
+    }
+    else
+    {
+        [self writeDescriptionOfValue:member depth:depth];
+    }
+}
+
+@end
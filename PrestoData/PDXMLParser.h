@@ -0,0 +1,58 @@
+//
+// PDXMLParser.h
+//
+// Copyright (c) 2015 Daniel Hall
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+
+#import <Foundation/Foundation.h>
+
+@class PDXPathStreamMatcher;
+
+/** This class is used internally by PrestoData to convert XML into PrestoData dictionaries.  The XML is read in chunks by a libxml2 SAX parser, so a stream or file never needs to be held in memory in full.  Element text is collected in a single reused buffer, attributes keep their document order, and repeated element and attribute names share NSString instances */
+
+@interface PDXMLParser : NSObject
+
+/** Creates a parser for the specified XML data
+* @param data An NSData instance that contains an XML document
+* @return A parser ready to parse the data
+*/
+- (instancetype)initWithXMLData:(NSData *)data;
+
+/** Creates a parser that reads XML from a stream
+* @param stream The stream to read from.  It is opened if necessary, and read until it ends.  A stream that the parser opens is also closed by it
+* @return A parser ready to parse the stream
+*/
+- (instancetype)initWithStream:(NSInputStream *)stream;
+
+/** Parses the XML document
+* @return An NSMutableDictionary with the document's root element as its only child, or nil if the XML is malformed, empty or can't be read
+*/
+- (NSMutableDictionary *)parsedDictionary;
+
+/** Parses the XML document, building only the elements that match a query and passing each one to a block as soon as it ends.  Everything else is discarded as it is read
+* @param matcher A matcher for the query, positioned at the start of a document
+* @param block Called with each matching element.  Setting *stop to YES ends parsing
+* @return YES if the whole document was parsed, or parsing was stopped by the block, otherwise NO
+*/
+- (BOOL)enumerateMatchesOfMatcher:(PDXPathStreamMatcher *)matcher usingBlock:(void (^)(NSMutableDictionary *element, BOOL *stop))block;
+
+@end
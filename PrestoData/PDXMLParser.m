@@ -0,0 +1,437 @@
+//
+// PDXMLParser.m
+//
+// Copyright (c) 2015 Daniel Hall
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+
+#import "PDXMLParser.h"
+#import "NSMutableDictionary+PrestoData.h"
+#import "NSMutableDictionary+_PrestoData_Internal.h"
+#import "NSNumber+_PrestoData_Internal.h"
+#import "PDNode.h"
+#import "PDXPathStreamMatcher.h"
+#import "PDStringTable.h"
+#import "PDStats+_PrestoData_Internal.h"
+#include <limits.h>
+#include <string.h>
+#include <libxml/parser.h>
+
+/** The number of bytes read from a stream and handed to libxml2 at a time */
+static const NSUInteger PDXMLReadLength = 65536;
+
+/** The number of element and attribute names remembered.  Must be a power of two, and a macro because it sizes an instance variable array */
+#define PDXMLNameCacheSize 256
+
+
+@interface PDXMLParser ()
+
+- (void)startElement:(const xmlChar *)name attributes:(const xmlChar **)attributes;
+- (void)endElement;
+- (void)appendCharacters:(const xmlChar *)characters length:(int)length;
+
+@end
+
+
+static void PDXMLStartElement(void *context, const xmlChar *name, const xmlChar **attributes)
+{
+    [(__bridge PDXMLParser *)context startElement:name attributes:attributes];
+}
+
+static void PDXMLEndElement(void *context, const xmlChar *name)
+{
+    [(__bridge PDXMLParser *)context endElement];
+}
+
+static void PDXMLCharacters(void *context, const xmlChar *characters, int length)
+{
+    [(__bridge PDXMLParser *)context appendCharacters:characters length:length];
+}
+
+static void PDXMLIgnoreMessage(void *context, const char *message, ...)
+{
+    // Errors are reported through the result of parsing rather than printed by libxml2
+}
+
+static inline BOOL PDXMLIsWhitespace(uint8_t byte)
+{
+    return byte == ' ' || byte == '\n' || byte == '\r' || byte == '\t';
+}
+
+
+@implementation PDXMLParser
+{
+    NSData *_data;
+    NSInputStream *_stream;
+    xmlParserCtxtPtr _context;
+    NSMutableDictionary *_currentElement;
+    NSMutableData *_text;
+    NSUInteger *_textStarts;
+    NSUInteger _textStartsCapacity;
+    NSUInteger _depth;
+    PDXPathStreamMatcher *_matcher;
+    NSMutableDictionary *_outermostMatch;
+    void (^_matchHandler)(NSMutableDictionary *element, BOOL *stop);
+    BOOL _stopped;
+    const xmlChar *_cachedNameKeys[PDXMLNameCacheSize];
+    NSString *_cachedNames[PDXMLNameCacheSize];
+    PDStringTable _names;
+    uint64_t _parsedLength;
+}
+
+- (instancetype)initWithXMLData:(NSData *)data
+{
+    self = [super init];
+
+    if (self) {
+        _data = data;
+    }
+
+    return self;
+}
+
+- (instancetype)initWithStream:(NSInputStream *)stream
+{
+    self = [super init];
+
+    if (self) {
+        _stream = stream;
+    }
+
+    return self;
+}
+
+- (void)dealloc
+{
+    free(_textStarts);
+    PDStringTableDestroy(&_names);
+}
+
+- (NSMutableDictionary *)parsedDictionary
+{
+    if (_data == nil && _stream == nil) {
+        return nil;
+    }
+
+    NSMutableDictionary *root = [PDNode dictionary];
+    return [self parseIntoElement:root] ? root : nil;
+}
+
+- (BOOL)enumerateMatchesOfMatcher:(PDXPathStreamMatcher *)matcher usingBlock:(void (^)(NSMutableDictionary *element, BOOL *stop))block
+{
+    if ((_data == nil && _stream == nil) || matcher == nil || block == nil) {
+        return NO;
+    }
+
+    _matcher = matcher;
+    _matchHandler = block;
+
+    // Without a root element, nothing is built until an element may match, and each match is released once the block returns
+    BOOL success = [self parseIntoElement:nil];
+
+    _matcher = nil;
+    _matchHandler = nil;
+    return success;
+}
+
+- (BOOL)parseIntoElement:(NSMutableDictionary *)root
+{
+    _currentElement = root;
+    _text = [NSMutableData data];
+    _depth = 0;
+    _stopped = NO;
+    _parsedLength = 0;
+    PDStatsToken token = PDStatsBeginOperation(PDStatsOperationParse, nil);
+
+    BOOL success = _data ? [self parseBytes:_data.bytes length:_data.length terminate:YES] : [self parseStream];
+    success = _stopped || (success && _context && _context->wellFormed);
+
+    if (_context)
+    {
+        xmlFreeParserCtxt(_context);
+        _context = NULL;
+    }
+
+    // Cached names are keyed by pointers into the parser's dictionary, which is gone now
+    for (NSUInteger i = 0; i < PDXMLNameCacheSize; i++)
+    {
+        _cachedNameKeys[i] = NULL;
+        _cachedNames[i] = nil;
+    }
+
+    _currentElement = nil;
+    _outermostMatch = nil;
+    _text = nil;
+    PDStatsEndOperation(token, nil, _parsedLength);
+    return success;
+}
+
+
+#pragma mark - Reading
+
+- (BOOL)parseStream
+{
+    BOOL openedStream = NO;
+    if (_stream.streamStatus == NSStreamStatusNotOpen)
+    {
+        [_stream open];
+        openedStream = YES;
+    }
+
+    uint8_t *buffer = malloc(PDXMLReadLength);
+    BOOL success = YES;
+
+    while (success && !_stopped)
+    {
+        NSInteger count = [_stream read:buffer maxLength:PDXMLReadLength];
+
+        if (count < 0)
+        {
+            success = NO;
+        }
+        else if (count == 0)
+        {
+            success = [self parseBytes:NULL length:0 terminate:YES];
+            break;
+        }
+        else
+        {
+            // Anything autoreleased while handling a chunk, including matches passed to a block, is released before the next chunk is read
+            @autoreleasepool {
+                success = [self parseBytes:buffer length:(NSUInteger)count terminate:NO];
+            }
+        }
+    }
+
+    free(buffer);
+
+    if (openedStream)
+    {
+        [_stream close];
+    }
+
+    return success;
+}
+
+- (BOOL)parseBytes:(const void *)bytes length:(NSUInteger)length terminate:(BOOL)terminate
+{
+    const char *cursor = bytes;
+    _parsedLength += length;
+
+    if (_context == NULL)
+    {
+        // Only the startElement, endElement and character callbacks are set, which makes libxml2 report elements the SAX1 way, with qualified names and attributes in document order.  Without entity callbacks, DTD entities are never expanded
+        xmlSAXHandler handler;
+        memset(&handler, 0, sizeof(handler));
+        handler.startElement = PDXMLStartElement;
+        handler.endElement = PDXMLEndElement;
+        handler.characters = PDXMLCharacters;
+        handler.cdataBlock = PDXMLCharacters;
+        handler.warning = PDXMLIgnoreMessage;
+        handler.error = PDXMLIgnoreMessage;
+        handler.fatalError = PDXMLIgnoreMessage;
+
+        // libxml2 detects the document's encoding from its first four bytes, which it wants when the context is created
+        int headerLength = (int)MIN(length, (NSUInteger)4);
+        _context = xmlCreatePushParserCtxt(&handler, (__bridge void *)self, cursor, headerLength, NULL);
+
+        if (_context == NULL)
+        {
+            return NO;
+        }
+
+        xmlCtxtUseOptions(_context, XML_PARSE_NONET);
+        cursor += headerLength;
+        length -= (NSUInteger)headerLength;
+    }
+
+    do
+    {
+        int count = (int)MIN(length, (NSUInteger)(INT_MAX / 2));
+        length -= (NSUInteger)count;
+
+        if (xmlParseChunk(_context, cursor, count, terminate && length == 0) != 0)
+        {
+            return NO;
+        }
+
+        cursor += count;
+    }
+    while (length > 0);
+
+    return YES;
+}
+
+
+#pragma mark - Building
+
+- (NSString *)stringForName:(const xmlChar *)name
+{
+    // libxml2 interns names in the parser's dictionary, so the same name arrives as the same pointer and can be looked up without being decoded again
+    if (xmlDictOwns(_context->dict, name) != 1)
+    {
+        return PDStringTableIntern(&_names, name, strlen((const char *)name));
+    }
+
+    NSUInteger slot = ((uintptr_t)name >> 3) & (PDXMLNameCacheSize - 1);
+
+    if (_cachedNameKeys[slot] != name)
+    {
+        _cachedNameKeys[slot] = name;
+        _cachedNames[slot] = PDStringTableIntern(&_names, name, strlen((const char *)name));
+    }
+
+    return _cachedNames[slot];
+}
+
+- (void)startElement:(const xmlChar *)name attributes:(const xmlChar **)attributes
+{
+    NSString *elementName = [self stringForName:name];
+
+    // Nested elements share the text buffer.  Each element's text starts where the buffer ended when the element began, and is cut off again when it ends, leaving the parent's own text in place
+    if (_depth == _textStartsCapacity)
+    {
+        _textStartsCapacity = MAX(_textStartsCapacity * 2, (NSUInteger)32);
+        _textStarts = realloc(_textStarts, _textStartsCapacity * sizeof(NSUInteger));
+    }
+    _textStarts[_depth++] = _text.length;
+
+    if (_matcher)
+    {
+        [_matcher enterElementNamed:elementName];
+
+        // Outside of a possible match there is no element to build; the matcher alone follows the document
+        if (!_currentElement && !_matcher.currentElementMayMatch)
+        {
+            return;
+        }
+    }
+
+    PDNode *element = [[PDNode alloc] init];
+
+    for (const xmlChar **attribute = attributes; attribute && attribute[0]; attribute += 2)
+    {
+        if (attribute[1] && attribute[1][0])
+        {
+            [element pd_setValue:[[NSString alloc] initWithUTF8String:(const char *)attribute[1]] forAttribute:[self stringForName:attribute[0]]];
+        }
+    }
+
+    if (_currentElement)
+    {
+        [_currentElement pd_addElement:element withName:elementName];
+    }
+    else
+    {
+        // Elements only hold their parents weakly, so the outermost element being built is kept here
+        element.pd_elementName = elementName;
+        _outermostMatch = element;
+    }
+    _currentElement = element;
+}
+
+- (void)endElement
+{
+    if (_depth == 0)
+    {
+        return;
+    }
+
+    NSUInteger start = _textStarts[--_depth];
+
+    if (!_currentElement)
+    {
+        [_matcher exitElement];
+        return;
+    }
+
+    const uint8_t *bytes = (const uint8_t *)_text.bytes + start;
+    NSUInteger length = _text.length - start;
+
+    while (length && PDXMLIsWhitespace(bytes[0]))
+    {
+        bytes++;
+        length--;
+    }
+
+    while (length && PDXMLIsWhitespace(bytes[length - 1]))
+    {
+        length--;
+    }
+
+    if (length)
+    {
+        id value = [NSNumber pd_numberFromDecimalBytes:bytes length:length];
+
+        if (!value)
+        {
+            NSString *string = [[NSString alloc] initWithBytes:bytes length:length encoding:NSUTF8StringEncoding];
+
+            // Non-ASCII whitespace, such as a no-break space, is rare enough to trim only when the text begins or ends with a multibyte character
+            if (bytes[0] >= 0x80 || bytes[length - 1] >= 0x80)
+            {
+                string = [string stringByTrimmingCharactersInSet:[NSCharacterSet whitespaceAndNewlineCharacterSet]];
+            }
+
+            value = string.length ? string : nil;
+        }
+
+        _currentElement.pd_innerValue = value;
+    }
+
+    _text.length = start;
+
+    NSMutableDictionary *parent = _currentElement.pd_parentDictionary;
+
+    if (_matcher)
+    {
+        if (!_stopped && [_matcher currentElementMatches:_currentElement])
+        {
+            _matchHandler(_currentElement, &_stopped);
+            if (_stopped)
+            {
+                xmlStopParser(_context);
+            }
+        }
+        [_matcher exitElement];
+
+        // A match that isn't inside another match has no parent, and is released along with its contents
+        _currentElement = parent;
+        if (!parent)
+        {
+            _outermostMatch = nil;
+        }
+        return;
+    }
+
+    _currentElement = parent ? : _currentElement;
+}
+
+- (void)appendCharacters:(const xmlChar *)characters length:(int)length
+{
+    // Whitespace between top-level nodes belongs to no element, and text outside of a match is not kept
+    if (_currentElement && _depth > 0 && length > 0)
+    {
+        [_text appendBytes:characters length:(NSUInteger)length];
+    }
+}
+
+@end
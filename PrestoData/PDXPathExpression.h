@@ -0,0 +1,82 @@
+//
+// PDXPathExpression.h
+//
+// Copyright (c) 2015 Daniel Hall
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+
+#import <Foundation/Foundation.h>
+
+/** The context a predicate expression is evaluated in: the element being tested, its 1-based position among the elements being filtered, and the number of elements being filtered */
+typedef struct
+{
+    __unsafe_unretained NSMutableDictionary *node;
+    NSUInteger position;
+    NSUInteger last;
+} PDXPathContext;
+
+/** The XPath 1.0 type an expression evaluates to */
+typedef NS_ENUM(NSUInteger, PDXPathExpressionType)
+{
+    PDXPathExpressionTypeNumber,
+    PDXPathExpressionTypeString,
+    PDXPathExpressionTypeBoolean,
+    PDXPathExpressionTypeNodeSet
+};
+
+/** This class is used internally by PrestoData to evaluate the expressions inside XPath predicates.  An expression is parsed once, when its query is compiled, and then compares numbers and strings taken from the document directly, so document values are never formatted into NSPredicate strings.
+*
+* Supported: numbers, quoted strings, @attribute and child element name tests (with * and ? wildcards), position(), last(), + - * div mod, unary minus, = != < <= > >=, and, or, and parentheses.
+*/
+
+@interface PDXPathExpression : NSObject
+
+/** Parses the contents of a predicate (without the enclosing brackets)
+* @param string The predicate expression
+* @return The parsed expression, or nil if the expression is malformed or uses unsupported syntax
+*/
++ (instancetype)expressionWithString:(NSString *)string;
+
+/** The type this expression evaluates to.  A predicate whose expression is a number selects the element at that position */
+@property (nonatomic, readonly) PDXPathExpressionType type;
+
+/** YES if evaluating the expression reads attributes or child elements of the context element */
+@property (nonatomic, readonly) BOOL dependsOnNode;
+
+/** YES if evaluating the expression uses position() */
+@property (nonatomic, readonly) BOOL dependsOnPosition;
+
+/** YES if evaluating the expression uses last() */
+@property (nonatomic, readonly) BOOL dependsOnSize;
+
+/** Evaluates the expression and converts the result to a number, following XPath 1.0 conversion rules
+* @param context The element, position and size of the set being filtered
+* @return The numeric value, or NaN if the value is not a number
+*/
+- (double)numberValueInContext:(const PDXPathContext *)context;
+
+/** Evaluates the expression and converts the result to a boolean, following XPath 1.0 conversion rules
+* @param context The element, position and size of the set being filtered
+* @return The boolean value
+*/
+- (BOOL)booleanValueInContext:(const PDXPathContext *)context;
+
+@end
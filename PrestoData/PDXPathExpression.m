@@ -0,0 +1,844 @@
+//
+// PDXPathExpression.m
+//
+// Copyright (c) 2015 Daniel Hall
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+
+#import "PDXPathExpression.h"
+#import "PDNameMatcher.h"
+#import "NSMutableDictionary+PrestoData.h"
+#import "NSNumber+_PrestoData_Internal.h"
+#include <math.h>
+#include <string.h>
+
+
+typedef NS_ENUM(NSUInteger, PDXPathExpressionKind)
+{
+    PDXPathExpressionKindNumber,
+    PDXPathExpressionKindString,
+    PDXPathExpressionKindPosition,
+    PDXPathExpressionKindLast,
+    PDXPathExpressionKindAttribute,
+    PDXPathExpressionKindChild,
+    PDXPathExpressionKindNegate,
+    PDXPathExpressionKindArithmetic,
+    PDXPathExpressionKindComparison,
+    PDXPathExpressionKindAnd,
+    PDXPathExpressionKindOr
+};
+
+typedef NS_ENUM(NSUInteger, PDXPathOperator)
+{
+    PDXPathOperatorAdd,
+    PDXPathOperatorSubtract,
+    PDXPathOperatorMultiply,
+    PDXPathOperatorDivide,
+    PDXPathOperatorModulo,
+    PDXPathOperatorEqual,
+    PDXPathOperatorNotEqual,
+    PDXPathOperatorLessThan,
+    PDXPathOperatorLessThanOrEqual,
+    PDXPathOperatorGreaterThan,
+    PDXPathOperatorGreaterThanOrEqual
+};
+
+
+static BOOL PDXPathIsWhitespace(uint8_t byte)
+{
+    return byte == ' ' || byte == '\t' || byte == '\n' || byte == '\r';
+}
+
+/** Converts a string to a number the way the XPath number() function does: optional whitespace, an optional minus sign, and digits with an optional decimal point.  Anything else is NaN.  The conversion never depends on the current locale */
+static double PDXPathNumberFromString(NSString *string)
+{
+    const uint8_t *bytes = (const uint8_t *)string.UTF8String;
+    NSUInteger start = 0;
+    NSUInteger end = bytes ? strlen((const char *)bytes) : 0;
+
+    while (start < end && PDXPathIsWhitespace(bytes[start]))
+    {
+        start++;
+    }
+    while (end > start && PDXPathIsWhitespace(bytes[end - 1]))
+    {
+        end--;
+    }
+
+    BOOL negative = start < end && bytes[start] == '-';
+    if (negative)
+    {
+        start++;
+    }
+
+    // XPath's grammar is narrower than the JSON number grammar the conversion accepts: no plus sign and no exponent
+    BOOL sawDigit = NO;
+    BOOL sawPoint = NO;
+    for (NSUInteger i = start; i < end; i++)
+    {
+        if (bytes[i] == '.' && !sawPoint)
+        {
+            sawPoint = YES;
+        }
+        else if (bytes[i] >= '0' && bytes[i] <= '9')
+        {
+            sawDigit = YES;
+        }
+        else
+        {
+            return NAN;
+        }
+    }
+
+    if (!sawDigit)
+    {
+        return NAN;
+    }
+
+    double value = [NSNumber pd_numberFromDecimalBytes:bytes + start length:end - start].doubleValue;
+    return negative ? -value : value;
+}
+
+static double PDXPathNumberFromValue(id value)
+{
+    if ([value isKindOfClass:[NSNumber class]])
+    {
+        return [value doubleValue];
+    }
+
+    if ([value isKindOfClass:[NSString class]])
+    {
+        return PDXPathNumberFromString(value);
+    }
+
+    return NAN;
+}
+
+static BOOL PDXPathOrderingSatisfiesOperator(NSComparisonResult ordering, PDXPathOperator operator)
+{
+    switch (operator)
+    {
+        case PDXPathOperatorLessThan:
+            return ordering == NSOrderedAscending;
+        case PDXPathOperatorLessThanOrEqual:
+            return ordering != NSOrderedDescending;
+        case PDXPathOperatorGreaterThan:
+            return ordering == NSOrderedDescending;
+        case PDXPathOperatorGreaterThanOrEqual:
+            return ordering != NSOrderedAscending;
+        default:
+            return NO;
+    }
+}
+
+/** Compares two atomic values (NSNumber or NSString).  Equality compares numerically when either side is a number and as strings otherwise.  Ordering compares numerically, except that two strings which are not both numeric are ordered as strings */
+static BOOL PDXPathCompareValues(id left, id right, PDXPathOperator operator)
+{
+    BOOL leftIsNumber = [left isKindOfClass:[NSNumber class]];
+    BOOL rightIsNumber = [right isKindOfClass:[NSNumber class]];
+
+    if ((!leftIsNumber && ![left isKindOfClass:[NSString class]]) || (!rightIsNumber && ![right isKindOfClass:[NSString class]]))
+    {
+        return NO;
+    }
+
+    if (operator == PDXPathOperatorEqual || operator == PDXPathOperatorNotEqual)
+    {
+        if (leftIsNumber || rightIsNumber)
+        {
+            double leftNumber = PDXPathNumberFromValue(left);
+            double rightNumber = PDXPathNumberFromValue(right);
+            // NaN is unequal to everything, including itself
+            return operator == PDXPathOperatorEqual ? leftNumber == rightNumber : leftNumber != rightNumber;
+        }
+
+        BOOL equal = [left isEqualToString:right];
+        return operator == PDXPathOperatorEqual ? equal : !equal;
+    }
+
+    double leftNumber = PDXPathNumberFromValue(left);
+    double rightNumber = PDXPathNumberFromValue(right);
+
+    if (!leftIsNumber && !rightIsNumber && (isnan(leftNumber) || isnan(rightNumber)))
+    {
+        return PDXPathOrderingSatisfiesOperator([left compare:right], operator);
+    }
+
+    switch (operator)
+    {
+        case PDXPathOperatorLessThan:
+            return leftNumber < rightNumber;
+        case PDXPathOperatorLessThanOrEqual:
+            return leftNumber <= rightNumber;
+        case PDXPathOperatorGreaterThan:
+            return leftNumber > rightNumber;
+        case PDXPathOperatorGreaterThanOrEqual:
+            return leftNumber >= rightNumber;
+        default:
+            return NO;
+    }
+}
+
+
+@interface PDXPathExpression ()
+{
+    @public
+    PDXPathExpressionKind _kind;
+    PDXPathOperator _operator;
+    PDXPathExpression *_left;
+    PDXPathExpression *_right;
+    double _number;
+    NSString *_string;
+    PDNameMatcher *_matcher;
+    id _constantValue;
+}
+
+- (instancetype)initWithKind:(PDXPathExpressionKind)kind;
+- (instancetype)initWithKind:(PDXPathExpressionKind)kind operator:(PDXPathOperator)operator left:(PDXPathExpression *)left right:(PDXPathExpression *)right;
+
+@end
+
+
+/** A recursive descent parser for predicate expressions, following the XPath 1.0 grammar from OrExpr down to PrimaryExpr */
+
+@interface PDXPathExpressionParser : NSObject
+
+- (instancetype)initWithString:(NSString *)string;
+- (PDXPathExpression *)parse;
+
+@end
+
+
+@implementation PDXPathExpressionParser
+{
+    NSString *_string;
+    NSMutableData *_buffer;
+    const unichar *_characters;
+    NSUInteger _length;
+    NSUInteger _index;
+}
+
+- (instancetype)initWithString:(NSString *)string
+{
+    self = [super init];
+
+    if (self) {
+        _string = [string copy];
+        _length = _string.length;
+        _buffer = [NSMutableData dataWithLength:(_length + 1) * sizeof(unichar)];
+        [_string getCharacters:_buffer.mutableBytes range:NSMakeRange(0, _length)];
+        _characters = _buffer.bytes;
+    }
+
+    return self;
+}
+
+- (PDXPathExpression *)parse
+{
+    PDXPathExpression *expression = [self parseOr];
+    [self skipWhitespace];
+    return _index == _length ? expression : nil;
+}
+
+- (PDXPathExpression *)parseOr
+{
+    PDXPathExpression *left = [self parseAnd];
+
+    while (left && [self consumeKeyword:@"or"])
+    {
+        PDXPathExpression *right = [self parseAnd];
+        left = right ? [[PDXPathExpression alloc] initWithKind:PDXPathExpressionKindOr operator:0 left:left right:right] : nil;
+    }
+
+    return left;
+}
+
+- (PDXPathExpression *)parseAnd
+{
+    PDXPathExpression *left = [self parseComparison];
+
+    while (left && [self consumeKeyword:@"and"])
+    {
+        PDXPathExpression *right = [self parseComparison];
+        left = right ? [[PDXPathExpression alloc] initWithKind:PDXPathExpressionKindAnd operator:0 left:left right:right] : nil;
+    }
+
+    return left;
+}
+
+- (PDXPathExpression *)parseComparison
+{
+    PDXPathExpression *left = [self parseAdditive];
+    PDXPathOperator operator;
+
+    while (left && [self consumeComparisonOperator:&operator])
+    {
+        PDXPathExpression *right = [self parseAdditive];
+        left = right ? [[PDXPathExpression alloc] initWithKind:PDXPathExpressionKindComparison operator:operator left:left right:right] : nil;
+    }
+
+    return left;
+}
+
+- (PDXPathExpression *)parseAdditive
+{
+    PDXPathExpression *left = [self parseMultiplicative];
+
+    while (left)
+    {
+        [self skipWhitespace];
+        PDXPathOperator operator;
+
+        if ([self consumeCharacter:'+'])
+        {
+            operator = PDXPathOperatorAdd;
+        }
+        else if ([self consumeCharacter:'-'])
+        {
+            operator = PDXPathOperatorSubtract;
+        }
+        else
+        {
+            break;
+        }
+
+        PDXPathExpression *right = [self parseMultiplicative];
+        left = right ? [[PDXPathExpression alloc] initWithKind:PDXPathExpressionKindArithmetic operator:operator left:left right:right] : nil;
+    }
+
+    return left;
+}
+
+- (PDXPathExpression *)parseMultiplicative
+{
+    PDXPathExpression *left = [self parseUnary];
+
+    while (left)
+    {
+        [self skipWhitespace];
+        PDXPathOperator operator;
+
+        // In operator position * always means multiplication, never a wildcard name
+        if ([self consumeCharacter:'*'])
+        {
+            operator = PDXPathOperatorMultiply;
+        }
+        else if ([self consumeCharacter:'/'] || [self consumeKeyword:@"div"])
+        {
+            operator = PDXPathOperatorDivide;
+        }
+        else if ([self consumeKeyword:@"mod"])
+        {
+            operator = PDXPathOperatorModulo;
+        }
+        else
+        {
+            break;
+        }
+
+        PDXPathExpression *right = [self parseUnary];
+        left = right ? [[PDXPathExpression alloc] initWithKind:PDXPathExpressionKindArithmetic operator:operator left:left right:right] : nil;
+    }
+
+    return left;
+}
+
+- (PDXPathExpression *)parseUnary
+{
+    [self skipWhitespace];
+
+    if ([self consumeCharacter:'-'])
+    {
+        PDXPathExpression *operand = [self parseUnary];
+        return operand ? [[PDXPathExpression alloc] initWithKind:PDXPathExpressionKindNegate operator:0 left:operand right:nil] : nil;
+    }
+
+    return [self parsePrimary];
+}
+
+- (PDXPathExpression *)parsePrimary
+{
+    [self skipWhitespace];
+
+    if (_index >= _length)
+    {
+        return nil;
+    }
+
+    unichar character = _characters[_index];
+
+    if (character == '(')
+    {
+        _index++;
+        PDXPathExpression *expression = [self parseOr];
+        [self skipWhitespace];
+        return expression && [self consumeCharacter:')'] ? expression : nil;
+    }
+
+    if (character == '\'' || character == '"')
+    {
+        NSUInteger start = ++_index;
+        while (_index < _length && _characters[_index] != character)
+        {
+            _index++;
+        }
+
+        if (_index >= _length)
+        {
+            return nil;
+        }
+
+        PDXPathExpression *expression = [[PDXPathExpression alloc] initWithKind:PDXPathExpressionKindString];
+        expression->_string = [_string substringWithRange:NSMakeRange(start, _index - start)];
+        expression->_constantValue = expression->_string;
+        _index++;
+        return expression;
+    }
+
+    if ([self isDigit:character] || (character == '.' && _index + 1 < _length && [self isDigit:_characters[_index + 1]]))
+    {
+        NSUInteger start = _index;
+        while (_index < _length && [self isDigit:_characters[_index]])
+        {
+            _index++;
+        }
+        if (_index < _length && _characters[_index] == '.')
+        {
+            _index++;
+            while (_index < _length && [self isDigit:_characters[_index]])
+            {
+                _index++;
+            }
+        }
+
+        PDXPathExpression *expression = [[PDXPathExpression alloc] initWithKind:PDXPathExpressionKindNumber];
+        expression->_number = PDXPathNumberFromString([_string substringWithRange:NSMakeRange(start, _index - start)]);
+        expression->_constantValue = @(expression->_number);
+        return expression;
+    }
+
+    if (character == '@')
+    {
+        _index++;
+        NSString *name = [self parseName];
+        if (!name)
+        {
+            return nil;
+        }
+
+        PDXPathExpression *expression = [[PDXPathExpression alloc] initWithKind:PDXPathExpressionKindAttribute];
+        expression->_matcher = [PDNameMatcher matcherWithPattern:name];
+        return expression;
+    }
+
+    NSString *name = [self parseName];
+    if (!name)
+    {
+        return nil;
+    }
+
+    [self skipWhitespace];
+
+    if ([self consumeCharacter:'('])
+    {
+        [self skipWhitespace];
+        if (![self consumeCharacter:')'])
+        {
+            return nil;
+        }
+
+        if ([name isEqualToString:@"position"])
+        {
+            return [[PDXPathExpression alloc] initWithKind:PDXPathExpressionKindPosition];
+        }
+        if ([name isEqualToString:@"last"])
+        {
+            return [[PDXPathExpression alloc] initWithKind:PDXPathExpressionKindLast];
+        }
+
+        // Other XPath functions are not supported
+        return nil;
+    }
+
+    PDXPathExpression *expression = [[PDXPathExpression alloc] initWithKind:PDXPathExpressionKindChild];
+    expression->_matcher = [PDNameMatcher matcherWithPattern:name];
+    return expression;
+}
+
+- (NSString *)parseName
+{
+    NSUInteger start = _index;
+
+    if (_index < _length && [self isNameStartCharacter:_characters[_index]])
+    {
+        _index++;
+        while (_index < _length && [self isNameCharacter:_characters[_index]])
+        {
+            _index++;
+        }
+    }
+
+    return _index > start ? [_string substringWithRange:NSMakeRange(start, _index - start)] : nil;
+}
+
+- (BOOL)consumeComparisonOperator:(PDXPathOperator *)operator
+{
+    [self skipWhitespace];
+
+    if ([self consumeCharacter:'='])
+    {
+        *operator = PDXPathOperatorEqual;
+    }
+    else if ([self consumeCharacter:'!'])
+    {
+        if (![self consumeCharacter:'='])
+        {
+            _index--;
+            return NO;
+        }
+        *operator = PDXPathOperatorNotEqual;
+    }
+    else if ([self consumeCharacter:'<'])
+    {
+        *operator = [self consumeCharacter:'='] ? PDXPathOperatorLessThanOrEqual : PDXPathOperatorLessThan;
+    }
+    else if ([self consumeCharacter:'>'])
+    {
+        *operator = [self consumeCharacter:'='] ? PDXPathOperatorGreaterThanOrEqual : PDXPathOperatorGreaterThan;
+    }
+    else
+    {
+        return NO;
+    }
+
+    return YES;
+}
+
+- (BOOL)consumeKeyword:(NSString *)keyword
+{
+    [self skipWhitespace];
+
+    NSUInteger keywordLength = keyword.length;
+    if (_index + keywordLength > _length)
+    {
+        return NO;
+    }
+
+    for (NSUInteger i = 0; i < keywordLength; i++)
+    {
+        if (_characters[_index + i] != [keyword characterAtIndex:i])
+        {
+            return NO;
+        }
+    }
+
+    // Operator names are only keywords when they stand alone, so an element named "order" is not "or" followed by "der"
+    if (_index + keywordLength < _length && [self isNameCharacter:_characters[_index + keywordLength]])
+    {
+        return NO;
+    }
+
+    _index += keywordLength;
+    return YES;
+}
+
+- (BOOL)consumeCharacter:(unichar)character
+{
+    if (_index < _length && _characters[_index] == character)
+    {
+        _index++;
+        return YES;
+    }
+
+    return NO;
+}
+
+- (void)skipWhitespace
+{
+    while (_index < _length && (_characters[_index] == ' ' || _characters[_index] == '\t' || _characters[_index] == '\n' || _characters[_index] == '\r'))
+    {
+        _index++;
+    }
+}
+
+- (BOOL)isDigit:(unichar)character
+{
+    return character >= '0' && character <= '9';
+}
+
+- (BOOL)isNameStartCharacter:(unichar)character
+{
+    return (character >= 'a' && character <= 'z') || (character >= 'A' && character <= 'Z') || character == '_' || character == '*' || character == '?' || (character > 0x7F && [[NSCharacterSet letterCharacterSet] characterIsMember:character]);
+}
+
+- (BOOL)isNameCharacter:(unichar)character
+{
+    return [self isNameStartCharacter:character] || [self isDigit:character] || character == '-' || character == '.' || character == ':';
+}
+
+@end
+
+
+@implementation PDXPathExpression
+
++ (instancetype)expressionWithString:(NSString *)string
+{
+    if (!string.length)
+    {
+        return nil;
+    }
+
+    return [[[PDXPathExpressionParser alloc] initWithString:string] parse];
+}
+
+- (instancetype)initWithKind:(PDXPathExpressionKind)kind
+{
+    return [self initWithKind:kind operator:0 left:nil right:nil];
+}
+
+- (instancetype)initWithKind:(PDXPathExpressionKind)kind operator:(PDXPathOperator)operator left:(PDXPathExpression *)left right:(PDXPathExpression *)right
+{
+    self = [super init];
+
+    if (self) {
+        _kind = kind;
+        _operator = operator;
+        _left = left;
+        _right = right;
+
+        switch (kind)
+        {
+            case PDXPathExpressionKindString:
+                _type = PDXPathExpressionTypeString;
+                break;
+            case PDXPathExpressionKindAttribute:
+            case PDXPathExpressionKindChild:
+                _type = PDXPathExpressionTypeNodeSet;
+                _dependsOnNode = YES;
+                break;
+            case PDXPathExpressionKindComparison:
+            case PDXPathExpressionKindAnd:
+            case PDXPathExpressionKindOr:
+                _type = PDXPathExpressionTypeBoolean;
+                break;
+            default:
+                _type = PDXPathExpressionTypeNumber;
+                break;
+        }
+
+        _dependsOnPosition = kind == PDXPathExpressionKindPosition || left.dependsOnPosition || right.dependsOnPosition;
+        _dependsOnSize = kind == PDXPathExpressionKindLast || left.dependsOnSize || right.dependsOnSize;
+        _dependsOnNode = _dependsOnNode || left.dependsOnNode || right.dependsOnNode;
+    }
+
+    return self;
+}
+
+
+#pragma mark - Evaluating
+
+- (double)numberValueInContext:(const PDXPathContext *)context
+{
+    switch (_kind)
+    {
+        case PDXPathExpressionKindNumber:
+            return _number;
+        case PDXPathExpressionKindString:
+            return PDXPathNumberFromString(_string);
+        case PDXPathExpressionKindPosition:
+            return context->position;
+        case PDXPathExpressionKindLast:
+            return context->last;
+        case PDXPathExpressionKindNegate:
+            return -[_left numberValueInContext:context];
+        case PDXPathExpressionKindArithmetic:
+        {
+            double left = [_left numberValueInContext:context];
+            double right = [_right numberValueInContext:context];
+
+            switch (_operator)
+            {
+                case PDXPathOperatorAdd:
+                    return left + right;
+                case PDXPathOperatorSubtract:
+                    return left - right;
+                case PDXPathOperatorMultiply:
+                    return left * right;
+                case PDXPathOperatorDivide:
+                    return left / right;
+                case PDXPathOperatorModulo:
+                    return fmod(left, right);
+                default:
+                    return NAN;
+            }
+        }
+        case PDXPathExpressionKindAttribute:
+        case PDXPathExpressionKindChild:
+        {
+            // A node-set converts to the number value of its first node
+            __block double number = NAN;
+            [self enumerateValuesInContext:context usingBlock:^BOOL(id value) {
+                number = PDXPathNumberFromValue(value);
+                return YES;
+            }];
+            return number;
+        }
+        default:
+            return [self booleanValueInContext:context] ? 1 : 0;
+    }
+}
+
+- (BOOL)booleanValueInContext:(const PDXPathContext *)context
+{
+    switch (_kind)
+    {
+        case PDXPathExpressionKindComparison:
+            return [self compareInContext:context];
+        case PDXPathExpressionKindAnd:
+            return [_left booleanValueInContext:context] && [_right booleanValueInContext:context];
+        case PDXPathExpressionKindOr:
+            return [_left booleanValueInContext:context] || [_right booleanValueInContext:context];
+        case PDXPathExpressionKindString:
+            return _string.length > 0;
+        case PDXPathExpressionKindAttribute:
+        case PDXPathExpressionKindChild:
+            return [self containsNodesInContext:context];
+        default:
+        {
+            double number = [self numberValueInContext:context];
+            return number != 0 && !isnan(number);
+        }
+    }
+}
+
+- (id)atomicValueInContext:(const PDXPathContext *)context
+{
+    if (_constantValue)
+    {
+        return _constantValue;
+    }
+
+    switch (_type)
+    {
+        case PDXPathExpressionTypeBoolean:
+            return @([self booleanValueInContext:context]);
+        default:
+            return @([self numberValueInContext:context]);
+    }
+}
+
+- (BOOL)compareInContext:(const PDXPathContext *)context
+{
+    PDXPathExpression *left = _left;
+    PDXPathExpression *right = _right;
+    PDXPathOperator operator = _operator;
+
+    // A comparison involving a node-set is true if any value in the node-set satisfies it
+    if (left.type == PDXPathExpressionTypeNodeSet && right.type == PDXPathExpressionTypeNodeSet)
+    {
+        return [left enumerateValuesInContext:context usingBlock:^BOOL(id leftValue) {
+            return [right enumerateValuesInContext:context usingBlock:^BOOL(id rightValue) {
+                return PDXPathCompareValues(leftValue, rightValue, operator);
+            }];
+        }];
+    }
+
+    if (left.type == PDXPathExpressionTypeNodeSet)
+    {
+        id rightValue = [right atomicValueInContext:context];
+        return [left enumerateValuesInContext:context usingBlock:^BOOL(id leftValue) {
+            return PDXPathCompareValues(leftValue, rightValue, operator);
+        }];
+    }
+
+    if (right.type == PDXPathExpressionTypeNodeSet)
+    {
+        id leftValue = [left atomicValueInContext:context];
+        return [right enumerateValuesInContext:context usingBlock:^BOOL(id rightValue) {
+            return PDXPathCompareValues(leftValue, rightValue, operator);
+        }];
+    }
+
+    return PDXPathCompareValues([left atomicValueInContext:context], [right atomicValueInContext:context], operator);
+}
+
+- (BOOL)containsNodesInContext:(const PDXPathContext *)context
+{
+    NSMutableDictionary *node = context->node;
+
+    for (NSString *key in node.pd_orderedKeys)
+    {
+        if (![_matcher matchesName:key])
+        {
+            continue;
+        }
+
+        BOOL isElement = [node[key] isKindOfClass:[NSMutableDictionary class]] || [node[key] isKindOfClass:[NSArray class]];
+        if (isElement == (_kind == PDXPathExpressionKindChild))
+        {
+            return YES;
+        }
+    }
+
+    return NO;
+}
+
+/** Calls the block with each attribute value, or the inner value of each child element, selected by this node-set expression until the block returns YES
+* @return YES if the block returned YES
+*/
+- (BOOL)enumerateValuesInContext:(const PDXPathContext *)context usingBlock:(BOOL (^)(id value))block
+{
+    NSMutableDictionary *node = context->node;
+
+    for (NSString *key in node.pd_orderedKeys)
+    {
+        if (![_matcher matchesName:key])
+        {
+            continue;
+        }
+
+        id value = node[key];
+
+        if (_kind == PDXPathExpressionKindAttribute)
+        {
+            if (![value isKindOfClass:[NSMutableDictionary class]] && ![value isKindOfClass:[NSArray class]] && block(value))
+            {
+                return YES;
+            }
+            continue;
+        }
+
+        NSArray *children = [value isKindOfClass:[NSArray class]] ? value : ([value isKindOfClass:[NSMutableDictionary class]] ? @[value] : nil);
+
+        for (NSMutableDictionary *child in children)
+        {
+            id innerValue = child.pd_innerValue;
+            if (innerValue && block(innerValue))
+            {
+                return YES;
+            }
+        }
+    }
+
+    return NO;
+}
+
+@end
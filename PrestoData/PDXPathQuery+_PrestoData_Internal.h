@@ -0,0 +1,59 @@
+//
+// PDXPathQuery+_PrestoData_Internal.h
+//
+// Copyright (c) 2015 Daniel Hall
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+
+#import "PDXPathQuery.h"
+
+/** This category is used internally by PrestoData for evaluating compiled queries while a document is being parsed, and for evaluating a query a few location steps at a time so that queries with a common beginning can share work */
+
+@interface PDXPathQuery (_PrestoData_Internal)
+
+/** Describes the query as a chain of name tests that can be matched against elements as they are parsed, without a tree to navigate
+* @param matchers Set to an array with the PDNameMatcher of each location step
+* @param descendantSteps Set to the indexes of the steps that use the descendant (//) axis
+* @param predicates Set to an array of the PDXPathExpressions in the final step's predicates
+* @return NO if evaluating the query needs the whole document: parenthesized groups, predicates before the final step, and positional predicates such as [2], [last()] or [position() < 3]
+*/
+- (BOOL)pd_getStreamingMatchers:(NSArray **)matchers descendantSteps:(NSIndexSet **)descendantSteps predicates:(NSArray **)predicates;
+
+/** The number of location steps in the query, counting a parenthesized group as one step */
+@property (nonatomic, readonly) NSUInteger pd_stepCount;
+
+/** The number of location steps at the start of the query that are plain / or // name tests without predicates.  What those steps select depends only on which elements a document contains, never on attribute values */
+@property (nonatomic, readonly) NSUInteger pd_nameStepCount;
+
+/** Returns a string identifying the first name steps of the query, which is equal for any two queries whose first steps select the same elements
+* @param count The number of steps, no more than pd_nameStepCount
+* @return A string such as /catalog//book
+*/
+- (NSString *)pd_keyForFirstSteps:(NSUInteger)count;
+
+/** Evaluates some of the query's location steps, starting from the nodes selected by the steps before them
+* @param range The steps to evaluate
+* @param nodes The context nodes for the first step in the range
+* @return The nodes selected by the last step in the range, or nil if there are none
+*/
+- (NSArray *)pd_evaluateStepsInRange:(NSRange)range onNodes:(NSArray *)nodes;
+
+@end
@@ -0,0 +1,83 @@
+//
+// PDXPathQuery.h
+//
+// Copyright (c) 2015 Daniel Hall
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+
+#import <Foundation/Foundation.h>
+#import "PDOptions.h"
+
+/** A compiled XPath 1.0-style query.  The query string is parsed once into a program of steps and predicates, which can then be evaluated repeatedly against different PrestoData dictionaries and arrays without reparsing.
+*
+* Compiled queries are immutable and may be shared between threads.  The string-based pd_filterWithXPath: methods use queryWithString: internally, so repeated queries are compiled only once.
+*/
+
+@interface PDXPathQuery : NSObject
+
+/** The XPath query string this query was compiled from */
+@property (nonatomic, copy, readonly) NSString *queryString;
+
+/** Returns a compiled query for the specified string, reusing a previously compiled query from a shared, thread-safe cache of recently used queries when possible
+*
+* @param queryString A string containing an XPath 1.0-style query.  See documentation here:  http://www.w3schools.com/xpath/xpath_syntax.asp
+* @return The compiled query, or nil if the string could not be parsed as a supported XPath query
+*/
++ (instancetype)queryWithString:(NSString *)queryString;
+
+/** Compiles a new query without consulting or populating the shared cache
+*
+* @param queryString A string containing an XPath 1.0-style query
+* @return The compiled query, or nil if the string could not be parsed as a supported XPath query
+*/
+- (instancetype)initWithString:(NSString *)queryString;
+
+/** Returns an array of all child or descendant elements inside the dictionary which match this query
+*
+* @param dictionary A PrestoData dictionary to evaluate the query against
+* @return The array of matching elements, or nil if there are no matches
+*/
+- (NSArray *)evaluateOnDictionary:(NSMutableDictionary *)dictionary;
+
+/** Returns an array of all child or descendant elements inside the dictionary which match this query, with options
+*
+* @param dictionary A PrestoData dictionary to evaluate the query against
+* @param options Options for evaluation.  PDXPathOptionsConcurrent spreads large steps and predicates across cores
+* @return The array of matching elements, or nil if there are no matches
+*/
+- (NSArray *)evaluateOnDictionary:(NSMutableDictionary *)dictionary options:(PDXPathOptions)options;
+
+/** Returns an array of all child or descendant elements inside the array which match this query
+*
+* @param array An array of PrestoData dictionaries to evaluate the query against
+* @return The array of matching elements, or nil if there are no matches
+*/
+- (NSArray *)evaluateOnArray:(NSArray *)array;
+
+/** Returns an array of all child or descendant elements inside the array which match this query, with options
+*
+* @param array An array of PrestoData dictionaries to evaluate the query against
+* @param options Options for evaluation.  PDXPathOptionsConcurrent spreads large steps and predicates across cores
+* @return The array of matching elements, or nil if there are no matches
+*/
+- (NSArray *)evaluateOnArray:(NSArray *)array options:(PDXPathOptions)options;
+
+@end
@@ -0,0 +1,660 @@
+//
+// PDXPathQuery.m
+//
+// Copyright (c) 2015 Daniel Hall
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+
+#import "PDXPathQuery.h"
+#import "PDXPathQuery+_PrestoData_Internal.h"
+#import "PDXPathExpression.h"
+#import "PDNameMatcher.h"
+#import "NSMutableDictionary+PrestoData.h"
+#import "NSMutableDictionary+_PrestoData_Internal.h"
+#import "NSArray+PrestoData.h"
+#import "NSArray+_PrestoData_Internal.h"
+#import "PDStats+_PrestoData_Internal.h"
+#import <pthread.h>
+#include <math.h>
+#include <stdlib.h>
+
+/** The number of compiled queries kept by queryWithString: before the least recently used query is evicted */
+static const NSUInteger PDXPathQueryCacheCapacity = 256;
+
+static pthread_mutex_t PDXPathQueryCacheLock = PTHREAD_MUTEX_INITIALIZER;
+static NSMutableDictionary *PDXPathQueryCache;
+static uint64_t PDXPathQueryCacheClock;
+
+/** The fewest nodes each thread is given when a step or predicate is evaluated concurrently.  Sets smaller than two chunks are evaluated serially, because scheduling would cost more than it saves */
+static const NSUInteger PDXPathConcurrentChunkLength = 2048;
+
+
+typedef NS_ENUM(NSUInteger, PDXPathStepAxis)
+{
+    PDXPathStepAxisChild,
+    PDXPathStepAxisDescendant,
+    PDXPathStepAxisGroup,
+    PDXPathStepAxisSelf
+};
+
+/** A single bracketed predicate from a query, parsed once into an expression when the query is compiled */
+
+@interface PDXPathPredicate : NSObject
+
+@property (nonatomic, strong) PDXPathExpression *expression;
+
++ (instancetype)predicateWithString:(NSString *)expressionString;
+- (NSArray *)filterNodes:(NSArray *)nodes concurrently:(BOOL)concurrently;
+
+@end
+
+
+/** A location step (/name, //name or a parenthesized group) and the predicates that filter its results */
+
+@interface PDXPathStep : NSObject
+
+@property (nonatomic, assign) PDXPathStepAxis axis;
+@property (nonatomic, strong) PDNameMatcher *matcher;
+@property (nonatomic, strong) PDXPathQuery *subquery;
+@property (nonatomic, strong) NSMutableArray *predicates;
+
+- (NSArray *)evaluateOnNodes:(NSArray *)nodes options:(PDXPathOptions)options;
+
+@end
+
+
+static NSUInteger PDXPathIndexOfClosingCharacter(const unichar *characters, NSUInteger length, NSUInteger openIndex, unichar open, unichar close)
+{
+    NSUInteger depth = 0;
+    unichar quote = 0;
+
+    for (NSUInteger i = openIndex; i < length; i++)
+    {
+        unichar character = characters[i];
+
+        if (quote)
+        {
+            if (character == quote)
+            {
+                quote = 0;
+            }
+        }
+        else if (character == '\'' || character == '"')
+        {
+            quote = character;
+        }
+        else if (character == open)
+        {
+            depth++;
+        }
+        else if (character == close && --depth == 0)
+        {
+            return i;
+        }
+    }
+
+    return NSNotFound;
+}
+
+/** Returns the number of chunks to split a set of nodes into for concurrent evaluation, or 1 if it should be evaluated serially */
+static NSUInteger PDXPathConcurrentChunkCount(NSUInteger count)
+{
+    if (count < PDXPathConcurrentChunkLength * 2)
+    {
+        return 1;
+    }
+
+    // A few chunks per core lets cores that finish early take work from the others
+    NSUInteger chunkCount = [NSProcessInfo processInfo].activeProcessorCount * 4;
+    return MAX(MIN(chunkCount, count / PDXPathConcurrentChunkLength), 1);
+}
+
+/** Splits the range 0..<count into chunks, has a block collect the results for each chunk on the global concurrent queue, and returns the results of all the chunks in order, which is the order serial evaluation would have produced */
+static NSArray *PDXPathCollectConcurrently(NSUInteger count, NSUInteger chunkCount, void (^collect)(NSRange range, NSMutableArray *results))
+{
+    __strong NSMutableArray **chunkResults = (__strong NSMutableArray **) calloc(chunkCount, sizeof(NSMutableArray *));
+
+    dispatch_apply(chunkCount, dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0), ^(size_t chunk) {
+        NSUInteger start = count * chunk / chunkCount;
+        NSUInteger end = count * (chunk + 1) / chunkCount;
+        NSMutableArray *results = [NSMutableArray array];
+        collect(NSMakeRange(start, end - start), results);
+        chunkResults[chunk] = results;
+    });
+
+    NSMutableArray *results = [NSMutableArray array];
+    for (NSUInteger i = 0; i < chunkCount; i++)
+    {
+        [results addObjectsFromArray:chunkResults[i]];
+        chunkResults[i] = nil;
+    }
+    free(chunkResults);
+
+    return results;
+}
+
+
+@implementation PDXPathPredicate
+
++ (instancetype)predicateWithString:(NSString *)expressionString
+{
+    PDXPathExpression *expression = [PDXPathExpression expressionWithString:expressionString];
+
+    if (!expression)
+    {
+        return nil;
+    }
+
+    PDXPathPredicate *predicate = [[self alloc] init];
+    predicate.expression = expression;
+    return predicate;
+}
+
+- (NSArray *)filterNodes:(NSArray *)nodes concurrently:(BOOL)concurrently
+{
+    PDXPathExpression *expression = self.expression;
+    NSUInteger count = nodes.count;
+    PDXPathContext context = { nil, 0, count };
+
+    // A numeric predicate such as [2] or [last()-1] that doesn't vary by node is an index, so it is evaluated once rather than for every node
+    if (expression.type == PDXPathExpressionTypeNumber && !expression.dependsOnNode && !expression.dependsOnPosition)
+    {
+        double index = [expression numberValueInContext:&context];
+        PDStatsAdd(predicateEvaluations, 1);
+
+        // XPath uses 1-based indexes
+        if (index >= 1 && index <= count && index == floor(index))
+        {
+            return @[nodes[(NSUInteger)index - 1]];
+        }
+        return nil;
+    }
+
+    NSUInteger chunkCount = concurrently ? PDXPathConcurrentChunkCount(count) : 1;
+    if (chunkCount > 1)
+    {
+        // Every chunk knows where it starts, so positions and last() mean the same as they do serially
+        return PDXPathCollectConcurrently(count, chunkCount, ^(NSRange range, NSMutableArray *filtered) {
+            [self filterNodes:nodes inRange:range toArray:filtered];
+        });
+    }
+
+    NSMutableArray *filtered = [NSMutableArray array];
+    [self filterNodes:nodes inRange:NSMakeRange(0, count) toArray:filtered];
+    return filtered;
+}
+
+- (void)filterNodes:(NSArray *)nodes inRange:(NSRange)range toArray:(NSMutableArray *)filtered
+{
+    PDXPathExpression *expression = self.expression;
+    PDXPathContext context = { nil, 0, nodes.count };
+    PDStatsAdd(predicateEvaluations, range.length);
+
+    for (NSUInteger i = range.location; i < NSMaxRange(range); i++)
+    {
+        context.node = nodes[i];
+        context.position = i + 1;
+
+        BOOL matches = expression.type == PDXPathExpressionTypeNumber ? [expression numberValueInContext:&context] == context.position : [expression booleanValueInContext:&context];
+
+        if (matches)
+        {
+            [filtered addObject:nodes[i]];
+        }
+    }
+}
+
+@end
+
+
+@implementation PDXPathStep
+
+- (instancetype)init
+{
+    self = [super init];
+
+    if (self) {
+        _predicates = [NSMutableArray array];
+    }
+
+    return self;
+}
+
+- (NSArray *)evaluateOnNodes:(NSArray *)nodes options:(PDXPathOptions)options
+{
+    BOOL concurrently = (options & PDXPathOptionsConcurrent) != 0;
+
+    if (self.axis == PDXPathStepAxisGroup)
+    {
+        return [self applyPredicatesToNodes:[self.subquery evaluateOnArray:nodes options:options] concurrently:concurrently];
+    }
+
+    if (self.axis == PDXPathStepAxisSelf)
+    {
+        return [self applyPredicatesToNodes:nodes concurrently:concurrently];
+    }
+
+    NSUInteger count = nodes.count;
+    NSUInteger chunkCount = concurrently ? PDXPathConcurrentChunkCount(count) : 1;
+
+    if (chunkCount > 1)
+    {
+        // Each context node is evaluated independently, so chunks of them can be too.  Predicates within a chunk run serially, as every core is already busy
+        return PDXPathCollectConcurrently(count, chunkCount, ^(NSRange range, NSMutableArray *results) {
+            [self addResultsForNodes:nodes inRange:range toArray:results concurrently:NO];
+        });
+    }
+
+    NSMutableArray *results = [NSMutableArray array];
+    [self addResultsForNodes:nodes inRange:NSMakeRange(0, count) toArray:results concurrently:concurrently];
+    return results;
+}
+
+- (void)addResultsForNodes:(NSArray *)nodes inRange:(NSRange)range toArray:(NSMutableArray *)results concurrently:(BOOL)concurrently
+{
+    // Predicates on a location step apply to the nodes selected from each context node separately, so that positions are relative to each parent
+    BOOL hasPredicates = self.predicates.count > 0;
+
+    for (NSUInteger i = range.location; i < NSMaxRange(range); i++)
+    {
+        NSMutableDictionary *node = nodes[i];
+
+        // Without predicates, matches are collected straight into the results
+        NSMutableArray *candidates = hasPredicates ? [NSMutableArray array] : results;
+        NSUInteger previousCount = candidates.count;
+        if (self.axis == PDXPathStepAxisChild)
+        {
+            [node pd_addChildrenMatching:self.matcher toArray:candidates];
+        }
+        else
+        {
+            [node pd_addDescendantsMatching:self.matcher toArray:candidates];
+        }
+        PDStatsAdd(nodesVisited, candidates.count - previousCount);
+
+        if (!hasPredicates)
+        {
+            continue;
+        }
+
+        NSArray *selected = [self applyPredicatesToNodes:candidates concurrently:concurrently];
+        if (selected.count)
+        {
+            [results addObjectsFromArray:selected];
+        }
+    }
+}
+
+- (NSArray *)applyPredicatesToNodes:(NSArray *)nodes concurrently:(BOOL)concurrently
+{
+    for (PDXPathPredicate *predicate in self.predicates)
+    {
+        if (!nodes.count)
+        {
+            break;
+        }
+        nodes = [predicate filterNodes:nodes concurrently:concurrently];
+    }
+
+    return nodes;
+}
+
+@end
+
+
+@implementation PDXPathQuery
+{
+    NSArray *_steps;
+    uint64_t _lastUse;
+}
+
++ (instancetype)queryWithString:(NSString *)queryString
+{
+    if (!queryString)
+    {
+        return nil;
+    }
+
+    pthread_mutex_lock(&PDXPathQueryCacheLock);
+    id cached = PDXPathQueryCache[queryString];
+    if ([cached isKindOfClass:[PDXPathQuery class]])
+    {
+        ((PDXPathQuery *) cached)->_lastUse = ++PDXPathQueryCacheClock;
+    }
+    pthread_mutex_unlock(&PDXPathQueryCacheLock);
+
+    if (cached)
+    {
+        return cached == [NSNull null] ? nil : cached;
+    }
+
+    // Compile outside the lock so that a slow compile never blocks lookups of other queries
+    PDXPathQuery *query = [[self alloc] initWithString:queryString];
+
+    pthread_mutex_lock(&PDXPathQueryCacheLock);
+    if (!PDXPathQueryCache)
+    {
+        PDXPathQueryCache = [NSMutableDictionary dictionaryWithCapacity:PDXPathQueryCacheCapacity];
+    }
+
+    if (PDXPathQueryCache.count >= PDXPathQueryCacheCapacity)
+    {
+        [self evictLeastRecentlyUsedQuery];
+    }
+
+    if (query)
+    {
+        query->_lastUse = ++PDXPathQueryCacheClock;
+    }
+    PDXPathQueryCache[queryString] = query ? : [NSNull null];
+    pthread_mutex_unlock(&PDXPathQueryCacheLock);
+
+    return query;
+}
+
++ (void)evictLeastRecentlyUsedQuery
+{
+    NSString *leastRecentKey = nil;
+    uint64_t leastRecentUse = UINT64_MAX;
+
+    for (NSString *key in PDXPathQueryCache)
+    {
+        id cached = PDXPathQueryCache[key];
+        // Queries that failed to compile are remembered too, but are the first to go
+        uint64_t lastUse = [cached isKindOfClass:[PDXPathQuery class]] ? ((PDXPathQuery *) cached)->_lastUse : 0;
+        if (lastUse < leastRecentUse)
+        {
+            leastRecentUse = lastUse;
+            leastRecentKey = key;
+        }
+    }
+
+    if (leastRecentKey)
+    {
+        [PDXPathQueryCache removeObjectForKey:leastRecentKey];
+    }
+}
+
+- (instancetype)initWithString:(NSString *)queryString
+{
+    self = [super init];
+
+    if (self) {
+        _queryString = [queryString copy];
+        _steps = [self compiledStepsFromString:_queryString];
+        PDStatsAdd(queriesCompiled, 1);
+
+        if (!_steps)
+        {
+            return nil;
+        }
+    }
+
+    return self;
+}
+
+- (NSArray *)evaluateOnDictionary:(NSMutableDictionary *)dictionary
+{
+    return [self evaluateOnDictionary:dictionary options:PDXPathOptionsNone];
+}
+
+- (NSArray *)evaluateOnDictionary:(NSMutableDictionary *)dictionary options:(PDXPathOptions)options
+{
+    if (!dictionary)
+    {
+        return nil;
+    }
+
+    NSArray *results = [self evaluateStepsOnNodes:@[dictionary] options:options];
+    return results.count ? results : nil;
+}
+
+- (NSArray *)evaluateOnArray:(NSArray *)array
+{
+    return [self evaluateOnArray:array options:PDXPathOptionsNone];
+}
+
+- (NSArray *)evaluateOnArray:(NSArray *)array options:(PDXPathOptions)options
+{
+    NSArray *results = [self evaluateStepsOnNodes:array options:options];
+    return results.count ? results : nil;
+}
+
+- (NSArray *)evaluateStepsOnNodes:(NSArray *)nodes options:(PDXPathOptions)options
+{
+    PDStatsToken token = PDStatsBeginOperation(PDStatsOperationQuery, _queryString);
+
+    for (PDXPathStep *step in _steps)
+    {
+        if (!nodes.count)
+        {
+            nodes = nil;
+            break;
+        }
+        nodes = [step evaluateOnNodes:nodes options:options];
+        PDStatsAdd(queryStepsEvaluated, 1);
+    }
+
+    PDStatsEndOperation(token, _queryString, 0);
+    return nodes;
+}
+
+- (BOOL)pd_getStreamingMatchers:(NSArray **)matchers descendantSteps:(NSIndexSet **)descendantSteps predicates:(NSArray **)predicates
+{
+    NSMutableArray *stepMatchers = [NSMutableArray arrayWithCapacity:_steps.count];
+    NSMutableIndexSet *descendantIndexes = [NSMutableIndexSet indexSet];
+    NSMutableArray *finalPredicates = [NSMutableArray array];
+
+    for (PDXPathStep *step in _steps)
+    {
+        if (step.axis != PDXPathStepAxisChild && step.axis != PDXPathStepAxisDescendant)
+        {
+            return NO;
+        }
+
+        BOOL isFinalStep = step == _steps.lastObject;
+
+        for (PDXPathPredicate *predicate in step.predicates)
+        {
+            // Predicates can only be tested once an element has ended, and positions are only known once all of its siblings have
+            PDXPathExpression *expression = predicate.expression;
+            if (!isFinalStep || expression.type == PDXPathExpressionTypeNumber || expression.dependsOnPosition || expression.dependsOnSize)
+            {
+                return NO;
+            }
+            [finalPredicates addObject:expression];
+        }
+
+        if (step.axis == PDXPathStepAxisDescendant)
+        {
+            [descendantIndexes addIndex:stepMatchers.count];
+        }
+        [stepMatchers addObject:step.matcher];
+    }
+
+    if (!stepMatchers.count)
+    {
+        return NO;
+    }
+
+    *matchers = stepMatchers;
+    *descendantSteps = descendantIndexes;
+    *predicates = finalPredicates;
+    return YES;
+}
+
+- (NSUInteger)pd_stepCount
+{
+    return _steps.count;
+}
+
+- (NSUInteger)pd_nameStepCount
+{
+    NSUInteger count = 0;
+
+    for (PDXPathStep *step in _steps)
+    {
+        if ((step.axis != PDXPathStepAxisChild && step.axis != PDXPathStepAxisDescendant) || step.predicates.count)
+        {
+            break;
+        }
+        count++;
+    }
+
+    return count;
+}
+
+- (NSString *)pd_keyForFirstSteps:(NSUInteger)count
+{
+    NSMutableString *key = [NSMutableString string];
+
+    for (NSUInteger i = 0; i < count; i++)
+    {
+        PDXPathStep *step = _steps[i];
+        [key appendString:step.axis == PDXPathStepAxisDescendant ? @"//" : @"/"];
+        [key appendString:step.matcher.pattern];
+    }
+
+    return key;
+}
+
+- (NSArray *)pd_evaluateStepsInRange:(NSRange)range onNodes:(NSArray *)nodes
+{
+    for (PDXPathStep *step in [_steps subarrayWithRange:range])
+    {
+        if (!nodes.count)
+        {
+            return nil;
+        }
+        nodes = [step evaluateOnNodes:nodes options:PDXPathOptionsNone];
+    }
+
+    return nodes.count ? nodes : nil;
+}
+
+
+#pragma mark - Compiling
+
+- (NSArray *)compiledStepsFromString:(NSString *)queryString
+{
+    NSUInteger length = queryString.length;
+    NSMutableData *buffer = [NSMutableData dataWithLength:length * sizeof(unichar)];
+    unichar *characters = buffer.mutableBytes;
+    [queryString getCharacters:characters range:NSMakeRange(0, length)];
+
+    NSCharacterSet *whitespace = [NSCharacterSet whitespaceAndNewlineCharacterSet];
+    NSMutableArray *steps = [NSMutableArray array];
+    NSUInteger index = 0;
+
+    while (YES)
+    {
+        while (index < length && [whitespace characterIsMember:characters[index]])
+        {
+            index++;
+        }
+
+        if (index >= length)
+        {
+            break;
+        }
+
+        unichar character = characters[index];
+
+        if (character == '(')
+        {
+            NSUInteger close = PDXPathIndexOfClosingCharacter(characters, length, index, '(', ')');
+            if (close == NSNotFound)
+            {
+                return nil;
+            }
+
+            PDXPathStep *step = [[PDXPathStep alloc] init];
+            step.axis = PDXPathStepAxisGroup;
+            step.subquery = [[PDXPathQuery alloc] initWithString:[queryString substringWithRange:NSMakeRange(index + 1, close - index - 1)]];
+            if (!step.subquery)
+            {
+                return nil;
+            }
+
+            [steps addObject:step];
+            index = close + 1;
+        }
+
+        else if (character == '[')
+        {
+            NSUInteger close = PDXPathIndexOfClosingCharacter(characters, length, index, '[', ']');
+            if (close == NSNotFound)
+            {
+                return nil;
+            }
+
+            PDXPathPredicate *predicate = [PDXPathPredicate predicateWithString:[queryString substringWithRange:NSMakeRange(index + 1, close - index - 1)]];
+            if (!predicate)
+            {
+                return nil;
+            }
+
+            // A predicate at the start of a query filters the context nodes themselves
+            PDXPathStep *step = steps.lastObject;
+            if (!step)
+            {
+                step = [[PDXPathStep alloc] init];
+                step.axis = PDXPathStepAxisSelf;
+                [steps addObject:step];
+            }
+
+            [step.predicates addObject:predicate];
+            index = close + 1;
+        }
+
+        else
+        {
+            NSUInteger slashCount = 0;
+            while (index < length && characters[index] == '/')
+            {
+                slashCount++;
+                index++;
+            }
+
+            NSUInteger nameStart = index;
+            while (index < length && characters[index] != '/' && characters[index] != '[' && characters[index] != '(' && characters[index] != ')')
+            {
+                index++;
+            }
+
+            NSString *name = [[queryString substringWithRange:NSMakeRange(nameStart, index - nameStart)] stringByTrimmingCharactersInSet:whitespace];
+            if (!name.length)
+            {
+                return nil;
+            }
+
+            PDXPathStep *step = [[PDXPathStep alloc] init];
+            step.axis = slashCount >= 2 ? PDXPathStepAxisDescendant : PDXPathStepAxisChild;
+            step.matcher = [PDNameMatcher matcherWithPattern:name];
+            [steps addObject:step];
+        }
+    }
+
+    return steps;
+}
+
+
+@end
@@ -0,0 +1,60 @@
+//
+// PDXPathStreamMatcher.h
+//
+// Copyright (c) 2015 Daniel Hall
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+
+#import <Foundation/Foundation.h>
+
+@class PDXPathQuery;
+
+/** This class is used internally by PrestoData to evaluate a query against elements as a parser reports them, rather than against a finished tree.  The query's steps become the states of a small automaton, and the parser keeps the matcher in step with the document by entering and exiting each element.  Only the set of live states for each open element is remembered, so matching needs no memory beyond the depth of the document */
+
+@interface PDXPathStreamMatcher : NSObject
+
+/** Creates a matcher for a compiled query
+* @param query The query to match
+* @return The matcher, or nil if the query can't be evaluated while streaming (see pd_getStreamingMatchers:descendantSteps:predicates:)
+*/
+- (instancetype)initWithQuery:(PDXPathQuery *)query;
+
+/** YES if the path to the current element satisfies every step of the query, so the element is a match if it also passes the final step's predicates.  Parsers build such elements in full */
+@property (nonatomic, readonly) BOOL currentElementMayMatch;
+
+/** YES if elements inside the current element could still match.  When NO, parsers can skip the current element's contents without reporting them */
+@property (nonatomic, readonly) BOOL tracking;
+
+/** Advances the matcher into a child of the current element
+* @param name The name of the element that begins
+*/
+- (void)enterElementNamed:(NSString *)name;
+
+/** Returns the matcher to the parent of the current element */
+- (void)exitElement;
+
+/** Tests a finished element against the query
+* @param element The completely parsed current element
+* @return YES if the element's path matches and the element passes the final step's predicates
+*/
+- (BOOL)currentElementMatches:(NSMutableDictionary *)element;
+
+@end
@@ -0,0 +1,156 @@
+//
+// PDXPathStreamMatcher.m
+//
+// Copyright (c) 2015 Daniel Hall
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+
+#import "PDXPathStreamMatcher.h"
+#import "PDXPathQuery+_PrestoData_Internal.h"
+#import "PDXPathExpression.h"
+#import "PDNameMatcher.h"
+#include <stdlib.h>
+
+/** States are kept as bits of a 64-bit word: bit k means the first k steps have matched, so one bit is needed beyond the last step */
+static const NSUInteger PDXPathStreamMaximumStepCount = 63;
+
+
+@implementation PDXPathStreamMatcher
+{
+    NSArray *_matchers;
+    NSArray *_predicates;
+    NSUInteger _stepCount;
+    uint64_t _descendantSteps;
+    uint64_t _liveMask;
+    uint64_t _acceptState;
+    uint64_t *_states;
+    NSUInteger _depth;
+    NSUInteger _capacity;
+}
+
+- (instancetype)initWithQuery:(PDXPathQuery *)query
+{
+    NSArray *matchers;
+    NSIndexSet *descendantSteps;
+    NSArray *predicates;
+
+    if (!query || ![query pd_getStreamingMatchers:&matchers descendantSteps:&descendantSteps predicates:&predicates] || matchers.count > PDXPathStreamMaximumStepCount)
+    {
+        return nil;
+    }
+
+    self = [super init];
+
+    if (self) {
+        _matchers = matchers;
+        _predicates = predicates;
+        _stepCount = matchers.count;
+        _liveMask = (1ULL << _stepCount) - 1;
+        _acceptState = 1ULL << _stepCount;
+
+        [descendantSteps enumerateIndexesUsingBlock:^(NSUInteger index, BOOL *stop) {
+            _descendantSteps |= 1ULL << index;
+        }];
+
+        // The context node of the query, which is the document itself, starts with no steps matched
+        _capacity = 32;
+        _states = malloc(_capacity * sizeof(uint64_t));
+        _states[0] = 1;
+    }
+
+    return self;
+}
+
+- (void)dealloc
+{
+    free(_states);
+}
+
+- (BOOL)currentElementMayMatch
+{
+    return _depth > 0 && (_states[_depth] & _acceptState);
+}
+
+- (BOOL)tracking
+{
+    return (_states[_depth] & _liveMask) != 0;
+}
+
+- (void)enterElementNamed:(NSString *)name
+{
+    uint64_t live = _states[_depth] & _liveMask;
+    uint64_t next = 0;
+
+    while (live)
+    {
+        NSUInteger step = (NSUInteger)__builtin_ctzll(live);
+        live &= live - 1;
+
+        // A descendant step can also match deeper down, so it stays live below any element
+        if (_descendantSteps & (1ULL << step))
+        {
+            next |= 1ULL << step;
+        }
+
+        if ([(PDNameMatcher *)_matchers[step] matchesName:name])
+        {
+            next |= 1ULL << (step + 1);
+        }
+    }
+
+    if (++_depth == _capacity)
+    {
+        _capacity *= 2;
+        _states = realloc(_states, _capacity * sizeof(uint64_t));
+    }
+    _states[_depth] = next;
+}
+
+- (void)exitElement
+{
+    if (_depth > 0)
+    {
+        _depth--;
+    }
+}
+
+- (BOOL)currentElementMatches:(NSMutableDictionary *)element
+{
+    if (!self.currentElementMayMatch)
+    {
+        return NO;
+    }
+
+    // Positional predicates are rejected when the matcher is created, so every element is tested as if it were alone
+    PDXPathContext context = { element, 1, 1 };
+
+    for (PDXPathExpression *predicate in _predicates)
+    {
+        if (![predicate booleanValueInContext:&context])
+        {
+            return NO;
+        }
+    }
+
+    return YES;
+}
+
+@end
@@ -26,10 +26,19 @@
 #import <Foundation/Foundation.h>
 #import "NSArray+PrestoData.h"
 #import "NSMutableDictionary+PrestoData.h"
+#import "PDXPathQuery.h"
+#import "PDOptions.h"
+#import "PDNode.h"
+#import "PDEdit.h"
+#import "PDDocumentCache.h"
+#import "PDStats.h"
 
 extern NSString *const defaultInnerValueKey;
 
-/** A class containing shortcut convenience methods for interacting with PrestoData */
+/** A class containing shortcut convenience methods for interacting with PrestoData
+*
+* JSON files are loaded through the shared PDDocumentCache.  It caches nothing by default, so every load parses the file.  Give it a memory budget when the same files are loaded repeatedly, and a file that hasn't changed since it was last loaded isn't parsed again; each method still works on its own copy of the document.
+*/
 
 @interface PrestoData : NSObject
 
@@ -80,4 +89,48 @@ extern NSString *const defaultInnerValueKey;
 */
 +(id)objectFromJSON:(NSString *)filePath filteredBy:(NSString *)xpathQuery removingElementNamed:(NSString *)elementName;
 
+/** Returns a PrestoData dictionary or array created by loading a JSON file from the app bundle or document folder and applying a list of edits to it in order.  The file is loaded and parsed only once, however many edits there are
+* @param filePath An NSString representation of the path to JSON resource that will be loaded from the file system
+* @param edits An array of PDEdits to apply.  See PDEdit for the kinds of change available
+* @return An NSMutableDictionary or NSArray (depending on what was modeled in the original JSON file) reflecting the changes made to the input JSON
+*/
++(id)objectFromJSON:(NSString *)filePath applyingEdits:(NSArray *)edits;
+
+/** Loads a JSON file, applies a list of edits to it in order, and writes the result as JSON to a file, which may be the file that was loaded.  The output is written to a temporary file first and moved into place, so a failed write never leaves a partly written file behind
+* @param edits An array of PDEdits to apply
+* @param filePath The path of the JSON file to load
+* @param outputPath The path to write the edited JSON to
+* @param options Options that control how the JSON is formatted
+* @param error Set to an error in PrestoDataErrorDomain if the file can't be loaded or the output can't be written.  May be NULL
+* @return YES if the edited JSON was written, otherwise NO
+*/
++(BOOL)applyEdits:(NSArray *)edits toJSONFile:(NSString *)filePath writingToFile:(NSString *)outputPath options:(PDWritingOptions)options error:(NSError **)error;
+
+
+/**---------------------------------------------------------------------------------------
+* @name Querying Streams
+*  ---------------------------------------------------------------------------------------
+*/
+
+
+/** Finds the elements matching an XPath 1.0-style query in JSON read from a stream, without building the rest of the document.  Each matching element is built on its own as the JSON is parsed, handed to the block, and released, so memory use depends on the size of a match rather than the size of the document.
+*
+* Streaming supports / and // steps with name tests and wildcards, and predicates on the last step that test the element's own attributes and children, such as //book[@category='WEB'] or //book[price>35].  Positional predicates ([2], [last()], position()), parenthesized groups and predicates on earlier steps need the whole document, so queries using them are not supported here.  An element is handed to the block when it ends, so matches nested inside another match arrive before it.
+*
+* @param xpathQuery An NSString containing an XPath 1.0-style query
+* @param stream A stream of UTF8-encoded JSON.  If it isn't open yet, it is opened, and closed again when parsing finishes
+* @param block Called with each matching element, which has no parent dictionary.  Set *stop to YES to stop parsing
+* @return YES if the JSON was read to the end, or the block stopped it, NO if the query can't be evaluated on a stream or the JSON is malformed or can't be read
+*/
++ (BOOL)enumerateMatchesOfXPath:(NSString *)xpathQuery inJSONStream:(NSInputStream *)stream usingBlock:(void (^)(NSMutableDictionary *element, BOOL *stop))block;
+
+/** Finds the elements matching an XPath 1.0-style query in XML read from a stream, without building the rest of the document.  Supports the same queries as enumerateMatchesOfXPath:inJSONStream:usingBlock:
+*
+* @param xpathQuery An NSString containing an XPath 1.0-style query
+* @param stream A stream of XML.  If it isn't open yet, it is opened, and closed again when parsing finishes
+* @param block Called with each matching element, which has no parent dictionary.  Set *stop to YES to stop parsing
+* @return YES if the XML was read to the end, or the block stopped it, NO if the query can't be evaluated on a stream or the XML is malformed or can't be read
+*/
++ (BOOL)enumerateMatchesOfXPath:(NSString *)xpathQuery inXMLStream:(NSInputStream *)stream usingBlock:(void (^)(NSMutableDictionary *element, BOOL *stop))block;
+
 @end
@@ -23,8 +23,12 @@
 
 
 #import "PrestoData.h"
+#import "PDJSONParser.h"
+#import "PDXMLParser.h"
+#import "PDXPathStreamMatcher.h"
 
 NSString *const defaultInnerValueKey = @"innerValue";
+NSString *const PrestoDataErrorDomain = @"PrestoDataErrorDomain";
 
 @implementation PrestoData
 
@@ -83,14 +87,65 @@ NSString *const defaultInnerValueKey = @"innerValue";
     return jsonObject;
 }
 
-+ (id)dictionaryOrArrayLoadedFromJSON:(NSString *)filePath {
-    if (filePath == nil) {
-        return nil;
++ (id)objectFromJSON:(NSString *)filePath applyingEdits:(NSArray *)edits {
+    id jsonObject = [self dictionaryOrArrayLoadedFromJSON:filePath];
+    [PDEdit applyEdits:edits toObject:jsonObject];
+    return jsonObject;
+}
+
++ (BOOL)applyEdits:(NSArray *)edits toJSONFile:(NSString *)filePath writingToFile:(NSString *)outputPath options:(PDWritingOptions)options error:(NSError **)error {
+    id jsonObject = [self dictionaryOrArrayLoadedFromJSON:filePath];
+
+    if (jsonObject == nil) {
+        if (error) {
+            *error = [NSError errorWithDomain:PrestoDataErrorDomain code:PrestoDataErrorReadFailed userInfo:@{NSLocalizedDescriptionKey : [NSString stringWithFormat:@"The file %@ could not be read as JSON", filePath]}];
+        }
+        return NO;
+    }
+
+    [PDEdit applyEdits:edits toObject:jsonObject];
+
+    NSData *data = [jsonObject pd_jsonDataWithOptions:options];
+    NSError *writeError = nil;
+
+    if (![data writeToFile:outputPath options:NSDataWritingAtomic error:&writeError]) {
+        if (error) {
+            NSMutableDictionary *userInfo = [NSMutableDictionary dictionaryWithObject:[NSString stringWithFormat:@"The edited JSON could not be written to %@", outputPath] forKey:NSLocalizedDescriptionKey];
+            if (writeError) {
+                userInfo[NSUnderlyingErrorKey] = writeError;
+            }
+            *error = [NSError errorWithDomain:PrestoDataErrorDomain code:PrestoDataErrorWriteFailed userInfo:userInfo];
+        }
+        return NO;
     }
 
-    NSData *data = [NSData dataWithContentsOfFile:filePath];
+    return YES;
+}
 
-    return [NSMutableDictionary pd_dictionaryFromJSONData:data] ? : [NSArray pd_arrayFromJSONData:data];
++ (BOOL)enumerateMatchesOfXPath:(NSString *)xpathQuery inJSONStream:(NSInputStream *)stream usingBlock:(void (^)(NSMutableDictionary *element, BOOL *stop))block {
+    PDXPathStreamMatcher *matcher = [[PDXPathStreamMatcher alloc] initWithQuery:[PDXPathQuery queryWithString:xpathQuery]];
+
+    if (!matcher || !stream || !block) {
+        return NO;
+    }
+
+    PDJSONParser *parser = [[PDJSONParser alloc] initWithStream:stream keyForInnerValue:defaultInnerValueKey];
+    return [parser enumerateMatchesOfMatcher:matcher usingBlock:block];
+}
+
++ (BOOL)enumerateMatchesOfXPath:(NSString *)xpathQuery inXMLStream:(NSInputStream *)stream usingBlock:(void (^)(NSMutableDictionary *element, BOOL *stop))block {
+    PDXPathStreamMatcher *matcher = [[PDXPathStreamMatcher alloc] initWithQuery:[PDXPathQuery queryWithString:xpathQuery]];
+
+    if (!matcher || !stream || !block) {
+        return NO;
+    }
+
+    PDXMLParser *parser = [[PDXMLParser alloc] initWithStream:stream];
+    return [parser enumerateMatchesOfMatcher:matcher usingBlock:block];
+}
+
++ (id)dictionaryOrArrayLoadedFromJSON:(NSString *)filePath {
+    return [[PDDocumentCache sharedCache] objectFromJSONFileAtPath:filePath];
 }
 
 @end
@@ -0,0 +1,163 @@
+//
+// PrestoDataDocumentCacheTests.m
+//
+// Copyright (c) 2015 Daniel Hall
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+
+#import <XCTest/XCTest.h>
+#import "PrestoData.h"
+
+@interface PrestoDataDocumentCacheTests : XCTestCase
+
+@end
+
+@implementation PrestoDataDocumentCacheTests
+
+- (NSString *)temporaryFileNamed:(NSString *)name containing:(NSString *)json
+{
+    NSString *path = [NSTemporaryDirectory() stringByAppendingPathComponent:name];
+    [[json dataUsingEncoding:NSUTF8StringEncoding] writeToFile:path atomically:YES];
+    return path;
+}
+
+- (void)testHitsReturnPrivateCopies
+{
+    PDDocumentCache *cache = [[PDDocumentCache alloc] initWithMemoryBudget:1024 * 1024];
+    NSString *path = [[NSBundle mainBundle] pathForResource:@"test" ofType:@"json"];
+
+    NSMutableDictionary *first = [cache objectFromJSONFileAtPath:path];
+    [[first pd_filterWithXPath:@"/bookstore/book"] pd_setValue:@"changed" forAttribute:@"category"];
+
+    NSMutableDictionary *second = [cache objectFromJSONFileAtPath:path];
+    XCTAssertNotEqual(first, second);
+    XCTAssertEqual([second pd_filterWithXPath:@"/bookstore/book[@category='changed']"].count, 0);
+    XCTAssertTrue([second pd_isEqualToDictionary:[NSMutableDictionary pd_dictionaryFromJSONData:[NSData dataWithContentsOfFile:path]]]);
+
+    XCTAssertEqual(cache.missCount, 1);
+    XCTAssertEqual(cache.hitCount, 1);
+}
+
+- (void)testChangedFilesAreParsedAgain
+{
+    PDDocumentCache *cache = [[PDDocumentCache alloc] initWithMemoryBudget:1024 * 1024];
+    NSString *path = [self temporaryFileNamed:@"PrestoDataCache.json" containing:@"{\"a\" : 1}"];
+
+    XCTAssertEqualObjects([cache objectFromJSONFileAtPath:path][@"a"], @1);
+
+    [self temporaryFileNamed:@"PrestoDataCache.json" containing:@"{\"a\" : 22}"];
+    XCTAssertEqualObjects([cache objectFromJSONFileAtPath:path][@"a"], @22);
+    XCTAssertEqual(cache.missCount, 2);
+    XCTAssertEqual(cache.hitCount, 0);
+
+    [[NSFileManager defaultManager] removeItemAtPath:path error:NULL];
+    XCTAssertNil([cache objectFromJSONFileAtPath:path]);
+    XCTAssertEqual(cache.totalCost, 0);
+}
+
+- (void)testLeastRecentlyUsedDocumentsAreEvicted
+{
+    NSString *first = [self temporaryFileNamed:@"PrestoDataCache1.json" containing:@"[{\"a\" : 1}]"];
+    NSString *second = [self temporaryFileNamed:@"PrestoDataCache2.json" containing:@"[{\"a\" : 2}]"];
+    NSString *third = [self temporaryFileNamed:@"PrestoDataCache3.json" containing:@"[{\"a\" : 3}]"];
+
+    // Room for two of the three documents
+    PDDocumentCache *cache = [[PDDocumentCache alloc] initWithMemoryBudget:0];
+    [cache objectFromJSONFileAtPath:first];
+    XCTAssertEqual(cache.totalCost, 0);
+    cache.memoryBudget = 1024;
+    [cache objectFromJSONFileAtPath:first];
+    NSUInteger cost = cache.totalCost;
+    cache.memoryBudget = cost * 2;
+
+    [cache objectFromJSONFileAtPath:second];
+    [cache objectFromJSONFileAtPath:first];
+    [cache objectFromJSONFileAtPath:third];
+    XCTAssertEqual(cache.evictionCount, 1);
+
+    NSUInteger hits = cache.hitCount;
+    [cache objectFromJSONFileAtPath:first];
+    [cache objectFromJSONFileAtPath:third];
+    XCTAssertEqual(cache.hitCount, hits + 2);
+
+    NSArray *reloaded = [cache objectFromJSONFileAtPath:second];
+    XCTAssertEqualObjects(reloaded[0][@"a"], @2);
+    XCTAssertEqual(cache.hitCount, hits + 2);
+}
+
+- (void)testConcurrentLoads
+{
+    PDDocumentCache *cache = [[PDDocumentCache alloc] initWithMemoryBudget:1024 * 1024];
+    NSString *path = [[NSBundle mainBundle] pathForResource:@"test" ofType:@"json"];
+    NSMutableDictionary *expected = [NSMutableDictionary pd_dictionaryFromJSONData:[NSData dataWithContentsOfFile:path]];
+    __block NSUInteger failures = 0;
+    NSObject *lock = [[NSObject alloc] init];
+
+    dispatch_apply(64, dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0), ^(size_t iteration) {
+        NSMutableDictionary *loaded = [cache objectFromJSONFileAtPath:path];
+        [loaded pd_setValue:@"mine" forAttribute:@"owner"];
+        [loaded pd_deleteAttribute:@"owner"];
+        if (![loaded pd_isEqualToDictionary:expected]) {
+            @synchronized (lock) {
+                failures++;
+            }
+        }
+    });
+
+    XCTAssertEqual(failures, 0);
+    XCTAssertEqual(cache.hitCount + cache.missCount, 64);
+}
+
+- (void)testCopyOfCachedDocumentLoadsOnSeveralThreads
+{
+    PDDocumentCache *cache = [[PDDocumentCache alloc] initWithMemoryBudget:1024 * 1024];
+    NSString *path = [[NSBundle mainBundle] pathForResource:@"test" ofType:@"json"];
+    [cache objectFromJSONFileAtPath:path];
+    NSMutableDictionary *copy = [cache objectFromJSONFileAtPath:path];
+    NSUInteger expected = [[NSMutableDictionary pd_dictionaryFromJSONData:[NSData dataWithContentsOfFile:path]] pd_filterWithXPath:@"//*"].count;
+    __block NSUInteger failures = 0;
+    NSObject *lock = [[NSObject alloc] init];
+
+    dispatch_apply(16, dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0), ^(size_t iteration) {
+        if ([copy pd_filterWithXPath:@"//*"].count != expected) {
+            @synchronized (lock) {
+                failures++;
+            }
+        }
+    });
+
+    XCTAssertEqual(cache.hitCount, 1);
+    XCTAssertEqual(failures, 0);
+}
+
+- (void)testSharedCacheIsOffByDefault
+{
+    PDDocumentCache *cache = [PDDocumentCache sharedCache];
+    NSString *path = [[NSBundle mainBundle] pathForResource:@"test" ofType:@"json"];
+
+    XCTAssertEqual(cache.memoryBudget, 0);
+    NSMutableDictionary *loaded = [cache objectFromJSONFileAtPath:path];
+    XCTAssertNotNil(loaded);
+    XCTAssertFalse(loaded.pd_isFrozen);
+    XCTAssertEqual(cache.totalCost, 0);
+}
+
+@end
@@ -0,0 +1,144 @@
+//
+// PrestoDataEditTests.m
+//
+// Copyright (c) 2015 Daniel Hall
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+
+#import <XCTest/XCTest.h>
+#import "PrestoData.h"
+
+@interface PrestoDataEditTests : XCTestCase
+
+@end
+
+@implementation PrestoDataEditTests
+
+- (NSString *)resourcePath
+{
+    return [[NSBundle mainBundle] pathForResource:@"test" ofType:@"json"];
+}
+
+- (NSMutableDictionary *)loadedResource
+{
+    return [NSMutableDictionary pd_dictionaryFromJSONData:[NSData dataWithContentsOfFile:[self resourcePath]]];
+}
+
+- (NSArray *)edits
+{
+    NSMutableDictionary *note = [NSMutableDictionary dictionary];
+    [note pd_setValue:@"reviewed" forAttribute:@"status"];
+
+    return @[[PDEdit editSettingValue:@"10%" forAttribute:@"discount" filteredBy:@"/bookstore/book"],
+             [PDEdit editRemovingAttributeNamed:@"year" filteredBy:@"/bookstore/book[price>35]"],
+             [PDEdit editAddingElement:note named:@"note" filteredBy:@"/bookstore/book[@category='WEB']"],
+             [PDEdit editSettingValue:@"de" forAttribute:@"lang" filteredBy:@"/bookstore/book/title"],
+             [PDEdit editSettingValue:@"yes" forAttribute:@"checked" filteredBy:@"/bookstore/book/note"],
+             [PDEdit editRemovingElementNamed:@"title" filteredBy:@"/bookstore/book[@category='COOKING']"],
+             [PDEdit editSettingValue:@"open" forAttribute:@"state" filteredBy:nil]];
+}
+
+- (void)testBatchMatchesSequentialEdits
+{
+    NSMutableDictionary *expected = [self loadedResource];
+    NSMutableDictionary *note = [NSMutableDictionary dictionary];
+    [note pd_setValue:@"reviewed" forAttribute:@"status"];
+
+    [[expected pd_filterWithXPath:@"/bookstore/book"] pd_setValue:@"10%" forAttribute:@"discount"];
+    [[expected pd_filterWithXPath:@"/bookstore/book[price>35]"] pd_deleteAttribute:@"year"];
+    [[expected pd_filterWithXPath:@"/bookstore/book[@category='WEB']"] pd_addElement:note withName:@"note"];
+    [[expected pd_filterWithXPath:@"/bookstore/book/title"] pd_setValue:@"de" forAttribute:@"lang"];
+    [[expected pd_filterWithXPath:@"/bookstore/book/note"] pd_setValue:@"yes" forAttribute:@"checked"];
+    [[expected pd_filterWithXPath:@"/bookstore/book[@category='COOKING']"] pd_removeElementNamed:@"title"];
+    [expected pd_setValue:@"open" forAttribute:@"state"];
+
+    NSMutableDictionary *batched = [PrestoData objectFromJSON:[self resourcePath] applyingEdits:[self edits]];
+    XCTAssertTrue([batched pd_isEqualToDictionary:expected]);
+    XCTAssertEqual([batched pd_filterWithXPath:@"/bookstore/book/note[@checked='yes']"].count, 2);
+}
+
+- (void)testEditsSeeEarlierStructuralChanges
+{
+    NSMutableDictionary *dictionary = [self loadedResource];
+    NSArray *edits = @[[PDEdit editSettingValue:@"de" forAttribute:@"lang" filteredBy:@"/bookstore/book/title"],
+                       [PDEdit editSettingValue:@"x" forAttribute:@"title" filteredBy:@"/bookstore/book"],
+                       [PDEdit editSettingValue:@"b" forAttribute:@"flag" filteredBy:@"/bookstore/book/title"],
+                       [PDEdit editRemovingElementNamed:@"book" filteredBy:@"/bookstore"],
+                       [PDEdit editSettingValue:@"c" forAttribute:@"flag" filteredBy:@"/bookstore/book"]];
+
+    [PDEdit applyEdits:edits toObject:dictionary];
+
+    XCTAssertNil([dictionary pd_filterWithXPath:@"/bookstore/book"]);
+    XCTAssertNil([dictionary pd_filterWithXPath:@"//*[@flag]"]);
+}
+
+- (void)testApplyingEditsWritesFile
+{
+    NSString *path = [NSTemporaryDirectory() stringByAppendingPathComponent:@"PrestoDataEdits.json"];
+    [[NSFileManager defaultManager] removeItemAtPath:path error:NULL];
+    [[NSFileManager defaultManager] copyItemAtPath:[self resourcePath] toPath:path error:NULL];
+
+    NSError *error = nil;
+    XCTAssertTrue([PrestoData applyEdits:[self edits] toJSONFile:path writingToFile:path options:PDWritingOptionsCompact error:&error]);
+    XCTAssertNil(error);
+
+    NSMutableDictionary *written = [NSMutableDictionary pd_dictionaryFromJSONData:[NSData dataWithContentsOfFile:path]];
+    XCTAssertTrue([written pd_isEqualToDictionary:[PrestoData objectFromJSON:[self resourcePath] applyingEdits:[self edits]]]);
+
+    [[NSFileManager defaultManager] removeItemAtPath:path error:NULL];
+    XCTAssertFalse([PrestoData applyEdits:[self edits] toJSONFile:path writingToFile:path options:PDWritingOptionsNone error:&error]);
+    XCTAssertEqualObjects(error.domain, PrestoDataErrorDomain);
+    XCTAssertEqual(error.code, PrestoDataErrorReadFailed);
+}
+
+- (void)testDiffChangesEarlierCopyIntoCurrent
+{
+    NSMutableDictionary *original = [self loadedResource];
+    NSMutableDictionary *current = [original pd_copy];
+    XCTAssertEqual([current pd_diffAgainst:original].count, 0);
+
+    NSMutableDictionary *bookstore = current[@"bookstore"];
+    NSMutableDictionary *note = [NSMutableDictionary dictionary];
+    [note pd_setValue:@"new" forAttribute:@"status"];
+    [[current pd_filterWithXPath:@"/bookstore/book[1]"] pd_setValue:@35 forAttribute:@"price"];
+    [[current pd_filterWithXPath:@"/bookstore/book[3]/title"] pd_setInnerValue:@"XQuery"];
+    [[current pd_filterWithXPath:@"/bookstore/book[4]"] pd_deleteAttribute:@"year"];
+    [[current pd_filterWithXPath:@"/bookstore/book[4]"] pd_addElement:note withName:@"note"];
+    [bookstore pd_removeElement:[current pd_filterWithXPath:@"/bookstore/book[2]"].firstObject];
+    [current pd_setValue:@"open" forAttribute:@"state"];
+
+    NSArray *edits = [current pd_diffAgainst:original];
+    XCTAssertEqual(edits.count, 6);
+
+    NSMutableDictionary *updated = [self loadedResource];
+    [PDEdit applyEdits:edits toObject:updated];
+    XCTAssertTrue([updated pd_isEqualToDictionary:current]);
+    XCTAssertTrue([[self loadedResource] pd_isEqualToDictionary:original], @"diffing shouldn't change either dictionary");
+
+    // Keys that have to change order are removed and added again
+    NSMutableDictionary *reordered = [NSMutableDictionary dictionary];
+    [reordered pd_setValue:@"open" forAttribute:@"state"];
+    [reordered pd_addElement:[bookstore pd_copy] withName:@"bookstore"];
+    [PDEdit applyEdits:[reordered pd_diffAgainst:updated] toObject:updated];
+    XCTAssertTrue([updated pd_isEqualToDictionary:reordered]);
+}
+
+@end
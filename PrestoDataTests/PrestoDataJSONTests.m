@@ -0,0 +1,259 @@
+//
+// PrestoDataJSONTests.m
+//
+// Copyright (c) 2015 Daniel Hall
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+
+#import <XCTest/XCTest.h>
+#import "NSMutableDictionary+PrestoData.h"
+#import "NSMutableDictionary+_PrestoData_Internal.h"
+#import "NSArray+PrestoData.h"
+#import "PrestoData.h"
+#import "PDNameMatcher.h"
+
+@interface PrestoDataJSONTests : XCTestCase
+
+@end
+
+@implementation PrestoDataJSONTests
+
+- (void)testEscapedStrings
+{
+    NSData *jsonData = [@"{ \"quote\" : \"say \\\"hi\\\"\", \"path\" : \"a\\\\b\\/c\", \"lines\" : \"one\\ntwo\", \"unicode\" : \"caf\\u00e9 \\ud83d\\ude00\" }" dataUsingEncoding:NSUTF8StringEncoding];
+    NSMutableDictionary *dictionary = [NSMutableDictionary pd_dictionaryFromJSONData:jsonData];
+    XCTAssertEqualObjects(dictionary[@"quote"], @"say \"hi\"");
+    XCTAssertEqualObjects(dictionary[@"path"], @"a\\b/c");
+    XCTAssertEqualObjects(dictionary[@"lines"], @"one\ntwo");
+    XCTAssertEqualObjects(dictionary[@"unicode"], @"café \U0001F600");
+}
+
+- (void)testBooleansAndNumbers
+{
+    NSData *jsonData = [@"{\"yes\":true,\"no\":false,\"count\":-12,\"ratio\":2.5e1,\"nothing\":null}" dataUsingEncoding:NSUTF8StringEncoding];
+    NSMutableDictionary *dictionary = [NSMutableDictionary pd_dictionaryFromJSONData:jsonData];
+    NSArray *expectedKeys = @[@"yes", @"no", @"count", @"ratio"];
+    XCTAssertEqualObjects(dictionary.pd_orderedKeys, expectedKeys);
+    XCTAssertEqualObjects(dictionary[@"yes"], @YES);
+    XCTAssertEqualObjects(dictionary[@"no"], @NO);
+    XCTAssertEqual([dictionary[@"count"] integerValue], -12);
+    XCTAssertEqual([dictionary[@"ratio"] doubleValue], 25.0);
+}
+
+- (void)testNumbersKeepTheirTypeAndPrecision
+{
+    NSString *json = @"{\"id\":9007199254740993,\"big\":18446744073709551615,\"min\":-9223372036854775808,\"ratio\":0.1,\"third\":0.3333333333333333,\"flag\":true}";
+    NSMutableDictionary *dictionary = [NSMutableDictionary pd_dictionaryFromJSONData:[json dataUsingEncoding:NSUTF8StringEncoding]];
+    XCTAssertEqual([dictionary[@"id"] longLongValue], 9007199254740993LL);
+    XCTAssertEqual([dictionary[@"big"] unsignedLongLongValue], ULLONG_MAX);
+    XCTAssertEqual([dictionary[@"min"] longLongValue], LLONG_MIN);
+    XCTAssertEqual([dictionary[@"ratio"] doubleValue], 0.1);
+
+    // Integers are written exactly, doubles in the fewest digits that read back the same, and booleans as booleans
+    NSString *written = [[NSString alloc] initWithData:[dictionary pd_jsonDataWithOptions:PDWritingOptionsCompact] encoding:NSUTF8StringEncoding];
+    XCTAssertEqualObjects(written, json);
+}
+
+- (void)testNestingAndInnerValues
+{
+    NSData *jsonData = [@"{\"store\":{\"book\":[{\"title\":{\"lang\":\"en\",\"text\":\"Learning XML\"}},{\"title\":\"Second\"}]}}" dataUsingEncoding:NSUTF8StringEncoding];
+    NSMutableDictionary *dictionary = [NSMutableDictionary pd_dictionaryFromJSONData:jsonData keyForInnerValue:@"text"];
+    NSArray *books = dictionary[@"store"][@"book"];
+    XCTAssertEqual(books.count, 2);
+    NSMutableDictionary *title = books[0][@"title"];
+    XCTAssertEqualObjects(title.pd_innerValue, @"Learning XML");
+    XCTAssertEqualObjects(title.pd_orderedKeys, @[@"lang"]);
+    XCTAssertEqualObjects(title.pd_elementName, @"title");
+    XCTAssertEqual(title.pd_parentDictionary, books[0]);
+    XCTAssertEqualObjects(((NSMutableDictionary *) books[1]).pd_elementName, @"book");
+}
+
+- (void)testArrayRoot
+{
+    NSData *jsonData = [@" [ {\"a\" : 1}, \"two\", 3 ] " dataUsingEncoding:NSUTF8StringEncoding];
+    XCTAssertNil([NSMutableDictionary pd_dictionaryFromJSONData:jsonData]);
+    NSArray *array = [NSArray pd_arrayFromJSONData:jsonData];
+    XCTAssertEqual(array.count, 3);
+    XCTAssertEqualObjects(((NSMutableDictionary *) array[1]).pd_innerValue, @"two");
+    XCTAssertEqualObjects(((NSMutableDictionary *) array[2]).pd_innerValue, @3);
+}
+
+- (void)testMalformedInput
+{
+    XCTAssertNil([NSMutableDictionary pd_dictionaryFromJSONData:[@"{\"a\" : }" dataUsingEncoding:NSUTF8StringEncoding]]);
+    XCTAssertNil([NSMutableDictionary pd_dictionaryFromJSONData:[@"{\"a\" : \"unterminated}" dataUsingEncoding:NSUTF8StringEncoding]]);
+    XCTAssertNil([NSArray pd_arrayFromJSONData:[@"[1, 2" dataUsingEncoding:NSUTF8StringEncoding]]);
+}
+
+- (void)testResourceMatchesXML
+{
+    NSData *jsonData = [NSData dataWithContentsOfFile:[[NSBundle mainBundle] pathForResource:@"test" ofType:@"json"]];
+    NSMutableDictionary *dictionary = [NSMutableDictionary pd_dictionaryFromJSONData:jsonData];
+    NSArray *titles = [dictionary pd_filterWithXPath:@"/bookstore/book/title"];
+    XCTAssertEqual(titles.count, 4);
+    XCTAssertEqualObjects(((NSMutableDictionary *) titles[1]).pd_innerValue, @"Harry Potter");
+}
+
+- (void)testLoadingFileDetectsArrayRoot
+{
+    NSString *path = [NSTemporaryDirectory() stringByAppendingPathComponent:@"PrestoDataArrayRoot.json"];
+    [[@"  \n[{\"name\" : \"a\"}, {\"name\" : \"b\"}]" dataUsingEncoding:NSUTF8StringEncoding] writeToFile:path atomically:YES];
+
+    NSArray *array = [PrestoData objectFromJSON:path filteredBy:nil withNewValue:@"c" forAttribute:@"flag"];
+    XCTAssertTrue([array isKindOfClass:[NSArray class]]);
+    XCTAssertEqual(array.count, 2);
+    XCTAssertEqualObjects(array[1][@"flag"], @"c");
+
+    [[NSFileManager defaultManager] removeItemAtPath:path error:NULL];
+    XCTAssertNil([PrestoData objectFromJSON:path filteredBy:nil withNewValue:@"c" forAttribute:@"flag"]);
+}
+
+- (void)testConcurrentArrayParsingMatchesSerial
+{
+    NSMutableString *json = [NSMutableString stringWithString:@"["];
+    for (NSUInteger i = 0; i < 40000; i++)
+    {
+        [json appendFormat:@"%@{\"id\" : %lu, \"note\" : \"a, [b] {c} \\\" ,\", \"tag\" : {\"innerValue\" : \"t%lu\"}, \"items\" : [1, \"x\"]}", i ? @"," : @"", (unsigned long)i, (unsigned long)i];
+        if (i % 1000 == 0)
+        {
+            [json appendString:@", \"scalar\", {}"];
+        }
+    }
+    [json appendString:@"]"];
+    NSData *jsonData = [json dataUsingEncoding:NSUTF8StringEncoding];
+
+    NSArray *serial = [NSArray pd_arrayFromJSONData:jsonData];
+    NSArray *concurrent = [NSArray pd_arrayFromJSONData:jsonData options:PDParsingOptionsConcurrent];
+    XCTAssertEqual(serial.count, 40040);
+    XCTAssertTrue([concurrent pd_isEqualToArray:serial]);
+    NSMutableDictionary *tag = concurrent[40039][@"tag"];
+    XCTAssertEqualObjects(tag.pd_innerValue, @"t39999");
+    XCTAssertEqualObjects(tag.pd_elementName, @"tag");
+    XCTAssertEqual(tag.pd_parentDictionary, concurrent[40039]);
+    XCTAssertEqual([concurrent[0] pd_orderedKeys].lastObject, [concurrent[40039] pd_orderedKeys].lastObject, @"chunks should share the document's keys");
+    XCTAssertEqual(((NSMutableDictionary *) concurrent[0][@"tag"]).pd_elementName, tag.pd_elementName);
+
+    // Malformed items are still caught when they fall inside a chunk
+    [json replaceCharactersInRange:NSMakeRange([json rangeOfString:@",{\"id\" : 20000,"].location, 0) withString:@","];
+    XCTAssertNil([NSArray pd_arrayFromJSONData:[json dataUsingEncoding:NSUTF8StringEncoding] options:PDParsingOptionsConcurrent]);
+}
+
+- (void)testKeysAndNamesAreInterned
+{
+    NSData *jsonData = [@"[{\"record\" : {\"status\" : \"a\"}}, {\"record\" : {\"status\" : \"b\"}}]" dataUsingEncoding:NSUTF8StringEncoding];
+    NSArray *first = [NSArray pd_arrayFromJSONData:jsonData];
+    NSArray *second = [NSArray pd_arrayFromJSONData:jsonData];
+
+    NSString *firstKey = [first[0] pd_orderedKeys].firstObject;
+    XCTAssertEqual(firstKey, [first[1] pd_orderedKeys].firstObject, @"repeated keys should share one instance");
+    XCTAssertEqual([first[0][@"record"] pd_orderedKeys].firstObject, [first[1][@"record"] pd_orderedKeys].firstObject);
+    XCTAssertEqual(((NSMutableDictionary *) first[0][@"record"]).pd_elementName, firstKey);
+
+    // Each document interns its own names, so nothing it parsed outlives it
+    XCTAssertEqualObjects(firstKey, [second[0] pd_orderedKeys].firstObject);
+    XCTAssertEqual([second[0] pd_orderedKeys].firstObject, [second[1] pd_orderedKeys].firstObject);
+    XCTAssertEqualObjects([PDNameMatcher matcherWithPattern:@"record"].exactName, firstKey);
+
+    NSData *xmlData = [@"<list><record status=\"a\"/><record status=\"b\"/></list>" dataUsingEncoding:NSUTF8StringEncoding];
+    NSArray *records = [[NSMutableDictionary pd_dictionaryFromXMLData:xmlData] pd_filterWithXPath:@"/list/record"];
+    XCTAssertEqualObjects(((NSMutableDictionary *) records[0]).pd_elementName, firstKey);
+    XCTAssertEqual(((NSMutableDictionary *) records[0]).pd_elementName, ((NSMutableDictionary *) records[1]).pd_elementName);
+}
+
+- (void)testLazyParsingMatchesFullParse
+{
+    NSString *json = @"{\"store\" : {\"name\" : \"Main\", \"innerValue\" : \"shop\", \"empty\" : {}, \"nested\" : {\"gone\" : {\"nothing\" : null}}, \"\" : \"unnamed\", "
+                     "\"book\" : [{\"title\" : \"A\", \"price\" : 5}, {}, [1, 2], \"loose\", \"\", 7, null, {\"title\" : \"B\", \"tags\" : {\"tag\" : [\"x\", \"y\"]}}], "
+                     "\"book\" : {\"title\" : \"C\", \"innerValue\" : 3}, \"flag\" : true, \"flag\" : false}}";
+    NSData *jsonData = [json dataUsingEncoding:NSUTF8StringEncoding];
+
+    NSMutableDictionary *full = [NSMutableDictionary pd_dictionaryFromJSONData:jsonData];
+    NSMutableDictionary *lazy = [NSMutableDictionary pd_dictionaryFromJSONData:jsonData options:PDParsingOptionsLazy];
+    XCTAssertEqualObjects([lazy[@"store"] pd_innerValue], @"shop");
+    XCTAssertEqual([lazy pd_filterWithXPath:@"/store/book[@title='B']/tags/tag"].count, 2);
+    XCTAssertEqualObjects([[lazy pd_filterWithXPath:@"/store/book[@price > 4]"].firstObject objectForKey:@"title"], @"A");
+    XCTAssertEqualObjects([lazy pd_jsonDataWithOptions:PDWritingOptionsCompact], [full pd_jsonDataWithOptions:PDWritingOptionsCompact]);
+    XCTAssertTrue([lazy pd_isEqualToDictionary:full]);
+    XCTAssertEqual([[lazy pd_filterWithXPath:@"/store/book"].lastObject pd_parentDictionary], lazy[@"store"]);
+
+    NSData *arrayData = [@"[{\"a\" : {\"b\" : 1}}, \"s\", {}, {\"a\" : 2}]" dataUsingEncoding:NSUTF8StringEncoding];
+    XCTAssertTrue([[NSArray pd_arrayFromJSONData:arrayData options:PDParsingOptionsLazy] pd_isEqualToArray:[NSArray pd_arrayFromJSONData:arrayData]]);
+
+    XCTAssertNil([NSMutableDictionary pd_dictionaryFromJSONData:[@"{\"a\" : {\"b\" : [1,]}}" dataUsingEncoding:NSUTF8StringEncoding] options:PDParsingOptionsLazy]);
+    XCTAssertNil([NSMutableDictionary pd_dictionaryFromJSONData:[@"{\"a\" : {}}" dataUsingEncoding:NSUTF8StringEncoding] options:PDParsingOptionsLazy]);
+    XCTAssertNil([NSArray pd_arrayFromJSONData:[@"[{\"a\" : 1}" dataUsingEncoding:NSUTF8StringEncoding] options:PDParsingOptionsLazy]);
+}
+
+- (void)testLazyParsingOnlyBuildsWhatIsUsed
+{
+    NSMutableString *json = [NSMutableString stringWithString:@"{\"records\" : {\"record\" : ["];
+    for (NSUInteger i = 0; i < 10000; i++)
+    {
+        [json appendFormat:@"%@{\"id\" : %lu, \"detail\" : {\"innerValue\" : \"d%lu\", \"more\" : {\"x\" : 1}}}", i ? @"," : @"", (unsigned long)i, (unsigned long)i];
+    }
+    [json appendString:@"]}}"];
+    NSData *jsonData = [json dataUsingEncoding:NSUTF8StringEncoding];
+
+    [PDStats setEnabled:YES];
+    [PDStats resetCurrentThreadCounters];
+    NSMutableDictionary *lazy = [NSMutableDictionary pd_dictionaryFromJSONData:jsonData options:PDParsingOptionsLazy];
+    NSMutableDictionary *detail = [lazy pd_filterWithXPath:@"/records/record[last()]/detail"].firstObject;
+    uint64_t nodesCreated = [PDStats currentThreadCounters].nodesCreated;
+    [PDStats setEnabled:NO];
+
+    XCTAssertEqualObjects(detail.pd_innerValue, @"d9999");
+    XCTAssertEqualObjects(detail.pd_parentDictionary[@"id"], @9999);
+    // The root, the records element, every record, and one detail, but none of the other details or anything inside them
+    XCTAssertEqual(nodesCreated, 10003);
+}
+
+- (void)testLazyDictionariesLoadOnSeveralThreads
+{
+    NSMutableString *json = [NSMutableString stringWithString:@"{\"records\" : {\"record\" : ["];
+    for (NSUInteger i = 0; i < 500; i++)
+    {
+        [json appendFormat:@"%@{\"id\" : %lu, \"detail\" : {\"name\" : \"d%lu\", \"more\" : {\"x\" : %lu}}}", i ? @"," : @"", (unsigned long)i, (unsigned long)i, (unsigned long)i];
+    }
+    [json appendString:@"]}}"];
+    NSData *jsonData = [json dataUsingEncoding:NSUTF8StringEncoding];
+
+    NSMutableDictionary *lazy = [NSMutableDictionary pd_dictionaryFromJSONData:jsonData options:PDParsingOptionsLazy];
+    NSArray *records = lazy[@"records"][@"record"];
+    __block NSUInteger mismatches = 0;
+
+    // Each record is read by several threads at once, and different records load at the same time
+    dispatch_apply(2000, dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0), ^(size_t iteration) {
+        NSUInteger index = iteration % records.count;
+        NSMutableDictionary *detail = records[index][@"detail"];
+        if (![detail[@"more"][@"x"] isEqual:@(index)] || ![detail[@"name"] isEqualToString:[NSString stringWithFormat:@"d%lu", (unsigned long)index]])
+        {
+            @synchronized (records)
+            {
+                mismatches++;
+            }
+        }
+    });
+
+    XCTAssertEqual(mismatches, 0);
+    XCTAssertTrue([lazy pd_isEqualToDictionary:[NSMutableDictionary pd_dictionaryFromJSONData:jsonData]]);
+}
+
+@end
@@ -0,0 +1,293 @@
+//
+// PrestoDataNodeTests.m
+//
+// Copyright (c) 2015 Daniel Hall
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+
+#import <XCTest/XCTest.h>
+#import "NSMutableDictionary+PrestoData.h"
+#import "NSMutableDictionary+_PrestoData_Internal.h"
+#import "NSArray+PrestoData.h"
+#import "NSArray+_PrestoData_Internal.h"
+#import "PDNode.h"
+
+@interface PrestoDataNodeTests : XCTestCase
+
+@end
+
+@implementation PrestoDataNodeTests
+
+- (void)testParsersAndCopiesCreateNodes
+{
+    NSData *jsonData = [@"{\"book\":{\"title\":\"Dune\",\"year\":1965}}" dataUsingEncoding:NSUTF8StringEncoding];
+    NSMutableDictionary *dictionary = [NSMutableDictionary pd_dictionaryFromJSONData:jsonData];
+    XCTAssert([dictionary isKindOfClass:[PDNode class]]);
+    XCTAssert([dictionary[@"book"] isKindOfClass:[PDNode class]]);
+    XCTAssertEqual([dictionary[@"book"] pd_parentDictionary], dictionary);
+    XCTAssertEqualObjects([dictionary[@"book"] pd_elementName], @"book");
+
+    NSString *xmlPath = [[NSBundle mainBundle] pathForResource:@"test" ofType:@"xml"];
+    NSMutableDictionary *xmlDictionary = [NSMutableDictionary pd_dictionaryFromXMLData:[NSData dataWithContentsOfFile:xmlPath]];
+    XCTAssert([xmlDictionary[@"bookstore"] isKindOfClass:[PDNode class]]);
+
+    NSMutableDictionary *copy = [dictionary pd_copy];
+    XCTAssert([copy isKindOfClass:[PDNode class]]);
+    XCTAssert([copy pd_isEqualToDictionary:dictionary]);
+}
+
+- (void)testNodeBehavesAsOrderedDictionary
+{
+    PDNode *node = [PDNode dictionary];
+    [node pd_setValue:@"z" forAttribute:@"last"];
+    [node pd_setValue:@"a" forAttribute:@"first"];
+    [node pd_setInnerValue:@"inner"];
+    [node pd_setValue:@"y" forAttribute:@"last"];
+
+    NSArray *expectedKeys = @[@"last", @"first"];
+    XCTAssertEqualObjects(node.pd_orderedKeys, expectedKeys);
+    XCTAssertEqualObjects(node.allKeys, expectedKeys);
+    XCTAssertEqualObjects(node[@"last"], @"y");
+    XCTAssertEqual(node.count, 2);
+    XCTAssertEqualObjects(node.pd_innerValue, @"inner");
+
+    [node pd_deleteAttribute:@"last"];
+    XCTAssertEqualObjects(node.pd_orderedKeys, @[@"first"]);
+    XCTAssertNil(node[@"last"]);
+
+    NSDictionary *expected = @{@"first" : @"a"};
+    XCTAssertEqualObjects([node copy], expected);
+}
+
+- (void)testWideNodeRemovalKeepsOrder
+{
+    PDNode *node = [PDNode dictionary];
+    for (NSUInteger i = 0; i < 1000; i++)
+    {
+        [node pd_setValue:@(i) forAttribute:[NSString stringWithFormat:@"attribute%lu", (unsigned long)i]];
+    }
+
+    for (NSUInteger i = 0; i < 1000; i += 2)
+    {
+        [node pd_deleteAttribute:[NSString stringWithFormat:@"attribute%lu", (unsigned long)i]];
+    }
+
+    XCTAssertEqual(node.count, 500);
+    XCTAssertEqual(node.pd_orderedKeys.count, 500);
+    XCTAssertEqualObjects(node.pd_orderedKeys[0], @"attribute1");
+    XCTAssertEqualObjects(node.pd_orderedKeys[499], @"attribute999");
+    XCTAssertNil(node[@"attribute500"]);
+    XCTAssertEqualObjects(node[@"attribute501"], @501);
+
+    NSUInteger expected = 1;
+    for (NSString *key in node)
+    {
+        XCTAssertEqualObjects(key, ([NSString stringWithFormat:@"attribute%lu", (unsigned long)expected]));
+        expected += 2;
+    }
+    XCTAssertEqual(expected, 1001);
+
+    [node pd_setValue:@"again" forAttribute:@"attribute0"];
+    XCTAssertEqualObjects(node.pd_orderedKeys.lastObject, @"attribute0");
+}
+
+- (void)testReadingKeysByIndexDoesNotMutate
+{
+    PDNode *node = [PDNode dictionary];
+    for (NSUInteger i = 0; i < 100; i++)
+    {
+        [node pd_setValue:@(i) forAttribute:[NSString stringWithFormat:@"attribute%lu", (unsigned long)i]];
+    }
+    for (NSUInteger i = 0; i < 100; i += 10)
+    {
+        [node pd_deleteAttribute:[NSString stringWithFormat:@"attribute%lu", (unsigned long)i]];
+    }
+
+    NSUInteger order = [node pd_orderOfOrderedKey:@"attribute55"];
+    NSUInteger index = 0;
+    for (NSString *key in node)
+    {
+        XCTAssertEqualObjects(node.pd_orderedKeys[index], key);
+        XCTAssertEqual([node.pd_orderedKeys indexOfObject:key], index);
+        index++;
+    }
+    XCTAssertEqual(index, 90);
+    XCTAssertEqual([node pd_orderOfOrderedKey:@"attribute55"], order);
+}
+
+- (void)testRemovingOneOfEqualSiblings
+{
+    PDNode *parent = [PDNode dictionary];
+    PDNode *first = [PDNode dictionary];
+    PDNode *second = [PDNode dictionary];
+    [parent pd_addElement:first withName:@"item"];
+    [parent pd_addElement:second withName:@"item"];
+
+    [second pd_removeFromParentDictionary];
+
+    NSArray *items = parent[@"item"];
+    XCTAssertEqual(items.count, 1);
+    XCTAssertEqual(items.firstObject, first);
+}
+
+- (void)testRemovingStoredElementArrayFromParent
+{
+    PDNode *parent = [PDNode dictionary];
+    PDNode *other = [PDNode dictionary];
+    for (NSUInteger i = 0; i < 3; i++)
+    {
+        [parent pd_addElement:[PDNode dictionary] withName:@"item"];
+    }
+    [parent pd_addElement:other withName:@"other"];
+
+    XCTAssertNoThrow([parent[@"item"] pd_removeFromParentDictionary]);
+    XCTAssertNil(parent[@"item"]);
+    XCTAssertEqual(parent[@"other"], other);
+
+    [parent pd_removeElement:other];
+    PDNode *replacement = [PDNode dictionary];
+    [parent pd_addElement:replacement withName:@"other"];
+    [parent pd_removeElement:other];
+    XCTAssertEqual(parent[@"other"], replacement, @"A removed element shouldn't remove a sibling that took its name");
+}
+
+- (void)testCopiesAreCopiedOnWrite
+{
+    NSString *xmlPath = [[NSBundle mainBundle] pathForResource:@"test" ofType:@"xml"];
+    NSMutableDictionary *original = [NSMutableDictionary pd_dictionaryFromXMLData:[NSData dataWithContentsOfFile:xmlPath]];
+    NSMutableDictionary *snapshot = [NSMutableDictionary pd_dictionaryFromXMLData:[NSData dataWithContentsOfFile:xmlPath]];
+
+    NSMutableDictionary *copy = [original pd_copy];
+    [[copy pd_filterWithXPath:@"/bookstore/book[@category='WEB']/title"] pd_setValue:@"de" forAttribute:@"lang"];
+    XCTAssertEqual([copy pd_filterWithXPath:@"//title[@lang='de']"].count, 2);
+    XCTAssertTrue([original pd_isEqualToDictionary:snapshot]);
+
+    // Changes to the original before the copy has been read are still kept out of it
+    NSMutableDictionary *untouchedCopy = [original pd_copy];
+    NSMutableDictionary *copyOfCopy = [copy pd_copy];
+    [[original pd_filterWithXPath:@"/bookstore/book/title"] pd_setInnerValue:@"Changed"];
+    [original[@"bookstore"] pd_removeElement:[original pd_filterWithXPath:@"/bookstore/book"].firstObject];
+    XCTAssertTrue([untouchedCopy pd_isEqualToDictionary:snapshot]);
+    XCTAssertEqual([copyOfCopy pd_filterWithXPath:@"//title[@lang='de']"].count, 2);
+    XCTAssertEqual([copyOfCopy pd_filterWithXPath:@"/bookstore/book"].count, 4);
+
+    // Changes to a copy are kept out of copies made from it earlier
+    [[copy pd_filterWithXPath:@"/bookstore/book"] pd_setValue:@"sold" forAttribute:@"status"];
+    XCTAssertNil([copyOfCopy pd_filterWithXPath:@"/bookstore/book[@status='sold']"]);
+    XCTAssertEqual([copyOfCopy[@"bookstore"] pd_parentDictionary], copyOfCopy);
+}
+
+- (void)testEqualityFollowsChanges
+{
+    NSString *jsonPath = [[NSBundle mainBundle] pathForResource:@"test" ofType:@"json"];
+    NSMutableDictionary *dictionary = [NSMutableDictionary pd_dictionaryFromJSONData:[NSData dataWithContentsOfFile:jsonPath]];
+    NSMutableDictionary *other = [NSMutableDictionary pd_dictionaryFromJSONData:[NSData dataWithContentsOfFile:jsonPath]];
+    XCTAssertTrue([dictionary pd_isEqualToDictionary:other]);
+    XCTAssertEqual(dictionary.pd_structuralHash, other.pd_structuralHash);
+
+    // Attribute values are compared, and a change deep inside invalidates the hashes kept on the way up
+    NSMutableDictionary *book = [other pd_filterWithXPath:@"/bookstore/book[3]"].firstObject;
+    [book pd_setValue:@50.99 forAttribute:@"price"];
+    XCTAssertFalse([dictionary pd_isEqualToDictionary:other]);
+    [book pd_setValue:@49.99 forAttribute:@"price"];
+    XCTAssertTrue([dictionary pd_isEqualToDictionary:other]);
+
+    [[other pd_filterWithXPath:@"/bookstore/book[3]/author[2]"].firstObject pd_setInnerValue:@"Someone Else"];
+    XCTAssertFalse([dictionary pd_isEqualToDictionary:other]);
+
+    NSMutableDictionary *copy = [dictionary pd_copy];
+    XCTAssertTrue([copy pd_isEqualToDictionary:dictionary]);
+    [copy[@"bookstore"] pd_removeElement:[copy pd_filterWithXPath:@"/bookstore/book[1]"].firstObject];
+    XCTAssertFalse([copy pd_isEqualToDictionary:dictionary]);
+}
+
+- (void)testFrozenDictionariesAreSharedBetweenThreads
+{
+    NSString *jsonPath = [[NSBundle mainBundle] pathForResource:@"test" ofType:@"json"];
+    NSMutableDictionary *dictionary = [NSMutableDictionary pd_dictionaryFromJSONData:[NSData dataWithContentsOfFile:jsonPath] options:PDParsingOptionsLazy];
+    [dictionary[@"bookstore"] pd_addElement:[[NSMutableDictionary dictionary] pd_setValue:@"Sale" forAttribute:@"label"] withName:@"shelf"];
+
+    NSMutableDictionary *frozen = [dictionary pd_freeze];
+    XCTAssertEqual(frozen, dictionary);
+    XCTAssertTrue(frozen.pd_isFrozen);
+
+    // Plain dictionaries inside are replaced by frozen nodes in the same place
+    NSMutableDictionary *shelf = frozen[@"bookstore"][@"shelf"];
+    XCTAssertTrue([shelf isKindOfClass:[PDNode class]]);
+    XCTAssertTrue(shelf.pd_isFrozen);
+    XCTAssertEqual(shelf.pd_parentDictionary, frozen[@"bookstore"]);
+    NSArray *books = frozen[@"bookstore"][@"book"];
+    XCTAssertEqualObjects(books.pd_elementName, @"book");
+    XCTAssertEqual(books.pd_parentDictionary, frozen[@"bookstore"]);
+
+    NSString *json = [frozen pd_jsonString];
+    NSUInteger bookCount = [frozen pd_filterWithXPath:@"//book"].count;
+    __block int failures = 0;
+
+    dispatch_apply(16, dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0), ^(size_t iteration) {
+        NSMutableDictionary *copy = [frozen pd_copy];
+        [[copy pd_filterWithXPath:@"/bookstore/book"] pd_setValue:@"sold" forAttribute:@"status"];
+
+        if ([frozen pd_filterWithXPath:@"//book"].count != bookCount || ![[frozen pd_jsonString] isEqualToString:json] || [copy pd_filterWithXPath:@"//book[@status='sold']"].count != bookCount || [frozen pd_filterWithXPath:@"//book[@status='sold']"])
+        {
+            __atomic_fetch_add(&failures, 1, __ATOMIC_RELAXED);
+        }
+    });
+
+    XCTAssertEqual(failures, 0);
+
+    // Changes fail without changing anything, and elements can't be moved into other dictionaries
+    NSMutableDictionary *book = [frozen pd_filterWithXPath:@"/bookstore/book[1]"].firstObject;
+    XCTAssertThrowsSpecificNamed([book pd_setValue:@"sold" forAttribute:@"status"], NSException, NSInternalInconsistencyException);
+    XCTAssertThrowsSpecificNamed([frozen[@"bookstore"] pd_removeElement:book], NSException, NSInternalInconsistencyException);
+    XCTAssertThrowsSpecificNamed([frozen[@"bookstore"] pd_addElement:[PDNode dictionary] withName:@"book"], NSException, NSInternalInconsistencyException);
+    XCTAssertThrowsSpecificNamed([[PDNode dictionary] pd_addElement:book withName:@"book"], NSException, NSInternalInconsistencyException);
+    PDNode *outsider = [PDNode dictionary];
+    PDNode *outsiderParent = [PDNode dictionary];
+    [outsiderParent pd_addElement:outsider withName:@"outsider"];
+    XCTAssertThrowsSpecificNamed([frozen[@"bookstore"] pd_addElement:outsider withName:@"book"], NSException, NSInternalInconsistencyException);
+    XCTAssertEqual(outsider.pd_parentDictionary, outsiderParent, @"A rejected add should leave the element in its own tree");
+    XCTAssertEqualObjects(outsider.pd_elementName, @"outsider");
+    XCTAssertEqualObjects([frozen pd_jsonString], json);
+}
+
+- (void)testFreezingPlainDictionaryLeavesItUnchanged
+{
+    NSMutableDictionary *plain = [NSMutableDictionary dictionary];
+    NSMutableDictionary *book = [PDNode dictionary];
+    [book pd_setValue:@"A" forAttribute:@"title"];
+    [plain pd_addElement:book withName:@"book"];
+
+    // The frozen replacement gets copies of the nodes inside, and the originals stay where they were
+    NSMutableDictionary *frozen = [plain pd_freeze];
+    XCTAssertNotEqual(frozen, plain);
+    XCTAssertTrue(frozen.pd_isFrozen);
+    XCTAssertNotEqual(frozen[@"book"], book);
+    XCTAssertEqual([frozen[@"book"] pd_parentDictionary], frozen);
+    XCTAssertFalse(book.pd_isFrozen);
+    XCTAssertEqual(book.pd_parentDictionary, plain);
+
+    [book pd_setValue:@"B" forAttribute:@"title"];
+    XCTAssertEqualObjects(plain[@"book"][@"title"], @"B");
+    XCTAssertEqualObjects(frozen[@"book"][@"title"], @"A");
+}
+
+@end
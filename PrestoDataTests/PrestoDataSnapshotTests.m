@@ -0,0 +1,96 @@
+//
+// PrestoDataSnapshotTests.m
+//
+// Copyright (c) 2015 Daniel Hall
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+
+#import <XCTest/XCTest.h>
+#import "PrestoData.h"
+#import "NSMutableDictionary+_PrestoData_Internal.h"
+
+@interface PrestoDataSnapshotTests : XCTestCase
+
+@end
+
+@implementation PrestoDataSnapshotTests
+
+- (NSString *)temporaryPathNamed:(NSString *)name
+{
+    return [NSTemporaryDirectory() stringByAppendingPathComponent:name];
+}
+
+- (void)testDictionaryRoundTrip
+{
+    NSString *xmlPath = [[NSBundle mainBundle] pathForResource:@"test" ofType:@"xml"];
+    NSMutableDictionary *original = [NSMutableDictionary pd_dictionaryFromXMLData:[NSData dataWithContentsOfFile:xmlPath]];
+    [original[@"bookstore"] pd_setValue:@YES forAttribute:@"open"];
+    [original[@"bookstore"] pd_setValue:@(-12) forAttribute:@"offset"];
+    [original[@"bookstore"] pd_setValue:@(2.5) forAttribute:@"rating"];
+
+    NSString *path = [self temporaryPathNamed:@"PrestoDataSnapshot.pdsnap"];
+    NSError *error = nil;
+    XCTAssertTrue([original pd_writeBinarySnapshotToFile:path error:&error], @"%@", error);
+
+    NSMutableDictionary *loaded = [NSMutableDictionary pd_dictionaryFromBinarySnapshotAtPath:path];
+    XCTAssertTrue([loaded pd_isEqualToDictionary:original]);
+    XCTAssertEqualObjects(loaded[@"bookstore"][@"open"], @YES);
+    XCTAssertEqualObjects(loaded[@"bookstore"][@"offset"], @(-12));
+    XCTAssertEqualObjects(loaded[@"bookstore"][@"rating"], @(2.5));
+
+    NSArray *titles = [loaded pd_filterWithXPath:@"/bookstore/book/title"];
+    XCTAssertEqual(titles.count, 4);
+    XCTAssertEqualObjects(((NSMutableDictionary *) titles[1]).pd_innerValue, @"Harry Potter");
+    XCTAssertEqualObjects(((NSMutableDictionary *) titles[1]).pd_elementName, @"title");
+    XCTAssertEqualObjects([titles[1] pd_parentDictionary].pd_elementName, @"book");
+
+    // Loaded elements can be changed like parsed ones
+    [titles[0] pd_removeFromParentDictionary];
+    XCTAssertEqual([loaded pd_filterWithXPath:@"/bookstore/book/title"].count, 3);
+
+    [[NSFileManager defaultManager] removeItemAtPath:path error:NULL];
+}
+
+- (void)testArrayRoundTripAndRejectedFiles
+{
+    NSData *jsonData = [@"[{\"a\" : 1, \"b\" : {\"c\" : \"d\"}}, \"two\", {\"e\" : [{\"f\" : false}, {\"f\" : true}]}]" dataUsingEncoding:NSUTF8StringEncoding];
+    NSArray *original = [NSArray pd_arrayFromJSONData:jsonData];
+
+    NSString *path = [self temporaryPathNamed:@"PrestoDataArraySnapshot.pdsnap"];
+    XCTAssertTrue([original pd_writeBinarySnapshotToFile:path error:NULL]);
+
+    NSArray *loaded = [NSArray pd_arrayFromBinarySnapshotAtPath:path];
+    XCTAssertTrue([loaded pd_isEqualToArray:original]);
+    XCTAssertNil([NSMutableDictionary pd_dictionaryFromBinarySnapshotAtPath:path], @"an array snapshot isn't a dictionary");
+
+    // Anything that isn't a snapshot is turned away
+    [jsonData writeToFile:path atomically:YES];
+    XCTAssertNil([NSArray pd_arrayFromBinarySnapshotAtPath:path]);
+
+    NSError *error = nil;
+    XCTAssertFalse([@[@"not an element"] pd_writeBinarySnapshotToFile:path error:&error]);
+    XCTAssertEqualObjects(error.domain, PrestoDataErrorDomain);
+    XCTAssertEqual(error.code, PrestoDataErrorWriteFailed);
+
+    [[NSFileManager defaultManager] removeItemAtPath:path error:NULL];
+}
+
+@end
@@ -0,0 +1,95 @@
+//
+// PrestoDataStatsTests.m
+//
+// Copyright (c) 2015 Daniel Hall
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+
+#import <XCTest/XCTest.h>
+#import "PrestoData.h"
+
+@interface PrestoDataStatsTests : XCTestCase
+
+@end
+
+@implementation PrestoDataStatsTests
+
+- (void)tearDown
+{
+    [PDStats setEnabled:NO];
+    [PDStats setOperationHandler:nil];
+    [super tearDown];
+}
+
+- (void)testCountersTrackWorkOnTheCurrentThread
+{
+    NSData *json = [@"{\"store\" : {\"book\" : [{\"price\" : 5}, {\"price\" : 15}, {\"price\" : 25}]}}" dataUsingEncoding:NSUTF8StringEncoding];
+
+    [PDStats setEnabled:YES];
+    [PDStats resetCurrentThreadCounters];
+
+    NSMutableDictionary *dictionary = [NSMutableDictionary pd_dictionaryFromJSONData:json];
+    NSArray *books = [dictionary pd_filterWithXPath:@"/store/book[@price > 10.5]"];
+    NSData *output = [dictionary pd_jsonDataWithOptions:PDWritingOptionsCompact];
+
+    PDStatsCounters counters = [PDStats currentThreadCounters];
+    XCTAssertEqual(books.count, 2);
+    XCTAssertEqual(counters.bytesParsed, json.length);
+    XCTAssertEqual(counters.nodesCreated, 5);
+    XCTAssertEqual(counters.queriesCompiled, 1);
+    XCTAssertEqual(counters.queryStepsEvaluated, 2);
+    XCTAssertEqual(counters.nodesVisited, 4);
+    XCTAssertEqual(counters.predicateEvaluations, 3);
+    XCTAssertEqual(counters.bytesSerialized, output.length);
+    XCTAssertEqual(counters.operations[PDStatsOperationParse], 1);
+    XCTAssertEqual(counters.operations[PDStatsOperationQuery], 1);
+    XCTAssertEqual(counters.operations[PDStatsOperationSerialize], 1);
+
+    // Copies are made lazily, so copying the whole document creates a single node until the copy is read
+    [dictionary pd_copy];
+    XCTAssertEqual([PDStats currentThreadCounters].nodesCopied, 1);
+    XCTAssertEqualObjects([PDStats dictionaryWithCounters:[PDStats currentThreadCounters]][@"copyCount"], @1);
+
+    [PDStats setEnabled:NO];
+    [NSMutableDictionary pd_dictionaryFromJSONData:json];
+    XCTAssertEqual([PDStats currentThreadCounters].bytesParsed, json.length);
+    XCTAssertGreaterThanOrEqual([PDStats allThreadsCounters].bytesParsed, json.length);
+}
+
+- (void)testHandlerSeesOutermostOperations
+{
+    NSMutableArray *events = [NSMutableArray array];
+    [PDStats setOperationHandler:^(PDStatsOperation operation, NSString *detail, BOOL finished, uint64_t nanoseconds) {
+        [events addObject:[NSString stringWithFormat:@"%@ %lu %@", finished ? @"end" : @"begin", (unsigned long)operation, detail ? : @"-"]];
+    }];
+
+    NSMutableDictionary *dictionary = [NSMutableDictionary pd_dictionaryFromJSONData:[@"{\"a\" : {\"b\" : {\"c\" : 1}}}" dataUsingEncoding:NSUTF8StringEncoding]];
+    XCTAssertEqual(events.count, 0);
+
+    [PDStats setEnabled:YES];
+    [dictionary pd_filterWithXPath:@"/a/b"];
+    [dictionary pd_isEqualToDictionary:[dictionary pd_copy]];
+
+    NSArray *expected = @[@"begin 1 /a/b", @"end 1 /a/b", @"begin 3 -", @"end 3 -", @"begin 4 -", @"end 4 -"];
+    XCTAssertEqualObjects(events, expected);
+}
+
+@end
@@ -0,0 +1,108 @@
+//
+// PrestoDataStreamingTests.m
+//
+// Copyright (c) 2015 Daniel Hall
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+
+#import <XCTest/XCTest.h>
+#import "PrestoData.h"
+
+@interface PrestoDataStreamingTests : XCTestCase
+
+@end
+
+@implementation PrestoDataStreamingTests
+
+- (NSArray *)streamedMatchesOfXPath:(NSString *)xpath inResourceOfType:(NSString *)type
+{
+    NSString *path = [[NSBundle mainBundle] pathForResource:@"test" ofType:type];
+    NSMutableArray *matches = [NSMutableArray array];
+    void (^collect)(NSMutableDictionary *, BOOL *) = ^(NSMutableDictionary *element, BOOL *stop) {
+        [matches addObject:element];
+    };
+
+    BOOL success = [type isEqualToString:@"json"] ? [PrestoData enumerateMatchesOfXPath:xpath inJSONStream:[NSInputStream inputStreamWithFileAtPath:path] usingBlock:collect] : [PrestoData enumerateMatchesOfXPath:xpath inXMLStream:[NSInputStream inputStreamWithFileAtPath:path] usingBlock:collect];
+    XCTAssert(success);
+    return matches;
+}
+
+- (NSArray *)treeMatchesOfXPath:(NSString *)xpath inResourceOfType:(NSString *)type
+{
+    NSData *data = [NSData dataWithContentsOfFile:[[NSBundle mainBundle] pathForResource:@"test" ofType:type]];
+    NSMutableDictionary *dictionary = [type isEqualToString:@"json"] ? [NSMutableDictionary pd_dictionaryFromJSONData:data] : [NSMutableDictionary pd_dictionaryFromXMLData:data];
+    return [dictionary pd_filterWithXPath:xpath];
+}
+
+- (void)testStreamedMatchesEqualTreeMatches
+{
+    NSArray *queries = @[@"//book[@category='WEB']", @"/bookstore/book/title", @"//title[@lang='en']", @"//book[price>35]", @"//author"];
+
+    for (NSString *type in @[@"json", @"xml"])
+    {
+        for (NSString *query in queries)
+        {
+            NSArray *streamed = [self streamedMatchesOfXPath:query inResourceOfType:type];
+            NSArray *tree = [self treeMatchesOfXPath:query inResourceOfType:type];
+            XCTAssertEqual(streamed.count, tree.count, @"%@ in %@", query, type);
+
+            for (NSUInteger i = 0; i < MIN(streamed.count, tree.count); i++)
+            {
+                XCTAssert([streamed[i] pd_isEqualToDictionary:tree[i]], @"%@ in %@", query, type);
+            }
+        }
+    }
+}
+
+- (void)testNestedMatchesAndStopping
+{
+    NSData *xmlData = [@"<a><item id=\"1\"><item id=\"2\"/></item><item id=\"3\"/></a>" dataUsingEncoding:NSUTF8StringEncoding];
+    NSMutableArray *ids = [NSMutableArray array];
+    BOOL success = [PrestoData enumerateMatchesOfXPath:@"//item" inXMLStream:[NSInputStream inputStreamWithData:xmlData] usingBlock:^(NSMutableDictionary *element, BOOL *stop) {
+        [ids addObject:element[@"id"]];
+    }];
+    XCTAssert(success);
+    NSArray *expectedIds = @[@"2", @"1", @"3"];
+    XCTAssertEqualObjects(ids, expectedIds);
+
+    NSData *jsonData = [@"[{\"item\":[{\"id\":1},{\"id\":2},{\"id\":3}]}]" dataUsingEncoding:NSUTF8StringEncoding];
+    __block NSUInteger count = 0;
+    success = [PrestoData enumerateMatchesOfXPath:@"item" inJSONStream:[NSInputStream inputStreamWithData:jsonData] usingBlock:^(NSMutableDictionary *element, BOOL *stop) {
+        count++;
+        *stop = [element[@"id"] isEqual:@2];
+    }];
+    XCTAssert(success);
+    XCTAssertEqual(count, 2);
+}
+
+- (void)testUnsupportedQueriesAndMalformedInput
+{
+    void (^ignore)(NSMutableDictionary *, BOOL *) = ^(NSMutableDictionary *element, BOOL *stop) {};
+    NSData *jsonData = [@"{\"book\":{\"title\":\"Dune\"}}" dataUsingEncoding:NSUTF8StringEncoding];
+
+    XCTAssertFalse([PrestoData enumerateMatchesOfXPath:@"//book[2]" inJSONStream:[NSInputStream inputStreamWithData:jsonData] usingBlock:ignore]);
+    XCTAssertFalse([PrestoData enumerateMatchesOfXPath:@"//book[last()]" inJSONStream:[NSInputStream inputStreamWithData:jsonData] usingBlock:ignore]);
+    XCTAssertFalse([PrestoData enumerateMatchesOfXPath:@"(//book)" inJSONStream:[NSInputStream inputStreamWithData:jsonData] usingBlock:ignore]);
+    XCTAssertFalse([PrestoData enumerateMatchesOfXPath:@"//book" inJSONStream:[NSInputStream inputStreamWithData:[@"{\"book\":{" dataUsingEncoding:NSUTF8StringEncoding]] usingBlock:ignore]);
+    XCTAssertTrue([PrestoData enumerateMatchesOfXPath:@"//book" inJSONStream:[NSInputStream inputStreamWithData:jsonData] usingBlock:ignore]);
+}
+
+@end
@@ -0,0 +1,145 @@
+//
+// PrestoDataWriterTests.m
+//
+// Copyright (c) 2015 Daniel Hall
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+
+#import <XCTest/XCTest.h>
+#import "NSMutableDictionary+PrestoData.h"
+#import "NSMutableDictionary+_PrestoData_Internal.h"
+#import "NSArray+PrestoData.h"
+
+@interface PrestoDataWriterTests : XCTestCase
+
+@end
+
+@implementation PrestoDataWriterTests
+
+- (void)testCompactJSONRoundTrip
+{
+    NSData *jsonData = [NSData dataWithContentsOfFile:[[NSBundle mainBundle] pathForResource:@"test" ofType:@"json"]];
+    NSMutableDictionary *dictionary = [NSMutableDictionary pd_dictionaryFromJSONData:jsonData];
+    NSData *compactData = [dictionary pd_jsonDataWithOptions:PDWritingOptionsCompact];
+    NSString *compactString = [[NSString alloc] initWithData:compactData encoding:NSUTF8StringEncoding];
+    XCTAssertEqual([compactString rangeOfString:@"\n"].location, NSNotFound, @"compact output shouldn't contain line breaks");
+    XCTAssert([[NSMutableDictionary pd_dictionaryFromJSONData:compactData] pd_isEqualToDictionary:dictionary], @"compact JSON didn't round trip");
+    XCTAssert([[NSMutableDictionary pd_dictionaryFromJSONData:[dictionary.pd_jsonString dataUsingEncoding:NSUTF8StringEncoding]] pd_isEqualToDictionary:dictionary], @"pretty JSON didn't round trip");
+}
+
+- (void)testJSONEscaping
+{
+    NSMutableDictionary *dictionary = [NSMutableDictionary dictionary];
+    [dictionary pd_setValue:@"say \"hi\"\n\\ café \U0001F600" forAttribute:@"quote"];
+    [dictionary pd_setValue:@YES forAttribute:@"flag"];
+    [dictionary pd_setValue:@2.5 forAttribute:@"ratio"];
+    NSString *json = [[NSString alloc] initWithData:[dictionary pd_jsonDataWithOptions:PDWritingOptionsCompact] encoding:NSUTF8StringEncoding];
+    XCTAssertEqualObjects(json, @"{\"quote\":\"say \\\"hi\\\"\\n\\\\ café \U0001F600\",\"flag\":true,\"ratio\":2.5}");
+}
+
+- (void)testXMLEscapingRoundTrip
+{
+    NSMutableDictionary *root = [NSMutableDictionary dictionary];
+    NSMutableDictionary *element = [NSMutableDictionary dictionary];
+    [element pd_setValue:@"a < b & \"c\"" forAttribute:@"expression"];
+    [element pd_setValue:@42 forAttribute:@"count"];
+    [element pd_setInnerValue:@"x > y & z"];
+    [root pd_addElement:element withName:@"formula"];
+
+    NSString *xml = root.pd_xmlString;
+    XCTAssertEqualObjects(xml, @"<formula expression=\"a &lt; b &amp; &quot;c&quot;\" count=\"42\">x &gt; y &amp; z</formula>\n");
+
+    NSMutableDictionary *parsed = [NSMutableDictionary pd_dictionaryFromXMLData:[root pd_xmlDataWithOptions:PDWritingOptionsCompact | PDWritingOptionsXMLDeclaration]];
+    XCTAssertEqualObjects(parsed[@"formula"][@"expression"], @"a < b & \"c\"");
+    XCTAssertEqualObjects([parsed[@"formula"] pd_innerValue], @"x > y & z");
+}
+
+- (void)testWritingToStream
+{
+    NSString *xmlPath = [[NSBundle mainBundle] pathForResource:@"test" ofType:@"xml"];
+    NSMutableDictionary *dictionary = [NSMutableDictionary pd_dictionaryFromXMLData:[NSData dataWithContentsOfFile:xmlPath]];
+
+    NSOutputStream *stream = [NSOutputStream outputStreamToMemory];
+    [stream open];
+    NSError *error = nil;
+    XCTAssert([dictionary pd_writeXMLToStream:stream options:PDWritingOptionsNone error:&error], @"writing failed: %@", error);
+    NSData *written = [stream propertyForKey:NSStreamDataWrittenToMemoryStreamKey];
+    [stream close];
+
+    XCTAssertEqualObjects(written, [dictionary pd_xmlDataWithOptions:PDWritingOptionsNone]);
+    XCTAssert([[NSMutableDictionary pd_dictionaryFromXMLData:written] pd_isEqualToDictionary:dictionary], @"XML didn't round trip");
+}
+
+- (void)testWritingToClosedStreamFails
+{
+    NSMutableDictionary *dictionary = [NSMutableDictionary dictionary];
+    [dictionary pd_setValue:@"value" forAttribute:@"key"];
+
+    NSOutputStream *stream = [NSOutputStream outputStreamToMemory];
+    NSError *error = nil;
+    XCTAssertFalse([dictionary pd_writeJSONToStream:stream options:PDWritingOptionsNone error:&error]);
+    XCTAssertEqualObjects(error.domain, PrestoDataErrorDomain);
+    XCTAssertEqual(error.code, PrestoDataErrorWriteFailed);
+}
+
+- (void)testUnchangedDictionariesAreWrittenFromSource
+{
+    NSString *library = @"{\"name\":\"main\",\"shelf\":[{\"id\":1,\"title\":\"A\"},{\"id\":2,\"title\":\"B\"}]}";
+    NSString *owner = @"{\"name\":\"Ann\"}";
+    NSString *json = [NSString stringWithFormat:@"{\"library\":%@,\"owner\":%@}", library, owner];
+    NSData *data = [json dataUsingEncoding:NSUTF8StringEncoding];
+
+    NSMutableDictionary *dictionary = [NSMutableDictionary pd_dictionaryFromJSONData:data options:PDParsingOptionsPreserveSource];
+    XCTAssertEqualObjects([dictionary pd_jsonDataWithOptions:PDWritingOptionsCompact], data, @"An unchanged document should be written as it was read");
+
+    [dictionary[@"owner"] pd_setValue:@"Bea" forAttribute:@"name"];
+    NSString *written = [[NSString alloc] initWithData:[dictionary pd_jsonDataWithOptions:PDWritingOptionsCompact] encoding:NSUTF8StringEncoding];
+    XCTAssert([written rangeOfString:library].location != NSNotFound, @"The unchanged subtree should be copied from its source: %@", written);
+    XCTAssert([written rangeOfString:owner].location == NSNotFound, @"The changed dictionary should be written again: %@", written);
+
+    NSMutableDictionary *parsed = [NSMutableDictionary pd_dictionaryFromJSONData:[written dataUsingEncoding:NSUTF8StringEncoding]];
+    XCTAssert([parsed pd_isEqualToDictionary:dictionary], @"JSON didn't round trip");
+    XCTAssertEqualObjects(parsed[@"owner"][@"name"], @"Bea");
+
+    // Changing an array of elements changes the dictionary that holds it
+    NSMutableDictionary *shelves = dictionary[@"library"];
+    [shelves pd_removeElement:shelves[@"shelf"][0]];
+    written = [[NSString alloc] initWithData:[dictionary pd_jsonDataWithOptions:PDWritingOptionsCompact] encoding:NSUTF8StringEncoding];
+    XCTAssert([written rangeOfString:library].location == NSNotFound, @"The changed subtree should be written again: %@", written);
+    XCTAssert([written rangeOfString:@"{\"id\":2,\"title\":\"B\"}"].location != NSNotFound, @"The remaining element should still be written: %@", written);
+}
+
+- (void)testSourceIsOnlyCopiedWhenWrittenTheSameWay
+{
+    NSString *json = @"{ \"library\" : {\"name\":\"main\",\"closed\":null,\"rating\":1.50},\n  \"owner\":{\"name\":\"Ann\"}, \"shelf\":{\"innerValue\":\"A\"} }";
+    NSData *data = [json dataUsingEncoding:NSUTF8StringEncoding];
+    NSMutableDictionary *plain = [NSMutableDictionary pd_dictionaryFromJSONData:data];
+
+    for (NSNumber *options in @[@(PDParsingOptionsPreserveSource), @(PDParsingOptionsPreserveSource | PDParsingOptionsLazy)])
+    {
+        NSMutableDictionary *dictionary = [NSMutableDictionary pd_dictionaryFromJSONData:data options:options.unsignedIntegerValue];
+        NSString *compact = [[NSString alloc] initWithData:[dictionary pd_jsonDataWithOptions:PDWritingOptionsCompact] encoding:NSUTF8StringEncoding];
+        XCTAssertEqualObjects(compact, @"{\"library\":{\"name\":\"main\",\"rating\":1.5},\"owner\":{\"name\":\"Ann\"},\"shelf\":\"A\"}", @"Whitespace, nulls and long numbers shouldn't be copied from the source");
+        XCTAssertEqualObjects([dictionary pd_jsonDataWithOptions:PDWritingOptionsNone], [plain pd_jsonDataWithOptions:PDWritingOptionsNone], @"Pretty output should be indented as usual");
+    }
+}
+
+@end
@@ -0,0 +1,104 @@
+//
+// PrestoDataXMLTests.m
+//
+// Copyright (c) 2015 Daniel Hall
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+
+#import <XCTest/XCTest.h>
+#import "NSMutableDictionary+PrestoData.h"
+#import "NSMutableDictionary+_PrestoData_Internal.h"
+#import "NSNumber+_PrestoData_Internal.h"
+
+@interface PrestoDataXMLTests : XCTestCase
+
+@end
+
+@implementation PrestoDataXMLTests
+
+- (NSMutableDictionary *)dictionaryFromXMLString:(NSString *)xml
+{
+    return [NSMutableDictionary pd_dictionaryFromXMLData:[xml dataUsingEncoding:NSUTF8StringEncoding]];
+}
+
+- (void)testAttributesKeepDocumentOrder
+{
+    NSMutableDictionary *dictionary = [self dictionaryFromXMLString:@"<book zeta=\"1\" alpha=\"2\" mid=\"a &amp; b\" empty=\"\"><title/></book>"];
+    NSMutableDictionary *book = dictionary[@"book"];
+    NSArray *expectedKeys = @[@"zeta", @"alpha", @"mid", @"title"];
+    XCTAssertEqualObjects(book.pd_orderedKeys, expectedKeys);
+    XCTAssertEqualObjects(book[@"zeta"], @"1");
+    XCTAssertEqualObjects(book[@"mid"], @"a & b");
+}
+
+- (void)testInnerValues
+{
+    NSMutableDictionary *dictionary = [self dictionaryFromXMLString:@"<root><count> 42 </count><price>-3.25</price><code>1e3</code><name>\n  Dune  \n</name><mixed>one<child>two</child>three</mixed><data><![CDATA[<raw>]]></data><blank>   </blank></root>"];
+    NSMutableDictionary *root = dictionary[@"root"];
+    XCTAssertEqualObjects([root[@"count"] pd_innerValue], @42);
+    XCTAssertEqualObjects([root[@"price"] pd_innerValue], @-3.25);
+    XCTAssertEqualObjects([root[@"code"] pd_innerValue], @1000);
+    XCTAssertEqualObjects([root[@"name"] pd_innerValue], @"Dune");
+    XCTAssertEqualObjects([root[@"mixed"] pd_innerValue], @"onethree");
+    XCTAssertEqualObjects([root[@"mixed"][@"child"] pd_innerValue], @"two");
+    XCTAssertEqualObjects([root[@"data"] pd_innerValue], @"<raw>");
+    XCTAssertNil([root[@"blank"] pd_innerValue]);
+}
+
+- (void)testDecimalNumberDetection
+{
+    const char *numbers[] = { "7", "007", "-12", "+5", "2.5", ".5", "6.02e23", "12345678901234567890" };
+    for (NSUInteger i = 0; i < sizeof(numbers) / sizeof(numbers[0]); i++)
+    {
+        NSNumber *number = [NSNumber pd_numberFromDecimalBytes:(const uint8_t *)numbers[i] length:strlen(numbers[i])];
+        XCTAssertNotNil(number, @"%s", numbers[i]);
+        XCTAssertEqualWithAccuracy(number.doubleValue, strtod(numbers[i], NULL), fabs(strtod(numbers[i], NULL)) * 1e-15, @"%s", numbers[i]);
+    }
+
+    const char *notNumbers[] = { "", "-", ".", "1.2.3", "1e", "12abc", "1,000", "0x10", " 1" };
+    for (NSUInteger i = 0; i < sizeof(notNumbers) / sizeof(notNumbers[0]); i++)
+    {
+        XCTAssertNil([NSNumber pd_numberFromDecimalBytes:(const uint8_t *)notNumbers[i] length:strlen(notNumbers[i])], @"%s", notNumbers[i]);
+    }
+
+    XCTAssertEqual(strcmp([[NSNumber pd_numberFromDecimalBytes:(const uint8_t *)"-12" length:3] objCType], @encode(long long)), 0);
+}
+
+- (void)testStreamMatchesData
+{
+    NSString *xmlPath = [[NSBundle mainBundle] pathForResource:@"test" ofType:@"xml"];
+    NSMutableDictionary *fromData = [NSMutableDictionary pd_dictionaryFromXMLData:[NSData dataWithContentsOfFile:xmlPath]];
+    NSMutableDictionary *fromFile = [NSMutableDictionary pd_dictionaryFromXMLFileAtPath:xmlPath];
+    NSMutableDictionary *fromStream = [NSMutableDictionary pd_dictionaryFromXMLStream:[NSInputStream inputStreamWithFileAtPath:xmlPath]];
+
+    XCTAssertNotNil(fromData);
+    XCTAssert([fromFile pd_isEqualToDictionary:fromData]);
+    XCTAssert([fromStream pd_isEqualToDictionary:fromData]);
+}
+
+- (void)testMalformedXMLReturnsNil
+{
+    XCTAssertNil([self dictionaryFromXMLString:@"<root><open></root>"]);
+    XCTAssertNil([self dictionaryFromXMLString:@""]);
+    XCTAssertNil([NSMutableDictionary pd_dictionaryFromXMLFileAtPath:@"/nonexistent/file.xml"]);
+}
+
+@end
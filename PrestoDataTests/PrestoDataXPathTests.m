@@ -26,6 +26,8 @@
 #import "NSMutableDictionary+PrestoData.h"
 #import "NSMutableDictionary+_PrestoData_Internal.h"
 #import "NSArray+PrestoData.h"
+#import "PDXPathQuery.h"
+#import "PDNameMatcher.h"
 
 @interface PrestoDataXPathTests : XCTestCase
 
@@ -170,6 +172,152 @@
     XCTAssert([results pd_isEqualToArray:expectedResults], @"didn't get expected results");
 }
 
+-(void)testCompiledQueryIsCachedAndReusable
+{
+    PDXPathQuery *query = [PDXPathQuery queryWithString:@"//book[@category = 'WEB']/title"];
+    XCTAssertEqual(query, [PDXPathQuery queryWithString:@"//book[@category = 'WEB']/title"], @"compiled query wasn't reused");
+    NSArray *fromDictionary = [query evaluateOnDictionary:self.dictionary];
+    NSArray *fromArray = [query evaluateOnArray:@[self.dictionary]];
+    XCTAssertEqual(fromDictionary.count, 2);
+    XCTAssert([fromDictionary pd_isEqualToArray:fromArray], @"didn't get expected results");
+    XCTAssertNil([PDXPathQuery queryWithString:@"/bookstore/book[1"], @"unterminated predicate should not compile");
+}
+
+-(void)testPredicateExpressions
+{
+    NSArray *results = [self.dictionary pd_filterWithXPath:@"//book[price > 35 and @category = 'WEB']/title"];
+    XCTAssertEqual(results.count, 2);
+    results = [self.dictionary pd_filterWithXPath:@"//book[year = 2005 or price div 2 < 20]/year"];
+    XCTAssertEqual(results.count, 3);
+    results = [self.dictionary pd_filterWithXPath:@"/bookstore/book[position() mod 2 = 0][last()]/title"];
+    XCTAssertEqualObjects([results.firstObject pd_innerValue], @"Learning XML");
+
+    NSMutableDictionary *library = [NSMutableDictionary dictionary];
+    NSMutableDictionary *book = [NSMutableDictionary dictionary];
+    [book pd_setValue:@"Don't Panic" forAttribute:@"title"];
+    [library pd_addElement:book withName:@"book"];
+    results = [library pd_filterWithXPath:@"//book[@title = \"Don't Panic\"]"];
+    XCTAssertEqual(results.count, 1, @"quotes in values shouldn't break comparisons");
+    XCTAssertNil([PDXPathQuery queryWithString:@"//book[contains(@title, 'Panic')]"], @"unsupported functions should not compile");
+}
+
+-(void)testNameMatcherPatterns
+{
+    XCTAssert([[PDNameMatcher matcherWithPattern:@" title "] matchesName:@"title"]);
+    XCTAssertFalse([[PDNameMatcher matcherWithPattern:@"title"] matchesName:@"titles"]);
+    XCTAssert([[PDNameMatcher matcherWithPattern:@"*"] matchesName:@"anything"]);
+    XCTAssert([[PDNameMatcher matcherWithPattern:@"item*"] matchesName:@"itemCount"]);
+    XCTAssertFalse([[PDNameMatcher matcherWithPattern:@"item*"] matchesName:@"lineItem"]);
+    XCTAssert([[PDNameMatcher matcherWithPattern:@"*g"] matchesName:@"lang"]);
+    XCTAssert([[PDNameMatcher matcherWithPattern:@"a*b*c"] matchesName:@"aXbYbZc"]);
+    XCTAssertFalse([[PDNameMatcher matcherWithPattern:@"a*b*c"] matchesName:@"aXbYcZ"]);
+    XCTAssert([[PDNameMatcher matcherWithPattern:@"t?tle"] matchesName:@"title"]);
+    XCTAssertFalse([[PDNameMatcher matcherWithPattern:@"t?tle"] matchesName:@"ttle"]);
+    XCTAssertFalse([[PDNameMatcher matcherWithPattern:@"a.c"] matchesName:@"abc"], @"only * and ? are wildcards");
+
+    NSArray *results = [self.dictionary pd_filterWithXPath:@"//b*k/t*"];
+    XCTAssertEqual(results.count, 4);
+}
+
+-(void)testElementIndex
+{
+    NSData *jsonData = [@"{\"a\":{\"item\":{\"id\":\"1\",\"item\":{\"id\":\"2\"}},\"b\":{\"item\":{\"id\":\"3\"}}},\"item\":{\"id\":\"4\"}}" dataUsingEncoding:NSUTF8StringEncoding];
+    NSMutableDictionary *indexed = [NSMutableDictionary pd_dictionaryFromJSONData:jsonData options:PDParsingOptionsIndexElements];
+    NSMutableDictionary *plain = [NSMutableDictionary pd_dictionaryFromJSONData:jsonData];
+
+    // Nested elements come back in document order, with or without the index
+    XCTAssertEqualObjects([[indexed pd_filterWithXPath:@"//item"] valueForKey:@"id"], (@[@"1", @"2", @"3", @"4"]));
+    XCTAssertEqualObjects([[plain pd_filterWithXPath:@"//item"] valueForKey:@"id"], (@[@"1", @"2", @"3", @"4"]));
+    XCTAssertEqualObjects([[indexed pd_filterWithXPath:@"/a/b//item"] valueForKey:@"id"], (@[@"3"]));
+
+    // Additions and removals keep the index in step with the tree
+    for (NSMutableDictionary *dictionary in @[indexed, plain])
+    {
+        [[dictionary pd_filterWithXPath:@"/a/item"].firstObject pd_addElement:[@{@"id": @"5"} mutableCopy] withName:@"item"];
+        [[dictionary pd_filterWithXPath:@"/a/b"].firstObject pd_addElement:[@{@"id": @"6"} mutableCopy] withName:@"item"];
+        [[dictionary pd_filterWithXPath:@"//item[@id='3']"].firstObject pd_removeFromParentDictionary];
+        [dictionary[@"a"] pd_removeElementNamed:@"b"];
+    }
+    XCTAssertEqualObjects([[indexed pd_filterWithXPath:@"//item"] valueForKey:@"id"], (@[@"1", @"2", @"5", @"4"]));
+    XCTAssertEqualObjects([[indexed pd_filterWithXPath:@"/a//item"] valueForKey:@"id"], [[plain pd_filterWithXPath:@"/a//item"] valueForKey:@"id"]);
+    XCTAssertNil([indexed pd_filterWithXPath:@"//b"]);
+
+    // Removing repeated siblings from the front, and adding an element that sorts before the rest of its list, keep the order too
+    NSMutableDictionary *list = [NSMutableDictionary dictionary];
+    NSMutableArray *expectedRows = [NSMutableArray array];
+    for (NSUInteger i = 0; i < 50; i++)
+    {
+        NSString *rowID = [NSString stringWithFormat:@"r%lu", (unsigned long)i];
+        [list pd_addElement:[@{@"id": rowID} mutableCopy] withName:@"row"];
+        if (i >= 40)
+        {
+            [expectedRows addObject:rowID];
+        }
+    }
+    [indexed pd_addElement:list withName:@"list"];
+    for (NSUInteger i = 0; i < 40; i++)
+    {
+        [indexed[@"list"][@"row"][0] pd_removeFromParentDictionary];
+    }
+    XCTAssertEqualObjects([[indexed pd_filterWithXPath:@"//row"] valueForKey:@"id"], expectedRows);
+    [indexed[@"a"] pd_addElement:[@{@"id": @"first"} mutableCopy] withName:@"row"];
+    [expectedRows insertObject:@"first" atIndex:0];
+    XCTAssertEqualObjects([[indexed pd_filterWithXPath:@"//row"] valueForKey:@"id"], expectedRows);
+    [indexed pd_removeElementNamed:@"list"];
+
+    [indexed pd_discardElementIndex];
+    XCTAssertEqualObjects([[indexed pd_filterWithXPath:@"//item"] valueForKey:@"id"], (@[@"1", @"2", @"5", @"4"]));
+}
+
+-(void)testConcurrentEvaluationMatchesSerial
+{
+    NSMutableDictionary *records = [NSMutableDictionary dictionary];
+    for (NSUInteger i = 0; i < 20000; i++)
+    {
+        NSMutableDictionary *record = [NSMutableDictionary dictionary];
+        [record pd_setValue:[NSString stringWithFormat:@"%lu", (unsigned long)i] forAttribute:@"id"];
+        [record pd_setValue:i % 3 ? @"open" : @"closed" forAttribute:@"status"];
+        [record pd_addElement:[NSMutableDictionary dictionary] withName:@"entry"];
+        [records pd_addElement:record withName:@"record"];
+    }
+    NSMutableDictionary *dictionary = [NSMutableDictionary dictionary];
+    [dictionary pd_addElement:records withName:@"records"];
+
+    for (NSString *query in @[@"//record[@status='closed']", @"/records/record[position() mod 7 = 0]", @"//record/entry", @"/records/record[last()]"])
+    {
+        NSArray *serial = [dictionary pd_filterWithXPath:query];
+        NSArray *concurrent = [dictionary pd_filterWithXPath:query options:PDXPathOptionsConcurrent];
+        XCTAssertTrue(serial.count > 0, @"%@", query);
+        XCTAssertEqual(serial.count, concurrent.count, @"%@", query);
+        for (NSUInteger i = 0; i < serial.count; i++)
+        {
+            XCTAssertEqual(serial[i], concurrent[i], @"%@ should return the same elements in the same order", query);
+        }
+    }
+}
+
+- (void)testNumberConversionFollowsXPathGrammar
+{
+    NSMutableDictionary *values = [NSMutableDictionary dictionary];
+    for (NSString *text in @[@" 42 ", @"-0.5", @".25", @"+1", @"1e3", @"4 2", @"12345678901234567890123"])
+    {
+        NSMutableDictionary *value = [NSMutableDictionary dictionary];
+        [value pd_setValue:text forAttribute:@"text"];
+        [values pd_addElement:value withName:@"value"];
+    }
+    [[values pd_childrenNamed:@"value"].lastObject pd_setValue:@(12345678901234567890123.0) forAttribute:@"exact"];
+    NSMutableDictionary *dictionary = [NSMutableDictionary dictionary];
+    [dictionary pd_addElement:values withName:@"values"];
+
+    XCTAssertEqual([dictionary pd_filterWithXPath:@"/values/value[@text = 42]"].count, 1);
+    XCTAssertEqual([dictionary pd_filterWithXPath:@"/values/value[@text = -0.5]"].count, 1);
+    XCTAssertEqual([dictionary pd_filterWithXPath:@"/values/value[@text = 0.25]"].count, 1);
+    XCTAssertEqual([dictionary pd_filterWithXPath:@"/values/value[@text = 1]"].count, 0, @"A plus sign isn't part of an XPath number");
+    XCTAssertEqual([dictionary pd_filterWithXPath:@"/values/value[@text = 1000]"].count, 0, @"An exponent isn't part of an XPath number");
+    XCTAssertEqual([dictionary pd_filterWithXPath:@"/values/value[@text = 42 or @text = 4 or @text = 2]"].count, 1);
+    XCTAssertEqual([dictionary pd_filterWithXPath:@"/values/value[@text = @exact]"].count, 1, @"Long numbers should be correctly rounded");
+}
+
 - (NSMutableDictionary *)dictionary
 {
     NSString *xmlPath = [[NSBundle mainBundle] pathForResource:@"test" ofType:@"xml"];